@@ -3,6 +3,10 @@
 #
 # This watches canvas.txt and automatically tells boxes-live to reload
 # when changes are detected (simulates live plugin updates)
+#
+# boxes-live can now do this itself: run it as
+#   boxes-live --watch demo_canvas.txt
+# and it reloads the file whenever it is rewritten, no signal needed.
 
 set -e
 
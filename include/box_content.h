@@ -0,0 +1,114 @@
+#ifndef BOX_CONTENT_H
+#define BOX_CONTENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+/* ============================================================
+ * Box Content - contiguous line-indexed content buffers
+ *
+ * All lines of a box live in one block with an offset per
+ * line, so line access, line length and line count are O(1),
+ * building content costs a handful of allocations and freeing
+ * it is a single call. Buffers are reference counted: undo
+ * snapshots share the box's buffer, and the box copies it the
+ * first time it writes while shared.
+ *
+ * The command runner and the file watch fill one buffer in place
+ * for all the boxes showing a run or a file, and mark it live while
+ * they do. Anything that must keep the lines as they are now, such
+ * as an undo snapshot, takes content_buffer_freeze() of it.
+ *
+ * Everything outside this module reads content through the
+ * box_content_* accessors rather than the struct fields.
+ *
+ * Ring buffers keep only the newest lines within fixed line and
+ * byte limits: appends are O(1) and never allocate, and line i is
+ * always the i-th oldest line still held.
+ *
+ * A box showing a large file has a FileMap instead of a buffer;
+ * the box_content_* accessors read through it, and any write
+ * replaces it with an ordinary buffer.
+ * ============================================================ */
+
+/* Create an empty buffer sized for roughly 'lines' lines of 'bytes' total
+ * (hints may be 0; returns NULL on allocation failure). Starts with one reference. */
+ContentBuffer *content_buffer_create(int lines, size_t bytes);
+
+/* Create an empty ring buffer holding at most max_lines lines in max_bytes
+ * of text (longer lines are cut to fit; returns NULL on allocation failure) */
+ContentBuffer *content_buffer_create_ring(int max_lines, size_t max_bytes);
+
+/* Add a reference (NULL-safe; returns buffer) */
+ContentBuffer *content_buffer_retain(ContentBuffer *buffer);
+
+/* Drop a reference, freeing the buffer with the last one (NULL-safe) */
+void content_buffer_release(ContentBuffer *buffer);
+
+/* Drop all lines but keep the allocated blocks (buffer must be unshared,
+ * or live and written by its producer) */
+void content_buffer_reset(ContentBuffer *buffer);
+
+/* Keep only the first count lines (growable buffers only) */
+void content_buffer_truncate(ContentBuffer *buffer, int count);
+
+/* Append a copy of the first len bytes of line (returns 0, or -1 on error;
+ * buffer must be unshared, or live and written by its producer) */
+int content_buffer_append(ContentBuffer *buffer, const char *line, size_t len);
+
+/* Mark a buffer as filled in place by its producer while shared, or
+ * as finished (NULL-safe) */
+void content_buffer_set_live(ContentBuffer *buffer, bool live);
+
+/* The buffer's lines as they are now: buffer itself with a reference
+ * added, or a private copy if it is live (NULL for NULL, or when the
+ * copy cannot be made) */
+ContentBuffer *content_buffer_freeze(ContentBuffer *buffer);
+
+/* Lines a ring buffer has dropped to make room (0 for other buffers) */
+unsigned long content_buffer_dropped(const ContentBuffer *buffer);
+
+/* Number of lines (0 for NULL) */
+int content_buffer_count(const ContentBuffer *buffer);
+
+/* Line i, or NULL when out of range */
+const char *content_buffer_line(const ContentBuffer *buffer, int i);
+
+/* Length of line i in bytes, or 0 when out of range */
+size_t content_buffer_line_length(const ContentBuffer *buffer, int i);
+
+/* First line at or after start_line containing needle, or -1 */
+int content_buffer_find(const ContentBuffer *buffer, const char *needle, int start_line);
+
+/* Bytes allocated beyond the line text itself (slack, tables, header) */
+size_t content_buffer_overhead(const ContentBuffer *buffer);
+
+/* Number of content lines in a box */
+int box_content_count(const Box *box);
+
+/* Content line i of a box, or NULL when out of range */
+const char *box_content_line(const Box *box, int i);
+
+/* Length of content line i of a box, or 0 when out of range */
+size_t box_content_line_length(const Box *box, int i);
+
+/* First content line at or after start_line containing needle, or -1 */
+int box_content_find(const Box *box, const char *needle, int start_line);
+
+/* Replace a box's content with copies of the given lines (returns 0, or -1) */
+int box_content_set(Box *box, const char **lines, int count);
+
+/* Replace a box's content with a shared reference to buffer (may be NULL) */
+void box_content_share(Box *box, ContentBuffer *buffer);
+
+/* Append one line to a box's content (returns 0, or -1 on error) */
+int box_content_append(Box *box, const char *line);
+
+/* Remove all content lines, keeping the buffer for the next fill if unshared */
+void box_content_reset(Box *box);
+
+/* Release a box's content (content and file_map become NULL) */
+void box_content_clear(Box *box);
+
+#endif /* BOX_CONTENT_H */
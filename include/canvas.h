@@ -9,6 +9,10 @@ int canvas_init(Canvas *canvas, double world_width, double world_height);
 /* Free canvas memory */
 void canvas_cleanup(Canvas *canvas);
 
+/* Pre-size storage for at least box_count boxes and conn_count connections
+ * so bulk loads fill in place without regrowing (returns 0, or -1 on error) */
+int canvas_reserve(Canvas *canvas, int box_count, int conn_count);
+
 /* Add a box to the canvas (returns box ID, or -1 on error) */
 int canvas_add_box(Canvas *canvas, double x, double y, int width, int height, const char *title);
 
@@ -25,12 +29,65 @@ int canvas_remove_box(Canvas *canvas, int box_id);
 /* Get box by ID (returns NULL if not found) */
 Box* canvas_get_box(Canvas *canvas, int box_id);
 
-/* Get box by index (returns NULL if out of bounds) */
+/* Get box by slot index (returns NULL if out of range or free) */
 Box* canvas_get_box_at(Canvas *canvas, int index);
 
+/* Draw-order traversal over box slots, bottom to top:
+ *   for (int i = canvas_draw_first(c); i >= 0; i = canvas_draw_next(c, i))
+ * Returns -1 past the end. Removing other boxes does not move a box's slot. */
+int canvas_draw_first(const Canvas *canvas);
+int canvas_draw_next(const Canvas *canvas, int slot);
+
+/* Get a generation-checked handle to a box (handle.slot is -1 if not found) */
+BoxHandle canvas_box_handle(const Canvas *canvas, int box_id);
+
+/* Resolve a handle (returns NULL if that box has been removed since) */
+Box* canvas_handle_box(Canvas *canvas, BoxHandle handle);
+
 /* Find box at world coordinates (returns box ID, or -1 if none found) */
 int canvas_find_box_at(Canvas *canvas, double x, double y);
 
+/* Collect slot indices of boxes intersecting a world rectangle, sorted in
+ * draw order. *indices is a caller-owned buffer grown with realloc as needed.
+ * Returns the number of indices written, or -1 on allocation failure. */
+int canvas_query_boxes(const Canvas *canvas, double x0, double y0, double x1, double y1,
+                       int **indices, int *capacity);
+
+/* Same result as canvas_query_boxes, computed by one linear pass over the
+ * geometry table (used for wide queries where the grid would visit more
+ * cells than there are boxes) */
+int canvas_scan_boxes(const Canvas *canvas, double x0, double y0, double x1, double y1,
+                      int **indices, int *capacity);
+
+/* Move a box to new world coordinates (keeps geometry and spatial index in sync) */
+int canvas_move_box(Canvas *canvas, int box_id, double x, double y);
+
+/* Resize a box (keeps geometry and spatial index in sync) */
+int canvas_resize_box(Canvas *canvas, int box_id, int width, int height);
+
+/* Re-index a box after its x/y/width/height were written directly */
+void canvas_sync_box_bounds(Canvas *canvas, int box_id);
+
+/* Damage a box's screen area (and note it for the journal) after changing
+ * its fields directly (title, color, type, content); geometry changes
+ * through the calls above already do */
+void canvas_mark_box_dirty(Canvas *canvas, int box_id);
+
+/* As canvas_mark_box_dirty, after changing what a box shows (its
+ * content type, file or command), so the journal writes its content
+ * even when it is not a text box */
+void canvas_mark_box_source(Canvas *canvas, int box_id);
+
+/* Damage a box's screen area only: for command output, run state or a
+ * reread file, which the box shows but the journal does not keep */
+void canvas_redraw_box(Canvas *canvas, int box_id);
+
+/* Damage the whole screen */
+void canvas_mark_all_dirty(Canvas *canvas);
+
+/* Show a message in the status bar (NULL clears it) */
+void canvas_set_status(Canvas *canvas, const char *message);
+
 /* Select a box by ID */
 void canvas_select_box(Canvas *canvas, int box_id);
 
@@ -0,0 +1,82 @@
+#ifndef CANVAS_WATCH_H
+#define CANVAS_WATCH_H
+
+#include <stdbool.h>
+#include "types.h"
+
+/* ============================================================
+ * Canvas Watch - reload the canvas file when it is rewritten
+ *
+ * An alternative to SIGUSR1 (--watch, or watch = true in the
+ * config). The file's directory is watched with inotify, so a
+ * file renamed into place is seen as well as one rewritten in
+ * place. Only a complete write counts: the writer closing the
+ * file, or a rename onto its name. Writes still under way hold
+ * the reload back.
+ *
+ * Bursts are folded into one reload: it fires once the file has
+ * been quiet for CANVAS_WATCH_QUIET seconds, or at the latest
+ * CANVAS_WATCH_MAX_DELAY seconds after the first write it
+ * covers, so a generator rewriting the file all the time gets
+ * a reload at that rate rather than one per write. Files this
+ * process wrote itself (see persistence_save_count()) are
+ * skipped.
+ *
+ * Without inotify, canvas_watch_start() fails and SIGUSR1 still
+ * works.
+ * ============================================================ */
+
+/* Seconds without writes before reloading */
+#define CANVAS_WATCH_QUIET 0.1
+
+/* Longest a stream of writes holds a reload back */
+#define CANVAS_WATCH_MAX_DELAY 0.5
+
+typedef struct {
+    int fd;                 /* inotify descriptor (-1 if not watching) */
+    char *path;             /* File watched (NULL if not watching) */
+    char *name;             /* Its name within its directory */
+    double first_write;     /* First complete write not yet reloaded (-1: none) */
+    double last_event;      /* Latest event on the file */
+    bool writing;           /* Written to since the last complete write */
+    bool own_known;         /* Identity of the file as this process last wrote it */
+    unsigned long long own_dev;
+    unsigned long long own_ino;
+    long long own_size;
+    long long own_mtime_ns;
+} CanvasWatch;
+
+/* Prepare an idle watch */
+void canvas_watch_init(CanvasWatch *watch);
+
+/**
+ * Watch path (stopping any earlier watch).
+ *
+ * @return 0 on success, -1 if its directory cannot be watched
+ */
+int canvas_watch_start(CanvasWatch *watch, const char *path);
+
+/* Stop watching */
+void canvas_watch_stop(CanvasWatch *watch);
+
+/* File being watched (NULL if none) */
+const char *canvas_watch_path(const CanvasWatch *watch);
+
+/* Descriptor to poll for readability (-1 if none) */
+int canvas_watch_fd(const CanvasWatch *watch);
+
+/* Read queued events without blocking; returns how many concerned
+ * the file */
+int canvas_watch_read_events(CanvasWatch *watch, double now);
+
+/* When canvas_watch_due() should next be asked (-1: only after an event) */
+double canvas_watch_next_deadline(const CanvasWatch *watch);
+
+/* True (once) when a complete rewrite has settled and should be
+ * reloaded; false until then, and for a file this process wrote */
+bool canvas_watch_due(CanvasWatch *watch, double now);
+
+/* The file as it is now was written by this process: do not reload it */
+void canvas_watch_ignore_current(CanvasWatch *watch);
+
+#endif /* CANVAS_WATCH_H */
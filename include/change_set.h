@@ -0,0 +1,39 @@
+#ifndef CHANGE_SET_H
+#define CHANGE_SET_H
+
+#include <stdbool.h>
+#include "types.h"
+
+/* ============================================================
+ * Change Set - which boxes and connections changed
+ *
+ * While a journal follows a canvas, canvas mutations note the
+ * IDs they touch here, much as they mark damage for the
+ * renderer. The journal turns the set into records on its next
+ * save and clears it, so a save costs what was edited rather
+ * than the whole canvas. Repeated edits of one box merge into
+ * one entry; a box added and removed between saves leaves
+ * nothing to write.
+ * ============================================================ */
+
+/* Start empty and disabled (no allocation until enabled and used) */
+void change_set_init(ChangeSet *set);
+
+/* Free all memory (and disable) */
+void change_set_free(ChangeSet *set);
+
+/* Forget recorded changes, keeping the set enabled */
+void change_set_clear(ChangeSet *set);
+
+/* Turn recording on or off (turning it off also clears it) */
+void change_set_enable(ChangeSet *set, bool enabled);
+
+/* True if nothing needs writing */
+bool change_set_empty(const ChangeSet *set);
+
+/* Record CHANGE_* flags for a box or a connection (no-op while
+ * disabled; an allocation failure sets 'overflow' instead) */
+void change_set_note_box(ChangeSet *set, int box_id, unsigned int flags);
+void change_set_note_connection(ChangeSet *set, int conn_id, unsigned int flags);
+
+#endif /* CHANGE_SET_H */
@@ -1,6 +1,8 @@
 #ifndef COMMAND_RUNNER_H
 #define COMMAND_RUNNER_H
 
+#include <stdbool.h>
+#include <sys/types.h>
 #include "types.h"
 
 /* Maximum command output size (in bytes) */
@@ -58,4 +60,162 @@ void command_runner_clear(Box *box);
  */
 int command_runner_validate(const char *command);
 
+/* ============================================================
+ * Asynchronous runner
+ *
+ * Commands run under /bin/sh in their own process group with stdout
+ * and stderr on one non-blocking pipe. The main loop watches the pipes
+ * (command_runner_fds) and calls command_runner_poll(), which streams
+ * complete lines into the box, reaps finished children, stops runs
+ * that time out and starts queued runs as slots free up. Jobs refer to
+ * boxes by ID, so boxes may move or be deleted while a command runs.
+ *
+ * Boxes with a refresh_interval are re-run on a schedule from the same
+ * pool. A refresh only starts in a free slot, is skipped while the
+ * box's previous run is still in flight, and gathers its output off
+ * the box so the old content stays up until the new run finishes.
+ *
+ * Stream boxes (command_stream) are for commands that never finish,
+ * such as tail -f: they have no timeout or output limit, and their
+ * output goes into a ring buffer holding the newest
+ * COMMAND_RUNNER_STREAM_LINES lines. A refresh interval on a stream
+ * box restarts it when it has exited.
+ * ============================================================ */
+
+#define COMMAND_RUNNER_MAX_JOBS 32              /* Running plus queued */
+#define COMMAND_RUNNER_DEFAULT_MAX_RUNNING 4    /* Concurrent children */
+#define COMMAND_RUNNER_MAX_RUNNING 16
+#define COMMAND_RUNNER_DEFAULT_TIMEOUT 30       /* Seconds (0 = no limit) */
+#define COMMAND_RUNNER_KILL_GRACE 1.0           /* SIGTERM to SIGKILL, seconds */
+#define COMMAND_RUNNER_LINE_MAX 1024            /* Longer lines are wrapped */
+#define COMMAND_RUNNER_MIN_REFRESH 1            /* Refresh interval range, seconds */
+#define COMMAND_RUNNER_MAX_REFRESH 86400
+#define COMMAND_RUNNER_REFRESH_JITTER 0.1       /* Periods vary by +/- 10% */
+#define COMMAND_RUNNER_REFRESH_SPREAD 1.0       /* First runs spread over this many seconds */
+#define COMMAND_RUNNER_STREAM_LINES 1000        /* Tail kept by stream boxes */
+#define COMMAND_RUNNER_STREAM_BYTES (256 * 1024)
+#define COMMAND_RUNNER_CACHE_TTL 2.0            /* Seconds a finished run's output is reused */
+
+/* A box showing a run's output */
+typedef struct {
+    int id;
+    bool live;              /* Shows output as it arrives; otherwise (refresh) swapped in at exit */
+} CommandJobBox;
+
+/* One run of a box's command */
+typedef struct {
+    bool active;
+    CommandJobBox *boxes;   /* Boxes sharing this run (none once all detached) */
+    int box_count;
+    int box_capacity;
+    char *command;          /* Copy taken when the run was requested */
+    unsigned long seq;      /* Request order, for starting queued runs */
+    pid_t pid;              /* 0 while queued */
+    int fd;                 /* Read end of the output pipe (-1 after EOF) */
+    double stop_at;         /* Timeout deadline (0 = none) */
+    double kill_at;         /* SIGKILL deadline once stopping (0 = not stopping) */
+    CommandState stop_reason;   /* COMMAND_CANCELLED / COMMAND_TIMED_OUT when stopping */
+    char line[COMMAND_RUNNER_LINE_MAX];     /* Incomplete last line */
+    size_t line_len;
+    size_t bytes;           /* Output kept so far */
+    int lines;
+    ContentBuffer *output;  /* Output so far, shared by the run's boxes (a ring for streams) */
+    bool stream;            /* Output goes to a ring buffer, unlimited */
+} CommandJob;
+
+/* Output of a finished run, kept for boxes with the same command */
+typedef struct {
+    char *command;
+    ContentBuffer *output;  /* Exit line included */
+    int exit_code;
+    double finished;        /* Monotonic time the run ended */
+} CommandResult;
+
+/* A command box re-run on a timer */
+typedef struct {
+    int box_id;
+    double due;             /* Monotonic time of the next run */
+} CommandRefresh;
+
+/* Pool of running and queued commands */
+typedef struct {
+    CommandJob jobs[COMMAND_RUNNER_MAX_JOBS];
+    int max_running;        /* Cap on concurrent children */
+    double timeout;         /* Seconds before a run is stopped (0 = never) */
+    unsigned long next_seq;
+
+    CommandRefresh *refresh;    /* Scheduled boxes, unordered */
+    int refresh_count;
+    int refresh_capacity;
+    unsigned int jitter_state;  /* xorshift state for refresh jitter */
+
+    CommandResult *results;     /* Recent finished runs, one per command */
+    int result_count;
+    int result_capacity;
+    double cache_ttl;           /* Seconds results are kept (0 = never reused) */
+} CommandRunner;
+
+/* Initialize an empty runner (max_running and timeout are clamped) */
+void command_runner_init(CommandRunner *runner, int max_running, double timeout);
+
+/* Stop every child, wait for them and free all jobs */
+void command_runner_shutdown(CommandRunner *runner);
+
+/* Runner used by :run / :rerun (NULL = run synchronously) */
+void command_runner_set_global(CommandRunner *runner);
+CommandRunner *command_runner_get_global(void);
+
+/**
+ * Start the box's command in the background, or queue it if max_running
+ * children are already running, or join a run of the same command that
+ * is already in flight. A run already in flight for the box is
+ * cancelled. Clears the box's output and sets its command_state.
+ *
+ * @return 0 if started or queued, -1 on error (no command, too many
+ *         jobs, or the child could not be created)
+ */
+int command_runner_start(CommandRunner *runner, Canvas *canvas, int box_id);
+
+/**
+ * Cancel the box's queued or running command. A running child gets
+ * SIGTERM, then SIGKILL after COMMAND_RUNNER_KILL_GRACE seconds; a run
+ * other boxes share keeps going for them.
+ *
+ * @return 0 if a run was cancelled, -1 if none was in flight
+ */
+int command_runner_cancel(CommandRunner *runner, Canvas *canvas, int box_id);
+
+/**
+ * Read available output, reap exited children, enforce timeouts and
+ * start queued runs. Never blocks. Changed boxes are marked dirty.
+ *
+ * @return Number of boxes whose content or state changed
+ */
+int command_runner_poll(CommandRunner *runner, Canvas *canvas);
+
+/**
+ * Set how often the box's command is re-run (seconds, 0 = manual only)
+ * and schedule or unschedule it. Intervals are clamped to
+ * COMMAND_RUNNER_MIN_REFRESH..COMMAND_RUNNER_MAX_REFRESH.
+ *
+ * @return 0 on success, -1 if the box has no command or memory ran out
+ */
+int command_runner_set_refresh(CommandRunner *runner, Canvas *canvas, int box_id, int interval);
+
+/* Rebuild the schedule from the canvas's boxes (after a load or reload) */
+void command_runner_schedule_canvas(CommandRunner *runner, const Canvas *canvas);
+
+/* Output pipes to watch for readability; returns how many were stored */
+int command_runner_fds(const CommandRunner *runner, int *fds, int max);
+
+/* Monotonic time command_runner_poll() next needs to run without pipe
+ * activity (timeouts, kills, reaping, due refreshes), or -1 if none */
+double command_runner_next_deadline(const CommandRunner *runner);
+
+/* Number of children currently running */
+int command_runner_running(const CommandRunner *runner);
+
+/* True if the box has a queued or running command */
+bool command_runner_busy(const CommandRunner *runner, int box_id);
+
 #endif /* COMMAND_RUNNER_H */
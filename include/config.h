@@ -14,8 +14,16 @@ typedef enum {
 typedef struct {
     /* General settings */
     bool show_visualizer;
-    bool auto_save;
+    bool auto_save;             /* Save edits to the journal every second (implies journal) */
+    bool journal;               /* F2 appends edits to FILE.journal instead of rewriting FILE */
+    bool watch;                 /* Reload the canvas file when it is rewritten (as SIGUSR1) */
+    char control_socket[256];   /* Unix socket programs change the canvas through ("" = none) */
     bool show_welcome_box;      /* Show welcome box on empty canvas start (Issue #47) */
+    int max_fps;                /* Frame rate cap; idle frames are never drawn */
+
+    /* Command boxes (:run / :rerun) */
+    int command_max_running;    /* Commands running at once; more are queued */
+    int command_timeout;        /* Seconds before a command is stopped (0 = never) */
 
     /* Box template settings (Issue #17) */
     int template_square_width;
@@ -0,0 +1,47 @@
+#ifndef CONN_INDEX_H
+#define CONN_INDEX_H
+
+#include "types.h"
+
+/* ============================================================
+ * Connection Index - lookups over canvas->connections
+ *
+ * Maps connection IDs to array positions, (source, dest) pairs
+ * to connection IDs, and each box to the connections touching it,
+ * so edge queries and box deletion cost O(degree) instead of a
+ * scan over every connection.
+ * ============================================================ */
+
+/* Initialize an empty index (no allocation until first insert) */
+void conn_index_init(ConnIndex *index);
+
+/* Free all memory held by the index */
+void conn_index_free(ConnIndex *index);
+
+/* Pre-size for 'count' connections (returns 0 on success, -1 on error) */
+int conn_index_reserve(ConnIndex *index, int count);
+
+/* Index a connection stored at 'position' in the connection array
+ * (returns 0 on success, -1 on allocation failure; index unchanged on failure) */
+int conn_index_insert(ConnIndex *index, const Connection *conn, int position);
+
+/* Unindex a connection (returns 0 if removed, -1 if not indexed) */
+int conn_index_remove(ConnIndex *index, const Connection *conn);
+
+/* Record that a connection moved to a new array position */
+int conn_index_set_position(ConnIndex *index, int conn_id, int position);
+
+/* Array position of a connection (returns -1 if not indexed) */
+int conn_index_position(const ConnIndex *index, int conn_id);
+
+/* Connection ID for a directed (source, dest) pair (returns -1 if none) */
+int conn_index_find_pair(const ConnIndex *index, int source_id, int dest_id);
+
+/* Connection IDs touching a box, in creation order (NULL with *count = 0 if none).
+ * The returned array is owned by the index and invalidated by any change. */
+const int *conn_index_box_edges(const ConnIndex *index, int box_id, int *count);
+
+/* Release the adjacency list of a box that has no connections left */
+void conn_index_drop_box(ConnIndex *index, int box_id);
+
+#endif /* CONN_INDEX_H */
@@ -0,0 +1,110 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+/* ============================================================
+ * Control - change a running canvas over a Unix domain socket
+ *
+ * With --control=PATH (or control_socket = PATH) boxes-live
+ * listens on PATH, and programs change the canvas by writing
+ * commands instead of rewriting the canvas file. The main loop
+ * applies commands between frames, so updates arriving together
+ * are drawn together.
+ *
+ * One command per line, fields separated by spaces; TEXT runs to
+ * the end of the line. Every command gets one reply line, "ok"
+ * with any values, or "err" and a reason. Clients may send many
+ * commands before reading the replies.
+ *
+ *   add X Y W H [TEXT]         ok ID        new text box titled TEXT
+ *   update ID pos X Y          ok           move
+ *   update ID size W H         ok           resize
+ *   update ID title TEXT       ok
+ *   update ID color N          ok           0-7
+ *   update ID type N           ok           0-3 (NOTE, TASK, CODE, STICKY)
+ *   update ID content N        ok           the next N lines replace the content
+ *   update ID append TEXT      ok           add one content line
+ *   delete ID                  ok           box and its connections
+ *   connect SRC DST [COLOR]    ok CONN_ID
+ *   disconnect CONN_ID         ok
+ *   query ID                   ok ID X Y W H COLOR TYPE LINES TITLE
+ *   query                      ok BOXES CONNECTIONS
+ *   batch N                    ok [IDS]     the next N commands, applied in
+ *                                           one pass; IDS are those add and
+ *                                           connect made, in order. On a
+ *                                           failure, "err K REASON" for the
+ *                                           first that failed (K from 1);
+ *                                           the others are still applied.
+ *   ping                       ok
+ *
+ * X and Y are finite numbers within CONTROL_COORD_MAX of 0, and W
+ * and H run from 3 to CONTROL_SIZE_MAX; anything else gets "err"
+ * and leaves the canvas as it was.
+ *
+ * Changes go through the canvas, so the journal saves them, but
+ * they are not on the undo stack.
+ * ============================================================ */
+
+#define CONTROL_COORD_MAX 1e9             /* Largest |X| or |Y| */
+#define CONTROL_SIZE_MAX 10000            /* Largest W or H */
+#define CONTROL_MAX_CLIENTS 8
+#define CONTROL_PASS_MAX 4096           /* Commands applied per client per pass */
+#define CONTROL_READ_AHEAD (256 * 1024) /* Unapplied bytes read from a client */
+#define CONTROL_INPUT_MAX (4 * 1024 * 1024) /* Largest single command (or batch) */
+#define CONTROL_OUTPUT_MAX (4 * 1024 * 1024) /* Unread replies before a client is dropped */
+
+/* One connected client */
+typedef struct {
+    int fd;
+    char *in;               /* Received, not yet applied */
+    size_t in_start;        /* Start of the first unapplied command */
+    size_t in_len;
+    size_t in_capacity;
+    char *out;              /* Replies not yet sent */
+    size_t out_len;
+    size_t out_capacity;
+    bool more;              /* Complete commands left for the next pass */
+    bool stalled;           /* Waiting for the rest of a command */
+    bool closing;           /* Client done sending: close once replies are out */
+    bool failed;            /* Drop the client */
+} ControlClient;
+
+typedef struct {
+    int listen_fd;          /* -1 if not listening */
+    char *path;             /* Socket path, removed on shutdown */
+    ControlClient clients[CONTROL_MAX_CLIENTS];
+    int client_count;
+} ControlServer;
+
+/* Prepare a server that is not listening */
+void control_server_init(ControlServer *server);
+
+/**
+ * Listen on path. A socket left there by a session that is gone is
+ * replaced; one that another session answers on is not.
+ *
+ * @return 0 on success, -1 on error (errno says why)
+ */
+int control_server_listen(ControlServer *server, const char *path);
+
+/* Disconnect every client, stop listening and remove the socket */
+void control_server_shutdown(ControlServer *server);
+
+/* Descriptors to poll for readability; returns how many were stored */
+int control_server_fds(const ControlServer *server, int *fds, int max);
+
+/**
+ * Accept clients, read what they sent, apply complete commands to
+ * canvas and send the replies. Never blocks.
+ *
+ * @return Number of commands applied
+ */
+int control_server_poll(ControlServer *server, Canvas *canvas);
+
+/* True while commands or replies are waiting for the next poll */
+bool control_server_pending(const ControlServer *server);
+
+#endif /* CONTROL_H */
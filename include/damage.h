@@ -0,0 +1,44 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <stdbool.h>
+#include "types.h"
+
+/* ============================================================
+ * Damage - dirty rectangle tracking for incremental redraw
+ *
+ * Mutations record the regions they change; the renderer
+ * erases and redraws only those regions and skips frames with
+ * no damage at all. Overlapping rectangles are merged, and
+ * once the list is full new rectangles are folded into the one
+ * that grows least, so the list never allocates.
+ * ============================================================ */
+
+/* Start with no damage */
+void damage_init(Damage *damage);
+
+/* Forget all damage (after a frame has been drawn) */
+void damage_clear(Damage *damage);
+
+/* Mark everything as damaged */
+void damage_mark_all(Damage *damage);
+
+/* Mark the rectangle [x0, x1) x [y0, y1) as damaged (empty rects are ignored) */
+void damage_mark(Damage *damage, double x0, double y0, double x1, double y1);
+
+/* Add every rectangle of src to dest */
+void damage_merge(Damage *dest, const Damage *src);
+
+/* True when nothing is damaged */
+bool damage_is_empty(const Damage *damage);
+
+/* True when point (x, y) lies in a damaged rectangle */
+bool damage_contains(const Damage *damage, double x, double y);
+
+/* True when [x0, x1) x [y0, y1) overlaps a damaged rectangle */
+bool damage_intersects(const Damage *damage, double x0, double y0, double x1, double y1);
+
+/* Bounding box of all damage (returns false when empty or full) */
+bool damage_bounds(const Damage *damage, DamageRect *bounds);
+
+#endif /* DAMAGE_H */
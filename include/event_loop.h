@@ -0,0 +1,97 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdbool.h>
+
+/* ============================================================
+ * Event Loop - poll()-based wait for input, signals and timers
+ *
+ * The main loop sleeps in poll() until a watched descriptor is
+ * readable (terminal, joystick, signal self-pipe), a timer is
+ * due, or a frame it asked for becomes due. Nothing wakes the
+ * process while the canvas is idle. Frames are paced to a
+ * configurable maximum rate.
+ * ============================================================ */
+
+#define EVENT_LOOP_MAX_FDS 32
+#define EVENT_LOOP_MAX_TIMERS 64
+
+/* Default and allowed range for the frame rate cap */
+#define EVENT_LOOP_DEFAULT_FPS 60
+#define EVENT_LOOP_MIN_FPS 1
+#define EVENT_LOOP_MAX_FPS 240
+
+/* Timer callback (runs on the main thread from event_loop_run_timers) */
+typedef void (*EventTimerFn)(void *ctx);
+
+/* One-shot or repeating timer */
+typedef struct {
+    bool active;
+    double deadline;        /* Monotonic seconds of the next expiry */
+    double interval;        /* Repeat period in seconds (0 = one-shot) */
+    EventTimerFn fn;
+    void *ctx;
+} EventTimer;
+
+/* Descriptors, timers and frame pacing state */
+typedef struct {
+    int fds[EVENT_LOOP_MAX_FDS];
+    bool ready[EVENT_LOOP_MAX_FDS];     /* Readable after the last wait */
+    bool hangup[EVENT_LOOP_MAX_FDS];    /* Closed or invalid after the last wait */
+    int fd_count;
+
+    EventTimer timers[EVENT_LOOP_MAX_TIMERS];
+
+    double frame_interval;  /* Seconds between frames (1 / max FPS) */
+    double last_frame;      /* When the last frame was drawn */
+    unsigned long wakeups;  /* Number of returns from event_loop_wait */
+    double woke_at;         /* When the last wait returned */
+} EventLoop;
+
+/* Monotonic clock in seconds */
+double event_loop_now(void);
+
+/* Initialize with no descriptors or timers */
+void event_loop_init(EventLoop *loop, int max_fps);
+
+/* Change the frame rate cap (clamped to the allowed range) */
+void event_loop_set_max_fps(EventLoop *loop, int max_fps);
+
+/* Watch fd for readability (returns 0, or -1 if full or fd < 0) */
+int event_loop_add_fd(EventLoop *loop, int fd);
+
+/* Stop watching fd (no-op if not watched) */
+void event_loop_remove_fd(EventLoop *loop, int fd);
+
+/* True if fd was readable (or hung up) when the last wait returned */
+bool event_loop_fd_ready(const EventLoop *loop, int fd);
+
+/* True if fd was hung up, in error or closed when the last wait returned */
+bool event_loop_fd_hangup(const EventLoop *loop, int fd);
+
+/* Start a timer firing after 'delay' seconds, then every 'interval'
+ * seconds if interval > 0. Returns a timer ID, or -1 if full. */
+int event_loop_add_timer(EventLoop *loop, double delay, double interval,
+                         EventTimerFn fn, void *ctx);
+
+/* Stop a timer (no-op for unknown or inactive IDs) */
+void event_loop_cancel_timer(EventLoop *loop, int timer_id);
+
+/* Earliest active timer deadline, or -1 if there are none */
+double event_loop_next_deadline(const EventLoop *loop);
+
+/* Run every timer that is due; returns how many fired */
+int event_loop_run_timers(EventLoop *loop);
+
+/* When the next frame may be drawn under the frame rate cap */
+double event_loop_next_frame(const EventLoop *loop);
+
+/* Record that a frame was just drawn */
+void event_loop_frame_drawn(EventLoop *loop);
+
+/* Block until a descriptor is readable, a timer is due, or 'deadline'
+ * (monotonic seconds; < 0 for none) passes. Returns the number of ready
+ * descriptors (0 on timeout or signal), or -1 on error. */
+int event_loop_wait(EventLoop *loop, double deadline);
+
+#endif /* EVENT_LOOP_H */
@@ -0,0 +1,121 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+/* ============================================================
+ * File Map - large files read in place from a read-only mapping
+ *
+ * The file is mmap'ed, never read into memory. Line starts are
+ * indexed lazily with memchr(): opening indexes just enough for a
+ * first screen, the main loop indexes the rest a slice at a time,
+ * and asking for a line past the index extends it on the spot.
+ * The index is sparse (one offset per FILE_MAP_STRIDE lines) and
+ * indexed pages are handed back to the kernel, so memory use
+ * follows what is displayed, not the file size. Lines are copied
+ * out (NUL-terminated) only when asked for, into a small cache.
+ *
+ * Maps are reference counted so boxes showing the same file share
+ * one. A file that grew is remapped in place with file_map_grow(),
+ * keeping the index built so far.
+ *
+ * Reading a mapped page past the end of a file that was truncated
+ * raises SIGBUS, so the file is kept open and checked with fstat()
+ * before each scan and each line copied out. A file found shorter
+ * is treated as ending there: the map is cut to the new size and
+ * indexed again, until the owner remaps it.
+ * ============================================================ */
+
+#define FILE_MAP_STRIDE 64                  /* Lines per index entry */
+#define FILE_MAP_CACHE_LINES 256            /* Materialized lines kept */
+#define FILE_MAP_LINE_MAX 4096              /* Longer lines are cut when materialized */
+#define FILE_MAP_OPEN_INDEX (64 * 1024)     /* Bytes indexed when opening */
+#define FILE_MAP_INDEX_SLICE (8 * 1024 * 1024)  /* Bytes indexed per main loop pass */
+
+/* One materialized line */
+typedef struct {
+    int line;           /* Line number held (-1 = empty) */
+    size_t len;
+    size_t capacity;
+    char *text;
+} FileMapLine;
+
+struct FileMap {
+    const char *data;       /* Mapping (NULL for an empty file) */
+    size_t size;            /* File size in bytes, as far as it is read */
+    size_t mapped;          /* Bytes mapped (size only ever shrinks below it) */
+    int fd;                 /* The mapped file, to notice it shrinking (-1 if none) */
+    bool cut;               /* Found shorter than mapped: the owner should remap it */
+    size_t *marks;          /* Start of line k * FILE_MAP_STRIDE */
+    int mark_count;
+    int mark_capacity;
+    int lines;              /* Lines indexed so far */
+    size_t scanned;         /* Bytes indexed so far */
+    bool complete;          /* Every line indexed */
+    int refs;               /* Owners (boxes, the file watch) */
+    struct FileMap *next_pending;   /* Maps still being indexed */
+    FileMapLine cache[FILE_MAP_CACHE_LINES];
+};
+
+/* Map a file and index its first lines (NULL on error or on
+ * platforms without mmap) */
+FileMap *file_map_open(const char *path);
+
+/* Add a reference (NULL-safe; returns map) */
+FileMap *file_map_retain(FileMap *map);
+
+/* Drop a reference, unmapping and freeing with the last one (NULL-safe) */
+void file_map_close(FileMap *map);
+
+/* Map the file at path again from scratch, as after it was replaced
+ * (returns 0, or -1 on error, leaving the map empty) */
+int file_map_reopen(FileMap *map, const char *path);
+
+/**
+ * Map the file at path again after it grew, keeping the index. The
+ * caller has checked that the old bytes are unchanged. A last line
+ * without a newline is indexed again, as it may have been continued.
+ *
+ * @return 0 on success, -1 if the file shrank or cannot be mapped
+ */
+int file_map_grow(FileMap *map, const char *path);
+
+/* Lines indexed so far (the total once file_map_complete()) */
+int file_map_count(const FileMap *map);
+
+/* True once every line is indexed */
+bool file_map_complete(const FileMap *map);
+
+/* Index up to 'budget' more bytes; returns the bytes scanned */
+size_t file_map_index(FileMap *map, size_t budget);
+
+/**
+ * Line i, NUL-terminated, without its line ending and cut to
+ * FILE_MAP_LINE_MAX bytes. Indexes further first if needed.
+ * The pointer stays valid until FILE_MAP_CACHE_LINES other lines
+ * have been asked for.
+ *
+ * @param len Set to the returned line's length (may be NULL)
+ * @return The line, or NULL past the end of the file
+ */
+const char *file_map_line(FileMap *map, int i, size_t *len);
+
+/* First line at or after start_line containing needle, or -1 */
+int file_map_find(FileMap *map, const char *needle, int start_line);
+
+/* Heap bytes held (index and line cache), not counting the mapping */
+size_t file_map_heap_bytes(const FileMap *map);
+
+/* Called from file_map_index_pending() for each map it advanced */
+typedef void (*FileMapProgressFn)(FileMap *map, void *ctx);
+
+/* True while any open map is not fully indexed */
+bool file_map_pending(void);
+
+/* Index up to 'budget' bytes across the maps still being indexed,
+ * calling progress for each one advanced; returns the maps advanced */
+int file_map_index_pending(size_t budget, FileMapProgressFn progress, void *ctx);
+
+#endif /* FILE_MAP_H */
@@ -1,17 +1,16 @@
 #ifndef FILE_VIEWER_H
 #define FILE_VIEWER_H
 
+#include <stdio.h>
 #include "types.h"
 
-/* Maximum file size to load (in bytes) */
-#define MAX_FILE_SIZE (1024 * 1024)  /* 1 MB */
-
-/* Maximum line length for file content */
-#define MAX_FILE_LINE_LENGTH 1024
+/* Files larger than this (in bytes) are memory-mapped rather than read in */
+#define FILE_VIEWER_MAP_THRESHOLD (1024 * 1024)  /* 1 MB */
 
 /**
  * Load file contents into a box.
- * Sets box->content_type to BOX_CONTENT_FILE and populates box->content.
+ * Sets box->content_type to BOX_CONTENT_FILE and populates box->content,
+ * or box->file_map for files over FILE_VIEWER_MAP_THRESHOLD.
  *
  * @param box The box to load file contents into
  * @param filepath Path to the file to load
@@ -19,6 +18,24 @@
  */
 int file_viewer_load(Box *box, const char *filepath);
 
+/**
+ * Append the lines of f, from its current position, to buffer.
+ * Line endings are stripped; lines are kept whole.
+ *
+ * @param consumed Set to the bytes read up to and including the last newline
+ * @param partial Set if the last line appended had no newline
+ * @return 0 on success, -1 on allocation failure
+ */
+int file_viewer_read_lines(ContentBuffer *buffer, FILE *f, size_t *consumed, bool *partial);
+
+/**
+ * Show a file's lines (content) or mapping (map, if not NULL) in a box,
+ * taking a reference and recording filepath as the box's source.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int file_viewer_attach(Box *box, const char *filepath, ContentBuffer *content, FileMap *map);
+
 /**
  * Reload file contents for a file-type box.
  * Only works if box->content_type == BOX_CONTENT_FILE and box->file_path is set.
@@ -52,4 +69,15 @@ int file_viewer_file_exists(const char *filepath);
  */
 const char *file_viewer_basename(const char *filepath);
 
+/* True while a mapped file is still having its lines indexed */
+bool file_viewer_indexing(void);
+
+/**
+ * Index the next slice of mapped files, redrawing boxes that finished.
+ * Called from the main loop while file_viewer_indexing().
+ *
+ * @param canvas The canvas holding the file boxes
+ */
+void file_viewer_index_step(Canvas *canvas);
+
 #endif /* FILE_VIEWER_H */
@@ -0,0 +1,93 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+/* ============================================================
+ * File Watch - live file boxes
+ *
+ * Every file shown in a box is read once and kept here, shared
+ * by all boxes with the same path, and watched with inotify.
+ * Events only mark a file as changed; the main loop applies the
+ * changes at most once per frame. A file that only grew has just
+ * its new bytes parsed (or, if mapped, is remapped keeping its
+ * line index). Anything else (truncation, a rewrite in place, or
+ * a new file renamed over the old one) is read again from the
+ * start. Updates happen in place, so every box sharing the copy
+ * sees them.
+ *
+ * A mapped file checks its size before each index slice and line
+ * read, since events arrive after the fact. One found cut short is
+ * read again at the next frame, whether or not its event came.
+ *
+ * Without inotify the shared copies still work, and :reload
+ * checks a file by hand.
+ * ============================================================ */
+
+/* Bytes kept from just before the end of the read part of a file,
+ * compared on change to tell an append from a rewrite */
+#define FILE_WATCH_SAMPLE 64
+
+/* One file and the copy of it that boxes share */
+typedef struct {
+    char *path;
+    int wd;                 /* inotify watch descriptor (-1 if none) */
+    ContentBuffer *content; /* Lines read in (NULL when mapped) */
+    FileMap *map;           /* Mapping of a large file (NULL when read in) */
+    size_t size;            /* File size when last read */
+    size_t parsed;          /* Bytes in content up to its last newline */
+    bool partial;           /* content's last line had no newline yet */
+    unsigned long long dev; /* Identity, to spot a file replaced by rename */
+    unsigned long long ino;
+    char sample[FILE_WATCH_SAMPLE];     /* Bytes just before 'size' */
+    size_t sample_len;
+    bool changed;           /* Event seen since changes were last applied */
+    bool updated;           /* Copy changed; its boxes need redrawing */
+} WatchedFile;
+
+typedef struct {
+    int fd;                 /* inotify descriptor (-1 if unavailable) */
+    WatchedFile *files;
+    int count;
+    int capacity;
+} FileWatch;
+
+/* Initialize (returns 0, or -1 if inotify is unavailable; sharing
+ * still works then, without automatic updates) */
+int file_watch_init(FileWatch *watch);
+
+/* Stop watching and release every shared copy */
+void file_watch_shutdown(FileWatch *watch);
+
+/* The watch file_viewer_load() goes through (NULL: boxes read privately) */
+void file_watch_set_global(FileWatch *watch);
+FileWatch *file_watch_get_global(void);
+
+/* Descriptor to poll for readability (-1 if none) */
+int file_watch_fd(const FileWatch *watch);
+
+/**
+ * Show filepath in box, sharing the copy other boxes already show
+ * (brought up to date first) or reading and watching it.
+ *
+ * @return 0 on success, -1 if the file cannot be read
+ */
+int file_watch_load(FileWatch *watch, Box *box, const char *filepath);
+
+/* Switch every file box of a freshly loaded canvas to its live file */
+void file_watch_attach_canvas(FileWatch *watch, Canvas *canvas);
+
+/* Read queued inotify events without blocking; returns how many
+ * files were newly marked as changed */
+int file_watch_read_events(FileWatch *watch);
+
+/* True while changes are waiting for file_watch_apply() */
+bool file_watch_pending(const FileWatch *watch);
+
+/* Bring changed files up to date, redraw the boxes showing them and
+ * drop files no box shows any more; returns files updated */
+int file_watch_apply(FileWatch *watch, Canvas *canvas);
+
+#endif /* FILE_WATCH_H */
@@ -0,0 +1,34 @@
+#ifndef ID_INDEX_H
+#define ID_INDEX_H
+
+#include "types.h"
+
+/* ============================================================
+ * ID Index - open-addressing int -> int hash map
+ *
+ * Used by the canvas to map box IDs to array indices so lookups
+ * by ID are O(1) instead of a linear scan over canvas->boxes.
+ * ============================================================ */
+
+/* Initialize an empty index (no allocation until first insert) */
+void id_index_init(IdIndex *index);
+
+/* Free all memory held by the index */
+void id_index_free(IdIndex *index);
+
+/* Remove all entries but keep the allocated table */
+void id_index_clear(IdIndex *index);
+
+/* Pre-size the table so that 'count' entries fit without rehashing */
+int id_index_reserve(IdIndex *index, int count);
+
+/* Insert or update key -> value (returns 0 on success, -1 on allocation failure) */
+int id_index_put(IdIndex *index, int key, int value);
+
+/* Look up key (returns stored value, or -1 if not present) */
+int id_index_get(const IdIndex *index, int key);
+
+/* Remove key (returns 0 if removed, -1 if not present) */
+int id_index_remove(IdIndex *index, int key);
+
+#endif /* ID_INDEX_H */
@@ -9,6 +9,29 @@
 /* Returns 0 to continue, 1 to quit */
 int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config);
 
+/* Process one key (or KEY_MOUSE) already read with terminal_read_key() */
+/* Returns 0 to continue, 1 to quit */
+int handle_key(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config, int ch);
+
+/* Most keys taken from the terminal in one batch, so a flood of input
+ * still lets frames through */
+#define INPUT_BATCH_MAX 1024
+
+/* Process every key and mouse event already queued (up to INPUT_BATCH_MAX),
+ * coalescing pans, zoom steps and drag motion so the batch costs one
+ * viewport or box update. Stores the number of events read in *events.
+ * Returns 0 to continue, 1 to quit */
+int handle_input_batch(Canvas *canvas, Viewport *vp, JoystickState *js,
+                       const AppConfig *config, int *events);
+
+/* True while a mouse-dragged box has a position not yet applied */
+bool input_drag_pending(void);
+
+/* Move the dragged box to the latest mouse position. Called once per
+ * frame so a drag costs one move (and one spatial index update) per
+ * frame however many motion events arrive. */
+void input_apply_drag(Canvas *canvas);
+
 /* Process joystick input based on current mode */
 /* Returns 0 to continue, 1 to quit */
 int handle_joystick_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config);
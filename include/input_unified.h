@@ -34,6 +34,7 @@ typedef enum {
     ACTION_CREATE_BOX,      /* Create new box */
     ACTION_DELETE_BOX,      /* Delete selected box */
     ACTION_MOVE_BOX,        /* Move/drag box */
+    ACTION_DROP_BOX,        /* Release a dragged box (ends the gesture) */
     
     /* Box property actions */
     ACTION_COLOR_BOX,       /* Change box color */
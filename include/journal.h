@@ -0,0 +1,109 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+#include "saver.h"
+
+/* ============================================================
+ * Journal - append-only log of edits beside a canvas file
+ *
+ * With a journal open, a save appends records for what changed
+ * since the last one (see change_set.h) to FILE.journal instead
+ * of rewriting FILE. The records cover a box added, moved,
+ * resized, retitled, refilled or deleted, a connection made or
+ * removed, and the small canvas-wide state. canvas_load() replays
+ * the journal over FILE.
+ *
+ * Once the journal passes its threshold it is compacted: a forked
+ * child writes FILE from its copy-on-write snapshot of the canvas
+ * while editing goes on, and afterwards the journal is cut back to
+ * the records written since the fork.
+ *
+ * Records set values ("box 7 is at x y", never "move it by dx"),
+ * so replaying records already in FILE changes nothing. A crash
+ * between the child replacing FILE and the journal being cut loses
+ * nothing, and a record torn by a crash is ignored, along with
+ * anything after it.
+ * ============================================================ */
+
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_MAGIC "BOXES_JOURNAL_V1"
+
+/* Journal size that triggers compaction */
+#define JOURNAL_COMPACT_BYTES (1024 * 1024)
+
+/* Seconds between automatic saves (config auto_save) */
+#define JOURNAL_AUTO_SAVE_INTERVAL 1.0
+
+typedef struct {
+    char *path;             /* Canvas file the journal belongs to */
+    char *journal_path;     /* path + JOURNAL_SUFFIX */
+    int format;             /* CanvasFormat the canvas file is rewritten in */
+    int fd;                 /* Journal, open for appending (-1 if closed) */
+    size_t size;            /* Journal length in bytes */
+    size_t compact_bytes;   /* Compact once the journal is larger than this */
+    Saver compactor;        /* Rewrites the canvas file in the background */
+    size_t compact_from;    /* Journal length when that rewrite started */
+    char state[160];        /* Canvas-wide state record as last written */
+    char *document;         /* Sidebar document as last written */
+    bool has_document;
+} Journal;
+
+/* Prepare an unopened journal */
+void journal_init(Journal *journal);
+
+/**
+ * Follow canvas with the journal of path. If loaded, the canvas was
+ * just loaded from path (journal included) and the journal carries
+ * on; otherwise path is first written out whole and the journal
+ * starts empty.
+ *
+ * @return 0 on success, -1 if the files cannot be written
+ */
+int journal_open(Journal *journal, Canvas *canvas, const char *path, bool loaded);
+
+/* Stop following the canvas, waiting for a compaction in progress.
+ * Unsaved edits are not written. */
+void journal_close(Journal *journal, Canvas *canvas);
+
+/* True if the canvas has edits the journal has not saved */
+bool journal_pending(const Journal *journal, const Canvas *canvas);
+
+/* Append the canvas's edits since the last save, then start a
+ * compaction if the journal has grown past its threshold
+ * (returns 0, or -1 if the journal could not be written) */
+int journal_save(Journal *journal, Canvas *canvas);
+
+/* Rewrite the canvas file now and empty the journal */
+int journal_compact(Journal *journal, Canvas *canvas);
+
+/* Finish a background compaction whose child has exited (call
+ * regularly; cheap when none is running) */
+void journal_poll(Journal *journal);
+
+/* The journal saves go through (NULL: saves rewrite the file) */
+void journal_set_global(Journal *journal);
+Journal *journal_get_global(void);
+
+/* Records that turn 'from' into 'to': boxes and connections added,
+ * removed or changed (by ID), and the document. Selection, view and
+ * grid are left out. File and command boxes keep the lines they show
+ * unless their file or command changed. Returns a malloc'd buffer of
+ * *len bytes, or NULL if out of memory. */
+char *journal_diff(Canvas *from, Canvas *to, size_t *len);
+
+/* Apply records such as journal_diff() returns (returns how many were
+ * applied, or -1 if they end malformed; those before still apply) */
+int journal_apply(Canvas *canvas, const char *records, size_t len);
+
+/* Apply path's journal, if it has one, to a canvas just loaded from
+ * path (returns the number of records applied) */
+int journal_replay(Canvas *canvas, const char *path);
+
+/* Remove path's journal, if it has one, after path was written whole
+ * outside journal mode (returns 0, or -1 on error) */
+int journal_remove(const char *path);
+
+#endif /* JOURNAL_H */
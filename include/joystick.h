@@ -135,6 +135,14 @@ void joystick_text_editor_move_cursor(JoystickState *state, int delta);
 // Returns true if reconnection successful
 bool joystick_try_reconnect(JoystickState *state);
 
+// Reconnect attempt without the per-frame throttle (for timer-driven retries)
+// Returns true if the joystick is connected afterwards
+bool joystick_reconnect_now(JoystickState *state);
+
+// True while the stick is deflected or a button is held, i.e. the
+// joystick needs frames even without new events (continuous movement)
+bool joystick_is_active(const JoystickState *state);
+
 // Joystick button mappings
 #define BUTTON_A      0  // Button 0 (South/A)
 #define BUTTON_B      1  // Button 1 (East/B)
@@ -3,14 +3,53 @@
 
 #include "types.h"
 
-/* Save canvas to file */
+/* On-disk canvas formats */
+typedef enum {
+    CANVAS_FORMAT_V1 = 1,   /* BOXES_CANVAS_V1 text (the default) */
+    CANVAS_FORMAT_V2 = 2    /* Binary: section table, exact doubles, length-prefixed strings */
+} CanvasFormat;
+
+/* Save canvas to file (V1) */
 /* Returns 0 on success, -1 on error */
 int canvas_save(const Canvas *canvas, const char *filename);
 
-/* Load canvas from file */
+/* Save canvas to file in the given format. The file is written under a
+ * temporary name, synced and renamed over filename, so filename holds
+ * the old or the new canvas whole, never part of one. A journal left
+ * beside filename (see journal.h) is removed once the file is in
+ * place, as it holds edits older than the new file. */
+/* Returns 0 on success, -1 on error (errno says why) */
+int canvas_save_format(const Canvas *canvas, const char *filename, CanvasFormat format);
+
+/* Write filename as canvas_save_format() does, but keep its journal:
+ * for journal compaction, which rewrites the journal itself */
+/* Returns 0 on success, -1 on error (errno says why) */
+int canvas_write_format(const Canvas *canvas, const char *filename, CanvasFormat format);
+
+/* Load canvas from file, detecting V1 or V2 from its first line, then
+ * replay FILE.journal over it if there is one (see journal.h) */
 /* Returns 0 on success, -1 on error */
 int canvas_load(Canvas *canvas, const char *filename);
 
+/* Why the last canvas_load() failed, e.g. "line 12, column 5: expected
+ * an integer" (empty after a successful load) */
+const char *persistence_last_error(void);
+
+/* Format of a canvas file, or -1 if it cannot be read or is not a canvas */
+int canvas_file_format(const char *filename);
+
+/* Load input (either format) and save it to output in format */
+/* Returns 0 on success, -1 on error */
+int canvas_convert(const char *input, const char *output, CanvasFormat format);
+
+/* Canvas saves this process has finished, counting those its
+ * background savers finished (see saver.h). Changes whenever the
+ * process may have rewritten a canvas file. */
+unsigned int persistence_save_count(void);
+
+/* Count a save finished by a background saver */
+void persistence_count_save(void);
+
 /* Set the current file name (for reload) */
 void persistence_set_current_file(const char *filename);
 
@@ -0,0 +1,66 @@
+#ifndef RELOADER_H
+#define RELOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "types.h"
+
+/* ============================================================
+ * Reloader - bring the live canvas up to date with its file
+ *
+ * Used for SIGUSR1, which connectors send after rewriting the
+ * canvas file. Instead of loading a new canvas and swapping it in,
+ * a forked child loads the file and compares it, box by box and
+ * connection by connection (by ID), with its copy-on-write snapshot
+ * of the live canvas. It sends back journal records for what
+ * differs (see journal_diff()) over a pipe, and the main loop
+ * applies them as they complete. The main loop's cost is the size
+ * of the change; the undo stack, selection, view, focus and an
+ * edit in progress are untouched.
+ *
+ * Where fork() is unavailable the same load, diff and apply run in
+ * place.
+ * ============================================================ */
+
+typedef struct {
+    pid_t pid;          /* Child loading and comparing (-1 if none) */
+    int fd;             /* Reading end of its pipe (-1 if none) */
+    char *records;      /* Records received so far */
+    size_t len;
+    size_t capacity;
+    char *queued_path;  /* Reload requested while one ran (NULL if none) */
+    int applied;        /* Records the last finished reload applied */
+} Reloader;
+
+/* Prepare an idle reloader */
+void reloader_init(Reloader *reloader);
+
+/**
+ * Start bringing canvas up to date with path. If a reload is running,
+ * another starts when it finishes (the file may have changed again).
+ *
+ * @return 1 if running or queued, 0 if it already finished (no fork),
+ *         -1 if it could not start or failed
+ */
+int reloader_start(Reloader *reloader, Canvas *canvas, const char *path);
+
+/* Pipe to watch while a reload runs (-1 if none) */
+int reloader_fd(const Reloader *reloader);
+
+/* True while a reload is running or queued */
+bool reloader_busy(const Reloader *reloader);
+
+/**
+ * Read what the child has sent; once it is done, apply the records to
+ * canvas and start a queued reload. Call when reloader_fd() is ready.
+ *
+ * @return 1 if a reload finished and was applied (reloader->applied
+ *         records), 0 if still running, -1 if it failed (canvas kept)
+ */
+int reloader_poll(Reloader *reloader, Canvas *canvas);
+
+/* Stop a running reload and free the reloader's memory */
+void reloader_cleanup(Reloader *reloader);
+
+#endif /* RELOADER_H */
@@ -4,6 +4,7 @@
 #include "types.h"
 #include "joystick.h"
 #include "config.h"
+#include <stdbool.h>
 
 /* Render all boxes in the canvas through the viewport */
 void render_canvas(const Canvas *canvas, const Viewport *vp, const AppConfig *config);
@@ -53,4 +54,36 @@ void render_command_line(const Canvas *canvas);
 /* Render text edit mode overlay (Issue #79) */
 void render_edit_mode(const Canvas *canvas, const Viewport *vp);
 
+/* ============================================================
+ * Frame damage (incremental redraw)
+ *
+ * A frame is drawn as:
+ *   if (render_frame_begin(canvas, vp)) {
+ *       ...grid, connections, boxes...
+ *       render_frame_overlays();
+ *       ...sidebar, status bar, panels...
+ *       render_frame_end();
+ *   }
+ * Changes to the viewport or to modes/overlays redraw everything;
+ * canvas mutations only erase and redraw the cells they damaged.
+ * ============================================================ */
+
+/* Start a frame. Returns false when nothing changed since the last one
+ * (skip drawing entirely; nothing is sent to the terminal). Otherwise
+ * erases the damaged cells and clips world-layer drawing to them. */
+bool render_frame_begin(Canvas *canvas, const Viewport *vp);
+
+/* True if render_frame_begin() would draw (lets the main loop sleep otherwise) */
+bool render_frame_pending(const Canvas *canvas, const Viewport *vp);
+
+/* Stop clipping: overlays drawn after this are drawn whole */
+void render_frame_overlays(void);
+
+/* Flush the frame to the terminal (see terminal_frame_bytes()) */
+void render_frame_end(void);
+
+/* Forget the previous frame so the next one is drawn in full
+ * (after the screen was cleared or replaced behind the renderer's back) */
+void render_frame_reset(void);
+
 #endif /* RENDER_H */
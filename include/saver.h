@@ -0,0 +1,80 @@
+#ifndef SAVER_H
+#define SAVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "types.h"
+
+/* ============================================================
+ * Saver - canvas saves that never block editing
+ *
+ * saver_start() forks; the child's memory is a copy-on-write
+ * snapshot of the canvas as of the fork, so taking it costs the
+ * main loop only the fork itself, and the child writes the file
+ * (atomically, see canvas_save_format()) while editing goes on.
+ * saver_poll() collects the result. A save requested while one is
+ * running is started, from the canvas as it is then, once the
+ * running one is done. Where fork() is unavailable or fails, the
+ * save runs in place.
+ * ============================================================ */
+
+/* Seconds a save result stays in the status bar */
+#define SAVER_MESSAGE_SECONDS 3.0
+
+/* Seconds between checks on a running save */
+#define SAVER_POLL_INTERVAL 0.05
+
+typedef struct {
+    pid_t pid;          /* Child writing the file (-1 if none) */
+    char *path;         /* File it is writing */
+    char *last_path;    /* File the last finished save wrote */
+    int format;         /* CanvasFormat it is writing */
+    char *queued_path;  /* Save to start after this one (NULL if none) */
+    int queued_format;
+    int error;          /* errno of the last failed save (0 if it succeeded) */
+    bool keep_journal;  /* Leave the file's journal (journal compaction) */
+} Saver;
+
+/* Prepare an idle saver */
+void saver_init(Saver *saver);
+
+/**
+ * Save canvas to path in format (a CanvasFormat) in the background.
+ * If a save is running, this one starts when it finishes.
+ *
+ * @return 1 if the save is running or queued, 0 if it already
+ *         finished (no fork), -1 if it failed (see saver->error)
+ */
+int saver_start(Saver *saver, const Canvas *canvas, const char *path, int format);
+
+/* True while a save is running or queued */
+bool saver_busy(const Saver *saver);
+
+/**
+ * Collect a finished save, starting a queued one from canvas.
+ * Cheap when nothing is running.
+ *
+ * @return 1 if a save finished, 0 if not, -1 if one failed
+ */
+int saver_poll(Saver *saver, const Canvas *canvas);
+
+/* Wait for the running save (and a queued one) to finish; returns as
+ * saver_poll() for the last of them, or 0 if none was running */
+int saver_wait(Saver *saver, const Canvas *canvas);
+
+/* Wait for saves in progress, then free the saver's memory */
+void saver_cleanup(Saver *saver, const Canvas *canvas);
+
+/* File the last finished save wrote (NULL before the first) */
+const char *saver_last_path(const Saver *saver);
+
+/* Status bar text for a saver_start() or saver_poll() result, e.g.
+ * "Saving canvas.txt...", "Saved canvas.txt" or "Save failed: ..." */
+void saver_describe(const Saver *saver, int result, char *out, size_t size);
+
+/* The saver F2 uses (NULL: F2 saves in place) */
+void saver_set_global(Saver *saver);
+Saver *saver_get_global(void);
+
+#endif /* SAVER_H */
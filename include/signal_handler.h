@@ -19,6 +19,13 @@ bool signal_should_reload(void);
 /* Check if sync signal (SIGUSR2) was received and reset it */
 bool signal_should_sync(void);
 
+/* Descriptor that becomes readable whenever a handled signal arrives,
+ * for waiting in poll() (-1 if unsupported) */
+int signal_wakeup_fd(void);
+
+/* Drain pending wake-ups from signal_wakeup_fd() */
+void signal_clear_wakeup(void);
+
 /* Cleanup signal handlers */
 void signal_handler_cleanup(void);
 
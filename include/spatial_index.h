@@ -0,0 +1,62 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "types.h"
+
+/* ============================================================
+ * Spatial Index - uniform grid over box bounds
+ *
+ * Each box is registered in every grid cell its bounds touch.
+ * Point and rectangle queries only visit the cells they cover,
+ * so hit-testing and viewport culling scale with the number of
+ * nearby boxes instead of the total box count.
+ *
+ * Boxes covering more than SPATIAL_MAX_CELLS cells go on a
+ * separate list that every query scans, so one huge box costs
+ * one entry, not millions. Cell coordinates are clamped to
+ * +/- SPATIAL_CELL_LIMIT; far-away, infinite or NaN bounds never
+ * overflow a cell loop.
+ * ============================================================ */
+
+/* Default grid cell size in world units (roughly one typical box) */
+#define SPATIAL_CELL_SIZE 32.0
+
+/* Cells a box may cover before it goes on the large list */
+#define SPATIAL_MAX_CELLS 256
+
+/* Cell coordinates are clamped to this range */
+#define SPATIAL_CELL_LIMIT (1 << 30)
+
+/* Callback invoked once per box matched by a query */
+typedef void (*SpatialVisitFn)(int box_id, void *ctx);
+
+/* Initialize an empty index with the given cell size */
+void spatial_index_init(SpatialIndex *index, double cell_size);
+
+/* Free all memory held by the index */
+void spatial_index_free(SpatialIndex *index);
+
+/* Pre-size record and bucket storage for 'count' boxes (returns 0, or -1) */
+int spatial_index_reserve(SpatialIndex *index, int count);
+
+/* Register a box with its bounds (returns 0 on success, -1 on error) */
+int spatial_index_insert(SpatialIndex *index, int box_id,
+                         double x, double y, double width, double height);
+
+/* Re-register a box whose bounds changed (inserts it if not yet indexed) */
+int spatial_index_update(SpatialIndex *index, int box_id,
+                         double x, double y, double width, double height);
+
+/* Unregister a box (returns 0 if removed, -1 if not indexed) */
+int spatial_index_remove(SpatialIndex *index, int box_id);
+
+/* Visit every box whose bounds contain the point (edges inclusive) */
+void spatial_index_visit_point(const SpatialIndex *index, double x, double y,
+                               SpatialVisitFn fn, void *ctx);
+
+/* Visit every box whose bounds intersect the rectangle, each exactly once */
+void spatial_index_visit_rect(const SpatialIndex *index,
+                              double x0, double y0, double x1, double y1,
+                              SpatialVisitFn fn, void *ctx);
+
+#endif /* SPATIAL_INDEX_H */
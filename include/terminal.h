@@ -12,10 +12,17 @@ void terminal_cleanup(void);
 /* Update viewport with current terminal dimensions */
 void terminal_update_size(Viewport *vp);
 
+/* Read one pending key without blocking (-1 if none is queued) */
+int terminal_read_key(void);
+
 /* Clear the screen */
 void terminal_clear(void);
 
 /* Refresh the display */
 void terminal_refresh(void);
 
+/* Bytes sent to the terminal by the last terminal_refresh(), or -1 if
+ * the platform cannot report it */
+long terminal_frame_bytes(void);
+
 #endif /* TERMINAL_H */
@@ -62,6 +62,8 @@ typedef struct {
     double fps_update_time;
     int fps_frame_count;
     time_t start_time;
+    double input_latency;      /* Seconds from input arriving to its frame */
+    double input_latency_max;  /* Worst input latency seen */
 
     /* Event log file */
     FILE *log_file;
@@ -172,6 +174,15 @@ void test_mode_clear_markers(TestMode *tm);
  */
 void test_mode_update_fps(TestMode *tm);
 
+/**
+ * Record input-to-display latency.
+ * Call after drawing a frame that showed the effect of new input.
+ *
+ * @param tm Test mode state
+ * @param seconds Time from the input arriving to the frame reaching the terminal
+ */
+void test_mode_record_latency(TestMode *tm, double seconds);
+
 /**
  * Get grid style name for display.
  *
@@ -42,6 +42,17 @@ typedef enum {
     BOX_CONTENT_COMMAND     /* Content from command output */
 } BoxContentType;
 
+/* State of a command box's last run (see command_runner.h) */
+typedef enum {
+    COMMAND_IDLE = 0,       /* Never run asynchronously */
+    COMMAND_QUEUED,         /* Waiting for a free runner slot */
+    COMMAND_RUNNING,        /* Child running, output streaming in */
+    COMMAND_EXITED,         /* Child exited; command_exit holds its status */
+    COMMAND_CANCELLED,      /* Stopped by the user */
+    COMMAND_TIMED_OUT,      /* Stopped after running too long */
+    COMMAND_FAILED          /* Could not be started */
+} CommandState;
+
 /* Display mode for boxes (Issue #33) */
 typedef enum {
     DISPLAY_MODE_COMPACT = 0,   /* Icon + Title only */
@@ -57,6 +68,33 @@ typedef struct {
     int color;          /* Color pair index (default: cyan) */
 } Connection;
 
+/* Content lines packed back to back in one growable block.
+ * Shared by reference count between a box and its undo snapshots;
+ * whoever writes to a shared buffer copies it first. A live buffer
+ * is the exception: the command run or watched file filling it
+ * appends in place for every box showing it, and snapshots take a
+ * copy instead of a reference.
+ *
+ * A ring buffer (limit > 0) has fixed blocks instead: appending to a
+ * full ring drops the oldest line, so it holds a rolling tail of a
+ * stream in constant memory. */
+typedef struct {
+    char *data;         /* Line bytes, each line NUL-terminated */
+    size_t used;        /* Bytes of data in use (ring: next write position) */
+    size_t size;        /* Bytes of data allocated */
+    size_t *offsets;    /* Start of each line within data */
+    int count;          /* Number of lines */
+    int capacity;       /* Allocated entries in offsets */
+    int refs;           /* Owners (box, undo snapshots) */
+    int limit;          /* Ring: maximum lines kept (0 = growable buffer) */
+    int first;          /* Ring: offsets slot of the oldest line */
+    unsigned long dropped;  /* Ring: lines dropped from the front so far */
+    bool live;          /* Still being filled in place by its producer */
+} ContentBuffer;
+
+/* Read-only mapping of a large file (see file_map.h) */
+typedef struct FileMap FileMap;
+
 /* Box structure representing a rectangular region with content */
 typedef struct {
     double x;           /* World X coordinate */
@@ -64,8 +102,8 @@ typedef struct {
     int width;          /* Width in characters */
     int height;         /* Height in characters */
     char *title;        /* Box title */
-    char **content;     /* Array of content lines */
-    int content_lines;  /* Number of content lines */
+    ContentBuffer *content; /* Content lines (see box_content.h); NULL when empty */
+    FileMap *file_map;      /* Large file read in place instead of content (NULL otherwise) */
     bool selected;      /* Is this box currently selected? */
     int id;             /* Unique box identifier */
     int color;          /* Color pair index (0 = default) */
@@ -75,6 +113,10 @@ typedef struct {
     BoxContentType content_type;  /* Content source type (text, file, command) */
     char *file_path;              /* File path for BOX_CONTENT_FILE (NULL otherwise) */
     char *command;                /* Command string for BOX_CONTENT_COMMAND (NULL otherwise) */
+    CommandState command_state;   /* Async run state (COMMAND_IDLE if never run that way) */
+    int command_exit;             /* Exit code once command_state is COMMAND_EXITED */
+    int refresh_interval;         /* Seconds between scheduled re-runs of command (0 = manual) */
+    bool command_stream;          /* Keep a rolling tail of a long-running command's output */
 } Box;
 
 /* Viewport structure for camera/view control */
@@ -184,8 +226,7 @@ typedef struct {
     double x, y;
     int width, height;
     char *title;
-    char **content;
-    int content_lines;
+    ContentBuffer *content;  /* Shared with the box, not copied */
     int color;
     BoxType box_type;
     BoxContentType content_type;
@@ -231,15 +272,169 @@ typedef struct {
     int max_size;                   /* Maximum operations to keep (default: 50) */
 } UndoStack;
 
+/* Open-addressing hash map from integer ID to array index */
+typedef struct {
+    int *keys;          /* Stored IDs (reserved values mark empty/deleted slots) */
+    int *values;        /* Array index for each stored ID */
+    int capacity;       /* Number of slots (power of two, 0 if unallocated) */
+    int count;          /* Number of live entries */
+    int tombstones;     /* Number of deleted slots awaiting rehash */
+} IdIndex;
+
+/* Spatial index entry: one box registered in one grid cell */
+typedef struct {
+    int cx, cy;         /* Grid cell coordinates */
+    int id;             /* Box ID */
+} SpatialEntry;
+
+/* Hash bucket holding the entries of every cell that maps to it */
+typedef struct {
+    SpatialEntry *entries;
+    int count;
+    int capacity;
+} SpatialBucket;
+
+/* Bounds a box was last indexed with (so stale entries can be removed) */
+typedef struct {
+    int id;
+    double x, y;
+    double width, height;
+    bool large;         /* On the large list instead of in grid cells */
+} SpatialRecord;
+
+/* Uniform-grid spatial index over box bounds for hit-testing and culling */
+typedef struct {
+    double cell_size;           /* Grid cell size in world units */
+    SpatialBucket *buckets;     /* Hashed cells (power-of-two count) */
+    int bucket_count;
+    int entry_count;            /* Total (cell, box) registrations */
+    SpatialRecord *records;     /* Indexed bounds, one per box */
+    int record_count;
+    int record_capacity;
+    IdIndex record_of;          /* Box ID -> index into records */
+    int *large;                 /* IDs of boxes spanning too many cells to register */
+    int large_count;
+    int large_capacity;
+} SpatialIndex;
+
+/* Connection pair hash slot: (source_id, dest_id) -> connection ID */
+typedef struct {
+    int source_id;
+    int dest_id;
+    int conn_id;        /* Reserved values mark empty and deleted slots */
+} ConnPairSlot;
+
+/* Connections touching one box, in creation order */
+typedef struct {
+    int box_id;
+    int *conn_ids;
+    int count;
+    int capacity;
+} ConnAdjacency;
+
+/* Connection index: ID lookup, duplicate-edge checks and per-box edges */
+typedef struct {
+    IdIndex by_id;              /* Connection ID -> index into connections */
+    ConnPairSlot *pairs;        /* Open-addressing (source, dest) hash */
+    int pair_capacity;
+    int pair_count;
+    int pair_tombstones;
+    IdIndex adjacency_of;       /* Box ID -> index into adjacency */
+    ConnAdjacency *adjacency;
+    int adjacency_count;
+    int adjacency_capacity;
+} ConnIndex;
+
+/* Slot-map bookkeeping for one entry of canvas->boxes */
+typedef struct {
+    unsigned int generation;    /* Bumped each time the slot is freed */
+    bool live;                  /* Slot holds a box */
+    int next_free;              /* Next free slot while not live (-1 ends the list) */
+    int draw_prev;              /* Slot drawn just below this one (-1 if bottom) */
+    int draw_next;              /* Slot drawn just above this one (-1 if top) */
+    unsigned int draw_seq;      /* Increases along the draw order; higher is on top */
+} BoxSlot;
+
+/* Hot box geometry as parallel arrays indexed by slot. Culling and
+ * proportional sizing scan these instead of the much larger Box records,
+ * which keep the cold text, content and source fields. */
+typedef struct {
+    double *x;
+    double *y;
+    int *width;         /* -1 marks a free slot */
+    int *height;
+} BoxGeometry;
+
+/* Generation-checked reference to a box slot; goes stale when the box is removed */
+typedef struct {
+    int slot;
+    unsigned int generation;
+} BoxHandle;
+
+/* Rectangles that changed since the last frame (see damage.h).
+ * The canvas keeps one in world units; the renderer derives a
+ * screen-cell one from it each frame. */
+#define DAMAGE_MAX_RECTS 32
+
+typedef struct {
+    double x0, y0;      /* Top-left corner (inclusive) */
+    double x1, y1;      /* Bottom-right corner (exclusive) */
+} DamageRect;
+
+typedef struct {
+    DamageRect rects[DAMAGE_MAX_RECTS];
+    int count;          /* Rects in use */
+    bool full;          /* Everything is damaged; rects are ignored */
+} Damage;
+
+/* Edits since the journal last caught up (see change_set.h). One
+ * entry per box or connection, its flags merged across edits. */
+#define CHANGE_ADDED    0x01    /* New (or restored): write it whole */
+#define CHANGE_MOVED    0x02
+#define CHANGE_RESIZED  0x04
+#define CHANGE_FIELDS   0x08    /* Title, color, type, command or content */
+#define CHANGE_REMOVED  0x10    /* Gone (with ADDED: replaced by a restored copy) */
+#define CHANGE_SOURCE   0x20    /* With FIELDS: its file or command changed */
+
+typedef struct {
+    int id;
+    unsigned int flags; /* CHANGE_* (0: added and removed again) */
+} ChangeEntry;
+
+typedef struct {
+    ChangeEntry *entries;
+    int count;
+    int capacity;
+    IdIndex position_of; /* ID -> index in entries */
+} ChangeList;
+
+typedef struct {
+    bool enabled;       /* Off unless a journal follows this canvas */
+    bool overflow;      /* An edit could not be recorded: save everything */
+    ChangeList boxes;
+    ChangeList connections;
+} ChangeSet;
+
 /* Canvas structure containing all boxes (dynamic array) */
 typedef struct {
-    Box *boxes;         /* Dynamic array of boxes */
-    int box_count;      /* Number of boxes currently in use */
-    int box_capacity;   /* Allocated capacity */
+    Box *boxes;         /* Slot array of boxes (free slots are reused) */
+    BoxSlot *box_slots; /* Per-slot liveness, free list and draw-order links */
+    BoxGeometry geometry; /* Per-slot bounds mirrored from boxes for scans */
+    int box_count;      /* Number of live boxes */
+    int box_capacity;   /* Allocated slots */
+    int slot_count;     /* Slots ever handed out (high-water mark) */
+    int free_slot;      /* Head of the free slot list, -1 if empty */
+    int draw_first;     /* Bottom-most slot in draw order, -1 if none */
+    int draw_last;      /* Topmost slot in draw order, -1 if none */
+    unsigned int next_draw_seq; /* draw_seq for the next box placed on top */
     double world_width;
     double world_height;
     int next_id;        /* Next unique ID to assign */
-    int selected_index; /* Index of selected box, -1 if none */
+    int selected_index; /* Slot of selected box, -1 if none */
+    IdIndex box_index;  /* Box ID -> slot in boxes, for O(1) lookup */
+    SpatialIndex spatial; /* Box bounds grid for hit-testing and culling */
+    Damage damage;      /* World regions changed since the last frame */
+    ChangeSet changes;  /* Edits not yet in the journal */
     GridConfig grid;    /* Grid configuration (Phase 4) */
     FocusState focus;   /* Focus mode state (Phase 5b) */
 
@@ -248,6 +443,7 @@ typedef struct {
     int conn_count;             /* Number of connections currently in use */
     int conn_capacity;          /* Allocated capacity for connections */
     int next_conn_id;           /* Next unique connection ID to assign */
+    ConnIndex conn_index;       /* Adjacency lists and pair hash over connections */
     ConnectionMode conn_mode;   /* Connection mode state */
 
     /* Sidebar document (Issue #35) */
@@ -272,6 +468,10 @@ typedef struct {
 
     /* Canvas metadata */
     char *filename;             /* Loaded filename (NULL if new/unsaved) */
+
+    /* Status bar message, e.g. how a save went (empty if none) */
+    char status_message[128];
+    unsigned int status_seq;    /* Bumped each time the message is set */
 } Canvas;
 
 #endif /* TYPES_H */
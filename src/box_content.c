@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "box_content.h"
+#include "file_map.h"
+
+/* Smallest blocks allocated for a fresh buffer */
+#define BUFFER_MIN_LINES 16
+#define BUFFER_MIN_BYTES 256
+
+/* Smallest text block for a ring buffer */
+#define RING_MIN_BYTES 64
+
+static int grow_offsets(ContentBuffer *buffer, int min_capacity) {
+    /* Double, or jump straight to the requested size hint */
+    int new_capacity = buffer->capacity ? buffer->capacity * 2 : BUFFER_MIN_LINES;
+    if (new_capacity < min_capacity) {
+        new_capacity = min_capacity;
+    }
+
+    size_t *new_offsets = realloc(buffer->offsets, sizeof(size_t) * new_capacity);
+    if (new_offsets == NULL) {
+        return -1;
+    }
+    buffer->offsets = new_offsets;
+    buffer->capacity = new_capacity;
+    return 0;
+}
+
+static int grow_data(ContentBuffer *buffer, size_t min_size) {
+    size_t new_size = buffer->size ? buffer->size * 2 : BUFFER_MIN_BYTES;
+    if (new_size < min_size) {
+        new_size = min_size;
+    }
+
+    char *new_data = realloc(buffer->data, new_size);
+    if (new_data == NULL) {
+        return -1;
+    }
+    buffer->data = new_data;
+    buffer->size = new_size;
+    return 0;
+}
+
+ContentBuffer *content_buffer_create(int lines, size_t bytes) {
+    ContentBuffer *buffer = calloc(1, sizeof(ContentBuffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->refs = 1;
+    if (grow_offsets(buffer, lines) != 0 || grow_data(buffer, bytes) != 0) {
+        content_buffer_release(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+ContentBuffer *content_buffer_create_ring(int max_lines, size_t max_bytes) {
+    if (max_lines < 1) {
+        max_lines = 1;
+    }
+    if (max_bytes < RING_MIN_BYTES) {
+        max_bytes = RING_MIN_BYTES;
+    }
+    ContentBuffer *buffer = calloc(1, sizeof(ContentBuffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->refs = 1;
+    buffer->limit = max_lines;
+    buffer->offsets = malloc(sizeof(size_t) * max_lines);
+    buffer->data = malloc(max_bytes);
+    if (buffer->offsets == NULL || buffer->data == NULL) {
+        content_buffer_release(buffer);
+        return NULL;
+    }
+    buffer->capacity = max_lines;
+    buffer->size = max_bytes;
+    return buffer;
+}
+
+/* Offsets slot holding line i */
+static int slot_of(const ContentBuffer *buffer, int i) {
+    if (buffer->limit == 0) {
+        return i;
+    }
+    int slot = buffer->first + i;
+    return slot < buffer->limit ? slot : slot - buffer->limit;
+}
+
+static void ring_drop_oldest(ContentBuffer *buffer) {
+    buffer->first = slot_of(buffer, 1);
+    buffer->count--;
+    buffer->dropped++;
+    if (buffer->count == 0) {
+        buffer->first = 0;
+        buffer->used = 0;
+    }
+}
+
+/* Lines sit in one stretch of the block from the oldest line's start
+ * up to the write position, possibly wrapping past the end. A line goes
+ * at the write position if it fits before the end of the block (or
+ * before the oldest line, once wrapped), else at the start of the
+ * block; oldest lines are dropped until the space is free. */
+static void ring_append(ContentBuffer *buffer, const char *line, size_t len) {
+    if (len + 1 > buffer->size) {
+        len = buffer->size - 1;
+    }
+    size_t need = len + 1;
+    if (buffer->count == buffer->limit) {
+        ring_drop_oldest(buffer);
+    }
+    while (buffer->count > 0) {
+        size_t tail = buffer->offsets[buffer->first];
+        if (tail < buffer->used) {
+            /* Not wrapped: free space after the newest line, then before the oldest */
+            if (buffer->used + need <= buffer->size) {
+                break;
+            }
+            buffer->used = 0;
+            continue;
+        }
+        /* Wrapped: free space is between the newest and the oldest line */
+        if (buffer->used + need <= tail) {
+            break;
+        }
+        ring_drop_oldest(buffer);
+    }
+
+    char *dst = buffer->data + buffer->used;
+    memcpy(dst, line, len);
+    dst[len] = '\0';
+    buffer->offsets[slot_of(buffer, buffer->count)] = buffer->used;
+    buffer->count++;
+    buffer->used += need;
+}
+
+ContentBuffer *content_buffer_retain(ContentBuffer *buffer) {
+    if (buffer != NULL) {
+        buffer->refs++;
+    }
+    return buffer;
+}
+
+void content_buffer_release(ContentBuffer *buffer) {
+    if (buffer == NULL || --buffer->refs > 0) {
+        return;
+    }
+    free(buffer->data);
+    free(buffer->offsets);
+    free(buffer);
+}
+
+/* Exact-size private copy of a buffer (rings keep their limits) */
+static ContentBuffer *content_buffer_clone(const ContentBuffer *buffer) {
+    if (buffer->limit > 0) {
+        ContentBuffer *ring = content_buffer_create_ring(buffer->limit, buffer->size);
+        if (ring == NULL) {
+            return NULL;
+        }
+        for (int i = 0; i < buffer->count; i++) {
+            const char *line = content_buffer_line(buffer, i);
+            ring_append(ring, line, strlen(line));
+        }
+        ring->dropped = buffer->dropped;
+        return ring;
+    }
+
+    ContentBuffer *copy = content_buffer_create(buffer->count, buffer->used);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy->data, buffer->data, buffer->used);
+    memcpy(copy->offsets, buffer->offsets, sizeof(size_t) * buffer->count);
+    copy->used = buffer->used;
+    copy->count = buffer->count;
+    return copy;
+}
+
+void content_buffer_reset(ContentBuffer *buffer) {
+    buffer->used = 0;
+    buffer->count = 0;
+    buffer->first = 0;
+    buffer->dropped = 0;
+}
+
+void content_buffer_truncate(ContentBuffer *buffer, int count) {
+    if (buffer->limit > 0 || count < 0 || count >= buffer->count) {
+        return;
+    }
+    buffer->used = buffer->offsets[count];
+    buffer->count = count;
+}
+
+int content_buffer_append(ContentBuffer *buffer, const char *line, size_t len) {
+    if (buffer->limit > 0) {
+        ring_append(buffer, line, len);
+        return 0;
+    }
+    if (buffer->count >= buffer->capacity && grow_offsets(buffer, buffer->count + 1) != 0) {
+        return -1;
+    }
+    if (buffer->used + len + 1 > buffer->size && grow_data(buffer, buffer->used + len + 1) != 0) {
+        return -1;
+    }
+
+    char *dst = buffer->data + buffer->used;
+    memcpy(dst, line, len);
+    dst[len] = '\0';
+
+    buffer->offsets[buffer->count++] = buffer->used;
+    buffer->used += len + 1;
+    return 0;
+}
+
+void content_buffer_set_live(ContentBuffer *buffer, bool live) {
+    if (buffer != NULL) {
+        buffer->live = live;
+    }
+}
+
+ContentBuffer *content_buffer_freeze(ContentBuffer *buffer) {
+    if (buffer == NULL || !buffer->live) {
+        return content_buffer_retain(buffer);
+    }
+    return content_buffer_clone(buffer);
+}
+
+unsigned long content_buffer_dropped(const ContentBuffer *buffer) {
+    return buffer ? buffer->dropped : 0;
+}
+
+int content_buffer_count(const ContentBuffer *buffer) {
+    return buffer ? buffer->count : 0;
+}
+
+const char *content_buffer_line(const ContentBuffer *buffer, int i) {
+    if (buffer == NULL || i < 0 || i >= buffer->count) {
+        return NULL;
+    }
+    return buffer->data + buffer->offsets[slot_of(buffer, i)];
+}
+
+size_t content_buffer_line_length(const ContentBuffer *buffer, int i) {
+    if (buffer == NULL || i < 0 || i >= buffer->count) {
+        return 0;
+    }
+    if (buffer->limit > 0) {
+        /* Ring lines are not laid out in order; neighbours say nothing */
+        return strlen(content_buffer_line(buffer, i));
+    }
+    size_t end = (i + 1 < buffer->count) ? buffer->offsets[i + 1] : buffer->used;
+    return end - buffer->offsets[i] - 1;
+}
+
+/* Line containing a byte offset (binary search over line starts) */
+static int line_at_offset(const ContentBuffer *buffer, size_t offset) {
+    int lo = 0;
+    int hi = buffer->count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (buffer->offsets[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+int content_buffer_find(const ContentBuffer *buffer, const char *needle, int start_line) {
+    if (buffer == NULL || needle == NULL || start_line < 0 || start_line >= buffer->count) {
+        return -1;
+    }
+    size_t needle_len = strlen(needle);
+    if (needle_len == 0) {
+        return start_line;
+    }
+    if (buffer->limit > 0) {
+        for (int i = start_line; i < buffer->count; i++) {
+            if (strstr(content_buffer_line(buffer, i), needle) != NULL) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* One pass over the whole block; lines are NUL-separated and needle
+     * has no NUL, so a match never spans two lines */
+    size_t start = buffer->offsets[start_line];
+    const char *hit = memmem(buffer->data + start, buffer->used - start, needle, needle_len);
+    if (hit == NULL) {
+        return -1;
+    }
+    return line_at_offset(buffer, (size_t)(hit - buffer->data));
+}
+
+size_t content_buffer_overhead(const ContentBuffer *buffer) {
+    if (buffer == NULL) {
+        return 0;
+    }
+    /* Everything except the line bytes (terminators count as overhead) */
+    size_t text = buffer->used - (size_t)buffer->count;
+    if (buffer->limit > 0) {
+        text = 0;
+        for (int i = 0; i < buffer->count; i++) {
+            text += content_buffer_line_length(buffer, i);
+        }
+    }
+    return sizeof(ContentBuffer) + buffer->size - text + sizeof(size_t) * (size_t)buffer->capacity;
+}
+
+/* A mapped file stands in for the buffer until the box is written to */
+int box_content_count(const Box *box) {
+    if (box->file_map != NULL) {
+        return file_map_count(box->file_map);
+    }
+    return content_buffer_count(box->content);
+}
+
+const char *box_content_line(const Box *box, int i) {
+    if (box->file_map != NULL) {
+        return file_map_line(box->file_map, i, NULL);
+    }
+    return content_buffer_line(box->content, i);
+}
+
+size_t box_content_line_length(const Box *box, int i) {
+    if (box->file_map != NULL) {
+        size_t len = 0;
+        file_map_line(box->file_map, i, &len);
+        return len;
+    }
+    return content_buffer_line_length(box->content, i);
+}
+
+int box_content_find(const Box *box, const char *needle, int start_line) {
+    if (box->file_map != NULL) {
+        return file_map_find(box->file_map, needle, start_line);
+    }
+    return content_buffer_find(box->content, needle, start_line);
+}
+
+static void box_content_unmap(Box *box) {
+    file_map_close(box->file_map);
+    box->file_map = NULL;
+}
+
+/* Give the box a private buffer before writing, copying a shared one */
+static int box_content_unshare(Box *box) {
+    box_content_unmap(box);
+    if (box->content == NULL) {
+        box->content = content_buffer_create(0, 0);
+        return box->content ? 0 : -1;
+    }
+    if (box->content->refs > 1) {
+        ContentBuffer *copy = content_buffer_clone(box->content);
+        if (copy == NULL) {
+            return -1;
+        }
+        content_buffer_release(box->content);
+        box->content = copy;
+    }
+    return 0;
+}
+
+int box_content_set(Box *box, const char **lines, int count) {
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += strlen(lines[i]) + 1;
+    }
+
+    box_content_clear(box);
+    if (count <= 0) {
+        return 0;
+    }
+
+    box->content = content_buffer_create(count, bytes);
+    if (box->content == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        /* Cannot fail: both blocks were sized up front */
+        content_buffer_append(box->content, lines[i], strlen(lines[i]));
+    }
+    return 0;
+}
+
+void box_content_share(Box *box, ContentBuffer *buffer) {
+    box_content_unmap(box);
+    content_buffer_retain(buffer);
+    content_buffer_release(box->content);
+    box->content = buffer;
+}
+
+int box_content_append(Box *box, const char *line) {
+    if (box_content_unshare(box) != 0) {
+        return -1;
+    }
+    return content_buffer_append(box->content, line, strlen(line));
+}
+
+void box_content_reset(Box *box) {
+    box_content_unmap(box);
+    if (box->content == NULL) {
+        return;
+    }
+    if (box->content->refs > 1) {
+        /* Snapshots keep the old lines; start the next fill fresh */
+        box_content_clear(box);
+        return;
+    }
+    content_buffer_reset(box->content);
+}
+
+void box_content_clear(Box *box) {
+    box_content_unmap(box);
+    content_buffer_release(box->content);
+    box->content = NULL;
+}
@@ -1,24 +1,97 @@
 #define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <float.h>
 #include "canvas.h"
+#include "id_index.h"
+#include "conn_index.h"
+#include "spatial_index.h"
 #include "undo.h"
 #include "editor.h"
+#include "box_content.h"
+#include "damage.h"
+#include "change_set.h"
+
+/* Resize the box slot arrays (records, slot metadata and geometry) */
+static int canvas_grow_slots(Canvas *canvas, int new_capacity) {
+    Box *new_boxes = realloc(canvas->boxes, sizeof(Box) * new_capacity);
+    if (new_boxes == NULL) return -1;
+    canvas->boxes = new_boxes;
+
+    BoxSlot *new_slots = realloc(canvas->box_slots, sizeof(BoxSlot) * new_capacity);
+    if (new_slots == NULL) return -1;
+    canvas->box_slots = new_slots;
+
+    BoxGeometry *geo = &canvas->geometry;
+    double *new_x = realloc(geo->x, sizeof(double) * new_capacity);
+    if (new_x == NULL) return -1;
+    geo->x = new_x;
+    double *new_y = realloc(geo->y, sizeof(double) * new_capacity);
+    if (new_y == NULL) return -1;
+    geo->y = new_y;
+    int *new_width = realloc(geo->width, sizeof(int) * new_capacity);
+    if (new_width == NULL) return -1;
+    geo->width = new_width;
+    int *new_height = realloc(geo->height, sizeof(int) * new_capacity);
+    if (new_height == NULL) return -1;
+    geo->height = new_height;
+
+    canvas->box_capacity = new_capacity;
+    return 0;
+}
+
+/* Free the box slot arrays */
+static void canvas_free_slots(Canvas *canvas) {
+    free(canvas->boxes);
+    free(canvas->box_slots);
+    free(canvas->geometry.x);
+    free(canvas->geometry.y);
+    free(canvas->geometry.width);
+    free(canvas->geometry.height);
+    canvas->boxes = NULL;
+    canvas->box_slots = NULL;
+    canvas->geometry.x = NULL;
+    canvas->geometry.y = NULL;
+    canvas->geometry.width = NULL;
+    canvas->geometry.height = NULL;
+    canvas->box_capacity = 0;
+}
 
 /* Initialize canvas with dynamic memory allocation */
 int canvas_init(Canvas *canvas, double world_width, double world_height) {
-    canvas->boxes = malloc(sizeof(Box) * INITIAL_BOX_CAPACITY);
-    if (canvas->boxes == NULL) {
+    canvas->boxes = NULL;
+    canvas->box_slots = NULL;
+    canvas->geometry.x = NULL;
+    canvas->geometry.y = NULL;
+    canvas->geometry.width = NULL;
+    canvas->geometry.height = NULL;
+    canvas->box_capacity = 0;
+    if (canvas_grow_slots(canvas, INITIAL_BOX_CAPACITY) != 0) {
+        canvas_free_slots(canvas);
         return -1;
     }
 
     canvas->box_count = 0;
-    canvas->box_capacity = INITIAL_BOX_CAPACITY;
+    canvas->slot_count = 0;
+    canvas->free_slot = -1;
+    canvas->draw_first = -1;
+    canvas->draw_last = -1;
+    canvas->next_draw_seq = 0;
     canvas->world_width = world_width;
     canvas->world_height = world_height;
     canvas->next_id = 1;
     canvas->selected_index = -1;
+    id_index_init(&canvas->box_index);
+    spatial_index_init(&canvas->spatial, SPATIAL_CELL_SIZE);
+
+    /* A fresh canvas has never been drawn */
+    damage_init(&canvas->damage);
+    damage_mark_all(&canvas->damage);
+    change_set_init(&canvas->changes);
 
     /* Initialize grid configuration (Phase 4) */
     canvas->grid.visible = false;
@@ -35,13 +108,13 @@ int canvas_init(Canvas *canvas, double world_width, double world_height) {
     /* Initialize connections (Issue #20) */
     canvas->connections = malloc(sizeof(Connection) * INITIAL_CONNECTION_CAPACITY);
     if (canvas->connections == NULL) {
-        free(canvas->boxes);
-        canvas->boxes = NULL;
+        canvas_free_slots(canvas);
         return -1;
     }
     canvas->conn_count = 0;
     canvas->conn_capacity = INITIAL_CONNECTION_CAPACITY;
     canvas->next_conn_id = 1;
+    conn_index_init(&canvas->conn_index);
 
     /* Initialize connection mode state */
     canvas->conn_mode.active = false;
@@ -70,6 +143,8 @@ int canvas_init(Canvas *canvas, double world_width, double world_height) {
 
     /* Initialize canvas metadata */
     canvas->filename = NULL;
+    canvas->status_message[0] = '\0';
+    canvas->status_seq = 0;
 
     /* Initialize undo/redo stack (Issue #81) */
     undo_stack_init(&canvas->undo_stack);
@@ -82,17 +157,15 @@ int canvas_init(Canvas *canvas, double world_width, double world_height) {
 
 /* Free canvas memory */
 void canvas_cleanup(Canvas *canvas) {
-    for (int i = 0; i < canvas->box_count; i++) {
+    for (int i = 0; i < canvas->slot_count; i++) {
+        if (!canvas->box_slots[i].live) {
+            continue;
+        }
         Box *box = &canvas->boxes[i];
         if (box->title) {
             free(box->title);
         }
-        if (box->content) {
-            for (int j = 0; j < box->content_lines; j++) {
-                free(box->content[j]);
-            }
-            free(box->content);
-        }
+        box_content_clear(box);
         /* Free content source fields (Issue #54) */
         if (box->file_path) {
             free(box->file_path);
@@ -102,12 +175,14 @@ void canvas_cleanup(Canvas *canvas) {
         }
     }
 
-    if (canvas->boxes) {
-        free(canvas->boxes);
-        canvas->boxes = NULL;
-    }
+    canvas_free_slots(canvas);
     canvas->box_count = 0;
-    canvas->box_capacity = 0;
+    canvas->slot_count = 0;
+    canvas->free_slot = -1;
+    canvas->draw_first = -1;
+    canvas->draw_last = -1;
+    id_index_free(&canvas->box_index);
+    spatial_index_free(&canvas->spatial);
 
     /* Free connections (Issue #20) */
     if (canvas->connections) {
@@ -116,6 +191,7 @@ void canvas_cleanup(Canvas *canvas) {
     }
     canvas->conn_count = 0;
     canvas->conn_capacity = 0;
+    conn_index_free(&canvas->conn_index);
 
     /* Free sidebar document (Issue #35) */
     if (canvas->document) {
@@ -134,44 +210,190 @@ void canvas_cleanup(Canvas *canvas) {
 
     /* Free text editor (Issue #79) */
     editor_cleanup(&canvas->editor);
+
+    change_set_free(&canvas->changes);
 }
 
-/* Grow the box array if needed */
+/* Make sure a slot is available for one more box */
 static int canvas_ensure_capacity(Canvas *canvas) {
-    if (canvas->box_count >= canvas->box_capacity) {
-        int new_capacity = canvas->box_capacity * 2;
-        Box *new_boxes = realloc(canvas->boxes, sizeof(Box) * new_capacity);
-        if (new_boxes == NULL) {
-            return -1;
-        }
-        canvas->boxes = new_boxes;
-        canvas->box_capacity = new_capacity;
+    if (canvas->free_slot < 0 && canvas->slot_count >= canvas->box_capacity) {
+        return canvas_grow_slots(canvas, canvas->box_capacity * 2);
     }
     return 0;
 }
 
-/* Add a box to the canvas (returns box ID, or -1 on error) */
-int canvas_add_box(Canvas *canvas, double x, double y, int width, int height, const char *title) {
-    if (canvas_ensure_capacity(canvas) != 0) {
+/* Renumber draw_seq along the draw order (only needed if the counter wraps) */
+static void canvas_renumber_draw_order(Canvas *canvas) {
+    unsigned int seq = 0;
+    for (int i = canvas->draw_first; i >= 0; i = canvas->box_slots[i].draw_next) {
+        canvas->box_slots[i].draw_seq = seq++;
+    }
+    canvas->next_draw_seq = seq;
+}
+
+/* Take a free slot (reusing freed ones first) and place it on top of the draw order */
+static int canvas_alloc_slot(Canvas *canvas) {
+    int slot;
+    if (canvas->free_slot >= 0) {
+        slot = canvas->free_slot;
+        canvas->free_slot = canvas->box_slots[slot].next_free;
+    } else {
+        slot = canvas->slot_count++;
+        canvas->box_slots[slot].generation = 0;
+        canvas->geometry.width[slot] = -1;
+    }
+
+    if (canvas->next_draw_seq == UINT_MAX) {
+        canvas_renumber_draw_order(canvas);
+    }
+
+    BoxSlot *s = &canvas->box_slots[slot];
+    s->live = true;
+    s->next_free = -1;
+    s->draw_seq = canvas->next_draw_seq++;
+    s->draw_prev = canvas->draw_last;
+    s->draw_next = -1;
+    if (canvas->draw_last >= 0) {
+        canvas->box_slots[canvas->draw_last].draw_next = slot;
+    } else {
+        canvas->draw_first = slot;
+    }
+    canvas->draw_last = slot;
+    return slot;
+}
+
+/* Damage the area a slot's box was last drawn in (from the geometry table).
+ * Titles and content lines may run past the right border, so the damage
+ * extends to the right edge of the world on the box's rows. */
+static void canvas_mark_slot(Canvas *canvas, int slot) {
+    const BoxGeometry *geo = &canvas->geometry;
+    if (geo->width[slot] < 0) {
+        return;  /* Not placed yet */
+    }
+    damage_mark(&canvas->damage, geo->x[slot], geo->y[slot],
+                DBL_MAX, geo->y[slot] + geo->height[slot] + 1);
+}
+
+/* Damage the segment between the centers of a connection's boxes */
+static void canvas_mark_connection(Canvas *canvas, const Connection *conn) {
+    int a = id_index_get(&canvas->box_index, conn->source_id);
+    int b = id_index_get(&canvas->box_index, conn->dest_id);
+    if (a < 0 || b < 0) {
+        return;
+    }
+    const BoxGeometry *geo = &canvas->geometry;
+    if (geo->width[a] < 0 || geo->width[b] < 0) {
+        return;
+    }
+    double ax = geo->x[a] + geo->width[a] / 2.0;
+    double ay = geo->y[a] + geo->height[a] / 2.0;
+    double bx = geo->x[b] + geo->width[b] / 2.0;
+    double by = geo->y[b] + geo->height[b] / 2.0;
+    damage_mark(&canvas->damage, fmin(ax, bx), fmin(ay, by), fmax(ax, bx) + 1, fmax(ay, by) + 1);
+}
+
+/* Damage every connection touching a box */
+static void canvas_mark_box_edges(Canvas *canvas, int box_id) {
+    int count;
+    const int *edges = conn_index_box_edges(&canvas->conn_index, box_id, &count);
+    for (int e = 0; e < count; e++) {
+        int i = conn_index_position(&canvas->conn_index, edges[e]);
+        if (i >= 0) {
+            canvas_mark_connection(canvas, &canvas->connections[i]);
+        }
+    }
+}
+
+/* Unlink a slot from the draw order and push it on the free list.
+ * The generation bump invalidates outstanding handles to it. */
+static void canvas_release_slot(Canvas *canvas, int slot) {
+    BoxSlot *s = &canvas->box_slots[slot];
+    if (s->draw_prev >= 0) {
+        canvas->box_slots[s->draw_prev].draw_next = s->draw_next;
+    } else {
+        canvas->draw_first = s->draw_next;
+    }
+    if (s->draw_next >= 0) {
+        canvas->box_slots[s->draw_next].draw_prev = s->draw_prev;
+    } else {
+        canvas->draw_last = s->draw_prev;
+    }
+
+    canvas_mark_slot(canvas, slot);
+    s->live = false;
+    s->generation++;
+    canvas->geometry.width[slot] = -1;
+    s->next_free = canvas->free_slot;
+    canvas->free_slot = slot;
+}
+
+/* Pre-size box and connection storage (and the box indexes) for bulk loads */
+int canvas_reserve(Canvas *canvas, int box_count, int conn_count) {
+    if (box_count > canvas->box_capacity && canvas_grow_slots(canvas, box_count) != 0) {
         return -1;
     }
 
-    /* Apply snap-to-grid if enabled (Phase 4) */
-    if (canvas->grid.snap_enabled && canvas->grid.spacing > 0) {
-        x = round(x / canvas->grid.spacing) * canvas->grid.spacing;
-        y = round(y / canvas->grid.spacing) * canvas->grid.spacing;
+    if (conn_count > canvas->conn_capacity) {
+        Connection *new_conns = realloc(canvas->connections, sizeof(Connection) * conn_count);
+        if (new_conns == NULL) {
+            return -1;
+        }
+        canvas->connections = new_conns;
+        canvas->conn_capacity = conn_count;
+    }
+
+    if (id_index_reserve(&canvas->box_index, box_count) != 0 ||
+        conn_index_reserve(&canvas->conn_index, conn_count) != 0) {
+        return -1;
     }
+    return spatial_index_reserve(&canvas->spatial, box_count);
+}
+
+/* Mirror a box's bounds into the geometry table and spatial index,
+ * damaging both the old and the new area */
+static int canvas_store_bounds(Canvas *canvas, int slot) {
+    const Box *box = &canvas->boxes[slot];
+    const BoxGeometry *geo = &canvas->geometry;
+    if (canvas->changes.enabled && geo->width[slot] >= 0) {
+        unsigned int flags = 0;
+        if (geo->x[slot] != box->x || geo->y[slot] != box->y) flags |= CHANGE_MOVED;
+        if (geo->width[slot] != box->width || geo->height[slot] != box->height) flags |= CHANGE_RESIZED;
+        if (flags) change_set_note_box(&canvas->changes, box->id, flags);
+    }
+    canvas_mark_slot(canvas, slot);
+    canvas_mark_box_edges(canvas, box->id);
+    canvas->geometry.x[slot] = box->x;
+    canvas->geometry.y[slot] = box->y;
+    canvas->geometry.width[slot] = box->width;
+    canvas->geometry.height[slot] = box->height;
+    canvas_mark_slot(canvas, slot);
+    canvas_mark_box_edges(canvas, box->id);
+    return spatial_index_update(&canvas->spatial, box->id, box->x, box->y,
+                                box->width, box->height);
+}
 
-    Box *box = &canvas->boxes[canvas->box_count];
+/* Place a new box with the given ID on top of the draw order.
+ * Returns the slot, or -1 on error (ID already in use or allocation failure). */
+static int canvas_insert_box(Canvas *canvas, int box_id, double x, double y,
+                             int width, int height, const char *title) {
+    if (id_index_get(&canvas->box_index, box_id) >= 0) {
+        return -1;
+    }
+    if (canvas_ensure_capacity(canvas) != 0) {
+        return -1;
+    }
+
+    int slot = canvas_alloc_slot(canvas);
+    Box *box = &canvas->boxes[slot];
     box->x = x;
     box->y = y;
     box->width = width;
     box->height = height;
     box->title = title ? strdup(title) : NULL;
     box->content = NULL;
-    box->content_lines = 0;
+    box->file_map = NULL;
     box->selected = false;
-    box->id = canvas->next_id++;
+    box->id = box_id;
     box->color = BOX_COLOR_DEFAULT;
     box->box_type = BOX_TYPE_NOTE;  /* Default to NOTE type (Issue #33) */
 
@@ -179,170 +401,365 @@ int canvas_add_box(Canvas *canvas, double x, double y, int width, int height, co
     box->content_type = BOX_CONTENT_TEXT;  /* Default to static text */
     box->file_path = NULL;
     box->command = NULL;
-
+    box->command_state = COMMAND_IDLE;
+    box->command_exit = 0;
+    box->refresh_interval = 0;
+    box->command_stream = false;
+
+    if (id_index_put(&canvas->box_index, box_id, slot) != 0) {
+        free(box->title);
+        canvas_release_slot(canvas, slot);
+        return -1;
+    }
+    if (canvas_store_bounds(canvas, slot) != 0) {
+        id_index_remove(&canvas->box_index, box_id);
+        free(box->title);
+        canvas_release_slot(canvas, slot);
+        return -1;
+    }
     canvas->box_count++;
+    change_set_note_box(&canvas->changes, box_id, CHANGE_ADDED);
+    return slot;
+}
+
+/* Add a box to the canvas (returns box ID, or -1 on error) */
+int canvas_add_box(Canvas *canvas, double x, double y, int width, int height, const char *title) {
+    /* Apply snap-to-grid if enabled (Phase 4) */
+    if (canvas->grid.snap_enabled && canvas->grid.spacing > 0) {
+        x = round(x / canvas->grid.spacing) * canvas->grid.spacing;
+        y = round(y / canvas->grid.spacing) * canvas->grid.spacing;
+    }
 
-    return box->id;
+    if (canvas_insert_box(canvas, canvas->next_id, x, y, width, height, title) < 0) {
+        return -1;
+    }
+    return canvas->next_id++;
 }
 
 /* Restore a box with a specific ID (for undo/redo) */
 int canvas_restore_box_with_id(Canvas *canvas, int box_id, double x, double y,
                                int width, int height, const char *title) {
-    if (canvas_ensure_capacity(canvas) != 0) {
+    /* Don't apply grid snap - restore exact position */
+    if (canvas_insert_box(canvas, box_id, x, y, width, height, title) < 0) {
         return -1;
     }
 
-    /* Don't apply grid snap - restore exact position */
-    Box *box = &canvas->boxes[canvas->box_count];
-    box->x = x;
-    box->y = y;
-    box->width = width;
-    box->height = height;
-    box->title = title ? strdup(title) : NULL;
-    box->content = NULL;
-    box->content_lines = 0;
-    box->selected = false;
-    box->id = box_id;  /* Use specified ID instead of next_id */
-    box->color = BOX_COLOR_DEFAULT;
-    box->box_type = BOX_TYPE_NOTE;
-
-    /* Initialize content source fields */
-    box->content_type = BOX_CONTENT_TEXT;
-    box->file_path = NULL;
-    box->command = NULL;
-
-    canvas->box_count++;
-
     /* Ensure next_id stays ahead of restored IDs */
     if (box_id >= canvas->next_id) {
         canvas->next_id = box_id + 1;
     }
 
-    return box->id;
+    return box_id;
 }
 
 /* Add content lines to a box by ID */
 int canvas_add_box_content(Canvas *canvas, int box_id, const char **lines, int count) {
-    for (int i = 0; i < canvas->box_count; i++) {
-        if (canvas->boxes[i].id == box_id) {
-            Box *box = &canvas->boxes[i];
-
-            box->content = malloc(sizeof(char *) * count);
-            if (box->content == NULL) {
-                return -1;
-            }
-
-            for (int j = 0; j < count; j++) {
-                box->content[j] = strdup(lines[j]);
-                if (box->content[j] == NULL) {
-                    /* Cleanup on failure */
-                    for (int k = 0; k < j; k++) {
-                        free(box->content[k]);
-                    }
-                    free(box->content);
-                    box->content = NULL;
-                    return -1;
-                }
-            }
-            box->content_lines = count;
-            return 0;
-        }
+    Box *box = canvas_get_box(canvas, box_id);
+    if (box == NULL) {
+        return -1;  /* Box not found */
     }
-    return -1;  /* Box not found */
+
+    canvas_mark_box_dirty(canvas, box_id);
+    return box_content_set(box, lines, count);
 }
 
 /* Remove a box from canvas by ID */
 int canvas_remove_box(Canvas *canvas, int box_id) {
-    for (int i = 0; i < canvas->box_count; i++) {
-        if (canvas->boxes[i].id == box_id) {
-            Box *box = &canvas->boxes[i];
-
-            /* Remove any connections involving this box (Issue #20) */
-            canvas_remove_box_connections(canvas, box_id);
-
-            /* Free box memory */
-            if (box->title) {
-                free(box->title);
-            }
-            if (box->content) {
-                for (int j = 0; j < box->content_lines; j++) {
-                    free(box->content[j]);
-                }
-                free(box->content);
-            }
-            /* Free content source fields (Issue #54) */
-            if (box->file_path) {
-                free(box->file_path);
-            }
-            if (box->command) {
-                free(box->command);
-            }
+    int i = id_index_get(&canvas->box_index, box_id);
+    if (i < 0) {
+        return -1;  /* Box not found */
+    }
 
-            /* Shift remaining boxes down */
-            for (int j = i; j < canvas->box_count - 1; j++) {
-                canvas->boxes[j] = canvas->boxes[j + 1];
-            }
+    /* Remove any connections involving this box (Issue #20) */
+    canvas_remove_box_connections(canvas, box_id);
+    conn_index_drop_box(&canvas->conn_index, box_id);
 
-            canvas->box_count--;
+    /* Free box memory */
+    Box *box = &canvas->boxes[i];
+    if (box->title) {
+        free(box->title);
+    }
+    box_content_clear(box);
+    /* Free content source fields (Issue #54) */
+    if (box->file_path) {
+        free(box->file_path);
+    }
+    if (box->command) {
+        free(box->command);
+    }
 
-            /* Update selected index if needed */
-            if (canvas->selected_index == i) {
-                canvas->selected_index = -1;
-            } else if (canvas->selected_index > i) {
-                canvas->selected_index--;
-            }
+    /* Free the slot; other boxes keep their slots (and Box pointers) */
+    spatial_index_remove(&canvas->spatial, box_id);
+    id_index_remove(&canvas->box_index, box_id);
+    canvas_release_slot(canvas, i);
+    canvas->box_count--;
+    change_set_note_box(&canvas->changes, box_id, CHANGE_REMOVED);
 
-            return 0;
-        }
+    if (canvas->selected_index == i) {
+        canvas->selected_index = -1;
     }
-    return -1;  /* Box not found */
+
+    return 0;
 }
 
 /* Get box by ID (returns NULL if not found) */
 Box* canvas_get_box(Canvas *canvas, int box_id) {
-    for (int i = 0; i < canvas->box_count; i++) {
-        if (canvas->boxes[i].id == box_id) {
-            return &canvas->boxes[i];
-        }
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot < 0) {
+        return NULL;
     }
-    return NULL;
+    return &canvas->boxes[slot];
 }
 
-/* Get box by index (returns NULL if out of bounds) */
+/* Get box by slot index (returns NULL if out of range or free) */
 Box* canvas_get_box_at(Canvas *canvas, int index) {
-    if (index < 0 || index >= canvas->box_count) {
+    if (index < 0 || index >= canvas->slot_count || !canvas->box_slots[index].live) {
         return NULL;
     }
     return &canvas->boxes[index];
 }
 
+/* Bottom-most slot in draw order (-1 if the canvas is empty) */
+int canvas_draw_first(const Canvas *canvas) {
+    return canvas->draw_first;
+}
+
+/* Slot drawn just above the given one (-1 if it is topmost) */
+int canvas_draw_next(const Canvas *canvas, int slot) {
+    return canvas->box_slots[slot].draw_next;
+}
+
+/* Get a generation-checked handle to a box (slot -1 if not found) */
+BoxHandle canvas_box_handle(const Canvas *canvas, int box_id) {
+    BoxHandle handle = {-1, 0};
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot >= 0) {
+        handle.slot = slot;
+        handle.generation = canvas->box_slots[slot].generation;
+    }
+    return handle;
+}
+
+/* Resolve a handle (returns NULL if the box has since been removed) */
+Box* canvas_handle_box(Canvas *canvas, BoxHandle handle) {
+    if (handle.slot < 0 || handle.slot >= canvas->slot_count) {
+        return NULL;
+    }
+    const BoxSlot *s = &canvas->box_slots[handle.slot];
+    if (!s->live || s->generation != handle.generation) {
+        return NULL;
+    }
+    return &canvas->boxes[handle.slot];
+}
+
+/* Hit-test state: keeps the candidate highest in draw order (topmost) */
+typedef struct {
+    const Canvas *canvas;
+    int best_slot;
+} HitTest;
+
+static void hit_test_visit(int box_id, void *ctx) {
+    HitTest *hit = ctx;
+    const BoxSlot *slots = hit->canvas->box_slots;
+    int slot = id_index_get(&hit->canvas->box_index, box_id);
+    if (hit->best_slot < 0 || slots[slot].draw_seq > slots[hit->best_slot].draw_seq) {
+        hit->best_slot = slot;
+    }
+}
+
 /* Find box at world coordinates (returns box ID, or -1 if none found) */
 int canvas_find_box_at(Canvas *canvas, double x, double y) {
-    /* Search in reverse order to find topmost box */
-    for (int i = canvas->box_count - 1; i >= 0; i--) {
-        Box *box = &canvas->boxes[i];
-        if (x >= box->x && x <= box->x + box->width &&
-            y >= box->y && y <= box->y + box->height) {
-            return box->id;
+    /* Only boxes registered in the cell under the point are candidates;
+     * the one latest in draw order is topmost */
+    HitTest hit = {canvas, -1};
+    spatial_index_visit_point(&canvas->spatial, x, y, hit_test_visit, &hit);
+    return hit.best_slot >= 0 ? canvas->boxes[hit.best_slot].id : -1;
+}
+
+/* Query collector: gathers (draw_seq, slot) sort keys of matched boxes */
+typedef struct {
+    const Canvas *canvas;
+    uint64_t *keys;
+    int count;
+    int capacity;
+    bool failed;
+} BoxQuery;
+
+static int compare_keys(const void *a, const void *b) {
+    uint64_t ka = *(const uint64_t *)a;
+    uint64_t kb = *(const uint64_t *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+static void box_query_push(BoxQuery *q, int slot) {
+    if (q->failed) return;
+
+    if (q->count >= q->capacity) {
+        int new_capacity = q->capacity ? q->capacity * 2 : 64;
+        uint64_t *new_keys = realloc(q->keys, sizeof(uint64_t) * new_capacity);
+        if (new_keys == NULL) {
+            q->failed = true;
+            return;
         }
+        q->keys = new_keys;
+        q->capacity = new_capacity;
+    }
+    q->keys[q->count++] = ((uint64_t)q->canvas->box_slots[slot].draw_seq << 32) | (uint32_t)slot;
+}
+
+static void box_query_visit(int box_id, void *ctx) {
+    BoxQuery *q = ctx;
+    box_query_push(q, id_index_get(&q->canvas->box_index, box_id));
+}
+
+/* Sort collected keys into draw order and copy the slots out */
+static int box_query_finish(BoxQuery *q, int **indices, int *capacity) {
+    if (q->failed) {
+        free(q->keys);
+        return -1;
+    }
+
+    if (q->count > *capacity) {
+        int *new_indices = realloc(*indices, sizeof(int) * q->count);
+        if (new_indices == NULL) {
+            free(q->keys);
+            return -1;
+        }
+        *indices = new_indices;
+        *capacity = q->count;
+    }
+
+    /* Sorting by draw_seq yields bottom-to-top draw order */
+    qsort(q->keys, q->count, sizeof(uint64_t), compare_keys);
+    for (int i = 0; i < q->count; i++) {
+        (*indices)[i] = (int)(uint32_t)q->keys[i];
     }
-    return -1;
+    free(q->keys);
+    return q->count;
+}
+
+
+/* Collect slots of boxes intersecting a world rectangle, in draw order */
+int canvas_query_boxes(const Canvas *canvas, double x0, double y0, double x1, double y1,
+                       int **indices, int *capacity) {
+    if (!canvas || !indices || !capacity) return -1;
+
+    /* Zoomed far out the grid has more cells in view than there are boxes;
+     * a straight pass over the geometry table is cheaper then */
+    double cells = ((x1 - x0) / SPATIAL_CELL_SIZE + 1.0) * ((y1 - y0) / SPATIAL_CELL_SIZE + 1.0);
+    if (cells > canvas->box_count) {
+        return canvas_scan_boxes(canvas, x0, y0, x1, y1, indices, capacity);
+    }
+
+    BoxQuery q = {canvas, NULL, 0, 0, false};
+    spatial_index_visit_rect(&canvas->spatial, x0, y0, x1, y1, box_query_visit, &q);
+    return box_query_finish(&q, indices, capacity);
+}
+
+/* Same as canvas_query_boxes, as one linear pass over the geometry table */
+int canvas_scan_boxes(const Canvas *canvas, double x0, double y0, double x1, double y1,
+                      int **indices, int *capacity) {
+    if (!canvas || !indices || !capacity) return -1;
+
+    const double *gx = canvas->geometry.x;
+    const double *gy = canvas->geometry.y;
+    const int *gw = canvas->geometry.width;
+    const int *gh = canvas->geometry.height;
+
+    BoxQuery q = {canvas, NULL, 0, 0, false};
+    for (int i = 0; i < canvas->slot_count; i++) {
+        /* Free slots have width -1 and can never pass the x test */
+        if (gx[i] + gw[i] >= x0 && gx[i] <= x1 && gw[i] >= 0 &&
+            gy[i] + gh[i] >= y0 && gy[i] <= y1) {
+            box_query_push(&q, i);
+        }
+    }
+    return box_query_finish(&q, indices, capacity);
+}
+
+/* Move a box to new world coordinates (keeps geometry and spatial index in sync) */
+int canvas_move_box(Canvas *canvas, int box_id, double x, double y) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot < 0) return -1;
+
+    canvas->boxes[slot].x = x;
+    canvas->boxes[slot].y = y;
+    return canvas_store_bounds(canvas, slot);
+}
+
+/* Resize a box (keeps geometry and spatial index in sync) */
+int canvas_resize_box(Canvas *canvas, int box_id, int width, int height) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot < 0) return -1;
+
+    canvas->boxes[slot].width = width;
+    canvas->boxes[slot].height = height;
+    return canvas_store_bounds(canvas, slot);
+}
+
+/* Re-index a box after its geometry fields were written directly */
+void canvas_sync_box_bounds(Canvas *canvas, int box_id) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot < 0) return;
+
+    canvas_store_bounds(canvas, slot);
+}
+
+/* Damage a box's area after its fields were changed directly */
+void canvas_mark_box_dirty(Canvas *canvas, int box_id) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot >= 0) {
+        canvas_mark_slot(canvas, slot);
+        change_set_note_box(&canvas->changes, box_id, CHANGE_FIELDS);
+    }
+}
+
+/* Damage a box and note that what it shows changed */
+void canvas_mark_box_source(Canvas *canvas, int box_id) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot >= 0) {
+        canvas_mark_slot(canvas, slot);
+        change_set_note_box(&canvas->changes, box_id, CHANGE_FIELDS | CHANGE_SOURCE);
+    }
+}
+
+/* Damage a box's area without noting a change */
+void canvas_redraw_box(Canvas *canvas, int box_id) {
+    int slot = id_index_get(&canvas->box_index, box_id);
+    if (slot >= 0) {
+        canvas_mark_slot(canvas, slot);
+    }
+}
+
+/* Damage the whole screen (viewport-independent changes such as grid or mode) */
+void canvas_mark_all_dirty(Canvas *canvas) {
+    damage_mark_all(&canvas->damage);
+}
+
+/* Show a message in the status bar (NULL clears it) */
+void canvas_set_status(Canvas *canvas, const char *message) {
+    snprintf(canvas->status_message, sizeof(canvas->status_message), "%s",
+             message ? message : "");
+    canvas->status_seq++;
+    canvas_mark_all_dirty(canvas);
 }
 
 /* Select a box by ID */
 void canvas_select_box(Canvas *canvas, int box_id) {
     /* Deselect current box */
-    if (canvas->selected_index >= 0 && canvas->selected_index < canvas->box_count) {
-        canvas->boxes[canvas->selected_index].selected = false;
+    Box *current = canvas_get_selected(canvas);
+    if (current) {
+        current->selected = false;
+        canvas_mark_slot(canvas, canvas->selected_index);
     }
 
     /* Find and select new box */
-    for (int i = 0; i < canvas->box_count; i++) {
-        if (canvas->boxes[i].id == box_id) {
-            canvas->boxes[i].selected = true;
-            canvas->selected_index = i;
-            return;
-        }
+    int index = id_index_get(&canvas->box_index, box_id);
+    if (index >= 0) {
+        canvas->boxes[index].selected = true;
+        canvas_mark_slot(canvas, index);
+        canvas->selected_index = index;
+        return;
     }
 
     /* Box not found, deselect */
@@ -351,18 +768,17 @@ void canvas_select_box(Canvas *canvas, int box_id) {
 
 /* Deselect current box */
 void canvas_deselect(Canvas *canvas) {
-    if (canvas->selected_index >= 0 && canvas->selected_index < canvas->box_count) {
-        canvas->boxes[canvas->selected_index].selected = false;
+    Box *current = canvas_get_selected(canvas);
+    if (current) {
+        current->selected = false;
+        canvas_mark_slot(canvas, canvas->selected_index);
     }
     canvas->selected_index = -1;
 }
 
 /* Get currently selected box (returns NULL if none) */
 Box* canvas_get_selected(Canvas *canvas) {
-    if (canvas->selected_index >= 0 && canvas->selected_index < canvas->box_count) {
-        return &canvas->boxes[canvas->selected_index];
-    }
-    return NULL;
+    return canvas_get_box_at(canvas, canvas->selected_index);
 }
 
 /* Snap box position to grid (Phase 4) */
@@ -374,6 +790,7 @@ void canvas_snap_box_to_grid(Canvas *canvas, Box *box) {
     /* Snap position to nearest grid point */
     box->x = round(box->x / canvas->grid.spacing) * canvas->grid.spacing;
     box->y = round(box->y / canvas->grid.spacing) * canvas->grid.spacing;
+    canvas_sync_box_bounds(canvas, box->id);
 }
 
 /* Calculate proportional dimensions based on nearby boxes (Issue #18) */
@@ -406,26 +823,31 @@ int canvas_calc_proportional_size(const Canvas *canvas, double x, double y,
     int nearest_width = default_width;
     int nearest_height = default_height;
 
-    for (int i = 0; i < canvas->box_count; i++) {
-        const Box *box = &canvas->boxes[i];
+    const BoxGeometry *geo = &canvas->geometry;
+    for (int i = 0; i < canvas->slot_count; i++) {
+        int width = geo->width[i];
+        int height = geo->height[i];
+        if (width < 0) {
+            continue;  /* Free slot */
+        }
 
         /* Calculate distance from new box position to box center */
-        double box_center_x = box->x + box->width / 2.0;
-        double box_center_y = box->y + box->height / 2.0;
+        double box_center_x = geo->x[i] + width / 2.0;
+        double box_center_y = geo->y[i] + height / 2.0;
         double dx = x - box_center_x;
         double dy = y - box_center_y;
         double dist_sq = dx * dx + dy * dy;
 
         if (dist_sq <= radius_sq) {
             neighbor_count++;
-            total_width += box->width;
-            total_height += box->height;
+            total_width += width;
+            total_height += height;
 
             /* Track nearest neighbor */
             if (nearest_dist_sq < 0.0 || dist_sq < nearest_dist_sq) {
                 nearest_dist_sq = dist_sq;
-                nearest_width = box->width;
-                nearest_height = box->height;
+                nearest_width = width;
+                nearest_height = height;
             }
         }
     }
@@ -496,12 +918,18 @@ int canvas_add_connection(Canvas *canvas, int source_id, int dest_id) {
 
     /* Add the connection */
     Connection *conn = &canvas->connections[canvas->conn_count];
-    conn->id = canvas->next_conn_id++;
+    conn->id = canvas->next_conn_id;
     conn->source_id = source_id;
     conn->dest_id = dest_id;
     conn->color = CONNECTION_COLOR_DEFAULT;
 
+    if (conn_index_insert(&canvas->conn_index, conn, canvas->conn_count) != 0) {
+        return -1;
+    }
     canvas->conn_count++;
+    canvas->next_conn_id++;
+    canvas_mark_connection(canvas, conn);
+    change_set_note_connection(&canvas->changes, conn->id, CHANGE_ADDED);
 
     return conn->id;
 }
@@ -519,9 +947,10 @@ int canvas_restore_connection_with_id(Canvas *canvas, int conn_id, int source_id
     /* Don't allow self-connections */
     if (source_id == dest_id) return -1;
 
-    /* Check if connection already exists (in either direction) */
+    /* Check if connection already exists (in either direction) or ID is taken */
     if (canvas_find_connection(canvas, source_id, dest_id) >= 0) return -1;
     if (canvas_find_connection(canvas, dest_id, source_id) >= 0) return -1;
+    if (canvas_get_connection(canvas, conn_id) != NULL) return -1;
 
     /* Ensure capacity */
     if (canvas_ensure_conn_capacity(canvas) != 0) {
@@ -535,7 +964,12 @@ int canvas_restore_connection_with_id(Canvas *canvas, int conn_id, int source_id
     conn->dest_id = dest_id;
     conn->color = color;
 
+    if (conn_index_insert(&canvas->conn_index, conn, canvas->conn_count) != 0) {
+        return -1;
+    }
     canvas->conn_count++;
+    canvas_mark_connection(canvas, conn);
+    change_set_note_connection(&canvas->changes, conn_id, CHANGE_ADDED);
 
     /* Ensure next_conn_id stays ahead of restored IDs */
     if (conn_id >= canvas->next_conn_id) {
@@ -549,54 +983,50 @@ int canvas_restore_connection_with_id(Canvas *canvas, int conn_id, int source_id
 int canvas_remove_connection(Canvas *canvas, int conn_id) {
     if (!canvas) return -1;
 
-    for (int i = 0; i < canvas->conn_count; i++) {
-        if (canvas->connections[i].id == conn_id) {
-            /* Shift remaining connections down */
-            for (int j = i; j < canvas->conn_count - 1; j++) {
-                canvas->connections[j] = canvas->connections[j + 1];
-            }
-            canvas->conn_count--;
-            return 0;
-        }
+    int i = conn_index_position(&canvas->conn_index, conn_id);
+    if (i < 0) {
+        return -1;  /* Connection not found */
     }
-    return -1;  /* Connection not found */
+    canvas_mark_connection(canvas, &canvas->connections[i]);
+    conn_index_remove(&canvas->conn_index, &canvas->connections[i]);
+    change_set_note_connection(&canvas->changes, conn_id, CHANGE_REMOVED);
+
+    /* Move the last connection into the hole (array order carries no meaning) */
+    int last = canvas->conn_count - 1;
+    if (i != last) {
+        canvas->connections[i] = canvas->connections[last];
+        conn_index_set_position(&canvas->conn_index, canvas->connections[i].id, i);
+    }
+    canvas->conn_count--;
+    return 0;
 }
 
 /* Get connection by ID (returns NULL if not found) */
 Connection* canvas_get_connection(Canvas *canvas, int conn_id) {
     if (!canvas) return NULL;
 
-    for (int i = 0; i < canvas->conn_count; i++) {
-        if (canvas->connections[i].id == conn_id) {
-            return &canvas->connections[i];
-        }
-    }
-    return NULL;
+    int i = conn_index_position(&canvas->conn_index, conn_id);
+    return i >= 0 ? &canvas->connections[i] : NULL;
 }
 
 /* Find connection between two boxes (returns connection ID, or -1 if none) */
 int canvas_find_connection(const Canvas *canvas, int source_id, int dest_id) {
     if (!canvas) return -1;
 
-    for (int i = 0; i < canvas->conn_count; i++) {
-        const Connection *conn = &canvas->connections[i];
-        if (conn->source_id == source_id && conn->dest_id == dest_id) {
-            return conn->id;
-        }
-    }
-    return -1;
+    return conn_index_find_pair(&canvas->conn_index, source_id, dest_id);
 }
 
 /* Get all connections involving a specific box (fills array, returns count) */
 int canvas_get_box_connections(const Canvas *canvas, int box_id, int *conn_ids, int max_count) {
     if (!canvas || !conn_ids || max_count <= 0) return 0;
 
-    int count = 0;
-    for (int i = 0; i < canvas->conn_count && count < max_count; i++) {
-        const Connection *conn = &canvas->connections[i];
-        if (conn->source_id == box_id || conn->dest_id == box_id) {
-            conn_ids[count++] = conn->id;
-        }
+    int count;
+    const int *edges = conn_index_box_edges(&canvas->conn_index, box_id, &count);
+    if (count > max_count) {
+        count = max_count;
+    }
+    if (count > 0) {
+        memcpy(conn_ids, edges, sizeof(int) * count);
     }
     return count;
 }
@@ -605,12 +1035,12 @@ int canvas_get_box_connections(const Canvas *canvas, int box_id, int *conn_ids,
 void canvas_remove_box_connections(Canvas *canvas, int box_id) {
     if (!canvas) return;
 
-    /* Remove connections in reverse order to avoid index issues */
-    for (int i = canvas->conn_count - 1; i >= 0; i--) {
-        const Connection *conn = &canvas->connections[i];
-        if (conn->source_id == box_id || conn->dest_id == box_id) {
-            canvas_remove_connection(canvas, conn->id);
-        }
+    /* Newest first: each removal then pops the tail of this box's list */
+    int count;
+    const int *edges = conn_index_box_edges(&canvas->conn_index, box_id, &count);
+    while (count > 0) {
+        canvas_remove_connection(canvas, edges[count - 1]);
+        edges = conn_index_box_edges(&canvas->conn_index, box_id, &count);
     }
 }
 
@@ -0,0 +1,150 @@
+#define _XOPEN_SOURCE 700
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "canvas_watch.h"
+
+#ifdef __linux__
+/* Writes, and files closed, created or renamed in the directory */
+#define WATCH_EVENTS (IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+#endif
+
+void canvas_watch_init(CanvasWatch *watch) {
+    memset(watch, 0, sizeof(*watch));
+    watch->fd = -1;
+    watch->first_write = -1.0;
+}
+
+int canvas_watch_start(CanvasWatch *watch, const char *path) {
+    canvas_watch_stop(watch);
+#ifdef __linux__
+    const char *slash = strrchr(path, '/');
+    char dir[PATH_MAX];
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - path) < sizeof(dir)) {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    } else {
+        return -1;
+    }
+
+    watch->path = strdup(path);
+    watch->name = strdup(slash ? slash + 1 : path);
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->path == NULL || watch->name == NULL || watch->fd < 0 ||
+        inotify_add_watch(watch->fd, dir, WATCH_EVENTS) < 0) {
+        canvas_watch_stop(watch);
+        return -1;
+    }
+    return 0;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+void canvas_watch_stop(CanvasWatch *watch) {
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+    free(watch->path);
+    free(watch->name);
+    canvas_watch_init(watch);
+}
+
+const char *canvas_watch_path(const CanvasWatch *watch) {
+    return watch->path;
+}
+
+int canvas_watch_fd(const CanvasWatch *watch) {
+    return watch->fd;
+}
+
+int canvas_watch_read_events(CanvasWatch *watch, double now) {
+    int seen = 0;
+#ifdef __linux__
+    if (watch->fd < 0) {
+        return 0;
+    }
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(watch->fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            /* The queue overflowed: the file may have been written */
+            bool all = (event->mask & IN_Q_OVERFLOW) != 0;
+            if (!all && (event->len == 0 || strcmp(event->name, watch->name) != 0)) {
+                continue;
+            }
+            seen++;
+            watch->last_event = now;
+            if (event->mask & (IN_MODIFY | IN_CREATE)) {
+                watch->writing = true;
+            } else {
+                /* Closed after writing, or renamed into place: complete */
+                watch->writing = false;
+                if (watch->first_write < 0.0) {
+                    watch->first_write = now;
+                }
+            }
+        }
+    }
+#else
+    (void)watch;
+    (void)now;
+#endif
+    return seen;
+}
+
+double canvas_watch_next_deadline(const CanvasWatch *watch) {
+    if (watch->first_write < 0.0 || watch->writing) {
+        return -1.0;
+    }
+    double quiet = watch->last_event + CANVAS_WATCH_QUIET;
+    double latest = watch->first_write + CANVAS_WATCH_MAX_DELAY;
+    return quiet < latest ? quiet : latest;
+}
+
+/* Identity of the file now; false if it cannot be read */
+static bool identify(const CanvasWatch *watch, struct stat *st) {
+    return watch->path != NULL && stat(watch->path, st) == 0;
+}
+
+static bool is_own(const CanvasWatch *watch, const struct stat *st) {
+    return watch->own_known &&
+           (unsigned long long)st->st_dev == watch->own_dev &&
+           (unsigned long long)st->st_ino == watch->own_ino &&
+           (long long)st->st_size == watch->own_size &&
+           (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec == watch->own_mtime_ns;
+}
+
+bool canvas_watch_due(CanvasWatch *watch, double now) {
+    double deadline = canvas_watch_next_deadline(watch);
+    if (deadline < 0.0 || now < deadline) {
+        return false;
+    }
+    watch->first_write = -1.0;
+    struct stat st;
+    return identify(watch, &st) && !is_own(watch, &st);
+}
+
+void canvas_watch_ignore_current(CanvasWatch *watch) {
+    struct stat st;
+    watch->own_known = identify(watch, &st);
+    if (watch->own_known) {
+        watch->own_dev = (unsigned long long)st.st_dev;
+        watch->own_ino = (unsigned long long)st.st_ino;
+        watch->own_size = (long long)st.st_size;
+        watch->own_mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+}
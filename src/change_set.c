@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include "change_set.h"
+#include "id_index.h"
+
+static void list_init(ChangeList *list) {
+    list->entries = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    id_index_init(&list->position_of);
+}
+
+static void list_free(ChangeList *list) {
+    free(list->entries);
+    id_index_free(&list->position_of);
+    list_init(list);
+}
+
+static void list_clear(ChangeList *list) {
+    /* Clearing costs the table's size; after one big burst of edits,
+     * drop the table instead of sweeping it on every later save */
+    if (list->position_of.capacity > 4 * list->count + 64) {
+        id_index_free(&list->position_of);
+        id_index_init(&list->position_of);
+    } else {
+        id_index_clear(&list->position_of);
+    }
+    list->count = 0;
+}
+
+/* Merge new flags into what is already recorded for an ID. An add
+ * supersedes other edits; CHANGE_REMOVED stays on it when the ID
+ * existed at the last save (removed, then restored by undo), so the
+ * old copy is still deleted first. Removing something added since the
+ * last save leaves nothing to write. */
+static unsigned int merge_flags(unsigned int old_flags, unsigned int flags) {
+    if (flags & CHANGE_REMOVED) {
+        bool added_since = (old_flags & CHANGE_ADDED) && !(old_flags & CHANGE_REMOVED);
+        return added_since ? 0 : CHANGE_REMOVED;
+    }
+    if (flags & CHANGE_ADDED) {
+        return CHANGE_ADDED | (old_flags & CHANGE_REMOVED);
+    }
+    return old_flags | flags;
+}
+
+static int list_note(ChangeList *list, int id, unsigned int flags) {
+    int i = id_index_get(&list->position_of, id);
+    if (i >= 0 && !(flags & CHANGE_ADDED)) {
+        list->entries[i].flags = merge_flags(list->entries[i].flags, flags);
+        return 0;
+    }
+    if (i >= 0) {
+        /* Restored after an earlier change: it is now the newest box,
+         * so move it to the end, where adds are written in order */
+        flags = merge_flags(list->entries[i].flags, flags);
+        for (int j = i + 1; j < list->count; j++) {
+            list->entries[j - 1] = list->entries[j];
+            id_index_put(&list->position_of, list->entries[j - 1].id, j - 1);
+        }
+        list->entries[list->count - 1].id = id;
+        list->entries[list->count - 1].flags = flags;
+        return id_index_put(&list->position_of, id, list->count - 1);
+    }
+
+    if (list->count >= list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 16;
+        ChangeEntry *new_entries = realloc(list->entries, sizeof(ChangeEntry) * new_capacity);
+        if (new_entries == NULL) {
+            return -1;
+        }
+        list->entries = new_entries;
+        list->capacity = new_capacity;
+    }
+    if (id_index_put(&list->position_of, id, list->count) != 0) {
+        return -1;
+    }
+    list->entries[list->count].id = id;
+    list->entries[list->count].flags = merge_flags(0, flags);
+    list->count++;
+    return 0;
+}
+
+void change_set_init(ChangeSet *set) {
+    set->enabled = false;
+    set->overflow = false;
+    list_init(&set->boxes);
+    list_init(&set->connections);
+}
+
+void change_set_free(ChangeSet *set) {
+    list_free(&set->boxes);
+    list_free(&set->connections);
+    set->enabled = false;
+    set->overflow = false;
+}
+
+void change_set_clear(ChangeSet *set) {
+    list_clear(&set->boxes);
+    list_clear(&set->connections);
+    set->overflow = false;
+}
+
+void change_set_enable(ChangeSet *set, bool enabled) {
+    change_set_clear(set);
+    set->enabled = enabled;
+}
+
+bool change_set_empty(const ChangeSet *set) {
+    return set->boxes.count == 0 && set->connections.count == 0 && !set->overflow;
+}
+
+void change_set_note_box(ChangeSet *set, int box_id, unsigned int flags) {
+    if (set->enabled && list_note(&set->boxes, box_id, flags) != 0) {
+        set->overflow = true;
+    }
+}
+
+void change_set_note_connection(ChangeSet *set, int conn_id, unsigned int flags) {
+    if (set->enabled && list_note(&set->connections, conn_id, flags) != 0) {
+        set->overflow = true;
+    }
+}
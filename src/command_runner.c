@@ -1,8 +1,18 @@
 #define _POSIX_C_SOURCE 200809L
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 #include "command_runner.h"
+#include "box_content.h"
+#include "canvas.h"
 
 /* Internal: Store exit code as metadata line */
 static void store_exit_code(Box *box, int exit_code) {
@@ -11,16 +21,7 @@ static void store_exit_code(Box *box, int exit_code) {
     /* Add exit code as last line */
     char exit_line[64];
     snprintf(exit_line, sizeof(exit_line), "[Exit: %d]", exit_code);
-
-    /* Reallocate content array for one more line */
-    char **new_content = realloc(box->content, sizeof(char *) * (box->content_lines + 1));
-    if (new_content) {
-        box->content = new_content;
-        box->content[box->content_lines] = strdup(exit_line);
-        if (box->content[box->content_lines]) {
-            box->content_lines++;
-        }
-    }
+    box_content_append(box, exit_line);
 }
 
 /* Execute command and capture output */
@@ -29,8 +30,8 @@ int command_runner_execute(Box *box) {
         return -1;
     }
 
-    /* Clear any existing output */
-    command_runner_clear(box);
+    /* Drop existing output but keep its buffer for the new run */
+    box_content_reset(box);
 
     /* Build command with stderr redirect */
     char cmd_with_redirect[1024];
@@ -42,17 +43,8 @@ int command_runner_execute(Box *box) {
         return -1;
     }
 
-    /* Read output lines */
-    char **lines = NULL;
+    /* Read output lines straight into the box's content buffer */
     int line_count = 0;
-    int capacity = 64;
-
-    lines = malloc(sizeof(char *) * capacity);
-    if (!lines) {
-        pclose(pipe);
-        return -1;
-    }
-
     char buffer[MAX_COMMAND_OUTPUT];
     size_t total_bytes = 0;
 
@@ -73,18 +65,7 @@ int command_runner_execute(Box *box) {
             }
         }
 
-        /* Grow array if needed */
-        if (line_count >= capacity) {
-            capacity *= 2;
-            char **new_lines = realloc(lines, sizeof(char *) * capacity);
-            if (!new_lines) {
-                break;
-            }
-            lines = new_lines;
-        }
-
-        lines[line_count] = strdup(buffer);
-        if (!lines[line_count]) {
+        if (box_content_append(box, buffer) != 0) {
             break;
         }
         line_count++;
@@ -106,15 +87,9 @@ int command_runner_execute(Box *box) {
 
     /* If no output, add a placeholder */
     if (line_count == 0) {
-        lines[0] = strdup("(no output)");
-        if (lines[0]) {
-            line_count = 1;
-        }
+        box_content_append(box, "(no output)");
     }
 
-    /* Assign to box */
-    box->content = lines;
-    box->content_lines = line_count;
     box->content_type = BOX_CONTENT_COMMAND;
 
     /* Store exit code as metadata */
@@ -149,12 +124,13 @@ int command_runner_get_exit_code(const Box *box) {
         return EXIT_CODE_UNKNOWN;
     }
 
-    if (!box->content || box->content_lines == 0) {
+    int line_count = box_content_count(box);
+    if (line_count == 0) {
         return EXIT_CODE_UNKNOWN;
     }
 
     /* Exit code is in the last line */
-    const char *last_line = box->content[box->content_lines - 1];
+    const char *last_line = box_content_line(box, line_count - 1);
     if (!last_line) {
         return EXIT_CODE_UNKNOWN;
     }
@@ -174,16 +150,7 @@ void command_runner_clear(Box *box) {
         return;
     }
 
-    if (box->content) {
-        for (int i = 0; i < box->content_lines; i++) {
-            if (box->content[i]) {
-                free(box->content[i]);
-            }
-        }
-        free(box->content);
-        box->content = NULL;
-    }
-    box->content_lines = 0;
+    box_content_clear(box);
 }
 
 /* Basic command validation */
@@ -205,3 +172,873 @@ int command_runner_validate(const char *command) {
 
     return 1;  /* Appears safe */
 }
+
+/* ============================================================
+ * Asynchronous runner
+ * ============================================================ */
+
+/* Most output read from one pipe per poll, so a chatty command cannot
+ * hold up input and drawing */
+#define POLL_READ_BUDGET (256 * 1024)
+
+/* How often to retry reaping a child that closed its output but has
+ * not exited yet */
+#define REAP_RETRY_INTERVAL 0.05
+
+static CommandRunner *global_runner = NULL;
+
+void command_runner_set_global(CommandRunner *runner) {
+    global_runner = runner;
+}
+
+CommandRunner *command_runner_get_global(void) {
+    return global_runner;
+}
+
+void command_runner_init(CommandRunner *runner, int max_running, double timeout) {
+    memset(runner, 0, sizeof(*runner));
+    if (max_running < 1) max_running = 1;
+    if (max_running > COMMAND_RUNNER_MAX_RUNNING) max_running = COMMAND_RUNNER_MAX_RUNNING;
+    runner->max_running = max_running;
+    runner->timeout = timeout > 0.0 ? timeout : 0.0;
+    runner->jitter_state = (unsigned int)time(NULL) | 1u;
+    runner->cache_ttl = COMMAND_RUNNER_CACHE_TTL;
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        runner->jobs[i].fd = -1;
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Uniform in [0, 1): spreads refreshes so boxes with the same interval
+ * do not all fork in the same instant */
+static double jitter(CommandRunner *runner) {
+    unsigned int x = runner->jitter_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    runner->jitter_state = x;
+    return (x >> 8) / 16777216.0;
+}
+
+/* Next run one interval from now, give or take the jitter */
+static double next_refresh(CommandRunner *runner, int interval, double now) {
+    double spread = COMMAND_RUNNER_REFRESH_JITTER * (2.0 * jitter(runner) - 1.0);
+    return now + interval * (1.0 + spread);
+}
+
+/* First run soon after scheduling, staggered across boxes */
+static double first_refresh(CommandRunner *runner, int interval, double now) {
+    double window = interval < COMMAND_RUNNER_REFRESH_SPREAD ? interval : COMMAND_RUNNER_REFRESH_SPREAD;
+    return now + window * jitter(runner);
+}
+
+static CommandRefresh *find_refresh(CommandRunner *runner, int box_id) {
+    for (int i = 0; i < runner->refresh_count; i++) {
+        if (runner->refresh[i].box_id == box_id) {
+            return &runner->refresh[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_refresh(CommandRunner *runner, int index) {
+    runner->refresh[index] = runner->refresh[--runner->refresh_count];
+}
+
+static int add_refresh(CommandRunner *runner, int box_id, double due) {
+    if (runner->refresh_count == runner->refresh_capacity) {
+        int capacity = runner->refresh_capacity ? runner->refresh_capacity * 2 : 16;
+        CommandRefresh *grown = realloc(runner->refresh, capacity * sizeof(*grown));
+        if (!grown) {
+            return -1;
+        }
+        runner->refresh = grown;
+        runner->refresh_capacity = capacity;
+    }
+    runner->refresh[runner->refresh_count].box_id = box_id;
+    runner->refresh[runner->refresh_count].due = due;
+    runner->refresh_count++;
+    return 0;
+}
+
+static bool refreshable(const Box *box) {
+    return box && box->content_type == BOX_CONTENT_COMMAND && box->command &&
+           box->command[0] != '\0' && box->refresh_interval > 0;
+}
+
+int command_runner_set_refresh(CommandRunner *runner, Canvas *canvas, int box_id, int interval) {
+    Box *box = canvas_get_box(canvas, box_id);
+    if (!box || box->content_type != BOX_CONTENT_COMMAND || !box->command) {
+        return -1;
+    }
+    if (interval > 0 && interval < COMMAND_RUNNER_MIN_REFRESH) interval = COMMAND_RUNNER_MIN_REFRESH;
+    if (interval > COMMAND_RUNNER_MAX_REFRESH) interval = COMMAND_RUNNER_MAX_REFRESH;
+    if (interval < 0) interval = 0;
+    box->refresh_interval = interval;
+    canvas_mark_box_dirty(canvas, box_id);
+
+    CommandRefresh *entry = find_refresh(runner, box_id);
+    if (interval == 0) {
+        if (entry) {
+            remove_refresh(runner, (int)(entry - runner->refresh));
+        }
+        return 0;
+    }
+    double due = first_refresh(runner, interval, now_seconds());
+    if (entry) {
+        entry->due = due;
+        return 0;
+    }
+    return add_refresh(runner, box_id, due);
+}
+
+void command_runner_schedule_canvas(CommandRunner *runner, const Canvas *canvas) {
+    double now = now_seconds();
+    runner->refresh_count = 0;
+    for (int i = canvas_draw_first(canvas); i >= 0; i = canvas_draw_next(canvas, i)) {
+        const Box *box = &canvas->boxes[i];
+        if (refreshable(box) &&
+            add_refresh(runner, box->id, first_refresh(runner, box->refresh_interval, now)) != 0) {
+            break;
+        }
+    }
+}
+
+#ifndef _WIN32
+
+static void free_job(CommandJob *job) {
+    content_buffer_release(job->output);
+    free(job->command);
+    free(job->boxes);
+    memset(job, 0, sizeof(*job));
+    job->fd = -1;
+}
+
+static int job_box_index(const CommandJob *job, int box_id) {
+    for (int i = 0; i < job->box_count; i++) {
+        if (job->boxes[i].id == box_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int add_job_box(CommandJob *job, int box_id, bool live) {
+    if (job->box_count == job->box_capacity) {
+        int capacity = job->box_capacity ? job->box_capacity * 2 : 4;
+        CommandJobBox *grown = realloc(job->boxes, capacity * sizeof(*grown));
+        if (!grown) {
+            return -1;
+        }
+        job->boxes = grown;
+        job->box_capacity = capacity;
+    }
+    job->boxes[job->box_count].id = box_id;
+    job->boxes[job->box_count].live = live;
+    job->box_count++;
+    return 0;
+}
+
+static void remove_job_box(CommandJob *job, int index) {
+    job->boxes[index] = job->boxes[--job->box_count];
+}
+
+/* The job (if any) the box is waiting on */
+static CommandJob *find_job(CommandRunner *runner, int box_id, int *index) {
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        CommandJob *job = &runner->jobs[i];
+        int at = job->active ? job_box_index(job, box_id) : -1;
+        if (at >= 0) {
+            if (index) *index = at;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+/* Add one line to a run's shared output, or to the box's own copy */
+static void add_note(ContentBuffer *output, Box *box, const char *line) {
+    if (output) {
+        content_buffer_append(output, line, strlen(line));
+    } else {
+        box_content_append(box, line);
+    }
+}
+
+/* Note how a run ended: placeholder, stop reason and the usual
+ * "[Exit: N]" line that command_runner_get_exit_code() reads */
+static void end_output(ContentBuffer *output, Box *box, CommandState state, int exit_code,
+                       int lines, double timeout) {
+    char note[64];
+    if (lines == 0) {
+        add_note(output, box, "(no output)");
+    }
+    if (state == COMMAND_CANCELLED) {
+        add_note(output, box, "[Cancelled]");
+    } else if (state == COMMAND_TIMED_OUT) {
+        snprintf(note, sizeof(note), "[Timed out after %.0fs]", timeout);
+        add_note(output, box, note);
+    }
+    snprintf(note, sizeof(note), "[Exit: %d]", exit_code);
+    add_note(output, box, note);
+}
+
+/* Record how a run ended in every box still showing it; returns how
+ * many boxes that was */
+static int finish_job(Canvas *canvas, CommandJob *job, CommandState state, int exit_code,
+                      double timeout) {
+    int finished = 0;
+    end_output(job->output, NULL, state, exit_code, job->lines, timeout);
+    content_buffer_set_live(job->output, false);
+    for (int i = 0; i < job->box_count; i++) {
+        Box *box = canvas_get_box(canvas, job->boxes[i].id);
+        if (!box) {
+            continue;
+        }
+        /* Refresh: replace the old output in one step */
+        box_content_share(box, job->output);
+        box->command_state = state;
+        box->command_exit = exit_code;
+        canvas_redraw_box(canvas, box->id);
+        finished++;
+    }
+    return finished;
+}
+
+/* Keep one line of output, within the same limits as the synchronous runner */
+static void emit_line(CommandJob *job) {
+    job->line[job->line_len] = '\0';
+    if (job->line_len > 0 && job->line[job->line_len - 1] == '\r') {
+        job->line[job->line_len - 1] = '\0';
+    }
+    size_t len = job->line_len;
+    job->line_len = 0;
+
+    if (!job->stream && (job->lines >= MAX_COMMAND_LINES || job->bytes + len > MAX_COMMAND_OUTPUT)) {
+        return;  /* Output limit reached: keep draining, drop the rest */
+    }
+    job->bytes += len;
+    job->lines++;
+    content_buffer_append(job->output, job->line, strlen(job->line));
+}
+
+/* Read what the pipe holds right now; returns true if output was added */
+static bool read_output(CommandJob *job) {
+    int before = job->lines;
+    char buf[4096];
+    size_t budget = POLL_READ_BUDGET;
+
+    while (job->fd >= 0 && budget > 0) {
+        ssize_t n = read(job->fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            /* EOF (or error): flush the unterminated last line */
+            if (job->line_len > 0) {
+                emit_line(job);
+            }
+            close(job->fd);
+            job->fd = -1;
+            break;
+        }
+        budget = (size_t)n < budget ? budget - (size_t)n : 0;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                emit_line(job);
+            } else {
+                job->line[job->line_len++] = buf[i];
+                if (job->line_len == sizeof(job->line) - 1) {
+                    emit_line(job);
+                }
+            }
+        }
+    }
+    return job->lines != before;
+}
+
+/* Redraw the boxes showing the run's output as it arrives (refresh
+ * output is not on its boxes until the run ends); returns how many */
+static int mark_live_boxes(Canvas *canvas, const CommandJob *job) {
+    int marked = 0;
+    for (int i = 0; i < job->box_count; i++) {
+        if (job->boxes[i].live && canvas_get_box(canvas, job->boxes[i].id)) {
+            canvas_redraw_box(canvas, job->boxes[i].id);
+            marked++;
+        }
+    }
+    return marked;
+}
+
+/* Ask the child's process group to stop; SIGKILL follows after a grace period */
+static void stop_job(CommandJob *job, CommandState reason, double now) {
+    if (job->kill_at > 0.0) {
+        return;
+    }
+    job->stop_reason = reason;
+    job->kill_at = now + COMMAND_RUNNER_KILL_GRACE;
+    kill(-job->pid, SIGTERM);
+}
+
+/* Fork /bin/sh -c command with stdout and stderr on a non-blocking pipe */
+static int spawn_job(CommandJob *job, double timeout) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* Child: own process group so cancel reaches the whole pipeline */
+        setpgid(0, 0);
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+        }
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        /* Don't leak the terminal, joystick or other jobs' pipes */
+        for (int fd = STDERR_FILENO + 1; fd < 1024; fd++) {
+            close(fd);
+        }
+        execl("/bin/sh", "sh", "-c", job->command, (char *)NULL);
+        _exit(127);
+    }
+
+    setpgid(pid, pid);  /* Also from the parent, so an early cancel finds the group */
+    close(fds[1]);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    job->pid = pid;
+    job->fd = fds[0];
+    job->stop_at = timeout > 0.0 ? now_seconds() + timeout : 0.0;
+    return 0;
+}
+
+/* Start a queued job; on failure its boxes record it and the job is freed */
+static int launch_job(CommandRunner *runner, Canvas *canvas, CommandJob *job) {
+    if (spawn_job(job, job->stream ? 0.0 : runner->timeout) != 0) {
+        content_buffer_append(job->output, "(failed to start)", strlen("(failed to start)"));
+        job->lines++;
+        finish_job(canvas, job, COMMAND_FAILED, -1, runner->timeout);
+        free_job(job);
+        return -1;
+    }
+    for (int i = 0; i < job->box_count; i++) {
+        Box *box = canvas_get_box(canvas, job->boxes[i].id);
+        if (box && job->boxes[i].live) {
+            box->command_state = COMMAND_RUNNING;
+            canvas_redraw_box(canvas, box->id);
+        }
+    }
+    return 0;
+}
+
+int command_runner_running(const CommandRunner *runner) {
+    int running = 0;
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        if (runner->jobs[i].active && runner->jobs[i].pid > 0) {
+            running++;
+        }
+    }
+    return running;
+}
+
+bool command_runner_busy(const CommandRunner *runner, int box_id) {
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        if (runner->jobs[i].active && job_box_index(&runner->jobs[i], box_id) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Take a box off a job. The last box leaving stops a running job (it
+ * is reaped later without touching any box) or drops a queued one. */
+static void leave_job(CommandJob *job, int index) {
+    remove_job_box(job, index);
+    if (job->box_count > 0) {
+        return;
+    }
+    if (job->pid > 0) {
+        stop_job(job, COMMAND_CANCELLED, now_seconds());
+    } else {
+        free_job(job);
+    }
+}
+
+/* Forget the box's current job, which carries on for other boxes */
+static void detach_box(CommandRunner *runner, int box_id) {
+    int index;
+    CommandJob *job = find_job(runner, box_id, &index);
+    if (job) {
+        leave_job(job, index);
+    }
+}
+
+/* Show the box its run: a live box shares the output as it fills and
+ * shows the run's state; a refresh keeps the box's current content and
+ * state until the run finishes */
+static int join_job(Canvas *canvas, CommandJob *job, Box *box, bool live) {
+    if (add_job_box(job, box->id, live) != 0) {
+        return -1;
+    }
+    if (live) {
+        bool source = box->content_type != BOX_CONTENT_COMMAND;
+        box_content_share(box, job->output);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command_state = job->pid > 0 ? COMMAND_RUNNING : COMMAND_QUEUED;
+        if (source) {
+            canvas_mark_box_source(canvas, box->id);
+        } else {
+            canvas_redraw_box(canvas, box->id);
+        }
+    }
+    return 0;
+}
+
+/* A queued or running run of the same command that the box can share */
+static CommandJob *find_shared_job(CommandRunner *runner, const Box *box) {
+    if (box->command_stream) {
+        return NULL;
+    }
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        CommandJob *job = &runner->jobs[i];
+        if (job->active && !job->stream && job->kill_at == 0.0 && job->box_count > 0 &&
+            strcmp(job->command, box->command) == 0) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+/* Take a free job slot for the box's command. Returns NULL when every
+ * slot is taken. */
+static CommandJob *add_job(CommandRunner *runner, Canvas *canvas, Box *box, bool refresh) {
+    CommandJob *job = NULL;
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        if (!runner->jobs[i].active) {
+            job = &runner->jobs[i];
+            break;
+        }
+    }
+    if (!job) {
+        return NULL;
+    }
+    job->command = strdup(box->command);
+    if (box->command_stream) {
+        job->output = content_buffer_create_ring(COMMAND_RUNNER_STREAM_LINES, COMMAND_RUNNER_STREAM_BYTES);
+    } else {
+        job->output = content_buffer_create(0, 0);
+    }
+    content_buffer_set_live(job->output, true);
+    job->active = true;
+    job->seq = runner->next_seq++;
+    job->stop_reason = COMMAND_RUNNING;
+    job->stream = box->command_stream;
+
+    /* Any run of a stream box shows its output as it arrives */
+    if (!job->command || !job->output ||
+        join_job(canvas, job, box, !refresh || box->command_stream) != 0) {
+        free_job(job);
+        return NULL;
+    }
+    return job;
+}
+
+static CommandResult *find_result(CommandRunner *runner, const char *command) {
+    for (int i = 0; i < runner->result_count; i++) {
+        if (strcmp(runner->results[i].command, command) == 0) {
+            return &runner->results[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_result(CommandRunner *runner, int index) {
+    free(runner->results[index].command);
+    content_buffer_release(runner->results[index].output);
+    runner->results[index] = runner->results[--runner->result_count];
+}
+
+/* Keep a finished run's output for boxes with the same command */
+static void keep_result(CommandRunner *runner, const CommandJob *job, int exit_code, double now) {
+    if (runner->cache_ttl <= 0.0 || job->stream) {
+        return;
+    }
+    CommandResult *result = find_result(runner, job->command);
+    if (!result) {
+        if (runner->result_count == runner->result_capacity) {
+            int capacity = runner->result_capacity ? runner->result_capacity * 2 : 8;
+            CommandResult *grown = realloc(runner->results, capacity * sizeof(*grown));
+            if (!grown) {
+                return;
+            }
+            runner->results = grown;
+            runner->result_capacity = capacity;
+        }
+        char *command = strdup(job->command);
+        if (!command) {
+            return;
+        }
+        result = &runner->results[runner->result_count++];
+        result->command = command;
+        result->output = NULL;
+    }
+    content_buffer_release(result->output);
+    result->output = content_buffer_retain(job->output);
+    result->exit_code = exit_code;
+    result->finished = now;
+}
+
+/* Give a refreshing box the output of a recent run of its command
+ * instead of forking. Results count as fresh for half the box's
+ * interval at most, so its own last result never stands in for a run. */
+static bool reuse_result(CommandRunner *runner, Canvas *canvas, Box *box, double now) {
+    if (box->command_stream) {
+        return false;
+    }
+    CommandResult *result = find_result(runner, box->command);
+    double ttl = runner->cache_ttl;
+    if (ttl > box->refresh_interval / 2.0) {
+        ttl = box->refresh_interval / 2.0;
+    }
+    if (!result || now - result->finished >= ttl) {
+        return false;
+    }
+    box_content_share(box, result->output);
+    box->command_state = COMMAND_EXITED;
+    box->command_exit = result->exit_code;
+    canvas_redraw_box(canvas, box->id);
+    return true;
+}
+
+int command_runner_start(CommandRunner *runner, Canvas *canvas, int box_id) {
+    Box *box = canvas_get_box(canvas, box_id);
+    if (!runner || !box || !box->command || box->command[0] == '\0') {
+        return -1;
+    }
+
+    detach_box(runner, box_id);
+
+    CommandJob *shared = find_shared_job(runner, box);
+    if (shared) {
+        return join_job(canvas, shared, box, true);
+    }
+    CommandJob *job = add_job(runner, canvas, box, false);
+    if (!job) {
+        return -1;
+    }
+    if (command_runner_running(runner) < runner->max_running) {
+        return launch_job(runner, canvas, job);
+    }
+    return 0;
+}
+
+int command_runner_cancel(CommandRunner *runner, Canvas *canvas, int box_id) {
+    int index;
+    CommandJob *job = find_job(runner, box_id, &index);
+    if (!job) {
+        return -1;
+    }
+    Box *box = canvas_get_box(canvas, box_id);
+    if (job->box_count > 1) {
+        /* Others still want the run: this box keeps a copy of what it
+         * has so far, as the run's output goes on growing */
+        remove_job_box(job, index);
+        if (box) {
+            ContentBuffer *so_far = content_buffer_freeze(job->output);
+            box_content_share(box, so_far);
+            content_buffer_release(so_far);
+            end_output(NULL, box, COMMAND_CANCELLED, -1, job->lines, runner->timeout);
+            box->command_state = COMMAND_CANCELLED;
+            box->command_exit = -1;
+            canvas_redraw_box(canvas, box_id);
+        }
+    } else if (job->pid > 0) {
+        stop_job(job, COMMAND_CANCELLED, now_seconds());
+    } else {
+        finish_job(canvas, job, COMMAND_CANCELLED, -1, runner->timeout);
+        free_job(job);
+    }
+    return 0;
+}
+
+int command_runner_poll(CommandRunner *runner, Canvas *canvas) {
+    double now = now_seconds();
+    int updated = 0;
+
+    for (int i = 0; i < runner->result_count; ) {
+        if (now - runner->results[i].finished >= runner->cache_ttl) {
+            remove_result(runner, i);
+        } else {
+            i++;
+        }
+    }
+
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        CommandJob *job = &runner->jobs[i];
+        if (!job->active || job->pid == 0) {
+            continue;
+        }
+
+        for (int b = job->box_count - 1; b >= 0; b--) {
+            if (!canvas_get_box(canvas, job->boxes[b].id)) {
+                leave_job(job, b);  /* Box deleted while its command ran */
+            }
+        }
+
+        bool changed = job->fd >= 0 && read_output(job);
+
+        if (job->kill_at == 0.0 && job->stop_at > 0.0 && now >= job->stop_at) {
+            stop_job(job, COMMAND_TIMED_OUT, now);
+        } else if (job->kill_at > 0.0 && now >= job->kill_at) {
+            kill(-job->pid, SIGKILL);
+        }
+
+        int status;
+        if (waitpid(job->pid, &status, WNOHANG) == job->pid) {
+            /* Whatever is still buffered in the pipe belongs to this run */
+            if (job->fd >= 0) {
+                read_output(job);
+                if (job->line_len > 0) {
+                    emit_line(job);
+                }
+                close(job->fd);
+                job->fd = -1;
+            }
+            if (job->box_count > 0) {
+                CommandState state = COMMAND_EXITED;
+                int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                if (job->kill_at > 0.0) {
+                    state = job->stop_reason;
+                    exit_code = -1;
+                }
+                updated += finish_job(canvas, job, state, exit_code, runner->timeout);
+                if (state == COMMAND_EXITED) {
+                    keep_result(runner, job, exit_code, now);
+                }
+            }
+            free_job(job);
+        } else if (changed) {
+            updated += mark_live_boxes(canvas, job);
+        }
+    }
+
+    /* Start queued runs, oldest request first, as slots free up */
+    int running = command_runner_running(runner);
+    while (running < runner->max_running) {
+        CommandJob *next = NULL;
+        for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+            CommandJob *job = &runner->jobs[i];
+            if (job->active && job->pid == 0 && (!next || job->seq < next->seq)) {
+                next = job;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        if (launch_job(runner, canvas, next) == 0) {
+            running++;
+        }
+        updated++;
+    }
+
+    /* Scheduled refreshes take the slots left over, most overdue first.
+     * A run of the same command already in flight or just finished is
+     * shared without a slot. While the pool is full the rest simply
+     * wait; periods missed meanwhile are skipped rather than run in a
+     * burst. */
+    for (int i = 0; i < runner->refresh_count; ) {
+        if (!refreshable(canvas_get_box(canvas, runner->refresh[i].box_id))) {
+            remove_refresh(runner, i);  /* Box deleted or no longer scheduled */
+        } else {
+            i++;
+        }
+    }
+    for (;;) {
+        CommandRefresh *next = NULL;
+        for (int i = 0; i < runner->refresh_count; i++) {
+            CommandRefresh *entry = &runner->refresh[i];
+            if (entry->due <= now && (!next || entry->due < next->due)) {
+                next = entry;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        Box *box = canvas_get_box(canvas, next->box_id);
+        if (command_runner_busy(runner, box->id)) {
+            next->due = next_refresh(runner, box->refresh_interval, now);
+            continue;  /* Previous run still in flight: skip this one */
+        }
+        CommandJob *shared = find_shared_job(runner, box);
+        if (reuse_result(runner, canvas, box, now)) {
+            next->due = next_refresh(runner, box->refresh_interval, now);
+            updated++;
+            continue;
+        }
+        if (shared && join_job(canvas, shared, box, false) == 0) {
+            next->due = next_refresh(runner, box->refresh_interval, now);
+            continue;
+        }
+        if (running >= runner->max_running) {
+            break;
+        }
+        next->due = next_refresh(runner, box->refresh_interval, now);
+        CommandJob *job = add_job(runner, canvas, box, true);
+        if (!job) {
+            break;  /* Every job slot taken; try again next period */
+        }
+        if (launch_job(runner, canvas, job) == 0) {
+            running++;
+        }
+    }
+    return updated;
+}
+
+int command_runner_fds(const CommandRunner *runner, int *fds, int max) {
+    int count = 0;
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS && count < max; i++) {
+        if (runner->jobs[i].active && runner->jobs[i].fd >= 0) {
+            fds[count++] = runner->jobs[i].fd;
+        }
+    }
+    return count;
+}
+
+double command_runner_next_deadline(const CommandRunner *runner) {
+    double next = -1.0;
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        const CommandJob *job = &runner->jobs[i];
+        if (!job->active || job->pid == 0) {
+            continue;
+        }
+        double deadline;
+        if (job->fd < 0) {
+            deadline = now_seconds() + REAP_RETRY_INTERVAL;
+        } else if (job->kill_at > 0.0) {
+            deadline = job->kill_at;
+        } else if (job->stop_at > 0.0) {
+            deadline = job->stop_at;
+        } else {
+            continue;
+        }
+        if (next < 0.0 || deadline < next) {
+            next = deadline;
+        }
+    }
+
+    /* With the pool full a refresh waits for a slot, and a child exiting
+     * wakes the loop anyway */
+    if (command_runner_running(runner) < runner->max_running) {
+        for (int i = 0; i < runner->refresh_count; i++) {
+            if (next < 0.0 || runner->refresh[i].due < next) {
+                next = runner->refresh[i].due;
+            }
+        }
+    }
+    return next;
+}
+
+void command_runner_shutdown(CommandRunner *runner) {
+    for (int i = 0; i < COMMAND_RUNNER_MAX_JOBS; i++) {
+        CommandJob *job = &runner->jobs[i];
+        if (job->active && job->pid > 0) {
+            kill(-job->pid, SIGKILL);
+            waitpid(job->pid, NULL, 0);
+        }
+        if (job->fd >= 0) {
+            close(job->fd);
+        }
+        if (job->active) {
+            free_job(job);
+        }
+    }
+    free(runner->refresh);
+    runner->refresh = NULL;
+    runner->refresh_count = 0;
+    runner->refresh_capacity = 0;
+    while (runner->result_count > 0) {
+        remove_result(runner, 0);
+    }
+    free(runner->results);
+    runner->results = NULL;
+    runner->result_capacity = 0;
+    if (global_runner == runner) {
+        global_runner = NULL;
+    }
+}
+
+#else /* _WIN32 */
+
+/* No fork(): callers fall back to command_runner_execute() */
+int command_runner_start(CommandRunner *runner, Canvas *canvas, int box_id) {
+    (void)runner; (void)canvas; (void)box_id;
+    return -1;
+}
+
+int command_runner_cancel(CommandRunner *runner, Canvas *canvas, int box_id) {
+    (void)runner; (void)canvas; (void)box_id;
+    return -1;
+}
+
+int command_runner_poll(CommandRunner *runner, Canvas *canvas) {
+    (void)runner; (void)canvas;
+    return 0;
+}
+
+int command_runner_fds(const CommandRunner *runner, int *fds, int max) {
+    (void)runner; (void)fds; (void)max;
+    return 0;
+}
+
+double command_runner_next_deadline(const CommandRunner *runner) {
+    (void)runner;
+    return -1.0;
+}
+
+int command_runner_running(const CommandRunner *runner) {
+    (void)runner;
+    return 0;
+}
+
+bool command_runner_busy(const CommandRunner *runner, int box_id) {
+    (void)runner; (void)box_id;
+    return false;
+}
+
+void command_runner_shutdown(CommandRunner *runner) {
+    free(runner->refresh);
+    runner->refresh = NULL;
+    runner->refresh_count = 0;
+    runner->refresh_capacity = 0;
+    if (global_runner == runner) {
+        global_runner = NULL;
+    }
+}
+
+#endif /* _WIN32 */
@@ -16,7 +16,15 @@ void config_init_defaults(AppConfig *config) {
     /* General */
     config->show_visualizer = true;
     config->auto_save = false;
+    config->journal = false;
+    config->watch = false;
+    config->control_socket[0] = '\0';
     config->show_welcome_box = false;   /* Empty canvas by default (Issue #47) */
+    config->max_fps = 60;               /* Upper bound; idle canvases draw nothing */
+
+    /* Command boxes */
+    config->command_max_running = 4;
+    config->command_timeout = 30;
 
     /* Box templates (Issue #17) */
     config->template_square_width = 20;
@@ -148,8 +156,19 @@ static int parse_config_line(AppConfig *config, const char *section, const char
             config->show_visualizer = (strcmp(value, "true") == 0);
         } else if (strcmp(key, "auto_save") == 0) {
             config->auto_save = (strcmp(value, "true") == 0);
+        } else if (strcmp(key, "journal") == 0) {
+            config->journal = (strcmp(value, "true") == 0);
+        } else if (strcmp(key, "watch") == 0) {
+            config->watch = (strcmp(value, "true") == 0);
+        } else if (strcmp(key, "control_socket") == 0) {
+            strncpy(config->control_socket, value, sizeof(config->control_socket) - 1);
+            config->control_socket[sizeof(config->control_socket) - 1] = '\0';
         } else if (strcmp(key, "show_welcome_box") == 0) {
             config->show_welcome_box = (strcmp(value, "true") == 0);
+        } else if (strcmp(key, "max_fps") == 0) {
+            config->max_fps = atoi(value);
+            if (config->max_fps < 1) config->max_fps = 1;
+            if (config->max_fps > 240) config->max_fps = 240;
         }
     } else if (strcmp(section, "grid") == 0) {
         if (strcmp(key, "visible") == 0) {
@@ -159,6 +178,15 @@ static int parse_config_line(AppConfig *config, const char *section, const char
         } else if (strcmp(key, "spacing") == 0) {
             config->grid_spacing = atoi(value);
         }
+    } else if (strcmp(section, "commands") == 0) {
+        if (strcmp(key, "max_running") == 0) {
+            config->command_max_running = atoi(value);
+            if (config->command_max_running < 1) config->command_max_running = 1;
+            if (config->command_max_running > 16) config->command_max_running = 16;
+        } else if (strcmp(key, "timeout") == 0) {
+            config->command_timeout = atoi(value);
+            if (config->command_timeout < 0) config->command_timeout = 0;
+        }
     } else if (strcmp(section, "templates") == 0) {
         /* Box template settings (Issue #17) */
         if (strcmp(key, "square_width") == 0) {
@@ -330,13 +358,21 @@ int config_save(const AppConfig *config, const char *path) {
 
     fprintf(f, "[general]\n");
     fprintf(f, "show_visualizer = %s\n", config->show_visualizer ? "true" : "false");
-    fprintf(f, "auto_save = %s\n\n", config->auto_save ? "true" : "false");
+    fprintf(f, "auto_save = %s\n", config->auto_save ? "true" : "false");
+    fprintf(f, "journal = %s\n", config->journal ? "true" : "false");
+    fprintf(f, "watch = %s\n", config->watch ? "true" : "false");
+    fprintf(f, "control_socket = %s\n", config->control_socket);
+    fprintf(f, "max_fps = %d\n\n", config->max_fps);
 
     fprintf(f, "[grid]\n");
     fprintf(f, "visible = %s\n", config->grid_visible_default ? "true" : "false");
     fprintf(f, "snap_enabled = %s\n", config->grid_snap_default ? "true" : "false");
     fprintf(f, "spacing = %d\n\n", config->grid_spacing);
 
+    fprintf(f, "[commands]\n");
+    fprintf(f, "max_running = %d\n", config->command_max_running);
+    fprintf(f, "timeout = %d\n\n", config->command_timeout);
+
     fprintf(f, "[icons]\n");
     fprintf(f, "# Icons for different box types (Issue #33)\n");
     fprintf(f, "note = %s\n", config->icon_note);
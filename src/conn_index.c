@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "conn_index.h"
+#include "id_index.h"
+
+/* Reserved connection ID values for empty and deleted pair slots */
+#define PAIR_EMPTY     INT_MIN
+#define PAIR_TOMBSTONE (INT_MIN + 1)
+
+/* Smallest pair table allocated on first insert */
+#define PAIR_MIN_CAPACITY 16
+
+/* Mix both box IDs so (a, b) and (b, a) land in different slots */
+static unsigned int hash_pair(int source_id, int dest_id, int capacity) {
+    unsigned int h = (unsigned int)source_id * 2654435769u;
+    h ^= (unsigned int)dest_id * 2246822519u + (h << 6) + (h >> 2);
+    return h & (unsigned int)(capacity - 1);
+}
+
+/* Rebuild the pair table at a new capacity, dropping tombstones */
+static int pair_rehash(ConnIndex *index, int new_capacity) {
+    ConnPairSlot *slots = malloc(sizeof(ConnPairSlot) * new_capacity);
+    if (slots == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < new_capacity; i++) {
+        slots[i].conn_id = PAIR_EMPTY;
+    }
+
+    unsigned int mask = (unsigned int)(new_capacity - 1);
+    for (int i = 0; i < index->pair_capacity; i++) {
+        const ConnPairSlot *old = &index->pairs[i];
+        if (old->conn_id == PAIR_EMPTY || old->conn_id == PAIR_TOMBSTONE) {
+            continue;
+        }
+        unsigned int slot = hash_pair(old->source_id, old->dest_id, new_capacity);
+        while (slots[slot].conn_id != PAIR_EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = *old;
+    }
+
+    free(index->pairs);
+    index->pairs = slots;
+    index->pair_capacity = new_capacity;
+    index->pair_tombstones = 0;
+    return 0;
+}
+
+/* Slot holding a pair, or -1 if absent */
+static int pair_slot(const ConnIndex *index, int source_id, int dest_id) {
+    if (index->pair_capacity == 0) {
+        return -1;
+    }
+
+    unsigned int mask = (unsigned int)(index->pair_capacity - 1);
+    unsigned int slot = hash_pair(source_id, dest_id, index->pair_capacity);
+
+    while (index->pairs[slot].conn_id != PAIR_EMPTY) {
+        const ConnPairSlot *s = &index->pairs[slot];
+        if (s->conn_id != PAIR_TOMBSTONE &&
+            s->source_id == source_id && s->dest_id == dest_id) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static int pair_put(ConnIndex *index, const Connection *conn) {
+    if ((index->pair_count + index->pair_tombstones + 1) * 2 > index->pair_capacity) {
+        int new_capacity = index->pair_capacity ? index->pair_capacity : PAIR_MIN_CAPACITY;
+        while ((index->pair_count + 1) * 2 > new_capacity) {
+            new_capacity *= 2;
+        }
+        if (pair_rehash(index, new_capacity) != 0) {
+            return -1;
+        }
+    }
+
+    unsigned int mask = (unsigned int)(index->pair_capacity - 1);
+    unsigned int slot = hash_pair(conn->source_id, conn->dest_id, index->pair_capacity);
+    while (index->pairs[slot].conn_id != PAIR_EMPTY &&
+           index->pairs[slot].conn_id != PAIR_TOMBSTONE) {
+        slot = (slot + 1) & mask;
+    }
+
+    if (index->pairs[slot].conn_id == PAIR_TOMBSTONE) {
+        index->pair_tombstones--;
+    }
+    index->pairs[slot].source_id = conn->source_id;
+    index->pairs[slot].dest_id = conn->dest_id;
+    index->pairs[slot].conn_id = conn->id;
+    index->pair_count++;
+    return 0;
+}
+
+static void pair_remove(ConnIndex *index, int source_id, int dest_id) {
+    int slot = pair_slot(index, source_id, dest_id);
+    if (slot >= 0) {
+        index->pairs[slot].conn_id = PAIR_TOMBSTONE;
+        index->pair_count--;
+        index->pair_tombstones++;
+    }
+}
+
+/* Adjacency list of a box, creating an empty one if needed */
+static ConnAdjacency *adjacency_get_or_create(ConnIndex *index, int box_id) {
+    int a = id_index_get(&index->adjacency_of, box_id);
+    if (a >= 0) {
+        return &index->adjacency[a];
+    }
+
+    if (index->adjacency_count >= index->adjacency_capacity) {
+        int new_capacity = index->adjacency_capacity ? index->adjacency_capacity * 2 : 16;
+        ConnAdjacency *grown = realloc(index->adjacency, sizeof(ConnAdjacency) * new_capacity);
+        if (grown == NULL) {
+            return NULL;
+        }
+        index->adjacency = grown;
+        index->adjacency_capacity = new_capacity;
+    }
+
+    if (id_index_put(&index->adjacency_of, box_id, index->adjacency_count) != 0) {
+        return NULL;
+    }
+    ConnAdjacency *adj = &index->adjacency[index->adjacency_count++];
+    adj->box_id = box_id;
+    adj->conn_ids = NULL;
+    adj->count = 0;
+    adj->capacity = 0;
+    return adj;
+}
+
+static int adjacency_push(ConnIndex *index, int box_id, int conn_id) {
+    ConnAdjacency *adj = adjacency_get_or_create(index, box_id);
+    if (adj == NULL) {
+        return -1;
+    }
+    if (adj->count >= adj->capacity) {
+        int new_capacity = adj->capacity ? adj->capacity * 2 : 4;
+        int *grown = realloc(adj->conn_ids, sizeof(int) * new_capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        adj->conn_ids = grown;
+        adj->capacity = new_capacity;
+    }
+    adj->conn_ids[adj->count++] = conn_id;
+    return 0;
+}
+
+/* Remove one connection from a box's list, keeping creation order.
+ * Searches from the back so draining a list newest-first is O(1) per edge. */
+static void adjacency_remove(ConnIndex *index, int box_id, int conn_id) {
+    int a = id_index_get(&index->adjacency_of, box_id);
+    if (a < 0) {
+        return;
+    }
+    ConnAdjacency *adj = &index->adjacency[a];
+    for (int i = adj->count - 1; i >= 0; i--) {
+        if (adj->conn_ids[i] == conn_id) {
+            memmove(&adj->conn_ids[i], &adj->conn_ids[i + 1],
+                    sizeof(int) * (adj->count - i - 1));
+            adj->count--;
+            return;
+        }
+    }
+}
+
+void conn_index_init(ConnIndex *index) {
+    id_index_init(&index->by_id);
+    index->pairs = NULL;
+    index->pair_capacity = 0;
+    index->pair_count = 0;
+    index->pair_tombstones = 0;
+    id_index_init(&index->adjacency_of);
+    index->adjacency = NULL;
+    index->adjacency_count = 0;
+    index->adjacency_capacity = 0;
+}
+
+void conn_index_free(ConnIndex *index) {
+    id_index_free(&index->by_id);
+    free(index->pairs);
+    id_index_free(&index->adjacency_of);
+    for (int a = 0; a < index->adjacency_count; a++) {
+        free(index->adjacency[a].conn_ids);
+    }
+    free(index->adjacency);
+    conn_index_init(index);
+}
+
+int conn_index_reserve(ConnIndex *index, int count) {
+    if (id_index_reserve(&index->by_id, count) != 0) {
+        return -1;
+    }
+    int needed = PAIR_MIN_CAPACITY;
+    while (needed < count * 2) {
+        needed *= 2;
+    }
+    if (needed > index->pair_capacity) {
+        return pair_rehash(index, needed);
+    }
+    return 0;
+}
+
+int conn_index_insert(ConnIndex *index, const Connection *conn, int position) {
+    if (id_index_put(&index->by_id, conn->id, position) != 0) {
+        return -1;
+    }
+    if (pair_put(index, conn) != 0) {
+        id_index_remove(&index->by_id, conn->id);
+        return -1;
+    }
+    if (adjacency_push(index, conn->source_id, conn->id) != 0) {
+        pair_remove(index, conn->source_id, conn->dest_id);
+        id_index_remove(&index->by_id, conn->id);
+        return -1;
+    }
+    if (adjacency_push(index, conn->dest_id, conn->id) != 0) {
+        adjacency_remove(index, conn->source_id, conn->id);
+        pair_remove(index, conn->source_id, conn->dest_id);
+        id_index_remove(&index->by_id, conn->id);
+        return -1;
+    }
+    return 0;
+}
+
+int conn_index_remove(ConnIndex *index, const Connection *conn) {
+    if (id_index_remove(&index->by_id, conn->id) != 0) {
+        return -1;
+    }
+    pair_remove(index, conn->source_id, conn->dest_id);
+    adjacency_remove(index, conn->source_id, conn->id);
+    adjacency_remove(index, conn->dest_id, conn->id);
+    return 0;
+}
+
+int conn_index_set_position(ConnIndex *index, int conn_id, int position) {
+    return id_index_put(&index->by_id, conn_id, position);
+}
+
+int conn_index_position(const ConnIndex *index, int conn_id) {
+    return id_index_get(&index->by_id, conn_id);
+}
+
+int conn_index_find_pair(const ConnIndex *index, int source_id, int dest_id) {
+    int slot = pair_slot(index, source_id, dest_id);
+    return slot >= 0 ? index->pairs[slot].conn_id : -1;
+}
+
+const int *conn_index_box_edges(const ConnIndex *index, int box_id, int *count) {
+    int a = id_index_get(&index->adjacency_of, box_id);
+    if (a < 0 || index->adjacency[a].count == 0) {
+        *count = 0;
+        return NULL;
+    }
+    *count = index->adjacency[a].count;
+    return index->adjacency[a].conn_ids;
+}
+
+void conn_index_drop_box(ConnIndex *index, int box_id) {
+    int a = id_index_get(&index->adjacency_of, box_id);
+    if (a < 0 || index->adjacency[a].count > 0) {
+        return;
+    }
+
+    free(index->adjacency[a].conn_ids);
+    id_index_remove(&index->adjacency_of, box_id);
+
+    /* Swap the last list into the hole */
+    int last = index->adjacency_count - 1;
+    if (a != last) {
+        index->adjacency[a] = index->adjacency[last];
+        id_index_put(&index->adjacency_of, index->adjacency[a].box_id, a);
+    }
+    index->adjacency_count--;
+}
@@ -0,0 +1,599 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "control.h"
+#include "canvas.h"
+#include "box_content.h"
+
+#define CONTROL_BUFFER_INITIAL 4096
+
+/* Commands being applied: the lines from p to end */
+typedef struct {
+    char *p;
+    char *end;
+} Cursor;
+
+/* What one command did */
+typedef struct {
+    const char *error;      /* Reason it failed (NULL: it did not) */
+    int value;              /* ID made by add or connect (-1: none) */
+    bool replied;           /* Reply already written (query), or none due */
+} Outcome;
+
+void control_server_init(ControlServer *server) {
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+int control_server_listen(ControlServer *server, const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    /* A socket nobody answers on was left by a session that is gone */
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        close(fd);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    if (errno == ECONNREFUSED) {
+        unlink(path);
+    }
+    close(fd);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    /* Only this user may change the canvas */
+    mode_t mask = umask(077);
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    char *copy = strdup(path);
+    if (bound != 0 || listen(fd, CONTROL_MAX_CLIENTS) != 0 || copy == NULL) {
+        int error = copy ? errno : ENOMEM;
+        if (bound == 0) {
+            unlink(path);
+        }
+        free(copy);
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    set_nonblocking(fd);
+    server->listen_fd = fd;
+    server->path = copy;
+    return 0;
+}
+
+static void close_client(ControlServer *server, int i) {
+    ControlClient *client = &server->clients[i];
+    close(client->fd);
+    free(client->in);
+    free(client->out);
+    server->clients[i] = server->clients[--server->client_count];
+}
+
+void control_server_shutdown(ControlServer *server) {
+    while (server->client_count > 0) {
+        close_client(server, server->client_count - 1);
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        unlink(server->path);
+    }
+    free(server->path);
+    control_server_init(server);
+}
+
+int control_server_fds(const ControlServer *server, int *fds, int max) {
+    int count = 0;
+    if (server->listen_fd >= 0 && count < max) {
+        fds[count++] = server->listen_fd;
+    }
+    for (int i = 0; i < server->client_count && count < max; i++) {
+        fds[count++] = server->clients[i].fd;
+    }
+    return count;
+}
+
+bool control_server_pending(const ControlServer *server) {
+    for (int i = 0; i < server->client_count; i++) {
+        const ControlClient *client = &server->clients[i];
+        if (client->more || client->out_len > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ============================================================
+ * Connections
+ * ============================================================ */
+
+static void accept_clients(ControlServer *server) {
+    while (server->listen_fd >= 0) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;
+        }
+        if (server->client_count == CONTROL_MAX_CLIENTS) {
+            static const char busy[] = "err too many clients\n";
+            ssize_t ignored = send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            (void)ignored;
+            close(fd);
+            continue;
+        }
+        ControlClient *client = &server->clients[server->client_count];
+        memset(client, 0, sizeof(*client));
+        client->fd = fd;
+        client->in = malloc(CONTROL_BUFFER_INITIAL);
+        client->out = malloc(CONTROL_BUFFER_INITIAL);
+        if (client->in == NULL || client->out == NULL) {
+            free(client->in);
+            free(client->out);
+            close(fd);
+            continue;
+        }
+        client->in_capacity = CONTROL_BUFFER_INITIAL;
+        client->out_capacity = CONTROL_BUFFER_INITIAL;
+        set_nonblocking(fd);
+        server->client_count++;
+    }
+}
+
+/* Read what the client sent, up to a read-ahead limit (more while a
+ * command is incomplete) */
+static void read_client(ControlClient *client) {
+    if (client->in_start > 0) {
+        client->in_len -= client->in_start;
+        memmove(client->in, client->in + client->in_start, client->in_len);
+        client->in_start = 0;
+    }
+    size_t limit = client->stalled ? CONTROL_INPUT_MAX : CONTROL_READ_AHEAD;
+    while (!client->closing && client->in_len < limit) {
+        if (client->in_capacity - client->in_len < CONTROL_BUFFER_INITIAL) {
+            size_t capacity = client->in_capacity * 2;
+            char *grown = realloc(client->in, capacity);
+            if (grown == NULL) {
+                client->failed = true;
+                return;
+            }
+            client->in = grown;
+            client->in_capacity = capacity;
+        }
+        ssize_t n = read(client->fd, client->in + client->in_len,
+                         client->in_capacity - client->in_len - 1);
+        if (n > 0) {
+            client->in_len += (size_t)n;
+        } else if (n == 0) {
+            /* A last command without its newline still counts */
+            if (client->in_len > 0 && client->in[client->in_len - 1] != '\n') {
+                client->in[client->in_len++] = '\n';
+            }
+            client->closing = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            client->failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return;
+        }
+    }
+}
+
+/* Send queued replies; a client that stops reading them is dropped */
+static void flush_client(ControlClient *client) {
+    size_t sent = 0;
+    while (sent < client->out_len) {
+        /* A client gone away is an error here, not a SIGPIPE */
+        ssize_t n = send(client->fd, client->out + sent, client->out_len - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                client->failed = true;
+            }
+            break;
+        }
+    }
+    client->out_len -= sent;
+    memmove(client->out, client->out + sent, client->out_len);
+    if (client->out_len > CONTROL_OUTPUT_MAX) {
+        client->failed = true;
+    }
+}
+
+static void reply(ControlClient *client, const char *format, ...) {
+    for (;;) {
+        size_t room = client->out_capacity - client->out_len;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(client->out + client->out_len, room, format, args);
+        va_end(args);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < room) {
+            client->out_len += (size_t)n;
+            return;
+        }
+        size_t capacity = client->out_capacity * 2;
+        while (capacity < client->out_len + (size_t)n + 1) {
+            capacity *= 2;
+        }
+        char *grown = realloc(client->out, capacity);
+        if (grown == NULL) {
+            client->failed = true;
+            return;
+        }
+        client->out = grown;
+        client->out_capacity = capacity;
+    }
+}
+
+/* ============================================================
+ * Commands
+ * ============================================================ */
+
+/* First line of a command, as a string, for matching its head */
+static void command_head(const char *p, const char *newline, char *head, size_t size) {
+    size_t len = (size_t)(newline - p);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(head, p, len);
+    head[len] = '\0';
+}
+
+/* End of the complete command at p (NULL if it is not all there).
+ * Reads the head as run_command() does. */
+static char *command_end(char *p, char *end, bool nested) {
+    char *newline = memchr(p, '\n', (size_t)(end - p));
+    if (newline == NULL) {
+        return NULL;
+    }
+    char head[64];
+    command_head(p, newline, head, sizeof(head));
+    char *next = newline + 1;
+    char word[16], field[16];
+    int id, count;
+    if (sscanf(head, "%15s %d %15s %d", word, &id, field, &count) == 4 &&
+        strcmp(word, "update") == 0 && strcmp(field, "content") == 0) {
+        for (int i = 0; i < count && next != NULL; i++) {
+            next = memchr(next, '\n', (size_t)(end - next));
+            next = next ? next + 1 : NULL;
+        }
+    } else if (!nested && sscanf(head, "%15s %d", word, &count) == 2 &&
+               strcmp(word, "batch") == 0) {
+        for (int i = 0; i < count && next != NULL; i++) {
+            next = command_end(next, end, true);
+        }
+    }
+    return next;
+}
+
+/* Take the next line as a string (empty once the command is used up) */
+static char *take_line(Cursor *cursor) {
+    char *line = cursor->p;
+    char *newline = memchr(line, '\n', (size_t)(cursor->end - line));
+    if (newline == NULL) {
+        static char none[1];
+        none[0] = '\0';
+        cursor->p = cursor->end;
+        return none;
+    }
+    cursor->p = newline + 1;
+    if (newline > line && newline[-1] == '\r') {
+        newline--;
+    }
+    *newline = '\0';
+    return line;
+}
+
+/* Text after n characters of fields and one space */
+static const char *rest(const char *line, int n) {
+    line += n;
+    return *line == ' ' ? line + 1 : line;
+}
+
+/* True if a position is in range (see control.h); otherwise say why */
+static bool valid_pos(double x, double y, Outcome *out) {
+    if (!isfinite(x) || !isfinite(y) || fabs(x) > CONTROL_COORD_MAX ||
+        fabs(y) > CONTROL_COORD_MAX) {
+        out->error = "X and Y must be finite, at most 1e9 from 0";
+        return false;
+    }
+    return true;
+}
+
+static bool valid_size(int w, int h, Outcome *out) {
+    if (w < 3 || h < 3 || w > CONTROL_SIZE_MAX || h > CONTROL_SIZE_MAX) {
+        out->error = "W and H must be 3-10000";
+        return false;
+    }
+    return true;
+}
+
+static void set_title(Canvas *canvas, Box *box, const char *title) {
+    char *copy = strdup(title);
+    if (copy != NULL) {
+        free(box->title);
+        box->title = copy;
+        canvas_mark_box_dirty(canvas, box->id);
+    }
+}
+
+/* update ID FIELD ... */
+static void run_update(Canvas *canvas, const char *args, Cursor *cursor, Outcome *out) {
+    int id, n = 0;
+    char field[16];
+    if (sscanf(args, "%d %15s%n", &id, field, &n) != 2) {
+        out->error = "usage: update ID FIELD VALUE";
+        return;
+    }
+    const char *value = rest(args, n);
+    Box *box = canvas_get_box(canvas, id);
+
+    if (strcmp(field, "content") == 0) {
+        /* Take the lines even if the box is missing */
+        int count = atoi(value);
+        ContentBuffer *content = box && count > 0 ? content_buffer_create(count, 0) : NULL;
+        for (int i = 0; i < count; i++) {
+            const char *line = take_line(cursor);
+            if (content) {
+                content_buffer_append(content, line, strlen(line));
+            }
+        }
+        if (box == NULL) {
+            out->error = "no such box";
+        } else if (count < 0) {
+            out->error = "bad line count";
+        } else {
+            box_content_share(box, content);
+            canvas_mark_box_dirty(canvas, id);
+        }
+        content_buffer_release(content);
+        return;
+    }
+    if (box == NULL) {
+        out->error = "no such box";
+        return;
+    }
+
+    double x, y;
+    int a, b;
+    if (strcmp(field, "pos") == 0) {
+        if (sscanf(value, "%lf %lf", &x, &y) != 2) {
+            out->error = "usage: update ID pos X Y";
+        } else if (valid_pos(x, y, out)) {
+            canvas_move_box(canvas, id, x, y);
+        }
+    } else if (strcmp(field, "size") == 0) {
+        if (sscanf(value, "%d %d", &a, &b) != 2) {
+            out->error = "usage: update ID size W H";
+        } else if (valid_size(a, b, out)) {
+            canvas_resize_box(canvas, id, a, b);
+        }
+    } else if (strcmp(field, "title") == 0) {
+        set_title(canvas, box, value);
+    } else if (strcmp(field, "color") == 0) {
+        if (sscanf(value, "%d", &a) != 1 || a < BOX_COLOR_DEFAULT || a > BOX_COLOR_WHITE) {
+            out->error = "color must be 0-7";
+        } else {
+            box->color = a;
+            canvas_mark_box_dirty(canvas, id);
+        }
+    } else if (strcmp(field, "type") == 0) {
+        if (sscanf(value, "%d", &a) != 1 || a < 0 || a >= BOX_TYPE_COUNT) {
+            out->error = "type must be 0-3";
+        } else {
+            box->box_type = (BoxType)a;
+            canvas_mark_box_dirty(canvas, id);
+        }
+    } else if (strcmp(field, "append") == 0) {
+        if (box_content_append(box, value) != 0) {
+            out->error = "out of memory";
+        } else {
+            canvas_mark_box_dirty(canvas, id);
+        }
+    } else {
+        out->error = "unknown field";
+    }
+}
+
+static void run_query(ControlClient *client, Canvas *canvas, const char *args, Outcome *out) {
+    int id;
+    if (sscanf(args, "%d", &id) != 1) {
+        reply(client, "ok %d %d\n", canvas->box_count, canvas->conn_count);
+        out->replied = true;
+        return;
+    }
+    const Box *box = canvas_get_box(canvas, id);
+    if (box == NULL) {
+        out->error = "no such box";
+        return;
+    }
+    reply(client, "ok %d %.2f %.2f %d %d %d %d %d %s\n", box->id, box->x, box->y,
+          box->width, box->height, box->color, (int)box->box_type,
+          box_content_count(box), box->title ? box->title : "");
+    out->replied = true;
+}
+
+static void run_command(ControlClient *client, Canvas *canvas, Cursor *cursor, bool nested, Outcome *out);
+
+/* batch N: the next N commands, with one reply for all of them */
+static void run_batch(ControlClient *client, Canvas *canvas, const char *args, Cursor *cursor) {
+    int count = atoi(args);
+    int failed_at = 0;
+    const char *error = NULL;
+    int *values = count > 0 ? malloc(sizeof(int) * (size_t)count) : NULL;
+    int value_count = 0;
+    for (int i = 0; i < count; i++) {
+        Outcome inner = {NULL, -1, false};
+        run_command(client, canvas, cursor, true, &inner);
+        if (inner.error && failed_at == 0) {
+            failed_at = i + 1;
+            error = inner.error;
+        }
+        if (inner.value >= 0 && values) {
+            values[value_count++] = inner.value;
+        }
+    }
+    if (failed_at > 0) {
+        reply(client, "err %d %s\n", failed_at, error);
+    } else {
+        reply(client, "ok");
+        for (int i = 0; i < value_count; i++) {
+            reply(client, " %d", values[i]);
+        }
+        reply(client, "\n");
+    }
+    free(values);
+}
+
+static void run_command(ControlClient *client, Canvas *canvas, Cursor *cursor, bool nested, Outcome *out) {
+    const char *line = take_line(cursor);
+    char word[16];
+    int n = 0;
+    if (sscanf(line, "%15s%n", word, &n) != 1) {
+        out->replied = !nested;  /* Blank lines are skipped */
+        if (nested) {
+            out->error = "empty command";
+        }
+        return;
+    }
+    const char *args = rest(line, n);
+    double x, y;
+    int a, b, c;
+
+    if (strcmp(word, "add") == 0) {
+        if (sscanf(args, "%lf %lf %d %d%n", &x, &y, &a, &b, &n) != 4) {
+            out->error = "usage: add X Y W H [TITLE]";
+            return;
+        }
+        if (!valid_pos(x, y, out) || !valid_size(a, b, out)) {
+            return;
+        }
+        out->value = canvas_add_box(canvas, x, y, a, b, rest(args, n));
+        if (out->value < 0) {
+            out->error = "out of memory";
+        }
+    } else if (strcmp(word, "update") == 0) {
+        run_update(canvas, args, cursor, out);
+    } else if (strcmp(word, "delete") == 0) {
+        if (sscanf(args, "%d", &a) != 1 || canvas_remove_box(canvas, a) != 0) {
+            out->error = "no such box";
+        }
+    } else if (strcmp(word, "connect") == 0) {
+        c = CONNECTION_COLOR_DEFAULT;
+        int fields = sscanf(args, "%d %d %d", &a, &b, &c);
+        if (fields < 2 || c < BOX_COLOR_DEFAULT || c > BOX_COLOR_WHITE) {
+            out->error = "usage: connect SRC DST [COLOR]";
+            return;
+        }
+        out->value = canvas_add_connection(canvas, a, b);
+        if (out->value < 0) {
+            out->error = "cannot connect";
+        } else {
+            canvas_get_connection(canvas, out->value)->color = c;
+        }
+    } else if (strcmp(word, "disconnect") == 0) {
+        if (sscanf(args, "%d", &a) != 1 || canvas_remove_connection(canvas, a) != 0) {
+            out->error = "no such connection";
+        }
+    } else if (strcmp(word, "query") == 0 && !nested) {
+        run_query(client, canvas, args, out);
+    } else if (strcmp(word, "batch") == 0 && !nested) {
+        run_batch(client, canvas, args, cursor);
+        out->replied = true;
+    } else if (strcmp(word, "ping") == 0) {
+        /* Nothing to do */
+    } else if (nested && (strcmp(word, "query") == 0 || strcmp(word, "batch") == 0)) {
+        out->error = "not allowed in a batch";
+    } else {
+        out->error = "unknown command";
+    }
+}
+
+/* Apply the client's complete commands, up to CONTROL_PASS_MAX */
+static int run_commands(ControlClient *client, Canvas *canvas) {
+    char *p = client->in + client->in_start;
+    char *end = client->in + client->in_len;
+    int applied = 0;
+    client->more = false;
+    client->stalled = false;
+    while (p < end) {
+        if (applied >= CONTROL_PASS_MAX) {
+            client->more = true;
+            break;
+        }
+        char *next = command_end(p, end, false);
+        if (next == NULL) {
+            client->stalled = true;
+            if (client->in_len >= CONTROL_INPUT_MAX) {
+                reply(client, "err command too long\n");
+                client->closing = true;
+                p = end;
+            }
+            break;
+        }
+        /* Lines become strings in place */
+        Cursor cursor = {p, next};
+        Outcome out = {NULL, -1, false};
+        run_command(client, canvas, &cursor, false, &out);
+        if (out.error) {
+            reply(client, "err %s\n", out.error);
+        } else if (out.value >= 0) {
+            reply(client, "ok %d\n", out.value);
+        } else if (!out.replied) {
+            reply(client, "ok\n");
+        }
+        p = next;
+        applied++;
+    }
+    client->in_start = (size_t)(p - client->in);
+    return applied;
+}
+
+int control_server_poll(ControlServer *server, Canvas *canvas) {
+    accept_clients(server);
+    int applied = 0;
+    for (int i = server->client_count - 1; i >= 0; i--) {
+        ControlClient *client = &server->clients[i];
+        read_client(client);
+        if (!client->failed) {
+            applied += run_commands(client, canvas);
+            flush_client(client);
+        }
+        bool done = client->closing && !client->more && client->out_len == 0;
+        if (client->failed || done) {
+            close_client(server, i);
+        }
+    }
+    return applied;
+}
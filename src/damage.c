@@ -0,0 +1,123 @@
+#include "damage.h"
+
+static bool rects_overlap(const DamageRect *a, const DamageRect *b) {
+    return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+static void rect_union(DamageRect *into, const DamageRect *r) {
+    if (r->x0 < into->x0) into->x0 = r->x0;
+    if (r->y0 < into->y0) into->y0 = r->y0;
+    if (r->x1 > into->x1) into->x1 = r->x1;
+    if (r->y1 > into->y1) into->y1 = r->y1;
+}
+
+static double rect_area(const DamageRect *r) {
+    return (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+void damage_init(Damage *damage) {
+    damage->count = 0;
+    damage->full = false;
+}
+
+void damage_clear(Damage *damage) {
+    damage_init(damage);
+}
+
+void damage_mark_all(Damage *damage) {
+    damage->count = 0;
+    damage->full = true;
+}
+
+void damage_mark(Damage *damage, double x0, double y0, double x1, double y1) {
+    if (damage->full || x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    DamageRect r = {x0, y0, x1, y1};
+
+    /* Absorb every rect the new one touches; the union may touch more */
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < damage->count; i++) {
+            if (rects_overlap(&damage->rects[i], &r)) {
+                rect_union(&r, &damage->rects[i]);
+                damage->rects[i] = damage->rects[--damage->count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (damage->count < DAMAGE_MAX_RECTS) {
+        damage->rects[damage->count++] = r;
+        return;
+    }
+
+    /* List full: fold into the rect whose area grows least */
+    int best = 0;
+    double best_growth = 0.0;
+    for (int i = 0; i < damage->count; i++) {
+        DamageRect u = damage->rects[i];
+        rect_union(&u, &r);
+        double growth = rect_area(&u) - rect_area(&damage->rects[i]);
+        if (i == 0 || growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    rect_union(&damage->rects[best], &r);
+}
+
+void damage_merge(Damage *dest, const Damage *src) {
+    if (src->full) {
+        damage_mark_all(dest);
+        return;
+    }
+    for (int i = 0; i < src->count; i++) {
+        const DamageRect *r = &src->rects[i];
+        damage_mark(dest, r->x0, r->y0, r->x1, r->y1);
+    }
+}
+
+bool damage_is_empty(const Damage *damage) {
+    return !damage->full && damage->count == 0;
+}
+
+bool damage_contains(const Damage *damage, double x, double y) {
+    if (damage->full) {
+        return true;
+    }
+    for (int i = 0; i < damage->count; i++) {
+        const DamageRect *r = &damage->rects[i];
+        if (x >= r->x0 && x < r->x1 && y >= r->y0 && y < r->y1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool damage_intersects(const Damage *damage, double x0, double y0, double x1, double y1) {
+    if (damage->full) {
+        return true;
+    }
+    for (int i = 0; i < damage->count; i++) {
+        const DamageRect *r = &damage->rects[i];
+        if (x0 < r->x1 && r->x0 < x1 && y0 < r->y1 && r->y0 < y1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool damage_bounds(const Damage *damage, DamageRect *bounds) {
+    if (damage->count == 0) {
+        return false;
+    }
+    *bounds = damage->rects[0];
+    for (int i = 1; i < damage->count; i++) {
+        rect_union(bounds, &damage->rects[i]);
+    }
+    return true;
+}
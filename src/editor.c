@@ -100,6 +100,7 @@ void editor_cancel(Canvas *canvas) {
                 box->title = restored;
             }
             /* On strdup failure, keep current title rather than setting NULL */
+            canvas_mark_box_dirty(canvas, editor->box_id);
         }
     }
 
@@ -130,6 +131,7 @@ int editor_confirm(Canvas *canvas) {
             /* Apply the new title */
             free(box->title);
             box->title = new_title;
+            canvas_mark_box_dirty(canvas, editor->box_id);
         }
     }
 
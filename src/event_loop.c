@@ -0,0 +1,182 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include "event_loop.h"
+
+double event_loop_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void event_loop_init(EventLoop *loop, int max_fps) {
+    memset(loop, 0, sizeof(*loop));
+    event_loop_set_max_fps(loop, max_fps);
+    loop->woke_at = event_loop_now();
+}
+
+void event_loop_set_max_fps(EventLoop *loop, int max_fps) {
+    if (max_fps < EVENT_LOOP_MIN_FPS) max_fps = EVENT_LOOP_MIN_FPS;
+    if (max_fps > EVENT_LOOP_MAX_FPS) max_fps = EVENT_LOOP_MAX_FPS;
+    loop->frame_interval = 1.0 / max_fps;
+}
+
+int event_loop_add_fd(EventLoop *loop, int fd) {
+    if (fd < 0 || loop->fd_count >= EVENT_LOOP_MAX_FDS) {
+        return -1;
+    }
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i] == fd) {
+            return 0;
+        }
+    }
+    loop->fds[loop->fd_count] = fd;
+    loop->ready[loop->fd_count] = false;
+    loop->hangup[loop->fd_count] = false;
+    loop->fd_count++;
+    return 0;
+}
+
+void event_loop_remove_fd(EventLoop *loop, int fd) {
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i] == fd) {
+            loop->fd_count--;
+            loop->fds[i] = loop->fds[loop->fd_count];
+            loop->ready[i] = loop->ready[loop->fd_count];
+            loop->hangup[i] = loop->hangup[loop->fd_count];
+            return;
+        }
+    }
+}
+
+bool event_loop_fd_ready(const EventLoop *loop, int fd) {
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i] == fd) {
+            return loop->ready[i];
+        }
+    }
+    return false;
+}
+
+bool event_loop_fd_hangup(const EventLoop *loop, int fd) {
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i] == fd) {
+            return loop->hangup[i];
+        }
+    }
+    return false;
+}
+
+int event_loop_add_timer(EventLoop *loop, double delay, double interval,
+                         EventTimerFn fn, void *ctx) {
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        EventTimer *timer = &loop->timers[i];
+        if (!timer->active) {
+            timer->active = true;
+            timer->deadline = event_loop_now() + (delay > 0.0 ? delay : 0.0);
+            timer->interval = interval > 0.0 ? interval : 0.0;
+            timer->fn = fn;
+            timer->ctx = ctx;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void event_loop_cancel_timer(EventLoop *loop, int timer_id) {
+    if (timer_id >= 0 && timer_id < EVENT_LOOP_MAX_TIMERS) {
+        loop->timers[timer_id].active = false;
+    }
+}
+
+double event_loop_next_deadline(const EventLoop *loop) {
+    double next = -1.0;
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        const EventTimer *timer = &loop->timers[i];
+        if (timer->active && (next < 0.0 || timer->deadline < next)) {
+            next = timer->deadline;
+        }
+    }
+    return next;
+}
+
+int event_loop_run_timers(EventLoop *loop) {
+    double now = event_loop_now();
+    int fired = 0;
+
+    for (int i = 0; i < EVENT_LOOP_MAX_TIMERS; i++) {
+        EventTimer *timer = &loop->timers[i];
+        if (!timer->active || timer->deadline > now) {
+            continue;
+        }
+
+        if (timer->interval > 0.0) {
+            /* Skip missed periods rather than firing a burst to catch up */
+            timer->deadline += timer->interval;
+            if (timer->deadline <= now) {
+                timer->deadline = now + timer->interval;
+            }
+        } else {
+            timer->active = false;
+        }
+
+        /* The callback may add or cancel timers, including this one */
+        timer->fn(timer->ctx);
+        fired++;
+    }
+    return fired;
+}
+
+double event_loop_next_frame(const EventLoop *loop) {
+    return loop->last_frame + loop->frame_interval;
+}
+
+void event_loop_frame_drawn(EventLoop *loop) {
+    loop->last_frame = event_loop_now();
+}
+
+int event_loop_wait(EventLoop *loop, double deadline) {
+    double timers = event_loop_next_deadline(loop);
+    if (timers >= 0.0 && (deadline < 0.0 || timers < deadline)) {
+        deadline = timers;
+    }
+
+    int timeout_ms = -1;
+    if (deadline >= 0.0) {
+        double remaining = deadline - event_loop_now();
+        /* Round up so a wake-up never lands just before the deadline */
+        timeout_ms = remaining > 0.0 ? (int)ceil(remaining * 1000.0) : 0;
+    }
+
+    struct pollfd pfds[EVENT_LOOP_MAX_FDS];
+    for (int i = 0; i < loop->fd_count; i++) {
+        pfds[i].fd = loop->fds[i];
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+        loop->ready[i] = false;
+        loop->hangup[i] = false;
+    }
+
+    int result = poll(pfds, (nfds_t)loop->fd_count, timeout_ms);
+    loop->wakeups++;
+    loop->woke_at = event_loop_now();
+    if (result < 0) {
+        /* A signal interrupted the wait; its handler has set a flag */
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int ready = 0;
+    for (int i = 0; i < loop->fd_count; i++) {
+        if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) {
+            loop->ready[i] = true;
+            ready++;
+        }
+        if (!(pfds[i].revents & POLLIN) && (pfds[i].revents & (POLLHUP | POLLERR | POLLNVAL))) {
+            loop->hangup[i] = true;
+        }
+    }
+    return ready;
+}
@@ -1,6 +1,7 @@
 #include "export.h"
 #include "viewport.h"
 #include "canvas.h"
+#include "box_content.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -79,14 +80,16 @@ static void render_box_to_grid(Cell *grid, int width, int height,
     }
     
     /* Draw content */
-    if (box->content && box->content_lines > 0 && sh > 2) {
+    int line_count = box_content_count(box);
+    if (line_count > 0 && sh > 2) {
         int cy = sy + 2;
-        for (int i = 0; i < box->content_lines && cy + i < sy + sh; i++) {
+        for (int i = 0; i < line_count && cy + i < sy + sh; i++) {
             int cx = sx + 2;
             int line_y = cy + i;
-            if (line_y >= 0 && line_y < height && box->content[i]) {
-                for (size_t j = 0; box->content[i][j] && cx + (int)j < sx + sw - 1; j++) {
-                    char buf[2] = {box->content[i][j], '\0'};
+            const char *line = box_content_line(box, i);
+            if (line_y >= 0 && line_y < height) {
+                for (size_t j = 0; line[j] && cx + (int)j < sx + sw - 1; j++) {
+                    char buf[2] = {line[j], '\0'};
                     set_cell(grid, width, cx + j, line_y, buf);
                 }
             }
@@ -140,7 +143,7 @@ int export_viewport_to_file(const Canvas *canvas, const Viewport *vp, const char
     }
     
     /* Render boxes and connections */
-    for (int i = 0; i < canvas->box_count; i++) {
+    for (int i = canvas_draw_first(canvas); i >= 0; i = canvas_draw_next(canvas, i)) {
         render_box_to_grid(grid, width, height, &canvas->boxes[i], vp);
     }
     render_connections_to_grid(grid, width, canvas, vp);
@@ -0,0 +1,432 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "file_map.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Maps opened but not yet fully indexed */
+static FileMap *pending = NULL;
+
+static bool line_span(FileMap *map, int i, size_t *start, size_t *end);
+
+static void remove_pending(FileMap *map) {
+    for (FileMap **p = &pending; *p != NULL; p = &(*p)->next_pending) {
+        if (*p == map) {
+            *p = map->next_pending;
+            map->next_pending = NULL;
+            return;
+        }
+    }
+}
+
+static int add_mark(FileMap *map, size_t offset) {
+    if (map->mark_count == map->mark_capacity) {
+        int new_capacity = map->mark_capacity ? map->mark_capacity * 2 : 64;
+        size_t *new_marks = realloc(map->marks, sizeof(size_t) * new_capacity);
+        if (new_marks == NULL) {
+            return -1;
+        }
+        map->marks = new_marks;
+        map->mark_capacity = new_capacity;
+    }
+    map->marks[map->mark_count++] = offset;
+    return 0;
+}
+
+/* Hand the pages below 'to', from the one holding 'from', back to the
+ * kernel once scanned. They are clean, so touching them again just
+ * reads them back from the page cache. */
+static void release_pages(const FileMap *map, size_t from, size_t to) {
+#ifndef _WIN32
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = from / page * page;
+    size_t end = to / page * page;
+    if (end > start) {
+        madvise((void *)(map->data + start), end - start, MADV_DONTNEED);
+    }
+#else
+    (void)map;
+    (void)from;
+    (void)to;
+#endif
+}
+
+/* Drop the index and the cached lines; the first size bytes are
+ * indexed again a slice at a time */
+static void reset_index(FileMap *map) {
+    remove_pending(map);
+    map->mark_count = 0;
+    map->lines = 0;
+    map->scanned = 0;
+    map->complete = true;
+    for (int i = 0; i < FILE_MAP_CACHE_LINES; i++) {
+        map->cache[i].line = -1;
+    }
+    if (map->size > 0) {
+        map->complete = false;
+        map->next_pending = pending;
+        pending = map;
+    }
+}
+
+/* Cut the map to the file's current size if it shrank, so no page
+ * past the end is touched. Returns false if it did. */
+static bool clamp_to_file(FileMap *map) {
+#ifndef _WIN32
+    if (map->fd < 0) {
+        return true;
+    }
+    struct stat st;
+    size_t size = fstat(map->fd, &st) == 0 ? (size_t)st.st_size : 0;
+    if (size >= map->size) {
+        return true;
+    }
+    map->size = size;
+    map->cut = true;
+    reset_index(map);
+    return false;
+#else
+    (void)map;
+    return true;
+#endif
+}
+
+/* Map path into an unmapped map and start a fresh index (0, or -1 on
+ * error, leaving the map empty) */
+static int map_file(FileMap *map, const char *path) {
+    map->data = NULL;
+    map->size = 0;
+    map->mapped = 0;
+    map->fd = -1;
+    map->cut = false;
+    reset_index(map);
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    map->mapped = map->size;
+    map->fd = fd;
+    reset_index(map);
+    file_map_index(map, FILE_MAP_OPEN_INDEX);
+    return 0;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+static void unmap_file(FileMap *map) {
+#ifndef _WIN32
+    if (map->data != NULL) {
+        munmap((void *)map->data, map->mapped);
+    }
+    if (map->fd >= 0) {
+        close(map->fd);
+    }
+#endif
+    map->data = NULL;
+    map->fd = -1;
+}
+
+FileMap *file_map_open(const char *path) {
+    if (path == NULL) {
+        return NULL;
+    }
+    FileMap *map = calloc(1, sizeof(FileMap));
+    if (map == NULL) {
+        return NULL;
+    }
+    map->refs = 1;
+    map->fd = -1;
+    if (map_file(map, path) != 0) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+int file_map_reopen(FileMap *map, const char *path) {
+    unmap_file(map);
+    return map_file(map, path);
+}
+
+FileMap *file_map_retain(FileMap *map) {
+    if (map != NULL) {
+        map->refs++;
+    }
+    return map;
+}
+
+void file_map_close(FileMap *map) {
+    if (map == NULL || --map->refs > 0) {
+        return;
+    }
+    remove_pending(map);
+    unmap_file(map);
+    for (int i = 0; i < FILE_MAP_CACHE_LINES; i++) {
+        free(map->cache[i].text);
+    }
+    free(map->marks);
+    free(map);
+}
+
+int file_map_grow(FileMap *map, const char *path) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < map->size) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == map->size) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    /* An unterminated last line is dropped from the index and scanned
+     * again with the bytes that follow it */
+    if (clamp_to_file(map) && map->complete && map->lines > 0 &&
+        map->data[map->size - 1] != '\n') {
+        size_t start, end;
+        line_span(map, map->lines - 1, &start, &end);
+        map->lines--;
+        if (map->lines % FILE_MAP_STRIDE == 0) {
+            map->mark_count--;
+        }
+        map->scanned = start;
+        map->cache[(unsigned)map->lines % FILE_MAP_CACHE_LINES].line = -1;
+    }
+
+    unmap_file(map);
+    map->data = data;
+    map->size = size;
+    map->mapped = size;
+    map->fd = fd;
+    map->cut = false;
+    if (map->complete) {
+        map->complete = false;
+        map->next_pending = pending;
+        pending = map;
+    }
+    return 0;
+#else
+    (void)map;
+    (void)path;
+    return -1;
+#endif
+}
+
+int file_map_count(const FileMap *map) {
+    return map ? map->lines : 0;
+}
+
+bool file_map_complete(const FileMap *map) {
+    return map == NULL || map->complete;
+}
+
+size_t file_map_index(FileMap *map, size_t budget) {
+    if (map == NULL || map->complete) {
+        return 0;
+    }
+    clamp_to_file(map);
+    if (map->complete) {
+        return 0;
+    }
+    size_t start = map->scanned;
+    size_t limit = map->size - start > budget ? start + budget : map->size;
+    size_t pos = start;
+
+    while (pos < limit) {
+        if (map->lines % FILE_MAP_STRIDE == 0 && add_mark(map, pos) != 0) {
+            /* Out of memory: show the lines indexed so far */
+            pos = map->size;
+            break;
+        }
+        map->lines++;
+        const char *nl = memchr(map->data + pos, '\n', map->size - pos);
+        pos = nl ? (size_t)(nl - map->data) + 1 : map->size;
+    }
+
+    map->scanned = pos;
+    if (pos >= map->size) {
+        map->complete = true;
+        remove_pending(map);
+    }
+    release_pages(map, start, pos);
+    return pos - start;
+}
+
+/* Byte range of line i without its line ending */
+static bool line_span(FileMap *map, int i, size_t *start, size_t *end) {
+    clamp_to_file(map);
+    while (!map->complete && map->lines <= i) {
+        file_map_index(map, FILE_MAP_OPEN_INDEX);
+    }
+    if (i < 0 || i >= map->lines) {
+        return false;
+    }
+
+    size_t pos = map->marks[i / FILE_MAP_STRIDE];
+    for (int skip = i % FILE_MAP_STRIDE; skip > 0; skip--) {
+        const char *nl = memchr(map->data + pos, '\n', map->size - pos);
+        pos = (size_t)(nl - map->data) + 1;
+    }
+    const char *nl = memchr(map->data + pos, '\n', map->size - pos);
+    *start = pos;
+    *end = nl ? (size_t)(nl - map->data) : map->size;
+    if (*end > *start && map->data[*end - 1] == '\r') {
+        (*end)--;
+    }
+    return true;
+}
+
+const char *file_map_line(FileMap *map, int i, size_t *len) {
+    if (map == NULL) {
+        return NULL;
+    }
+    FileMapLine *slot = &map->cache[(unsigned)i % FILE_MAP_CACHE_LINES];
+    if (i < 0 || slot->line != i) {
+        size_t start, end;
+        if (!line_span(map, i, &start, &end)) {
+            return NULL;
+        }
+        size_t n = end - start;
+        if (n > FILE_MAP_LINE_MAX) {
+            n = FILE_MAP_LINE_MAX;
+        }
+        if (slot->capacity < n + 1) {
+            char *text = realloc(slot->text, n + 1);
+            if (text == NULL) {
+                return NULL;
+            }
+            slot->text = text;
+            slot->capacity = n + 1;
+        }
+        memcpy(slot->text, map->data + start, n);
+        slot->text[n] = '\0';
+        slot->len = n;
+        slot->line = i;
+    }
+    if (len != NULL) {
+        *len = slot->len;
+    }
+    return slot->text;
+}
+
+int file_map_find(FileMap *map, const char *needle, int start_line) {
+    size_t start, end;
+    if (map == NULL || needle == NULL) {
+        return -1;
+    }
+    if (start_line < 0) {
+        start_line = 0;
+    }
+    if (!line_span(map, start_line, &start, &end)) {
+        return -1;
+    }
+    size_t n = strlen(needle);
+    if (n == 0) {
+        return start_line;
+    }
+
+    /* Search the bytes in one pass, then work out the hit's line */
+    const char *hit = memmem(map->data + start, map->size - start, needle, n);
+    if (hit == NULL) {
+        release_pages(map, start, map->size);
+        return -1;
+    }
+    size_t offset = (size_t)(hit - map->data);
+    release_pages(map, start, offset);
+    while (!map->complete && map->scanned <= offset) {
+        file_map_index(map, FILE_MAP_INDEX_SLICE);
+    }
+    if (offset >= map->size) {
+        return -1;  /* The file was cut short before the hit */
+    }
+
+    int lo = 0, hi = map->mark_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (map->marks[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    int line = lo * FILE_MAP_STRIDE;
+    size_t pos = map->marks[lo];
+    for (;;) {
+        const char *nl = memchr(map->data + pos, '\n', map->size - pos);
+        if (nl == NULL || (size_t)(nl - map->data) >= offset) {
+            break;
+        }
+        pos = (size_t)(nl - map->data) + 1;
+        line++;
+    }
+    return line;
+}
+
+size_t file_map_heap_bytes(const FileMap *map) {
+    if (map == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(FileMap) + sizeof(size_t) * (size_t)map->mark_capacity;
+    for (int i = 0; i < FILE_MAP_CACHE_LINES; i++) {
+        bytes += map->cache[i].capacity;
+    }
+    return bytes;
+}
+
+bool file_map_pending(void) {
+    return pending != NULL;
+}
+
+int file_map_index_pending(size_t budget, FileMapProgressFn progress, void *ctx) {
+    int advanced = 0;
+    FileMap *map = pending;
+    while (map != NULL && budget > 0) {
+        /* Finishing the map unlinks it */
+        FileMap *next = map->next_pending;
+        size_t done = file_map_index(map, budget);
+        budget = done < budget ? budget - done : 0;
+        advanced++;
+        if (progress != NULL) {
+            progress(map, ctx);
+        }
+        map = next;
+    }
+    return advanced;
+}
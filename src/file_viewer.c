@@ -4,6 +4,56 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "file_viewer.h"
+#include "box_content.h"
+#include "file_map.h"
+#include "canvas.h"
+#include "file_watch.h"
+
+int file_viewer_read_lines(ContentBuffer *buffer, FILE *f, size_t *consumed, bool *partial) {
+    char *line_buf = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    int result = 0;
+
+    *consumed = 0;
+    *partial = false;
+    while ((len = getline(&line_buf, &line_cap, f)) != -1) {
+        /* Remove trailing newline, and the CR of a Windows CRLF */
+        if (len > 0 && line_buf[len - 1] == '\n') {
+            *consumed += (size_t)len;
+            line_buf[--len] = '\0';
+            if (len > 0 && line_buf[len - 1] == '\r') {
+                line_buf[--len] = '\0';
+            }
+        } else {
+            *partial = true;
+        }
+        if (content_buffer_append(buffer, line_buf, (size_t)len) != 0) {
+            result = -1;
+            break;
+        }
+    }
+
+    free(line_buf);
+    return result;
+}
+
+int file_viewer_attach(Box *box, const char *filepath, ContentBuffer *content, FileMap *map) {
+    char *path = strdup(filepath);
+    if (path == NULL) {
+        return -1;
+    }
+    file_viewer_clear(box);
+    if (map != NULL) {
+        box->file_map = file_map_retain(map);
+    } else {
+        box_content_share(box, content);
+    }
+    free(box->file_path);
+    box->file_path = path;
+    box->content_type = BOX_CONTENT_FILE;
+    return 0;
+}
 
 /* Load file contents into a box */
 int file_viewer_load(Box *box, const char *filepath) {
@@ -11,15 +61,27 @@ int file_viewer_load(Box *box, const char *filepath) {
         return -1;
     }
 
+    /* Boxes showing the same file share the watched copy */
+    FileWatch *watch = file_watch_get_global();
+    if (watch != NULL) {
+        return file_watch_load(watch, box, filepath);
+    }
+
     /* Check file exists and get size */
     struct stat st;
     if (stat(filepath, &st) != 0) {
         return -1;
     }
 
-    /* Check file size limit */
-    if (st.st_size > MAX_FILE_SIZE) {
-        return -1;
+    /* Large files are read in place; lines are copied out as displayed */
+    if (st.st_size > FILE_VIEWER_MAP_THRESHOLD) {
+        FileMap *map = file_map_open(filepath);
+        if (map == NULL) {
+            return -1;
+        }
+        int result = file_viewer_attach(box, filepath, NULL, map);
+        file_map_close(map);
+        return result;
     }
 
     /* Open file for reading */
@@ -28,72 +90,20 @@ int file_viewer_load(Box *box, const char *filepath) {
         return -1;
     }
 
-    /* Clear existing content */
-    file_viewer_clear(box);
-
-    /* Count lines first */
-    int line_count = 0;
-    char line_buf[MAX_FILE_LINE_LENGTH];
-    while (fgets(line_buf, sizeof(line_buf), f) != NULL) {
-        line_count++;
-    }
-
-    /* Rewind to start */
-    rewind(f);
-
-    /* Allocate content array */
-    if (line_count > 0) {
-        box->content = malloc(sizeof(char *) * line_count);
-        if (box->content == NULL) {
-            fclose(f);
-            return -1;
-        }
-
-        /* Read lines into content array */
-        int i = 0;
-        while (fgets(line_buf, sizeof(line_buf), f) != NULL && i < line_count) {
-            /* Remove trailing newline */
-            size_t len = strlen(line_buf);
-            if (len > 0 && line_buf[len - 1] == '\n') {
-                line_buf[len - 1] = '\0';
-                /* Also handle Windows CRLF */
-                if (len > 1 && line_buf[len - 2] == '\r') {
-                    line_buf[len - 2] = '\0';
-                }
-            }
-            box->content[i] = strdup(line_buf);
-            if (box->content[i] == NULL) {
-                /* Cleanup on allocation failure */
-                for (int j = 0; j < i; j++) {
-                    free(box->content[j]);
-                }
-                free(box->content);
-                box->content = NULL;
-                fclose(f);
-                return -1;
-            }
-            i++;
-        }
-        box->content_lines = i;
-    } else {
-        box->content = NULL;
-        box->content_lines = 0;
-    }
-
-    fclose(f);
-
-    /* Set file path and content type */
-    if (box->file_path != NULL) {
-        free(box->file_path);
-    }
-    box->file_path = strdup(filepath);
-    if (box->file_path == NULL) {
-        file_viewer_clear(box);
+    /* Size the buffer from the file so reading never reallocates text */
+    ContentBuffer *content = content_buffer_create(0, (size_t)st.st_size + 1);
+    size_t consumed;
+    bool partial;
+    if (content == NULL || file_viewer_read_lines(content, f, &consumed, &partial) != 0) {
+        content_buffer_release(content);
+        fclose(f);
         return -1;
     }
-    box->content_type = BOX_CONTENT_FILE;
+    fclose(f);
 
-    return 0;
+    int result = file_viewer_attach(box, filepath, content, NULL);
+    content_buffer_release(content);
+    return result;
 }
 
 /* Reload file contents for a file-type box */
@@ -127,17 +137,7 @@ void file_viewer_clear(Box *box) {
         return;
     }
 
-    /* Free content lines */
-    if (box->content != NULL) {
-        for (int i = 0; i < box->content_lines; i++) {
-            if (box->content[i] != NULL) {
-                free(box->content[i]);
-            }
-        }
-        free(box->content);
-        box->content = NULL;
-    }
-    box->content_lines = 0;
+    box_content_clear(box);
 }
 
 /* Check if file exists and is readable */
@@ -177,3 +177,30 @@ const char *file_viewer_basename(const char *filepath) {
 
     return filepath;
 }
+
+/* Redraw boxes whose file finished indexing, or whose growing line
+ * count is on show in focus mode */
+static void index_progress(FileMap *map, void *ctx) {
+    Canvas *canvas = ctx;
+    if (file_map_complete(map)) {
+        for (int i = canvas_draw_first(canvas); i >= 0; i = canvas_draw_next(canvas, i)) {
+            Box *box = canvas_get_box_at(canvas, i);
+            if (box->file_map == map) {
+                canvas_redraw_box(canvas, box->id);
+            }
+        }
+    } else if (canvas->focus.active) {
+        Box *box = canvas_get_box(canvas, canvas->focus.focused_box_id);
+        if (box != NULL && box->file_map == map) {
+            canvas_redraw_box(canvas, box->id);
+        }
+    }
+}
+
+bool file_viewer_indexing(void) {
+    return file_map_pending();
+}
+
+void file_viewer_index_step(Canvas *canvas) {
+    file_map_index_pending(FILE_MAP_INDEX_SLICE, index_progress, canvas);
+}
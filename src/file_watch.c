@@ -0,0 +1,420 @@
+#define _XOPEN_SOURCE 700
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "file_watch.h"
+#include "file_viewer.h"
+#include "file_map.h"
+#include "box_content.h"
+#include "canvas.h"
+
+#ifdef __linux__
+/* Writes, truncation, and the file being moved or deleted */
+#define WATCH_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF)
+#endif
+
+static FileWatch *global_watch = NULL;
+
+void file_watch_set_global(FileWatch *watch) {
+    global_watch = watch;
+}
+
+FileWatch *file_watch_get_global(void) {
+    return global_watch;
+}
+
+int file_watch_init(FileWatch *watch) {
+    memset(watch, 0, sizeof(*watch));
+#ifdef __linux__
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    watch->fd = -1;
+#endif
+    return watch->fd >= 0 ? 0 : -1;
+}
+
+int file_watch_fd(const FileWatch *watch) {
+    return watch->fd;
+}
+
+static void add_watch(FileWatch *watch, WatchedFile *file) {
+#ifdef __linux__
+    file->wd = watch->fd >= 0 ? inotify_add_watch(watch->fd, file->path, WATCH_EVENTS) : -1;
+#else
+    (void)watch;
+    file->wd = -1;
+#endif
+}
+
+static void remove_watch(FileWatch *watch, WatchedFile *file) {
+#ifdef __linux__
+    if (file->wd < 0) {
+        return;
+    }
+    /* Hard links to one file share a watch descriptor */
+    for (int i = 0; i < watch->count; i++) {
+        if (&watch->files[i] != file && watch->files[i].wd == file->wd) {
+            file->wd = -1;
+            return;
+        }
+    }
+    inotify_rm_watch(watch->fd, file->wd);
+#else
+    (void)watch;
+#endif
+    file->wd = -1;
+}
+
+/* Remember the file's identity, size and last bytes */
+static void take_sample(WatchedFile *file, int fd, size_t size) {
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        file->dev = (unsigned long long)st.st_dev;
+        file->ino = (unsigned long long)st.st_ino;
+    }
+    file->size = size;
+    size_t n = size < FILE_WATCH_SAMPLE ? size : FILE_WATCH_SAMPLE;
+    ssize_t got = pread(fd, file->sample, n, (off_t)(size - n));
+    file->sample_len = got > 0 ? (size_t)got : 0;
+}
+
+static void sample_path(WatchedFile *file, size_t size) {
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        take_sample(file, fd, size);
+        close(fd);
+    }
+}
+
+/* True if the bytes read last time are still there, so the file can
+ * only have grown */
+static bool sample_matches(const WatchedFile *file, int fd) {
+    char now[FILE_WATCH_SAMPLE];
+    if (file->sample_len == 0) {
+        return file->size == 0;
+    }
+    ssize_t got = pread(fd, now, file->sample_len, (off_t)(file->size - file->sample_len));
+    return got == (ssize_t)file->sample_len && memcmp(now, file->sample, file->sample_len) == 0;
+}
+
+/* Parse lines from byte offset 'from' (the end of the last complete
+ * line) to the end of the file into file->content */
+static int read_lines_from(WatchedFile *file, size_t from) {
+    FILE *f = fopen(file->path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    if (fseeko(f, (off_t)from, SEEK_SET) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    size_t consumed;
+    bool partial;
+    int result = file_viewer_read_lines(file->content, f, &consumed, &partial);
+    file->parsed = from + consumed;
+    file->partial = partial;
+    off_t end = ftello(f);
+    take_sample(file, fileno(f), end > 0 ? (size_t)end : 0);
+    fclose(f);
+    return result;
+}
+
+/* Read the whole file again into the same buffer or mapping */
+static int read_all(WatchedFile *file) {
+    if (file->map != NULL) {
+        int result = file_map_reopen(file->map, file->path);
+        sample_path(file, file->map->size);
+        return result;
+    }
+    /* Check the file is readable before dropping what is shown */
+    if (access(file->path, R_OK) != 0) {
+        return -1;
+    }
+    content_buffer_reset(file->content);
+    return read_lines_from(file, 0);
+}
+
+/* Parse only what was added since the last read */
+static int read_appended(WatchedFile *file) {
+    if (file->map != NULL) {
+        if (file_map_grow(file->map, file->path) != 0) {
+            return read_all(file);
+        }
+        sample_path(file, file->map->size);
+        return 0;
+    }
+    /* A last line without a newline may have been continued */
+    if (file->partial) {
+        content_buffer_truncate(file->content, content_buffer_count(file->content) - 1);
+    }
+    return read_lines_from(file, file->parsed);
+}
+
+/* Bring a file's shared copy up to date (1 if it changed, 0 if not,
+ * -1 if the file cannot be read; the old copy stays up then) */
+static int update_file(WatchedFile *file) {
+    /* A mapping cut short is read again from the start, and only once */
+    bool cut = file->map != NULL && file->map->cut;
+    if (cut) {
+        file->map->cut = false;
+    }
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    bool same = (unsigned long long)st.st_dev == file->dev &&
+                (unsigned long long)st.st_ino == file->ino;
+    bool grew = !cut && same && size >= file->size && sample_matches(file, fd);
+    close(fd);
+    if (grew && size == file->size) {
+        return 0;
+    }
+
+    int result = grew ? read_appended(file) : read_all(file);
+    file->updated = true;
+    return result == 0 ? 1 : -1;
+}
+
+static WatchedFile *find_file(FileWatch *watch, const char *key) {
+    for (int i = 0; i < watch->count; i++) {
+        if (strcmp(watch->files[i].path, key) == 0) {
+            return &watch->files[i];
+        }
+    }
+    return NULL;
+}
+
+/* Read a file for the first time and start watching it */
+static WatchedFile *add_file(FileWatch *watch, const char *key) {
+    struct stat st;
+    if (stat(key, &st) != 0) {
+        return NULL;
+    }
+    if (watch->count == watch->capacity) {
+        int new_capacity = watch->capacity ? watch->capacity * 2 : 8;
+        WatchedFile *new_files = realloc(watch->files, sizeof(WatchedFile) * new_capacity);
+        if (new_files == NULL) {
+            return NULL;
+        }
+        watch->files = new_files;
+        watch->capacity = new_capacity;
+    }
+
+    WatchedFile *file = &watch->files[watch->count];
+    memset(file, 0, sizeof(*file));
+    file->wd = -1;
+    file->path = strdup(key);
+    if (file->path == NULL) {
+        return NULL;
+    }
+
+    /* Large files are read in place; lines are copied out as displayed */
+    int result;
+    if (st.st_size > FILE_VIEWER_MAP_THRESHOLD) {
+        file->map = file_map_open(key);
+        result = file->map ? 0 : -1;
+        if (file->map) {
+            sample_path(file, file->map->size);
+        }
+    } else {
+        file->content = content_buffer_create(0, (size_t)st.st_size + 1);
+        content_buffer_set_live(file->content, true);
+        result = file->content ? read_lines_from(file, 0) : -1;
+    }
+    if (result != 0) {
+        file_map_close(file->map);
+        content_buffer_release(file->content);
+        free(file->path);
+        return NULL;
+    }
+
+    add_watch(watch, file);
+    watch->count++;
+    return file;
+}
+
+static void free_file(FileWatch *watch, WatchedFile *file) {
+    remove_watch(watch, file);
+    content_buffer_release(file->content);
+    file_map_close(file->map);
+    free(file->path);
+}
+
+/* Forget files that only the watch still holds */
+static void prune(FileWatch *watch) {
+    for (int i = watch->count - 1; i >= 0; i--) {
+        WatchedFile *file = &watch->files[i];
+        int refs = file->map ? file->map->refs : file->content->refs;
+        if (refs <= 1) {
+            free_file(watch, file);
+            watch->files[i] = watch->files[--watch->count];
+        }
+    }
+}
+
+void file_watch_shutdown(FileWatch *watch) {
+    for (int i = 0; i < watch->count; i++) {
+        free_file(watch, &watch->files[i]);
+    }
+    free(watch->files);
+    if (watch->fd >= 0) {
+        close(watch->fd);
+    }
+    if (global_watch == watch) {
+        global_watch = NULL;
+    }
+    memset(watch, 0, sizeof(*watch));
+    watch->fd = -1;
+}
+
+int file_watch_load(FileWatch *watch, Box *box, const char *filepath) {
+    /* Different spellings of one path share a copy */
+    char resolved[PATH_MAX];
+    const char *key = realpath(filepath, resolved) ? resolved : filepath;
+
+    WatchedFile *file = find_file(watch, key);
+    if (file != NULL) {
+        if (update_file(file) < 0) {
+            return -1;
+        }
+    } else {
+        file = add_file(watch, key);
+        if (file == NULL) {
+            return -1;
+        }
+    }
+    int result = file_viewer_attach(box, filepath, file->content, file->map);
+    /* The box may have been showing another file */
+    prune(watch);
+    return result;
+}
+
+void file_watch_attach_canvas(FileWatch *watch, Canvas *canvas) {
+    for (int id = canvas_draw_first(canvas); id >= 0; id = canvas_draw_next(canvas, id)) {
+        Box *box = canvas_get_box_at(canvas, id);
+        if (box->content_type == BOX_CONTENT_FILE && box->file_path != NULL) {
+            /* Best effort: a missing file keeps the lines saved with the canvas */
+            file_watch_load(watch, box, box->file_path);
+        }
+    }
+}
+
+int file_watch_read_events(FileWatch *watch) {
+    int marked = 0;
+#ifdef __linux__
+    if (watch->fd < 0) {
+        return 0;
+    }
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(watch->fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            /* The queue overflowed: check everything */
+            bool all = (event->mask & IN_Q_OVERFLOW) != 0;
+            bool gone = (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) != 0;
+            for (int i = 0; i < watch->count; i++) {
+                WatchedFile *file = &watch->files[i];
+                if (!all && (event->wd < 0 || file->wd != event->wd)) {
+                    continue;
+                }
+                if (!file->changed) {
+                    file->changed = true;
+                    marked++;
+                }
+                if (gone && !all) {
+                    /* Watch whatever is at the path next, not the moved file */
+                    remove_watch(watch, file);
+                }
+            }
+        }
+    }
+#else
+    (void)watch;
+#endif
+    return marked;
+}
+
+bool file_watch_pending(const FileWatch *watch) {
+    for (int i = 0; i < watch->count; i++) {
+        const WatchedFile *file = &watch->files[i];
+        if (file->changed || file->updated || (file->map && file->map->cut)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int file_watch_apply(FileWatch *watch, Canvas *canvas) {
+    int updated = 0;
+    for (int i = 0; i < watch->count; i++) {
+        WatchedFile *file = &watch->files[i];
+        /* A mapping found cut short while being read needs no event */
+        if (file->changed || (file->map && file->map->cut)) {
+            file->changed = false;
+            update_file(file);
+            if (file->wd < 0) {
+                add_watch(watch, file);
+            }
+        }
+        /* A file read in that grew large is mapped instead from now on;
+         * its boxes move over below */
+        if (file->updated && file->content && file->size > FILE_VIEWER_MAP_THRESHOLD) {
+            file->map = file_map_open(file->path);
+            if (file->map) {
+                sample_path(file, file->map->size);
+            }
+        }
+        if (file->updated) {
+            updated++;
+        }
+    }
+    if (updated == 0) {
+        return 0;
+    }
+
+    for (int id = canvas_draw_first(canvas); id >= 0; id = canvas_draw_next(canvas, id)) {
+        Box *box = canvas_get_box_at(canvas, id);
+        for (int i = 0; i < watch->count; i++) {
+            const WatchedFile *file = &watch->files[i];
+            if (!file->updated) {
+                continue;
+            }
+            if (file->content && box->content == file->content) {
+                if (file->map) {
+                    file_viewer_attach(box, box->file_path, NULL, file->map);
+                }
+            } else if (!file->map || box->file_map != file->map) {
+                continue;
+            }
+            canvas_redraw_box(canvas, box->id);
+            break;
+        }
+    }
+    for (int i = 0; i < watch->count; i++) {
+        WatchedFile *file = &watch->files[i];
+        if (file->updated && file->content && file->map) {
+            content_buffer_release(file->content);
+            file->content = NULL;
+        }
+        file->updated = false;
+    }
+    prune(watch);
+    return updated;
+}
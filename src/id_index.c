@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "id_index.h"
+
+/* Reserved key values for empty and deleted slots */
+#define ID_INDEX_EMPTY     INT_MIN
+#define ID_INDEX_TOMBSTONE (INT_MIN + 1)
+
+/* Smallest table allocated on first insert */
+#define ID_INDEX_MIN_CAPACITY 16
+
+/* Fibonacci hashing - spreads sequential IDs across the table */
+static unsigned int hash_key(int key, int capacity) {
+    unsigned int h = (unsigned int)key * 2654435769u;
+    return h & (unsigned int)(capacity - 1);
+}
+
+/* Allocate a fresh table of the given capacity (power of two) */
+static int alloc_table(IdIndex *index, int capacity) {
+    index->keys = malloc(sizeof(int) * capacity);
+    index->values = malloc(sizeof(int) * capacity);
+    if (index->keys == NULL || index->values == NULL) {
+        free(index->keys);
+        free(index->values);
+        index->keys = NULL;
+        index->values = NULL;
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        index->keys[i] = ID_INDEX_EMPTY;
+    }
+    index->capacity = capacity;
+    index->count = 0;
+    index->tombstones = 0;
+    return 0;
+}
+
+/* Rebuild the table at a new capacity, dropping tombstones */
+static int rehash(IdIndex *index, int new_capacity) {
+    int *old_keys = index->keys;
+    int *old_values = index->values;
+    int old_capacity = index->capacity;
+
+    if (alloc_table(index, new_capacity) != 0) {
+        index->keys = old_keys;
+        index->values = old_values;
+        index->capacity = old_capacity;
+        return -1;
+    }
+
+    for (int i = 0; i < old_capacity; i++) {
+        int key = old_keys[i];
+        if (key == ID_INDEX_EMPTY || key == ID_INDEX_TOMBSTONE) {
+            continue;
+        }
+        unsigned int slot = hash_key(key, new_capacity);
+        while (index->keys[slot] != ID_INDEX_EMPTY) {
+            slot = (slot + 1) & (unsigned int)(new_capacity - 1);
+        }
+        index->keys[slot] = key;
+        index->values[slot] = old_values[i];
+        index->count++;
+    }
+
+    free(old_keys);
+    free(old_values);
+    return 0;
+}
+
+void id_index_init(IdIndex *index) {
+    index->keys = NULL;
+    index->values = NULL;
+    index->capacity = 0;
+    index->count = 0;
+    index->tombstones = 0;
+}
+
+void id_index_free(IdIndex *index) {
+    free(index->keys);
+    free(index->values);
+    id_index_init(index);
+}
+
+void id_index_clear(IdIndex *index) {
+    for (int i = 0; i < index->capacity; i++) {
+        index->keys[i] = ID_INDEX_EMPTY;
+    }
+    index->count = 0;
+    index->tombstones = 0;
+}
+
+int id_index_reserve(IdIndex *index, int count) {
+    /* Keep load factor (including tombstones) at or below 1/2 */
+    int needed = ID_INDEX_MIN_CAPACITY;
+    while (needed < count * 2) {
+        needed *= 2;
+    }
+    if (needed <= index->capacity) {
+        return 0;
+    }
+    if (index->keys == NULL) {
+        return alloc_table(index, needed);
+    }
+    return rehash(index, needed);
+}
+
+int id_index_put(IdIndex *index, int key, int value) {
+    if (key == ID_INDEX_EMPTY || key == ID_INDEX_TOMBSTONE) {
+        return -1;
+    }
+
+    if ((index->count + index->tombstones + 1) * 2 > index->capacity) {
+        int new_capacity = index->capacity ? index->capacity : ID_INDEX_MIN_CAPACITY;
+        /* Only grow if live entries need it; otherwise just purge tombstones */
+        while ((index->count + 1) * 2 > new_capacity) {
+            new_capacity *= 2;
+        }
+        int result = index->keys ? rehash(index, new_capacity)
+                                 : alloc_table(index, new_capacity);
+        if (result != 0) {
+            return -1;
+        }
+    }
+
+    unsigned int mask = (unsigned int)(index->capacity - 1);
+    unsigned int slot = hash_key(key, index->capacity);
+    int reuse = -1;
+
+    while (index->keys[slot] != ID_INDEX_EMPTY) {
+        if (index->keys[slot] == key) {
+            index->values[slot] = value;
+            return 0;
+        }
+        if (index->keys[slot] == ID_INDEX_TOMBSTONE && reuse < 0) {
+            reuse = (int)slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (reuse >= 0) {
+        slot = (unsigned int)reuse;
+        index->tombstones--;
+    }
+    index->keys[slot] = key;
+    index->values[slot] = value;
+    index->count++;
+    return 0;
+}
+
+int id_index_get(const IdIndex *index, int key) {
+    if (index->capacity == 0 || key == ID_INDEX_EMPTY || key == ID_INDEX_TOMBSTONE) {
+        return -1;
+    }
+
+    unsigned int mask = (unsigned int)(index->capacity - 1);
+    unsigned int slot = hash_key(key, index->capacity);
+
+    while (index->keys[slot] != ID_INDEX_EMPTY) {
+        if (index->keys[slot] == key) {
+            return index->values[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+int id_index_remove(IdIndex *index, int key) {
+    if (index->capacity == 0 || key == ID_INDEX_EMPTY || key == ID_INDEX_TOMBSTONE) {
+        return -1;
+    }
+
+    unsigned int mask = (unsigned int)(index->capacity - 1);
+    unsigned int slot = hash_key(key, index->capacity);
+
+    while (index->keys[slot] != ID_INDEX_EMPTY) {
+        if (index->keys[slot] == key) {
+            index->keys[slot] = ID_INDEX_TOMBSTONE;
+            index->count--;
+            index->tombstones++;
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
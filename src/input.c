@@ -6,12 +6,16 @@
 #include "input_unified.h"
 #include "viewport.h"
 #include "canvas.h"
+#include "box_content.h"
 #include "persistence.h"
 #include "joystick.h"
 #include "config.h"
 #include "export.h"
 #include "file_viewer.h"
+#include "file_watch.h"
 #include "command_runner.h"
+#include "journal.h"
+#include "saver.h"
 #include "test_mode.h"
 #include "undo.h"
 #include "editor.h"
@@ -40,6 +44,12 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
 /* Helper function to execute command line commands (Issue #55) */
 static void execute_command(Canvas *canvas);
 
+/* Helper function to run a command box (in the background when a runner is set) */
+static int run_box_command(Canvas *canvas, Box *box);
+
+/* Helper function to fetch the queued mouse event after KEY_MOUSE */
+static bool read_mouse(MEVENT *mouse_event);
+
 int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config) {
     int ch = getch();
 
@@ -47,6 +57,17 @@ int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfi
         /* No input available */
         return 0;
     }
+    return handle_key(canvas, vp, js, config, ch);
+}
+
+int handle_key(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config, int ch) {
+
+    /* Modal UI (help, command line, editors, focus view, connection mode)
+     * is drawn whole rather than damage-tracked: redraw it on any key */
+    if (canvas->help.visible || canvas->command_line.active || canvas->editor.active ||
+        canvas->focus.active || canvas->conn_mode.active) {
+        canvas_mark_all_dirty(canvas);
+    }
 
     /* Test mode key handling (Issue #70) - check before normal input */
     TestMode *tm = test_mode_get_global();
@@ -223,7 +244,7 @@ int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfi
         } else if (ch == 'r' || ch == 'R') {
             /* Re-run command (Issue #56) */
             if (box && box->content_type == BOX_CONTENT_COMMAND && box->command) {
-                command_runner_execute(box);
+                run_box_command(canvas, box);
                 /* Reset scroll to top to see new output */
                 canvas->focus.scroll_offset = 0;
             } else if (box && box->content_type == BOX_CONTENT_FILE && box->file_path) {
@@ -246,6 +267,9 @@ int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfi
         if (ch == 27 || ch == KEY_F(10)) {  /* ESC or F10 */
             /* Save and close editor */
             joystick_close_text_editor(js, true, box);
+            if (box) {
+                canvas_mark_box_dirty(canvas, box->id);
+            }
             return 0;
         } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
             /* Backspace */
@@ -287,24 +311,7 @@ int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfi
     /* Handle mouse events */
     if (ch == KEY_MOUSE) {
         MEVENT mouse_event;
-        #ifdef _WIN32
-        /* PDCurses mouse handling - API differs from ncurses */
-        /* Clear the mouse event queue; ignore errors as we just want to flush */
-        (void)getmouse();
-        #ifdef PDC_WIDE
-        /* PDC_WIDE builds have nc_getmouse() for MEVENT support */
-        if (nc_getmouse(&mouse_event) == OK) {
-        #else
-        /* Non-PDC_WIDE builds: mouse support disabled due to MEVENT API differences.
-         * This is intentional - older PDCurses versions lack full mouse support.
-         * Mouse will work on Unix/Linux and PDC_WIDE Windows builds. */
-        memset(&mouse_event, 0, sizeof(mouse_event));  /* Suppress uninitialized warning */
-        if (false) {  /* Mouse handling disabled on non-PDC_WIDE Windows */
-        #endif
-        #else
-        /* ncurses API: getmouse() takes pointer to MEVENT */
-        if (getmouse(&mouse_event) == OK) {
-        #endif
+        if (read_mouse(&mouse_event)) {
             source = input_unified_process_mouse(&mouse_event, canvas, vp, &event);
         }
     } else {
@@ -320,6 +327,196 @@ int handle_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfi
     return 0;
 }
 
+/* Mouse drag in progress. Motion only records where the box should go;
+ * the box moves once per frame (input_apply_drag) and the whole gesture
+ * becomes one undo step when the button is released. */
+static struct {
+    int box_id;                 /* -1 when no drag is in progress */
+    double start_x, start_y;    /* Box position when the drag began */
+    double target_x, target_y;  /* Latest position from the mouse */
+    bool pending;               /* Target not yet applied */
+} drag = {-1, 0.0, 0.0, 0.0, 0.0, false};
+
+bool input_drag_pending(void) {
+    return drag.pending;
+}
+
+void input_apply_drag(Canvas *canvas) {
+    if (!drag.pending) {
+        return;
+    }
+    drag.pending = false;
+    canvas_move_box(canvas, drag.box_id, drag.target_x, drag.target_y);
+}
+
+/* Release: apply the last position and record the gesture */
+static void finish_drag(Canvas *canvas, int box_id) {
+    if (drag.box_id < 0 || drag.box_id != box_id) {
+        return;
+    }
+    input_apply_drag(canvas);
+    Box *box = canvas_get_box(canvas, drag.box_id);
+    if (box && (box->x != drag.start_x || box->y != drag.start_y)) {
+        undo_record_box_move(canvas, box->id, drag.start_x, drag.start_y, box->x, box->y);
+    }
+    drag.box_id = -1;
+}
+
+/* Input coalesced within one batch: keyboard pans summed into one
+ * viewport move and zoom steps in one direction counted. (Mouse drag
+ * motion is coalesced per frame by the drag state below.) */
+typedef struct {
+    InputEvent event;       /* action is ACTION_NONE when nothing is pending */
+    int repeat;             /* Zoom steps to apply */
+} PendingInput;
+
+static bool is_discrete_pan(const InputEvent *event) {
+    return (event->action == ACTION_PAN_UP || event->action == ACTION_PAN_DOWN ||
+            event->action == ACTION_PAN_LEFT || event->action == ACTION_PAN_RIGHT) &&
+           !event->data.pan.continuous;
+}
+
+/* Keys that go to modal UI (or test mode logging) are handled one by one */
+static bool key_is_modal(const Canvas *canvas, const JoystickState *js, int ch) {
+    TestMode *tm = test_mode_get_global();
+    return (tm && tm->enabled) || ch == ':' ||
+           canvas->help.visible || canvas->command_line.active ||
+           editor_is_active(canvas) || canvas->focus.active ||
+           canvas->conn_mode.active || (js && js->text_editor_active);
+}
+
+/* Fold event into pending; returns false if it has to be applied on its own */
+static bool merge_pending(PendingInput *pending, const InputEvent *event) {
+    InputEvent *p = &pending->event;
+
+    if (is_discrete_pan(event)) {
+        if (p->action == ACTION_NONE) {
+            *p = *event;
+            return true;
+        }
+        if (is_discrete_pan(p)) {
+            /* viewport_pan() is linear, so the sum lands in the same place */
+            p->data.pan.dx += event->data.pan.dx;
+            p->data.pan.dy += event->data.pan.dy;
+            return true;
+        }
+        return false;
+    }
+
+    if (event->action == ACTION_ZOOM_IN || event->action == ACTION_ZOOM_OUT) {
+        /* Only same-direction steps: clamping makes in+out not cancel */
+        if (p->action == ACTION_NONE || p->action == event->action) {
+            *p = *event;
+            pending->repeat++;
+            return true;
+        }
+        return false;
+    }
+
+    return false;
+}
+
+static int flush_pending(Canvas *canvas, Viewport *vp, JoystickState *js,
+                         const AppConfig *config, PendingInput *pending) {
+    int result = 0;
+    if (pending->event.action == ACTION_ZOOM_IN || pending->event.action == ACTION_ZOOM_OUT) {
+        for (int i = 0; i < pending->repeat; i++) {
+            execute_canvas_action(canvas, vp, js, &pending->event, config);
+        }
+    } else if (pending->event.action != ACTION_NONE) {
+        result = execute_canvas_action(canvas, vp, js, &pending->event, config);
+    }
+    pending->event.action = ACTION_NONE;
+    pending->repeat = 0;
+    return result;
+}
+
+int handle_input_batch(Canvas *canvas, Viewport *vp, JoystickState *js,
+                       const AppConfig *config, int *events) {
+    PendingInput pending;
+    memset(&pending, 0, sizeof(pending));
+    pending.event.action = ACTION_NONE;
+
+    int count = 0;
+    int quit = 0;
+    while (!quit && count < INPUT_BATCH_MAX) {
+        int ch = getch();
+        if (ch == ERR) {
+            break;
+        }
+        count++;
+
+        if (key_is_modal(canvas, js, ch)) {
+            quit = flush_pending(canvas, vp, js, config, &pending);
+            if (!quit) {
+                quit = handle_key(canvas, vp, js, config, ch);
+            }
+            continue;
+        }
+
+        InputEvent event;
+        int source;
+        if (ch == KEY_MOUSE) {
+            MEVENT mouse_event;
+            if (!read_mouse(&mouse_event)) {
+                continue;
+            }
+            /* Mouse positions map through the viewport: apply pending pans first */
+            quit = flush_pending(canvas, vp, js, config, &pending);
+            source = input_unified_process_mouse(&mouse_event, canvas, vp, &event);
+        } else {
+            source = input_unified_process_keyboard(ch, vp, &event);
+        }
+        if (quit || source < 0 || event.action == ACTION_NONE) {
+            continue;
+        }
+        if (merge_pending(&pending, &event)) {
+            continue;
+        }
+
+        quit = flush_pending(canvas, vp, js, config, &pending);
+        if (quit) {
+            break;
+        }
+        if (ch != KEY_MOUSE) {
+            /* Re-read against the viewport the pending input just moved */
+            source = input_unified_process_keyboard(ch, vp, &event);
+        }
+        if (source >= 0 && event.action != ACTION_NONE) {
+            quit = execute_canvas_action(canvas, vp, js, &event, config);
+        }
+    }
+
+    if (!quit) {
+        quit = flush_pending(canvas, vp, js, config, &pending);
+    }
+    if (events) {
+        *events = count;
+    }
+    return quit;
+}
+
+static bool read_mouse(MEVENT *mouse_event) {
+    #ifdef _WIN32
+    /* PDCurses mouse handling - API differs from ncurses */
+    /* Clear the mouse event queue; ignore errors as we just want to flush */
+    (void)getmouse();
+    #ifdef PDC_WIDE
+    /* PDC_WIDE builds have nc_getmouse() for MEVENT support */
+    return nc_getmouse(mouse_event) == OK;
+    #else
+    /* Non-PDC_WIDE builds: mouse support disabled due to MEVENT API differences.
+     * This is intentional - older PDCurses versions lack full mouse support.
+     * Mouse will work on Unix/Linux and PDC_WIDE Windows builds. */
+    memset(mouse_event, 0, sizeof(*mouse_event));  /* Suppress uninitialized warning */
+    return false;  /* Mouse handling disabled on non-PDC_WIDE Windows */
+    #endif
+    #else
+    /* ncurses API: getmouse() takes pointer to MEVENT */
+    return getmouse(mouse_event) == OK;
+    #endif
+}
+
 /* Handle joystick input based on current mode */
 int handle_joystick_input(Canvas *canvas, Viewport *vp, JoystickState *js, const AppConfig *config) {
     if (!canvas || !vp || !js || !js->available) {
@@ -344,6 +541,14 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
                                   const InputEvent *event, const AppConfig *config) {
     if (!canvas || !vp || !event) return 0;
 
+    /* Anything but drag motion sees the dragged box where the mouse left it;
+     * a new press ends a gesture whose release never arrived */
+    if (event->action == ACTION_SELECT_BOX || event->action == ACTION_DESELECT_BOX) {
+        finish_drag(canvas, drag.box_id);
+    } else if (event->action != ACTION_MOVE_BOX) {
+        input_apply_drag(canvas);
+    }
+
     switch (event->action) {
         case ACTION_QUIT:
             /* If in connection mode, cancel instead of quit (Issue #20) */
@@ -393,7 +598,12 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
 
         case ACTION_CYCLE_BOX:
             if (canvas->box_count > 0) {
-                int next_index = (canvas->selected_index + 1) % canvas->box_count;
+                /* Step through draw order, wrapping from topmost to bottom-most */
+                int next_index = canvas_get_selected(canvas)
+                                     ? canvas_draw_next(canvas, canvas->selected_index) : -1;
+                if (next_index < 0) {
+                    next_index = canvas_draw_first(canvas);
+                }
                 Box *next_box = canvas_get_box_at(canvas, next_index);
                 if (next_box) {
                     canvas_select_box(canvas, next_box->id);
@@ -487,22 +697,34 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
                     if (js && js->mode == MODE_EDIT) {
                         /* Joystick - relative movement (analog) */
                         double scaled_speed = PAN_SPEED / vp->zoom;
-                        box->x += event->data.move.world_x * scaled_speed;
-                        box->y += event->data.move.world_y * scaled_speed;
-                        
+                        canvas_move_box(canvas, box->id,
+                                        box->x + event->data.move.world_x * scaled_speed,
+                                        box->y + event->data.move.world_y * scaled_speed);
+
                         /* Update cursor to box position */
                         js->cursor_x = box->x;
                         js->cursor_y = box->y;
                     } else {
-                        /* Mouse - absolute position with offset */
-                        box->x = event->data.move.world_x - event->data.move.offset_x;
-                        box->y = event->data.move.world_y - event->data.move.offset_y;
+                        /* Mouse - absolute position with offset, applied at the next frame */
+                        if (drag.box_id != box->id) {
+                            input_apply_drag(canvas);
+                            drag.box_id = box->id;
+                            drag.start_x = box->x;
+                            drag.start_y = box->y;
+                        }
+                        drag.target_x = event->data.move.world_x - event->data.move.offset_x;
+                        drag.target_y = event->data.move.world_y - event->data.move.offset_y;
+                        drag.pending = true;
                     }
                 }
             }
             break;
         }
 
+        case ACTION_DROP_BOX:
+            finish_drag(canvas, event->data.move.box_id);
+            break;
+
         case ACTION_COLOR_BOX:
             if (canvas->selected_index >= 0) {
                 Box *box = &canvas->boxes[canvas->selected_index];
@@ -521,6 +743,7 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
                 undo_record_box_color(canvas, box->id, old_color, new_color);
 
                 box->color = new_color;
+                canvas_mark_box_dirty(canvas, box->id);
             } else if (event->data.color.color_index == 0) {
                 /* No box selected, reset view */
                 vp->cam_x = 0.0;
@@ -534,6 +757,7 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
             if (canvas->selected_index >= 0) {
                 Box *box = &canvas->boxes[canvas->selected_index];
                 box->box_type = (box->box_type + 1) % BOX_TYPE_COUNT;
+                canvas_mark_box_dirty(canvas, box->id);
             }
             break;
 
@@ -614,9 +838,28 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
             canvas->focus.focused_box_id = -1;
             break;
 
-        case ACTION_SAVE_CANVAS:
-            canvas_save(canvas, DEFAULT_SAVE_FILE);
+        case ACTION_SAVE_CANVAS: {
+            /* In journal mode only the edits since the last save are
+             * written; the first save writes the file whole */
+            Journal *journal = journal_get_global();
+            Saver *saver = saver_get_global();
+            char message[sizeof(canvas->status_message)];
+            if (journal != NULL) {
+                int result = journal->path != NULL ? journal_save(journal, canvas)
+                                                   : journal_open(journal, canvas, DEFAULT_SAVE_FILE, false);
+                snprintf(message, sizeof(message), "%s %s", result == 0 ? "Saved" : "Save failed:",
+                         journal->path ? journal->path : DEFAULT_SAVE_FILE);
+                canvas_set_status(canvas, message);
+            } else if (saver != NULL) {
+                /* Written in the background; the main loop reports the result */
+                int result = saver_start(saver, canvas, DEFAULT_SAVE_FILE, CANVAS_FORMAT_V1);
+                saver_describe(saver, result, message, sizeof(message));
+                canvas_set_status(canvas, message);
+            } else {
+                canvas_save(canvas, DEFAULT_SAVE_FILE);
+            }
             break;
+        }
 
         case ACTION_LOAD_CANVAS: {
             const char *file_to_load = persistence_get_current_file();
@@ -624,11 +867,24 @@ static int execute_canvas_action(Canvas *canvas, Viewport *vp, JoystickState *js
                 file_to_load = DEFAULT_SAVE_FILE;
             }
 
-            Canvas old_canvas = *canvas;
-            if (canvas_load(canvas, file_to_load) != 0) {
-                *canvas = old_canvas;
-            } else {
-                canvas_cleanup(&old_canvas);
+            /* Load beside the current canvas, which is kept if it fails */
+            Canvas loaded;
+            loaded.boxes = NULL;
+            if (canvas_load(&loaded, file_to_load) == 0) {
+                canvas_cleanup(canvas);
+                *canvas = loaded;
+                Journal *journal = journal_get_global();
+                if (journal) {
+                    journal_open(journal, canvas, file_to_load, true);
+                }
+                CommandRunner *runner = command_runner_get_global();
+                if (runner) {
+                    command_runner_schedule_canvas(runner, canvas);
+                }
+                FileWatch *watch = file_watch_get_global();
+                if (watch) {
+                    file_watch_attach_canvas(watch, canvas);
+                }
             }
             break;
         }
@@ -788,6 +1044,7 @@ static void execute_command(Canvas *canvas) {
             free(box->title);
             box->title = strdup(basename);
         }
+        canvas_mark_box_source(canvas, box->id);
 
         return;
     }
@@ -815,19 +1072,30 @@ static void execute_command(Canvas *canvas) {
             canvas->command_line.has_error = true;
             return;
         }
+        canvas_mark_box_dirty(canvas, box->id);
 
         return;
     }
 
-    /* :run <command> - Execute command and display output */
-    if (strncmp(cmd, "run ", 4) == 0) {
-        const char *command = cmd + 4;
+    /* :run <command> - Execute command and display output
+     * :stream <command> - Run a long-running command, keeping a rolling tail */
+    if (strncmp(cmd, "run ", 4) == 0 || strncmp(cmd, "stream ", 7) == 0) {
+        bool stream = cmd[0] == 's';
+        const char *command = cmd + (stream ? 7 : 4);
         /* Skip whitespace after command */
         while (*command == ' ' || *command == '\t') command++;
 
         if (*command == '\0') {
             snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
-                     "Usage: :run <command>");
+                     stream ? "Usage: :stream <command>" : "Usage: :run <command>");
+            canvas->command_line.has_error = true;
+            return;
+        }
+
+        /* Streams never end, so they need the background runner */
+        if (stream && !command_runner_get_global()) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "Streaming not available");
             canvas->command_line.has_error = true;
             return;
         }
@@ -848,9 +1116,10 @@ static void execute_command(Canvas *canvas) {
             canvas->command_line.has_error = true;
             return;
         }
+        box->command_stream = stream;
 
-        int exit_code = command_runner_execute(box);
-        if (exit_code < 0 && box->content_lines == 0) {
+        int result = run_box_command(canvas, box);
+        if (result < 0 && (command_runner_get_global() || box_content_count(box) == 0)) {
             snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
                      "Failed to execute command");
             canvas->command_line.has_error = true;
@@ -869,6 +1138,7 @@ static void execute_command(Canvas *canvas) {
         } else {
             box->title = strdup(command);
         }
+        canvas_mark_box_source(canvas, box->id);
 
         return;
     }
@@ -890,7 +1160,60 @@ static void execute_command(Canvas *canvas) {
             return;
         }
 
-        command_runner_execute(box);
+        run_box_command(canvas, box);
+        return;
+    }
+
+    /* :cancel - Stop the selected box's running command */
+    if (strcmp(cmd, "cancel") == 0) {
+        Box *box = canvas_get_selected(canvas);
+        CommandRunner *runner = command_runner_get_global();
+        if (!box || !runner || command_runner_cancel(runner, canvas, box->id) != 0) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "No running command in selected box");
+            canvas->command_line.has_error = true;
+        }
+        return;
+    }
+
+    /* :refresh <seconds>|off - Re-run the selected command box on a schedule */
+    if (strncmp(cmd, "refresh", 7) == 0 && (cmd[7] == ' ' || cmd[7] == '\0')) {
+        const char *arg = cmd + 7;
+        while (*arg == ' ' || *arg == '\t') arg++;
+
+        char *end = NULL;
+        long seconds = strcmp(arg, "off") == 0 ? 0 : strtol(arg, &end, 10);
+        if (*arg == '\0' || (end && (*end != '\0' || seconds < 0))) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "Usage: :refresh <seconds>|off");
+            canvas->command_line.has_error = true;
+            return;
+        }
+
+        Box *box = canvas_get_selected(canvas);
+        if (!box) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "No box selected");
+            canvas->command_line.has_error = true;
+            return;
+        }
+
+        if (box->content_type != BOX_CONTENT_COMMAND || !box->command) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "Box is not a command box");
+            canvas->command_line.has_error = true;
+            return;
+        }
+
+        CommandRunner *runner = command_runner_get_global();
+        if (seconds > COMMAND_RUNNER_MAX_REFRESH) {
+            seconds = COMMAND_RUNNER_MAX_REFRESH;
+        }
+        if (!runner || command_runner_set_refresh(runner, canvas, box->id, (int)seconds) != 0) {
+            snprintf(canvas->command_line.error_msg, COMMAND_BUFFER_SIZE,
+                     "Cannot schedule command");
+            canvas->command_line.has_error = true;
+        }
         return;
     }
 
@@ -906,3 +1229,19 @@ static void execute_command(Canvas *canvas) {
              "Unknown command: %.50s%s", cmd, strlen(cmd) > 50 ? "..." : "");
     canvas->command_line.has_error = true;
 }
+
+/* Run a command box: streamed in the background through the global
+ * runner, or synchronously when there is none (tests, Windows; not
+ * for stream boxes) */
+static int run_box_command(Canvas *canvas, Box *box) {
+    CommandRunner *runner = command_runner_get_global();
+    if (runner) {
+        return command_runner_start(runner, canvas, box->id);
+    }
+    if (box->command_stream) {
+        return -1;  /* Would never return */
+    }
+    int exit_code = command_runner_execute(box);
+    canvas_mark_box_dirty(canvas, box->id);
+    return exit_code;
+}
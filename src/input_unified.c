@@ -40,6 +40,7 @@ const char* input_unified_action_name(CanvasAction action) {
         case ACTION_CREATE_BOX:      return "CREATE_BOX";
         case ACTION_DELETE_BOX:      return "DELETE_BOX";
         case ACTION_MOVE_BOX:        return "MOVE_BOX";
+        case ACTION_DROP_BOX:        return "DROP_BOX";
         case ACTION_COLOR_BOX:       return "COLOR_BOX";
         case ACTION_RESET_VIEW:      return "RESET_VIEW";
         case ACTION_TOGGLE_GRID:     return "TOGGLE_GRID";
@@ -344,10 +345,15 @@ int input_unified_process_mouse(void *mouse_event_ptr, Canvas *canvas, const Vie
     }
     /* Mouse button released - end drag */
     else if (mevent->bstate & BUTTON1_RELEASED) {
+        bool was_dragging = mouse_state.dragging;
+        event->data.move.box_id = mouse_state.drag_box_id;
         mouse_state.dragging = false;
         mouse_state.drag_box_id = -1;
-        /* No action needed - just state cleanup */
-        return -1;
+        if (!was_dragging) {
+            return -1;
+        }
+        event->action = ACTION_DROP_BOX;
+        return INPUT_SOURCE_MOUSE;
     }
     /* Single click (no drag) */
     else if (mevent->bstate & BUTTON1_CLICKED) {
@@ -424,14 +430,14 @@ static int input_unified_process_param_editor(JoystickState *js, Canvas *canvas,
                 js->param_edit_width += delta;
                 if (js->param_edit_width < 10) js->param_edit_width = 10;
                 if (js->param_edit_width > 80) js->param_edit_width = 80;
-                box->width = js->param_edit_width;  /* Live update */
+                canvas_resize_box(canvas, box->id, js->param_edit_width, box->height);  /* Live update */
                 break;
 
             case 1:  /* Height */
                 js->param_edit_height += delta;
                 if (js->param_edit_height < 3) js->param_edit_height = 3;
                 if (js->param_edit_height > 30) js->param_edit_height = 30;
-                box->height = js->param_edit_height;  /* Live update */
+                canvas_resize_box(canvas, box->id, box->width, js->param_edit_height);  /* Live update */
                 break;
 
             case 2:  /* Color */
@@ -449,12 +455,12 @@ static int input_unified_process_param_editor(JoystickState *js, Canvas *canvas,
             case 0:  /* Width */
                 js->param_edit_width -= 5;
                 if (js->param_edit_width < 10) js->param_edit_width = 10;
-                box->width = js->param_edit_width;
+                canvas_resize_box(canvas, box->id, js->param_edit_width, box->height);
                 break;
             case 1:  /* Height */
                 js->param_edit_height -= 3;
                 if (js->param_edit_height < 3) js->param_edit_height = 3;
-                box->height = js->param_edit_height;
+                canvas_resize_box(canvas, box->id, box->width, js->param_edit_height);
                 break;
             case 2:  /* Color */
                 js->param_edit_color = (js->param_edit_color + 7) % 8;
@@ -469,12 +475,12 @@ static int input_unified_process_param_editor(JoystickState *js, Canvas *canvas,
             case 0:  /* Width */
                 js->param_edit_width += 5;
                 if (js->param_edit_width > 80) js->param_edit_width = 80;
-                box->width = js->param_edit_width;
+                canvas_resize_box(canvas, box->id, js->param_edit_width, box->height);
                 break;
             case 1:  /* Height */
                 js->param_edit_height += 3;
                 if (js->param_edit_height > 30) js->param_edit_height = 30;
-                box->height = js->param_edit_height;
+                canvas_resize_box(canvas, box->id, box->width, js->param_edit_height);
                 break;
             case 2:  /* Color */
                 js->param_edit_color = (js->param_edit_color + 1) % 8;
@@ -486,12 +492,16 @@ static int input_unified_process_param_editor(JoystickState *js, Canvas *canvas,
     /* Button A - Apply and close */
     if (joystick_button_pressed(js, BUTTON_A)) {
         joystick_close_param_editor(js, true, box);
+        canvas_sync_box_bounds(canvas, box->id);
+        canvas_mark_box_dirty(canvas, box->id);
         return -1;  /* No canvas action */
     }
 
     /* Button B - Cancel and close */
     if (joystick_button_pressed(js, BUTTON_B)) {
         joystick_close_param_editor(js, false, box);
+        canvas_sync_box_bounds(canvas, box->id);
+        canvas_mark_box_dirty(canvas, box->id);
         return -1;  /* No canvas action */
     }
 
@@ -520,6 +530,9 @@ int input_unified_process_joystick(JoystickState *js, Canvas *canvas, const View
         if (joystick_button_pressed(js, BUTTON_B)) {
             Box *box = canvas_get_box(canvas, js->selected_box_id);
             joystick_close_text_editor(js, true, box);
+            if (box) {
+                canvas_mark_box_dirty(canvas, box->id);
+            }
         }
         return -1;  /* No canvas action while text editor active */
     }
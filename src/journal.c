@@ -0,0 +1,897 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "journal.h"
+#include "canvas.h"
+#include "box_content.h"
+#include "change_set.h"
+#include "command_runner.h"
+#include "file_viewer.h"
+#include "file_watch.h"
+#include "persistence.h"
+#include "saver.h"
+
+/* Journal that saves go through (NULL: saves rewrite the file) */
+static Journal *global_journal = NULL;
+
+/* ============================================================
+ * Record format
+ *
+ * One record per line, fields separated by spaces; strings follow
+ * on lines of their own. Boxes are only ever referred to by ID.
+ *
+ *   A id x y width height        box exists with these bounds
+ *   M id x y                     box moved
+ *   R id width height            box resized
+ *   P id color type content refresh stream has_path has_command
+ *     [file path] [command]      box fields
+ *   T id has_title [title]       box title
+ *   C id count <count lines>     box content
+ *   D id                         box deleted
+ *   L id source dest color       connection exists
+ *   U id                         connection removed
+ *   S next_id next_conn selected grid_visible grid_snap grid_spacing
+ *     sidebar_state sidebar_width
+ *   N length <length bytes>      sidebar document (length -1: none)
+ * ============================================================ */
+
+/* Growable buffer a save's records are built in, written with one write() */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool failed;
+} RecordBuf;
+
+static bool rb_reserve(RecordBuf *rb, size_t extra) {
+    if (rb->failed) {
+        return false;
+    }
+    if (rb->len + extra <= rb->capacity) {
+        return true;
+    }
+    size_t capacity = rb->capacity ? rb->capacity : 4096;
+    while (capacity < rb->len + extra) {
+        capacity *= 2;
+    }
+    char *data = realloc(rb->data, capacity);
+    if (data == NULL) {
+        rb->failed = true;
+        return false;
+    }
+    rb->data = data;
+    rb->capacity = capacity;
+    return true;
+}
+
+static void rb_bytes(RecordBuf *rb, const char *bytes, size_t len) {
+    if (rb_reserve(rb, len)) {
+        memcpy(rb->data + rb->len, bytes, len);
+        rb->len += len;
+    }
+}
+
+static void rb_line(RecordBuf *rb, const char *text, size_t len) {
+    rb_bytes(rb, text, len);
+    rb_bytes(rb, "\n", 1);
+}
+
+static void rb_printf(RecordBuf *rb, const char *format, ...) {
+    char record[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(record, sizeof(record), format, args);
+    va_end(args);
+    if (len < 0 || (size_t)len >= sizeof(record)) {
+        rb->failed = true;
+        return;
+    }
+    rb_bytes(rb, record, (size_t)len);
+}
+
+static void write_box_props(RecordBuf *rb, const Box *box) {
+    rb_printf(rb, "P %d %d %d %d %d %d %d %d\n", box->id, box->color, box->box_type,
+              box->content_type, box->refresh_interval, box->command_stream ? 1 : 0,
+              box->file_path != NULL, box->command != NULL);
+    if (box->file_path) {
+        rb_line(rb, box->file_path, strlen(box->file_path));
+    }
+    if (box->command) {
+        rb_line(rb, box->command, strlen(box->command));
+    }
+}
+
+static void write_box_title(RecordBuf *rb, const Box *box) {
+    rb_printf(rb, "T %d %d\n", box->id, box->title != NULL);
+    if (box->title) {
+        rb_line(rb, box->title, strlen(box->title));
+    }
+}
+
+static void write_box_content(RecordBuf *rb, const Box *box) {
+    /* A mapped file is reopened from file_path instead, as in saves */
+    int lines = box->file_map ? 0 : box_content_count(box);
+    rb_printf(rb, "C %d %d\n", box->id, lines);
+    for (int j = 0; j < lines; j++) {
+        rb_line(rb, box_content_line(box, j), box_content_line_length(box, j));
+    }
+}
+
+/* Everything about a box except its bounds */
+static void write_box_fields(RecordBuf *rb, const Box *box) {
+    write_box_props(rb, box);
+    write_box_title(rb, box);
+    write_box_content(rb, box);
+}
+
+/* The canvas-wide state record */
+static void format_state(const Canvas *canvas, char *out, size_t size) {
+    int selected = -1;
+    if (canvas->selected_index >= 0) {
+        selected = canvas->boxes[canvas->selected_index].id;
+    }
+    snprintf(out, size, "S %d %d %d %d %d %d %d %d\n", canvas->next_id,
+             canvas->next_conn_id, selected, canvas->grid.visible ? 1 : 0,
+             canvas->grid.snap_enabled ? 1 : 0, canvas->grid.spacing,
+             (int)canvas->sidebar_state, canvas->sidebar_width);
+}
+
+/* Remember canvas-wide state as written (by a save or a full rewrite) */
+static void remember_state(Journal *journal, const Canvas *canvas) {
+    format_state(canvas, journal->state, sizeof(journal->state));
+    free(journal->document);
+    journal->document = canvas->document ? strdup(canvas->document) : NULL;
+    journal->has_document = journal->document != NULL;
+}
+
+static bool document_changed(const Journal *journal, const Canvas *canvas) {
+    if (canvas->document == NULL || journal->document == NULL) {
+        return (canvas->document != NULL) != journal->has_document;
+    }
+    return strcmp(canvas->document, journal->document) != 0;
+}
+
+/* Records for everything canvas->changes holds, removals before
+ * additions so connections always find their boxes */
+static void write_changes(RecordBuf *rb, Journal *journal, Canvas *canvas) {
+    const ChangeList *conns = &canvas->changes.connections;
+    const ChangeList *boxes = &canvas->changes.boxes;
+
+    for (int i = 0; i < conns->count; i++) {
+        if (conns->entries[i].flags & CHANGE_REMOVED) {
+            rb_printf(rb, "U %d\n", conns->entries[i].id);
+        }
+    }
+
+    for (int i = 0; i < boxes->count; i++) {
+        unsigned int flags = boxes->entries[i].flags;
+        int id = boxes->entries[i].id;
+        if (flags & CHANGE_REMOVED) {
+            rb_printf(rb, "D %d\n", id);
+        }
+        const Box *box = canvas_get_box(canvas, id);
+        if (box == NULL || flags == 0 || flags == CHANGE_REMOVED) {
+            continue;
+        }
+        if (flags & CHANGE_ADDED) {
+            rb_printf(rb, "A %d %.17g %.17g %d %d\n", id, box->x, box->y, box->width, box->height);
+            write_box_fields(rb, box);
+            continue;
+        }
+        if (flags & CHANGE_MOVED) {
+            rb_printf(rb, "M %d %.17g %.17g\n", id, box->x, box->y);
+        }
+        if (flags & CHANGE_RESIZED) {
+            rb_printf(rb, "R %d %d %d\n", id, box->width, box->height);
+        }
+        if (flags & CHANGE_FIELDS) {
+            /* As in journal_diff: file and command boxes get their
+             * content from the file or a run, unless what they show
+             * changed */
+            write_box_props(rb, box);
+            write_box_title(rb, box);
+            if (box->content_type == BOX_CONTENT_TEXT || (flags & CHANGE_SOURCE)) {
+                write_box_content(rb, box);
+            }
+        }
+    }
+
+    for (int i = 0; i < conns->count; i++) {
+        if (!(conns->entries[i].flags & CHANGE_ADDED)) {
+            continue;
+        }
+        const Connection *conn = canvas_get_connection(canvas, conns->entries[i].id);
+        if (conn) {
+            rb_printf(rb, "L %d %d %d %d\n", conn->id, conn->source_id, conn->dest_id, conn->color);
+        }
+    }
+
+    char state[sizeof(journal->state)];
+    format_state(canvas, state, sizeof(state));
+    if (strcmp(state, journal->state) != 0) {
+        rb_bytes(rb, state, strlen(state));
+    }
+    if (document_changed(journal, canvas)) {
+        if (canvas->document) {
+            size_t len = strlen(canvas->document);
+            rb_printf(rb, "N %zu\n", len);
+            rb_line(rb, canvas->document, len);
+        } else {
+            rb_printf(rb, "N -1\n");
+        }
+    }
+}
+
+static bool same_string(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static bool same_content(const Box *a, const Box *b) {
+    int count = box_content_count(a);
+    if (count != box_content_count(b)) {
+        return false;
+    }
+    for (int j = 0; j < count; j++) {
+        size_t len = box_content_line_length(a, j);
+        if (len != box_content_line_length(b, j) ||
+            memcmp(box_content_line(a, j), box_content_line(b, j), len) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Documents as the text format writes them: an empty one is left out
+ * and a missing final newline is added */
+static bool same_document(const char *a, const char *b) {
+    size_t a_len = a ? strlen(a) : 0;
+    size_t b_len = b ? strlen(b) : 0;
+    if (a_len > 0 && a[a_len - 1] == '\n') {
+        a_len--;
+    }
+    if (b_len > 0 && b[b_len - 1] == '\n') {
+        b_len--;
+    }
+    return a_len == b_len && (a_len == 0 || memcmp(a, b, a_len) == 0);
+}
+
+/* Records turning box 'from' (NULL: none) into 'to' */
+static void diff_box(RecordBuf *rb, const Box *from, const Box *to) {
+    if (from == NULL) {
+        rb_printf(rb, "A %d %.17g %.17g %d %d\n", to->id, to->x, to->y, to->width, to->height);
+        write_box_fields(rb, to);
+        return;
+    }
+    if (from->x != to->x || from->y != to->y) {
+        rb_printf(rb, "M %d %.17g %.17g\n", to->id, to->x, to->y);
+    }
+    if (from->width != to->width || from->height != to->height) {
+        rb_printf(rb, "R %d %d %d\n", to->id, to->width, to->height);
+    }
+    bool source = to->content_type != from->content_type ||
+                  !same_string(from->file_path, to->file_path) ||
+                  !same_string(from->command, to->command);
+    if (source || from->color != to->color || from->box_type != to->box_type ||
+        from->refresh_interval != to->refresh_interval ||
+        from->command_stream != to->command_stream) {
+        write_box_props(rb, to);
+    }
+    if (!same_string(from->title, to->title)) {
+        write_box_title(rb, to);
+    }
+    /* File and command boxes keep showing the file or output as it is
+     * now, not the lines last written, unless what they show changed */
+    if ((to->content_type == BOX_CONTENT_TEXT || source) && !same_content(from, to)) {
+        write_box_content(rb, to);
+    }
+}
+
+char *journal_diff(Canvas *from, Canvas *to, size_t *len) {
+    RecordBuf rb = {NULL, 0, 0, false};
+    rb_reserve(&rb, 1);
+
+    for (int i = 0; i < from->conn_count; i++) {
+        if (canvas_get_connection(to, from->connections[i].id) == NULL) {
+            rb_printf(&rb, "U %d\n", from->connections[i].id);
+        }
+    }
+    for (int i = canvas_draw_first(from); i >= 0; i = canvas_draw_next(from, i)) {
+        if (canvas_get_box(to, from->boxes[i].id) == NULL) {
+            rb_printf(&rb, "D %d\n", from->boxes[i].id);
+        }
+    }
+    for (int i = canvas_draw_first(to); i >= 0; i = canvas_draw_next(to, i)) {
+        diff_box(&rb, canvas_get_box(from, to->boxes[i].id), &to->boxes[i]);
+    }
+    for (int i = 0; i < to->conn_count; i++) {
+        const Connection *conn = &to->connections[i];
+        const Connection *old = canvas_get_connection(from, conn->id);
+        if (old == NULL || old->source_id != conn->source_id ||
+            old->dest_id != conn->dest_id || old->color != conn->color) {
+            rb_printf(&rb, "L %d %d %d %d\n", conn->id, conn->source_id, conn->dest_id, conn->color);
+        }
+    }
+    if (!same_document(from->document, to->document)) {
+        if (to->document) {
+            size_t doc_len = strlen(to->document);
+            rb_printf(&rb, "N %zu\n", doc_len);
+            rb_line(&rb, to->document, doc_len);
+        } else {
+            rb_printf(&rb, "N -1\n");
+        }
+    }
+
+    if (rb.failed) {
+        free(rb.data);
+        return NULL;
+    }
+    *len = rb.len;
+    return rb.data;
+}
+
+/* ============================================================
+ * Replay
+ * ============================================================ */
+
+typedef struct {
+    const char *p;
+    const char *end;
+} RecordReader;
+
+/* Next line as a NUL-terminated copy in out (false at end of data,
+ * on a line without its newline (torn), or one too long for a record) */
+static bool rr_record(RecordReader *rr, char *out, size_t size) {
+    const char *nl = memchr(rr->p, '\n', (size_t)(rr->end - rr->p));
+    if (nl == NULL || (size_t)(nl - rr->p) >= size) {
+        return false;
+    }
+    memcpy(out, rr->p, (size_t)(nl - rr->p));
+    out[nl - rr->p] = '\0';
+    rr->p = nl + 1;
+    return true;
+}
+
+/* Next raw line (pointer and length, without the newline) */
+static bool rr_line(RecordReader *rr, const char **line, size_t *len) {
+    const char *nl = memchr(rr->p, '\n', (size_t)(rr->end - rr->p));
+    if (nl == NULL) {
+        return false;
+    }
+    *line = rr->p;
+    *len = (size_t)(nl - rr->p);
+    rr->p = nl + 1;
+    return true;
+}
+
+/* Next raw line as a malloc'd string, or NULL when absent */
+static bool rr_string(RecordReader *rr, bool present, char **out) {
+    *out = NULL;
+    if (!present) {
+        return true;
+    }
+    const char *line;
+    size_t len;
+    if (!rr_line(rr, &line, &len)) {
+        return false;
+    }
+    *out = malloc(len + 1);
+    if (*out) {
+        memcpy(*out, line, len);
+        (*out)[len] = '\0';
+    }
+    return true;
+}
+
+static void replace_string(char **field, char *value) {
+    free(*field);
+    *field = value;
+}
+
+/* A file box shows the file as it is now (large files are written
+ * without their lines, as in saves), followed in a running session;
+ * the lines written stay if it cannot be read */
+static void show_file(Box *box) {
+    if (box->content_type != BOX_CONTENT_FILE || box->file_path == NULL) {
+        return;
+    }
+    FileWatch *watch = file_watch_get_global();
+    if (watch) {
+        file_watch_load(watch, box, box->file_path);
+    } else {
+        file_viewer_load(box, box->file_path);
+    }
+}
+
+/* Read one record and apply it to canvas (NULL: only check it);
+ * false if the record is malformed or cut short */
+static bool apply_record(RecordReader *rr, Canvas *canvas) {
+    char record[256];
+    if (!rr_record(rr, record, sizeof(record))) {
+        return false;
+    }
+    int id, a, b, c, d, e, f, g;
+    double x, y;
+    Box *box = NULL;
+
+    switch (record[0]) {
+    case 'A':
+        if (sscanf(record, "A %d %lf %lf %d %d", &id, &x, &y, &a, &b) != 5) return false;
+        if (canvas == NULL) return true;
+        /* Already there when replaying over a newer file: just place it */
+        if (canvas_get_box(canvas, id)) {
+            canvas_move_box(canvas, id, x, y);
+            canvas_resize_box(canvas, id, a, b);
+        } else {
+            canvas_restore_box_with_id(canvas, id, x, y, a, b, NULL);
+        }
+        return true;
+    case 'M':
+        if (sscanf(record, "M %d %lf %lf", &id, &x, &y) != 3) return false;
+        if (canvas) canvas_move_box(canvas, id, x, y);
+        return true;
+    case 'R':
+        if (sscanf(record, "R %d %d %d", &id, &a, &b) != 3) return false;
+        if (canvas) canvas_resize_box(canvas, id, a, b);
+        return true;
+    case 'P': {
+        int has_path, has_command;
+        if (sscanf(record, "P %d %d %d %d %d %d %d %d", &id, &a, &b, &c, &d, &e,
+                   &has_path, &has_command) != 8) return false;
+        char *path, *command;
+        if (!rr_string(rr, has_path, &path) || !rr_string(rr, has_command, &command)) {
+            free(path);
+            return false;
+        }
+        box = canvas ? canvas_get_box(canvas, id) : NULL;
+        if (box == NULL) {
+            free(path);
+            free(command);
+            return true;
+        }
+        int refresh = box->refresh_interval;
+        bool source = (int)box->content_type != c || !same_string(box->file_path, path) ||
+                      !same_string(box->command, command);
+        box->color = a;
+        box->box_type = b;
+        box->content_type = c;
+        box->refresh_interval = d < 0 ? 0 : d;
+        box->command_stream = e ? true : false;
+        replace_string(&box->file_path, path);
+        replace_string(&box->command, command);
+        if (source) {
+            canvas_mark_box_source(canvas, id);
+        } else {
+            canvas_mark_box_dirty(canvas, id);
+        }
+        /* A running session re-times the box's command */
+        CommandRunner *runner = command_runner_get_global();
+        if (runner && (box->refresh_interval != refresh || source)) {
+            command_runner_set_refresh(runner, canvas, id, box->refresh_interval);
+        }
+        if (source) {
+            show_file(box);
+        }
+        return true;
+    }
+    case 'T': {
+        char *title;
+        if (sscanf(record, "T %d %d", &id, &a) != 2 || !rr_string(rr, a, &title)) return false;
+        box = canvas ? canvas_get_box(canvas, id) : NULL;
+        if (box) {
+            replace_string(&box->title, title);
+            canvas_mark_box_dirty(canvas, id);
+        } else {
+            free(title);
+        }
+        return true;
+    }
+    case 'C': {
+        if (sscanf(record, "C %d %d", &id, &a) != 2 || a < 0) return false;
+        box = canvas ? canvas_get_box(canvas, id) : NULL;
+        ContentBuffer *content = NULL;
+        if (box && a > 0) {
+            content = content_buffer_create(a, 0);
+        }
+        for (int j = 0; j < a; j++) {
+            const char *line;
+            size_t len;
+            if (!rr_line(rr, &line, &len)) {
+                content_buffer_release(content);
+                return false;
+            }
+            if (content) {
+                content_buffer_append(content, line, len);
+            }
+        }
+        if (box) {
+            box_content_share(box, content);
+            content_buffer_release(content);
+            canvas_mark_box_dirty(canvas, id);
+            show_file(box);
+        }
+        return true;
+    }
+    case 'D':
+        if (sscanf(record, "D %d", &id) != 1) return false;
+        if (canvas) canvas_remove_box(canvas, id);
+        return true;
+    case 'L':
+        if (sscanf(record, "L %d %d %d %d", &id, &a, &b, &c) != 4) return false;
+        if (canvas) {
+            canvas_remove_connection(canvas, id);
+            canvas_restore_connection_with_id(canvas, id, a, b, c);
+        }
+        return true;
+    case 'U':
+        if (sscanf(record, "U %d", &id) != 1) return false;
+        if (canvas) canvas_remove_connection(canvas, id);
+        return true;
+    case 'S':
+        if (sscanf(record, "S %d %d %d %d %d %d %d %d", &a, &b, &id, &c, &d, &e, &f, &g) != 8) {
+            return false;
+        }
+        if (canvas == NULL) return true;
+        if (a > canvas->next_id) canvas->next_id = a;
+        if (b > canvas->next_conn_id) canvas->next_conn_id = b;
+        if (id >= 0 && canvas_get_box(canvas, id)) {
+            canvas_select_box(canvas, id);
+        } else {
+            canvas_deselect(canvas);
+        }
+        canvas->grid.visible = c ? true : false;
+        canvas->grid.snap_enabled = d ? true : false;
+        canvas->grid.spacing = e;
+        canvas->sidebar_state = (SidebarState)f;
+        canvas->sidebar_width = g;
+        return true;
+    case 'N': {
+        long len;
+        if (sscanf(record, "N %ld", &len) != 1) return false;
+        if (len < 0) {
+            if (canvas) {
+                replace_string(&canvas->document, NULL);
+                canvas_mark_all_dirty(canvas);
+            }
+            return true;
+        }
+        if ((size_t)(rr->end - rr->p) < (size_t)len + 1 || rr->p[len] != '\n') {
+            return false;
+        }
+        if (canvas) {
+            char *document = malloc((size_t)len + 1);
+            if (document) {
+                memcpy(document, rr->p, (size_t)len);
+                document[len] = '\0';
+                replace_string(&canvas->document, document);
+            }
+            canvas_mark_all_dirty(canvas);
+        }
+        rr->p += len + 1;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/* Apply (or with canvas NULL, just check) a journal's records; returns
+ * the length of the intact part, and counts records in *applied */
+static size_t apply_journal(Canvas *canvas, const char *data, size_t size, int *applied) {
+    size_t magic_len = strlen(JOURNAL_MAGIC);
+    *applied = 0;
+    if (size < magic_len + 1 || memcmp(data, JOURNAL_MAGIC, magic_len) != 0 ||
+        data[magic_len] != '\n') {
+        return 0;
+    }
+    RecordReader rr = {data + magic_len + 1, data + size};
+    const char *intact = rr.p;
+    while (rr.p < rr.end && apply_record(&rr, canvas)) {
+        intact = rr.p;
+        (*applied)++;
+    }
+    return (size_t)(intact - data);
+}
+
+int journal_apply(Canvas *canvas, const char *records, size_t len) {
+    RecordReader rr = {records, records + len};
+    int applied = 0;
+    while (rr.p < rr.end) {
+        if (!apply_record(&rr, canvas)) {
+            return -1;
+        }
+        applied++;
+    }
+    return applied;
+}
+
+/* Read a whole file (NULL if it does not exist or cannot be read) */
+static char *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    char *data = NULL;
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0 && (data = malloc((size_t)st.st_size + 1)) != NULL) {
+        *size = fread(data, 1, (size_t)st.st_size, f);
+    }
+    fclose(f);
+    return data;
+}
+
+static char *journal_path_for(const char *path) {
+    size_t len = strlen(path);
+    char *journal_path = malloc(len + sizeof(JOURNAL_SUFFIX));
+    if (journal_path) {
+        memcpy(journal_path, path, len);
+        memcpy(journal_path + len, JOURNAL_SUFFIX, sizeof(JOURNAL_SUFFIX));
+    }
+    return journal_path;
+}
+
+int journal_replay(Canvas *canvas, const char *path) {
+    char *journal_path = journal_path_for(path);
+    size_t size = 0;
+    char *data = journal_path ? read_file(journal_path, &size) : NULL;
+    free(journal_path);
+    if (data == NULL) {
+        return 0;
+    }
+    int applied;
+    apply_journal(canvas, data, size, &applied);
+    free(data);
+    return applied;
+}
+
+int journal_remove(const char *path) {
+    char *journal_path = journal_path_for(path);
+    if (journal_path == NULL) {
+        return -1;
+    }
+    int result = unlink(journal_path) == 0 || errno == ENOENT ? 0 : -1;
+    free(journal_path);
+    return result;
+}
+
+/* ============================================================
+ * Files
+ * ============================================================ */
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Replace the journal with a fresh one holding 'tail' (records the
+ * canvas file does not have yet), and reopen it for appending */
+static int rewrite_journal(Journal *journal, const char *tail, size_t tail_len) {
+    size_t len = strlen(journal->journal_path);
+    char tmp[len + 5];
+    memcpy(tmp, journal->journal_path, len);
+    memcpy(tmp + len, ".tmp", 5);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (write_all(fd, JOURNAL_MAGIC "\n", strlen(JOURNAL_MAGIC) + 1) != 0 ||
+        write_all(fd, tail, tail_len) != 0 || fsync(fd) != 0 ||
+        rename(tmp, journal->journal_path) != 0) {
+        close(fd);
+        unlink(tmp);
+        return -1;
+    }
+    close(fd);
+
+    if (journal->fd >= 0) {
+        close(journal->fd);
+    }
+    journal->fd = open(journal->journal_path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    journal->size = strlen(JOURNAL_MAGIC) + 1 + tail_len;
+    return journal->fd >= 0 ? 0 : -1;
+}
+
+/* A compaction is done: on success drop the records the canvas file
+ * now holds, keeping the ones appended while it was written */
+static void finish_compaction(Journal *journal, int result) {
+    if (result < 0) {
+        return;  /* Journal kept whole; the next save past the threshold retries */
+    }
+    size_t tail_len = journal->size - journal->compact_from;
+    char *tail = malloc(tail_len + 1);
+    if (tail == NULL) {
+        return;
+    }
+    int fd = open(journal->journal_path, O_RDONLY | O_CLOEXEC);
+    ssize_t n = fd >= 0 ? pread(fd, tail, tail_len, (off_t)journal->compact_from) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (n == (ssize_t)tail_len) {
+        rewrite_journal(journal, tail, tail_len);
+    }
+    free(tail);
+}
+
+static void wait_compaction(Journal *journal, bool block) {
+    if (!saver_busy(&journal->compactor)) {
+        return;
+    }
+    int result = block ? saver_wait(&journal->compactor, NULL)
+                       : saver_poll(&journal->compactor, NULL);
+    if (result != 0) {
+        finish_compaction(journal, result);
+    }
+}
+
+/* Rewrite the canvas file in the background (see saver.h) */
+static void start_compaction(Journal *journal, Canvas *canvas) {
+    journal->compact_from = journal->size;
+    int result = saver_start(&journal->compactor, canvas, journal->path, journal->format);
+    if (result <= 0) {
+        finish_compaction(journal, result);  /* Could not fork: it ran in place */
+    }
+}
+
+/* ============================================================
+ * Public API
+ * ============================================================ */
+
+void journal_init(Journal *journal) {
+    journal->path = NULL;
+    journal->journal_path = NULL;
+    journal->format = CANVAS_FORMAT_V1;
+    journal->fd = -1;
+    journal->size = 0;
+    journal->compact_bytes = JOURNAL_COMPACT_BYTES;
+    saver_init(&journal->compactor);
+    journal->compactor.keep_journal = true;
+    journal->compact_from = 0;
+    journal->state[0] = '\0';
+    journal->document = NULL;
+    journal->has_document = false;
+}
+
+int journal_open(Journal *journal, Canvas *canvas, const char *path, bool loaded) {
+    size_t compact_bytes = journal->compact_bytes;
+    journal_close(journal, canvas);
+    journal->compact_bytes = compact_bytes;
+    journal->path = strdup(path);
+    journal->journal_path = journal_path_for(path);
+    if (journal->path == NULL || journal->journal_path == NULL) {
+        journal_close(journal, canvas);
+        return -1;
+    }
+    /* Compaction keeps the file in the format it already has */
+    int format = canvas_file_format(path);
+    journal->format = format == CANVAS_FORMAT_V2 ? CANVAS_FORMAT_V2 : CANVAS_FORMAT_V1;
+    change_set_enable(&canvas->changes, true);
+
+    if (!loaded) {
+        return journal_compact(journal, canvas);
+    }
+
+    /* Carry on with the journal the canvas was loaded with, cutting
+     * off a record a crash left half-written */
+    remember_state(journal, canvas);
+    size_t size = 0;
+    char *data = read_file(journal->journal_path, &size);
+    int applied;
+    size_t intact = data ? apply_journal(NULL, data, size, &applied) : 0;
+    int result;
+    if (intact == 0) {
+        result = rewrite_journal(journal, "", 0);
+    } else {
+        size_t magic_len = strlen(JOURNAL_MAGIC) + 1;
+        result = rewrite_journal(journal, data + magic_len, intact - magic_len);
+    }
+    free(data);
+    return result;
+}
+
+void journal_close(Journal *journal, Canvas *canvas) {
+    wait_compaction(journal, true);
+    saver_cleanup(&journal->compactor, NULL);
+    if (journal->fd >= 0) {
+        close(journal->fd);
+    }
+    free(journal->path);
+    free(journal->journal_path);
+    free(journal->document);
+    size_t compact_bytes = journal->compact_bytes;
+    journal_init(journal);
+    journal->compact_bytes = compact_bytes;
+    if (canvas) {
+        change_set_enable(&canvas->changes, false);
+    }
+}
+
+bool journal_pending(const Journal *journal, const Canvas *canvas) {
+    if (journal->fd < 0) {
+        return false;
+    }
+    if (!change_set_empty(&canvas->changes) || document_changed(journal, canvas)) {
+        return true;
+    }
+    char state[sizeof(journal->state)];
+    format_state(canvas, state, sizeof(state));
+    return strcmp(state, journal->state) != 0;
+}
+
+int journal_save(Journal *journal, Canvas *canvas) {
+    if (journal->fd < 0) {
+        return -1;
+    }
+    wait_compaction(journal, false);
+    if (canvas->changes.overflow) {
+        return journal_compact(journal, canvas);
+    }
+    if (!journal_pending(journal, canvas)) {
+        return 0;
+    }
+
+    RecordBuf rb = {NULL, 0, 0, false};
+    write_changes(&rb, journal, canvas);
+    if (rb.failed) {
+        free(rb.data);
+        return journal_compact(journal, canvas);
+    }
+    /* A failed write is cut off again, so the journal never keeps
+     * half a save ahead of the next one */
+    if (write_all(journal->fd, rb.data, rb.len) != 0 || fsync(journal->fd) != 0) {
+        if (ftruncate(journal->fd, (off_t)journal->size) != 0) {
+            /* The torn record is ignored on replay */
+        }
+        free(rb.data);
+        return -1;
+    }
+    journal->size += rb.len;
+    free(rb.data);
+    remember_state(journal, canvas);
+    change_set_clear(&canvas->changes);
+
+    if (journal->size > journal->compact_bytes && !saver_busy(&journal->compactor)) {
+        start_compaction(journal, canvas);
+    }
+    return 0;
+}
+
+int journal_compact(Journal *journal, Canvas *canvas) {
+    if (journal->path == NULL) {
+        return -1;
+    }
+    wait_compaction(journal, true);
+    if (canvas_write_format(canvas, journal->path, (CanvasFormat)journal->format) != 0 ||
+        rewrite_journal(journal, "", 0) != 0) {
+        return -1;
+    }
+    remember_state(journal, canvas);
+    change_set_clear(&canvas->changes);
+    return 0;
+}
+
+void journal_poll(Journal *journal) {
+    wait_compaction(journal, false);
+}
+
+void journal_set_global(Journal *journal) {
+    global_journal = journal;
+}
+
+Journal *journal_get_global(void) {
+    return global_journal;
+}
@@ -555,6 +555,18 @@ bool joystick_try_reconnect(JoystickState *state) {
     // Reset counter
     state->reconnect_counter = 0;
 
+    return joystick_reconnect_now(state);
+}
+
+// Attempt to reopen the device immediately
+bool joystick_reconnect_now(JoystickState *state) {
+    if (!state) return false;
+
+    // Already connected?
+    if (state->available && state->fd >= 0) {
+        return true;
+    }
+
     // Try to open joystick (evdev interface)
     state->fd = open("/dev/input/event0", O_RDONLY | O_NONBLOCK);
     if (state->fd < 0) {
@@ -602,6 +614,20 @@ bool joystick_try_reconnect(JoystickState *state) {
     return true;
 }
 
+// True while the stick is deflected or a button is held
+bool joystick_is_active(const JoystickState *state) {
+    if (!state || !state->available) return false;
+
+    if (joystick_get_axis_normalized(state, AXIS_X) != 0.0 ||
+        joystick_get_axis_normalized(state, AXIS_Y) != 0.0) {
+        return true;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (state->button[i]) return true;
+    }
+    return false;
+}
+
 #else
 /* ========================================================================
  * WINDOWS IMPLEMENTATION - Stub implementation (joystick not supported)
@@ -693,4 +719,14 @@ bool joystick_try_reconnect(JoystickState *state) {
     return false;
 }
 
+bool joystick_reconnect_now(JoystickState *state) {
+    (void)state;
+    return false;
+}
+
+bool joystick_is_active(const JoystickState *state) {
+    (void)state;
+    return false;
+}
+
 #endif  /* _WIN32 */
@@ -1,8 +1,10 @@
 #define _POSIX_C_SOURCE 200809L
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdbool.h>
 #include <time.h>
 #include "types.h"
 #include "terminal.h"
@@ -16,6 +18,18 @@
 #include "joystick.h"
 #include "config.h"
 #include "test_mode.h"
+#include "event_loop.h"
+#include "command_runner.h"
+#include "file_viewer.h"
+#include "file_watch.h"
+#include "journal.h"
+#include "saver.h"
+#include "reloader.h"
+#include "canvas_watch.h"
+#include "control.h"
+
+/* Seconds between attempts to reopen a disconnected joystick */
+#define JOYSTICK_RECONNECT_INTERVAL 1.0
 
 /* Print usage information */
 static void print_usage(const char *program_name) {
@@ -26,6 +40,10 @@ static void print_usage(const char *program_name) {
     printf("  -T, --test-mode    Enable usability test mode (blank canvas + debug)\n");
     printf("  --test-mode=X      Enable test mode with variant X (A, B, or C)\n");
     printf("  --log-events       Log input events to events.log\n");
+    printf("  --watch            Reload FILE whenever another program rewrites it\n");
+    printf("  --control=PATH     Take commands that change the canvas on Unix socket PATH\n");
+    printf("  --convert=v1|v2 IN OUT\n");
+    printf("                     Convert canvas file IN (either format) to OUT and exit\n");
     printf("\nFILE:\n");
     printf("  Optional canvas file to load on startup (*.txt)\n");
     printf("  If not specified, starts with empty canvas\n");
@@ -51,6 +69,7 @@ static void print_usage(const char *program_name) {
     printf("  %s                          # Start with sample canvas\n", program_name);
     printf("  %s my_canvas.txt            # Load specific canvas file\n", program_name);
     printf("  %s demos/live_monitor.txt   # Load demo file\n", program_name);
+    printf("  %s --convert=v2 big.txt big.canvas  # Binary copy of a canvas\n", program_name);
 }
 
 /* Initialize empty canvas (Issue #47 - default behavior) */
@@ -94,6 +113,155 @@ static void init_welcome_canvas(Canvas *canvas) {
     canvas_add_box_content(canvas, box_id, welcome, 21);
 }
 
+/* Timer callback: retry a disconnected joystick */
+static void reconnect_joystick(void *ctx) {
+    JoystickState *joystick = ctx;
+    if (!joystick->available) {
+        joystick_reconnect_now(joystick);
+    }
+}
+
+/* What the auto-save timer saves */
+typedef struct {
+    Journal *journal;
+    Canvas *canvas;
+} AutoSave;
+
+/* Timer callback: append any edits made since the last save to the
+ * journal (auto_save) */
+static void auto_save(void *ctx) {
+    AutoSave *save = ctx;
+    if (save->journal->path != NULL && journal_pending(save->journal, save->canvas)) {
+        journal_save(save->journal, save->canvas);
+    }
+}
+
+/* Timer callback: take a save result off the status bar */
+static void clear_status(void *ctx) {
+    canvas_set_status(ctx, NULL);
+}
+
+/* Watch the control socket and its clients */
+static void watch_control_fds(EventLoop *loop, const ControlServer *server,
+                              int *fds, int *count) {
+    for (int i = 0; i < *count; i++) {
+        event_loop_remove_fd(loop, fds[i]);
+    }
+    *count = control_server_fds(server, fds, CONTROL_MAX_CLIENTS + 1);
+    for (int i = 0; i < *count; i++) {
+        event_loop_add_fd(loop, fds[i]);
+    }
+}
+
+/* Watch exactly the output pipes of the commands now running */
+static void watch_command_fds(EventLoop *loop, const CommandRunner *runner,
+                              int *fds, int *count) {
+    for (int i = 0; i < *count; i++) {
+        event_loop_remove_fd(loop, fds[i]);
+    }
+    *count = command_runner_fds(runner, fds, COMMAND_RUNNER_MAX_JOBS);
+    for (int i = 0; i < *count; i++) {
+        event_loop_add_fd(loop, fds[i]);
+    }
+}
+
+/* Draw one frame: world layers (clipped to damage), then UI overlays */
+static void draw_frame(Canvas *canvas, Viewport *viewport, JoystickState *joystick,
+                       TestMode *test_mode, const AppConfig *app_config) {
+    /* Focus mode rendering (Phase 5b) - takes over entire screen */
+    if (canvas->focus.active) {
+        render_focused_box(canvas);
+    } else {
+        /* Normal canvas rendering */
+
+        /* Render grid (Phase 4 - background layer) */
+        /* In test mode, use test_mode_render_grid for style experiments */
+        if (test_mode->enabled && test_mode->grid_style != GRID_STYLE_NONE) {
+            test_mode_render_grid(test_mode, viewport->cam_x, viewport->cam_y,
+                                  viewport->zoom, canvas->grid.spacing,
+                                  viewport->term_width, viewport->term_height);
+        } else {
+            render_grid(canvas, viewport);
+        }
+
+        /* Render connections between boxes (Issue #20 - behind boxes) */
+        render_connections(canvas, viewport);
+
+        /* Render canvas */
+        render_canvas(canvas, viewport, app_config);
+
+        /* Everything below is UI on top of the world layers */
+        render_frame_overlays();
+
+        /* Render sidebar (Issue #35 - overlays canvas) */
+        render_sidebar(canvas, viewport);
+
+        /* Render connection mode indicator (Issue #20) */
+        render_connection_mode(canvas, viewport);
+
+        /* Render joystick cursor (if in navigation mode) */
+        if (joystick->available) {
+            render_joystick_cursor(joystick, viewport);
+        }
+
+        /* Render status bar */
+        render_status(canvas, viewport);
+
+        /* Render joystick mode indicator */
+        if (joystick->available) {
+            render_joystick_mode(joystick, canvas);
+        }
+
+        /* Render parameter panel if active (Phase 2) */
+        if (joystick->available && joystick->param_editor_active) {
+            Box *selected = canvas_get_box(canvas, joystick->selected_box_id);
+            if (selected) {
+                render_parameter_panel(joystick, selected);
+            }
+        }
+
+        /* Render text editor if active (Phase 3) */
+        if (joystick->available && joystick->text_editor_active) {
+            Box *selected = canvas_get_box(canvas, joystick->selected_box_id);
+            if (selected) {
+                render_text_editor(joystick, selected);
+            }
+        }
+
+        /* Render joystick visualizer (if enabled) */
+        if (joystick->available) {
+            render_joystick_visualizer(joystick, viewport);
+        }
+    }
+
+    /* Render help overlay if visible (Issue #34) - after all other elements */
+    if (canvas->help.visible) {
+        render_help_overlay();
+    }
+
+    /* Render command line if active (Issue #55) - after status bar */
+    render_command_line(canvas);
+
+    /* Render text edit mode overlay (Issue #79) */
+    render_edit_mode(canvas, viewport);
+
+    /* Render test mode overlays (Issue #70) - on top of everything */
+    if (test_mode->enabled) {
+        test_mode_update_fps(test_mode);
+
+        /* Render markers */
+        test_mode_render_markers(test_mode, viewport->cam_x, viewport->cam_y,
+                                 viewport->zoom);
+
+        /* Render debug overlay */
+        const char *mode_name = canvas->focus.active ? "FOCUS" :
+                               (canvas->selected_index >= 0 ? "SELECT" : "NAV");
+        test_mode_render_overlay(test_mode, viewport->cam_x, viewport->cam_y,
+                                 viewport->zoom, joystick->cursor_x, joystick->cursor_y,
+                                 mode_name, canvas->box_count, canvas->conn_count);
+    }
+}
+
 
 int main(int argc, char *argv[]) {
     char *load_file = NULL;
@@ -128,6 +296,34 @@ int main(int argc, char *argv[]) {
             }
         } else if (strcmp(argv[i], "--log-events") == 0) {
             log_events = 1;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            app_config.watch = true;
+        } else if (strncmp(argv[i], "--control=", 10) == 0) {
+            strncpy(app_config.control_socket, argv[i] + 10, sizeof(app_config.control_socket) - 1);
+            app_config.control_socket[sizeof(app_config.control_socket) - 1] = '\0';
+        } else if (strncmp(argv[i], "--convert=", 10) == 0) {
+            const char *name = argv[i] + 10;
+            CanvasFormat format;
+            if (strcmp(name, "v1") == 0) {
+                format = CANVAS_FORMAT_V1;
+            } else if (strcmp(name, "v2") == 0) {
+                format = CANVAS_FORMAT_V2;
+            } else {
+                fprintf(stderr, "Unknown canvas format: %s (use v1 or v2)\n", name);
+                return 1;
+            }
+            if (i + 2 >= argc) {
+                fprintf(stderr, "Usage: %s --convert=v1|v2 IN OUT\n", argv[0]);
+                return 1;
+            }
+            if (canvas_convert(argv[i + 1], argv[i + 2], format) != 0) {
+                fprintf(stderr, "Error: Failed to convert '%s' to '%s'\n", argv[i + 1], argv[i + 2]);
+                if (persistence_last_error()[0] != '\0') {
+                    fprintf(stderr, "%s\n", persistence_last_error());
+                }
+                return 1;
+            }
+            return 0;
         } else if (argv[i][0] == '-') {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
             fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
@@ -167,6 +363,9 @@ int main(int argc, char *argv[]) {
         if (canvas_load(&canvas, load_file) != 0) {
             terminal_cleanup();
             fprintf(stderr, "Error: Failed to load canvas from '%s'\n", load_file);
+            if (persistence_last_error()[0] != '\0') {
+                fprintf(stderr, "%s\n", persistence_last_error());
+            }
             fprintf(stderr, "Make sure the file exists and is in the correct format.\n");
             return 1;
         }
@@ -179,12 +378,13 @@ int main(int argc, char *argv[]) {
         /* Center viewport on loaded content */
         if (canvas.box_count > 0) {
             /* Find bounding box of all boxes */
-            double min_x = canvas.boxes[0].x;
-            double min_y = canvas.boxes[0].y;
-            double max_x = canvas.boxes[0].x + canvas.boxes[0].width;
-            double max_y = canvas.boxes[0].y + canvas.boxes[0].height;
+            int first = canvas_draw_first(&canvas);
+            double min_x = canvas.boxes[first].x;
+            double min_y = canvas.boxes[first].y;
+            double max_x = canvas.boxes[first].x + canvas.boxes[first].width;
+            double max_y = canvas.boxes[first].y + canvas.boxes[first].height;
 
-            for (int i = 1; i < canvas.box_count; i++) {
+            for (int i = canvas_draw_next(&canvas, first); i >= 0; i = canvas_draw_next(&canvas, i)) {
                 if (canvas.boxes[i].x < min_x) min_x = canvas.boxes[i].x;
                 if (canvas.boxes[i].y < min_y) min_y = canvas.boxes[i].y;
                 if (canvas.boxes[i].x + canvas.boxes[i].width > max_x)
@@ -235,9 +435,91 @@ int main(int argc, char *argv[]) {
     joystick.cursor_x = viewport.cam_x + (viewport.term_width / 2.0) / viewport.zoom;
     joystick.cursor_y = viewport.cam_y + (viewport.term_height / 2.0) / viewport.zoom;
 
+    /* Event loop: sleep until the terminal, joystick, a signal or a timer
+     * needs attention, and draw only when something changed */
+    EventLoop loop;
+    event_loop_init(&loop, app_config.max_fps);
+    event_loop_add_fd(&loop, STDIN_FILENO);
+    event_loop_add_fd(&loop, signal_wakeup_fd());
+    int joystick_fd = joystick.available ? joystick.fd : -1;
+    event_loop_add_fd(&loop, joystick_fd);
+    event_loop_add_timer(&loop, JOYSTICK_RECONNECT_INTERVAL, JOYSTICK_RECONNECT_INTERVAL,
+                         reconnect_joystick, &joystick);
+
+    /* Commands from :run / :rerun, and command boxes with a refresh
+     * interval, run in the background */
+    CommandRunner commands;
+    command_runner_init(&commands, app_config.command_max_running, app_config.command_timeout);
+    command_runner_set_global(&commands);
+    command_runner_schedule_canvas(&commands, &canvas);
+    int command_fds[COMMAND_RUNNER_MAX_JOBS];
+    int command_fd_count = 0;
+
+    /* File boxes share one copy per file and follow changes on disk */
+    FileWatch files;
+    file_watch_init(&files);
+    file_watch_set_global(&files);
+    file_watch_attach_canvas(&files, &canvas);
+    event_loop_add_fd(&loop, file_watch_fd(&files));
+
+    /* F2 saves are written by a forked child, so editing never waits
+     * on the disk (see saver.h) */
+    Saver saver;
+    saver_init(&saver);
+    saver_set_global(&saver);
+    unsigned int status_seq = canvas.status_seq;
+
+    /* SIGUSR1 reloads run in the background too (see reloader.h) */
+    Reloader reloader;
+    reloader_init(&reloader);
+    int reload_fd = -1;
+
+    /* --watch: rewrites of the file reload it as SIGUSR1 does */
+    CanvasWatch canvas_watch;
+    canvas_watch_init(&canvas_watch);
+    const char *watched_file = NULL;
+    int canvas_watch_fd_now = -1;
+    unsigned int save_count = persistence_save_count();
+
+    /* --control: programs change the canvas through a Unix socket */
+    ControlServer control;
+    control_server_init(&control);
+    int control_fds[CONTROL_MAX_CLIENTS + 1];
+    int control_fd_count = 0;
+    if (app_config.control_socket[0] != '\0') {
+        if (control_server_listen(&control, app_config.control_socket) != 0) {
+            char message[sizeof(canvas.status_message)];
+            snprintf(message, sizeof(message), "Control socket failed: %.80s (%s)",
+                     app_config.control_socket, strerror(errno));
+            canvas_set_status(&canvas, message);
+        }
+        watch_control_fds(&loop, &control, control_fds, &control_fd_count);
+    }
+    int status_timer = -1;
+
+    /* Journal mode: saves append what changed to FILE.journal. It
+     * follows the loaded file, or canvas.txt from the first F2 on */
+    Journal journal;
+    journal_init(&journal);
+    AutoSave auto_save_ctx = {&journal, &canvas};
+    if (app_config.journal || app_config.auto_save) {
+        journal_set_global(&journal);
+        if (load_file != NULL) {
+            journal_open(&journal, &canvas, load_file, true);
+        }
+        if (app_config.auto_save) {
+            event_loop_add_timer(&loop, JOURNAL_AUTO_SAVE_INTERVAL, JOURNAL_AUTO_SAVE_INTERVAL,
+                                 auto_save, &auto_save_ctx);
+        }
+    }
+
     /* Main loop */
     int running = 1;
+    bool input_pending = true;  /* ncurses may already hold queued keys */
+    double input_since = -1.0;  /* When input not yet on screen arrived */
     while (running) {
+        signal_clear_wakeup();
+
         /* Check for termination signals (Ctrl+C, kill, etc.) */
         if (signal_should_quit()) {
             running = 0;
@@ -249,139 +531,233 @@ int main(int argc, char *argv[]) {
             terminal_update_size(&viewport);
         }
 
-        /* Check for reload signal (SIGUSR1) */
+        /* Check for reload signal (SIGUSR1): the file is compared with
+         * the canvas in the background and only the differences applied */
         if (signal_should_reload()) {
             const char *current_file = persistence_get_current_file();
             if (current_file != NULL) {
-                Canvas new_canvas;
-                if (canvas_load(&new_canvas, current_file) == 0) {
-                    canvas_cleanup(&canvas);
-                    canvas = new_canvas;
-                }
+                reloader_start(&reloader, &canvas, current_file);
             }
         }
 
-        /* Update terminal size (in case of resize) */
-        terminal_update_size(&viewport);
-
-        /* Clear screen */
-        terminal_clear();
-
-        /* Focus mode rendering (Phase 5b) - takes over entire screen */
-        if (canvas.focus.active) {
-            render_focused_box(&canvas);
-        } else {
-            /* Normal canvas rendering */
-
-            /* Render grid (Phase 4 - background layer) */
-            /* In test mode, use test_mode_render_grid for style experiments */
-            if (test_mode.enabled && test_mode.grid_style != GRID_STYLE_NONE) {
-                test_mode_render_grid(&test_mode, viewport.cam_x, viewport.cam_y,
-                                      viewport.zoom, canvas.grid.spacing,
-                                      viewport.term_width, viewport.term_height);
-            } else {
-                render_grid(&canvas, &viewport);
+        /* --watch follows the file now loaded (F3 may switch it) */
+        if (app_config.watch && persistence_get_current_file() != watched_file) {
+            watched_file = persistence_get_current_file();
+            if (watched_file != NULL && canvas_watch_start(&canvas_watch, watched_file) == 0) {
+                canvas_watch_ignore_current(&canvas_watch);
             }
+        }
+        if (canvas_watch_fd(&canvas_watch) != canvas_watch_fd_now) {
+            event_loop_remove_fd(&loop, canvas_watch_fd_now);
+            canvas_watch_fd_now = canvas_watch_fd(&canvas_watch);
+            event_loop_add_fd(&loop, canvas_watch_fd_now);
+        }
 
-            /* Render connections between boxes (Issue #20 - behind boxes) */
-            render_connections(&canvas, &viewport);
+        /* Reload the watched file once a rewrite settles. Our own saves
+         * are not reloaded: one finishing meanwhile holds it back */
+        if (canvas_watch_fd_now >= 0 && event_loop_fd_ready(&loop, canvas_watch_fd_now)) {
+            canvas_watch_read_events(&canvas_watch, event_loop_now());
+        }
+        if (persistence_save_count() != save_count) {
+            save_count = persistence_save_count();
+            canvas_watch_ignore_current(&canvas_watch);
+        }
+        bool saving = saver_busy(&saver) || saver_busy(&journal.compactor);
+        if (!saving && canvas_watch_due(&canvas_watch, event_loop_now())) {
+            reloader_start(&reloader, &canvas, canvas_watch_path(&canvas_watch));
+        }
 
-            /* Render canvas */
-            render_canvas(&canvas, &viewport, &app_config);
+        if (reloader_fd(&reloader) != reload_fd) {
+            event_loop_remove_fd(&loop, reload_fd);
+            reload_fd = reloader_fd(&reloader);
+            event_loop_add_fd(&loop, reload_fd);
+        }
 
-            /* Render sidebar (Issue #35 - overlays canvas) */
-            render_sidebar(&canvas, &viewport);
+        /* Update terminal size (in case of resize) */
+        terminal_update_size(&viewport);
 
-            /* Render connection mode indicator (Issue #20) */
-            render_connection_mode(&canvas, &viewport);
+        /* Terminal gone (e.g. SSH connection dropped without SIGHUP) */
+        if (event_loop_fd_hangup(&loop, STDIN_FILENO)) {
+            running = 0;
+            break;
+        }
 
-            /* Render joystick cursor (if in navigation mode) */
-            if (joystick.available) {
-                render_joystick_cursor(&joystick, &viewport);
+        /* Handle keyboard and mouse input: drain everything queued so a
+         * burst is applied in one pass and shown in one frame */
+        if (input_pending || event_loop_fd_ready(&loop, STDIN_FILENO)) {
+            int events = 0;
+            if (handle_input_batch(&canvas, &viewport, &joystick, &app_config, &events)) {
+                running = 0;
             }
-
-            /* Render status bar */
-            render_status(&canvas, &viewport);
-
-            /* Render joystick mode indicator */
-            if (joystick.available) {
-                render_joystick_mode(&joystick, &canvas);
+            /* A full batch may have left more behind */
+            input_pending = (events >= INPUT_BATCH_MAX);
+            if (events > 0 && input_since < 0.0 &&
+                (render_frame_pending(&canvas, &viewport) || input_drag_pending())) {
+                input_since = loop.woke_at;
             }
+        }
 
-            /* Render parameter panel if active (Phase 2) */
-            if (joystick.available && joystick.param_editor_active) {
-                Box *selected = canvas_get_box(&canvas, joystick.selected_box_id);
-                if (selected) {
-                    render_parameter_panel(&joystick, selected);
-                }
+        /* Handle joystick input (new events, or a held stick/button) */
+        if (joystick.available &&
+            (event_loop_fd_ready(&loop, joystick.fd) || joystick_is_active(&joystick))) {
+            double cursor_x = joystick.cursor_x;
+            double cursor_y = joystick.cursor_y;
+            int events = joystick_poll(&joystick);
+            if (handle_joystick_input(&canvas, &viewport, &joystick, &app_config)) {
+                running = 0;
             }
-
-            /* Render text editor if active (Phase 3) */
-            if (joystick.available && joystick.text_editor_active) {
-                Box *selected = canvas_get_box(&canvas, joystick.selected_box_id);
-                if (selected) {
-                    render_text_editor(&joystick, selected);
-                }
+            /* Cursor, panels and visualizer are not damage-tracked */
+            if (events > 0 || joystick.cursor_x != cursor_x || joystick.cursor_y != cursor_y) {
+                canvas_mark_all_dirty(&canvas);
             }
+        }
 
-            /* Render joystick visualizer (if enabled) */
-            if (joystick.available) {
-                render_joystick_visualizer(&joystick, &viewport);
-            }
+        /* Follow joystick connects and disconnects */
+        int current_fd = joystick.available ? joystick.fd : -1;
+        if (current_fd != joystick_fd) {
+            event_loop_remove_fd(&loop, joystick_fd);
+            event_loop_add_fd(&loop, current_fd);
+            joystick_fd = current_fd;
         }
 
-        /* Render help overlay if visible (Issue #34) - after all other elements */
-        if (canvas.help.visible) {
-            render_help_overlay();
+        /* Stream command output, reap finished commands, start queued ones.
+         * Pipes only close in here, so the watched set is refreshed right after */
+        command_runner_poll(&commands, &canvas);
+        watch_command_fds(&loop, &commands, command_fds, &command_fd_count);
+
+        /* Apply commands from control clients; they are drawn with the
+         * next frame. A pass is capped, so a flood of them leaves room
+         * for input and drawing */
+        bool control_ready = control_server_pending(&control);
+        for (int i = 0; i < control_fd_count && !control_ready; i++) {
+            control_ready = event_loop_fd_ready(&loop, control_fds[i]) ||
+                            event_loop_fd_hangup(&loop, control_fds[i]);
+        }
+        if (control_ready) {
+            control_server_poll(&control, &canvas);
+            watch_control_fds(&loop, &control, control_fds, &control_fd_count);
         }
 
-        /* Render command line if active (Issue #55) - after status bar */
-        render_command_line(&canvas);
+        /* Finish a background compaction of the journal */
+        journal_poll(&journal);
 
-        /* Render text edit mode overlay (Issue #79) */
-        render_edit_mode(&canvas, &viewport);
+        /* Apply a reload whose differences are in */
+        if (reload_fd >= 0 && event_loop_fd_ready(&loop, reload_fd) &&
+            reloader_poll(&reloader, &canvas) < 0) {
+            char message[sizeof(canvas.status_message)];
+            snprintf(message, sizeof(message), "Reload failed: %s",
+                     persistence_get_current_file());
+            canvas_set_status(&canvas, message);
+        }
 
-        /* Render test mode overlays (Issue #70) - on top of everything */
-        if (test_mode.enabled) {
-            test_mode_update_fps(&test_mode);
+        /* Report a background save that finished */
+        int saved = saver_poll(&saver, &canvas);
+        if (saved != 0) {
+            char message[sizeof(canvas.status_message)];
+            saver_describe(&saver, saved, message, sizeof(message));
+            canvas_set_status(&canvas, message);
+        }
 
-            /* Render markers */
-            test_mode_render_markers(&test_mode, viewport.cam_x, viewport.cam_y,
-                                     viewport.zoom);
+        /* Note changed files; they are re-read below, once per frame */
+        if (event_loop_fd_ready(&loop, file_watch_fd(&files))) {
+            file_watch_read_events(&files);
+        }
 
-            /* Render debug overlay */
-            const char *mode_name = canvas.focus.active ? "FOCUS" :
-                                   (canvas.selected_index >= 0 ? "SELECT" : "NAV");
-            test_mode_render_overlay(&test_mode, viewport.cam_x, viewport.cam_y,
-                                     viewport.zoom, joystick.cursor_x, joystick.cursor_y,
-                                     mode_name, canvas.box_count, canvas.conn_count);
+        /* Index large files a slice per pass so input stays responsive */
+        if (file_viewer_indexing()) {
+            file_viewer_index_step(&canvas);
         }
 
-        /* Refresh display */
-        terminal_refresh();
+        /* Timers (joystick reconnect, periodic work) */
+        event_loop_run_timers(&loop);
+
+        /* A new status bar message stays for a few seconds; "Saving..."
+         * stays until the save is done */
+        if (canvas.status_seq != status_seq) {
+            status_seq = canvas.status_seq;
+            event_loop_cancel_timer(&loop, status_timer);
+            status_timer = -1;
+            if (canvas.status_message[0] != '\0' && !saver_busy(&saver)) {
+                status_timer = event_loop_add_timer(&loop, SAVER_MESSAGE_SECONDS, 0.0,
+                                                    clear_status, &canvas);
+            }
+        }
 
-        /* Handle keyboard input */
-        if (handle_input(&canvas, &viewport, &joystick, &app_config)) {
-            running = 0;
+        /* Test mode overlays (FPS, markers) change every frame */
+        if (test_mode.enabled) {
+            canvas_mark_all_dirty(&canvas);
         }
 
-        /* Handle joystick input */
-        if (joystick.available) {
-            joystick_poll(&joystick);
-            if (handle_joystick_input(&canvas, &viewport, &joystick, &app_config)) {
-                running = 0;
+        /* Apply file changes when the next frame is due, so a file written
+         * to many times a second is re-read at most once per frame */
+        bool files_pending = file_watch_pending(&files);
+        if (files_pending && event_loop_now() >= event_loop_next_frame(&loop)) {
+            file_watch_apply(&files, &canvas);
+            files_pending = false;
+        }
+
+        /* Draw when something changed, at most max_fps times a second */
+        bool frame_pending = render_frame_pending(&canvas, &viewport) || input_drag_pending();
+        if (frame_pending && event_loop_now() >= event_loop_next_frame(&loop)) {
+            input_apply_drag(&canvas);
+            if (render_frame_begin(&canvas, &viewport)) {
+                draw_frame(&canvas, &viewport, &joystick, &test_mode, &app_config);
+                render_frame_end();
             }
-        } else {
-            /* Try to reconnect joystick if disconnected */
-            joystick_try_reconnect(&joystick);
+            if (input_since >= 0.0) {
+                test_mode_record_latency(&test_mode, event_loop_now() - input_since);
+                input_since = -1.0;
+            }
+            event_loop_frame_drawn(&loop);
+            frame_pending = false;
         }
 
-        /* Small delay to reduce CPU usage */
-        struct timespec ts = {0, 16667000}; /* ~60 FPS (16.667ms) */
-        nanosleep(&ts, NULL);
+        /* Sleep: not at all while keys are still queued or files are being
+         * indexed, until the next frame slot while something is waiting to
+         * be drawn, the joystick is held or control commands are left over,
+         * otherwise until an fd or timer wakes us */
+        double deadline = -1.0;
+        if (input_pending || file_viewer_indexing()) {
+            deadline = 0.0;
+        } else if (frame_pending || files_pending || joystick_is_active(&joystick) ||
+                   control_server_pending(&control)) {
+            deadline = event_loop_next_frame(&loop);
+        }
+        saving = saver_busy(&saver) || saver_busy(&journal.compactor);
+        if (saving) {
+            /* Children exiting do not wake the loop: check back shortly */
+            double save_deadline = event_loop_now() + SAVER_POLL_INTERVAL;
+            if (deadline < 0.0 || save_deadline < deadline) {
+                deadline = save_deadline;
+            }
+        }
+        /* A settling rewrite of the watched file (after any save) */
+        double watch_deadline = saving ? -1.0 : canvas_watch_next_deadline(&canvas_watch);
+        if (watch_deadline >= 0.0 && (deadline < 0.0 || watch_deadline < deadline)) {
+            deadline = watch_deadline;
+        }
+        double command_deadline = command_runner_next_deadline(&commands);
+        if (command_deadline >= 0.0 && (deadline < 0.0 || command_deadline < deadline)) {
+            deadline = command_deadline;
+        }
+        if (running) {
+            event_loop_wait(&loop, deadline);
+        }
     }
 
     /* Cleanup */
+    if (app_config.auto_save) {
+        auto_save(&auto_save_ctx);
+    }
+    journal_close(&journal, &canvas);
+    journal_set_global(NULL);
+    canvas_watch_stop(&canvas_watch);
+    control_server_shutdown(&control);
+    reloader_cleanup(&reloader);
+    saver_cleanup(&saver, &canvas);  /* Let a save in progress finish */
+    saver_set_global(NULL);
+    command_runner_shutdown(&commands);
+    file_watch_shutdown(&files);
     test_mode_cleanup(&test_mode);
     joystick_close(&joystick);
     canvas_cleanup(&canvas);
@@ -1,9 +1,23 @@
 #define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 #include "persistence.h"
 #include "canvas.h"
+#include "box_content.h"
+#include "file_viewer.h"
+#include "journal.h"
 
 #define FILE_MAGIC "BOXES_CANVAS_V1"
 #define MAX_LINE_LENGTH 1024
@@ -11,6 +25,31 @@
 /* Current file for reload functionality */
 static const char *current_file = NULL;
 
+/* Saves finished, for persistence_save_count() */
+static unsigned int saves_finished = 0;
+
+/* Why the last canvas_load() failed */
+static char last_error[256] = "";
+
+static void set_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(last_error, sizeof(last_error), format, args);
+    va_end(args);
+}
+
+const char *persistence_last_error(void) {
+    return last_error;
+}
+
+unsigned int persistence_save_count(void) {
+    return saves_finished;
+}
+
+void persistence_count_save(void) {
+    saves_finished++;
+}
+
 /* Set the current file name */
 void persistence_set_current_file(const char *filename) {
     current_file = filename;
@@ -21,26 +60,35 @@ const char *persistence_get_current_file(void) {
     return current_file;
 }
 
-/* Save canvas to file */
-int canvas_save(const Canvas *canvas, const char *filename) {
-    FILE *f = fopen(filename, "w");
-    if (f == NULL) {
-        return -1;
-    }
-
+/* Write canvas to f in the V1 text format */
+static int canvas_save_v1(const Canvas *canvas, FILE *f) {
     /* Write header */
     fprintf(f, "%s\n", FILE_MAGIC);
     fprintf(f, "%.2f %.2f\n", canvas->world_width, canvas->world_height);
     fprintf(f, "%d\n", canvas->box_count);
 
-    /* Write each box */
-    for (int i = 0; i < canvas->box_count; i++) {
+    /* Write each box in draw order; a loaded canvas fills slots in this order */
+    int selected_rank = -1;
+    int rank = 0;
+    for (int i = canvas_draw_first(canvas); i >= 0; i = canvas_draw_next(canvas, i), rank++) {
         const Box *box = &canvas->boxes[i];
+        if (i == canvas->selected_index) {
+            selected_rank = rank;
+        }
 
-        /* Write box properties (Issue #33: added box_type, Issue #54: added content_type) */
-        fprintf(f, "%d %.2f %.2f %d %d %d %d %d %d\n",
+        /* Write box properties (Issue #33: added box_type, Issue #54: added content_type).
+         * Refresh interval and stream flag are appended only when set, so
+         * other boxes keep the 9-field line older builds read. */
+        fprintf(f, "%d %.2f %.2f %d %d %d %d %d %d",
                 box->id, box->x, box->y, box->width, box->height,
                 box->selected ? 1 : 0, box->color, box->box_type, box->content_type);
+        if (box->refresh_interval > 0 || box->command_stream) {
+            fprintf(f, " %d", box->refresh_interval);
+        }
+        if (box->command_stream) {
+            fprintf(f, " 1");
+        }
+        fprintf(f, "\n");
 
         /* Write title */
         if (box->title) {
@@ -63,15 +111,16 @@ int canvas_save(const Canvas *canvas, const char *filename) {
             fprintf(f, "NULL\n");
         }
 
-        /* Write content */
-        fprintf(f, "%d\n", box->content_lines);
-        for (int j = 0; j < box->content_lines; j++) {
-            fprintf(f, "%s\n", box->content[j]);
+        /* Write content (a mapped file is reopened from file_path instead) */
+        int content_lines = box->file_map ? 0 : box_content_count(box);
+        fprintf(f, "%d\n", content_lines);
+        for (int j = 0; j < content_lines; j++) {
+            fprintf(f, "%s\n", box_content_line(box, j));
         }
     }
 
     /* Write next_id and selected_index */
-    fprintf(f, "%d %d\n", canvas->next_id, canvas->selected_index);
+    fprintf(f, "%d %d\n", canvas->next_id, selected_rank);
 
     /* Write connections (Issue #20) */
     fprintf(f, "CONNECTIONS\n");
@@ -101,317 +150,1197 @@ int canvas_save(const Canvas *canvas, const char *filename) {
     fprintf(f, "END_DOCUMENT\n");
     fprintf(f, "%d %d\n", canvas->sidebar_state, canvas->sidebar_width);
 
-    fclose(f);
-    return 0;
+    return ferror(f) ? -1 : 0;
 }
 
-/* Load canvas from file */
-int canvas_load(Canvas *canvas, const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (f == NULL) {
+/* ============================================================
+ * Binary format (V2)
+ *
+ * A 16-byte magic line, a section count, then a table of sections
+ * (tag, version, offset, length) pointing into the rest of the file.
+ * Everything is little-endian. Doubles are stored as their IEEE 754
+ * bits, so positions load exactly as saved. Other numbers are LEB128
+ * varints (signed ones zigzag-encoded), so small values take a byte.
+ * Strings are a varint of length + 1 (0 for a missing string)
+ * followed by the bytes, so lines of any length and content survive. Readers skip sections
+ * with tags they do not know, or versions newer than they read, so
+ * new sections can be added without breaking older builds.
+ * ============================================================ */
+
+#define V2_MAGIC "BOXES_CANVAS_V2\n"
+#define V2_MAGIC_LEN 16
+#define V2_HEADER_LEN (V2_MAGIC_LEN + 8)
+#define V2_ENTRY_LEN 24
+
+#define V2_TAG(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define V2_SECTION_CANVAS V2_TAG('C', 'N', 'V', 'S')
+#define V2_SECTION_BOXES V2_TAG('B', 'O', 'X', 'S')
+#define V2_SECTION_CONNECTIONS V2_TAG('C', 'O', 'N', 'N')
+#define V2_SECTION_GRID V2_TAG('G', 'R', 'I', 'D')
+#define V2_SECTION_DOCUMENT V2_TAG('D', 'O', 'C', 'U')
+#define V2_SECTION_VERSION 1
+#define V2_SECTION_COUNT 5
+#define V2_MIN_BOX_LEN 27      /* A box record with small numbers, no strings or lines */
+
+/* Growable output buffer; the file is written with one fwrite */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    bool failed;
+} WriteBuf;
+
+static unsigned char *wb_reserve(WriteBuf *wb, size_t n) {
+    if (wb->failed) {
+        return NULL;
+    }
+    if (wb->len + n > wb->cap) {
+        size_t cap = wb->cap ? wb->cap : 4096;
+        while (cap < wb->len + n) {
+            cap *= 2;
+        }
+        unsigned char *grown = realloc(wb->data, cap);
+        if (grown == NULL) {
+            wb->failed = true;
+            return NULL;
+        }
+        wb->data = grown;
+        wb->cap = cap;
+    }
+    unsigned char *p = wb->data + wb->len;
+    wb->len += n;
+    return p;
+}
+
+static void put_le(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static void wb_u8(WriteBuf *wb, unsigned v) {
+    unsigned char *p = wb_reserve(wb, 1);
+    if (p) *p = (unsigned char)v;
+}
+
+static void wb_uv(WriteBuf *wb, uint32_t v) {
+    unsigned char *p = wb_reserve(wb, 5);
+    if (p == NULL) {
+        return;
+    }
+    int n = 0;
+    do {
+        p[n++] = (unsigned char)((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+        v >>= 7;
+    } while (v != 0);
+    wb->len -= 5 - n;
+}
+
+static void wb_iv(WriteBuf *wb, int v) {
+    uint32_t u = (uint32_t)v;
+    wb_uv(wb, (u << 1) ^ (v < 0 ? 0xFFFFFFFFu : 0));
+}
+
+static void wb_f64(WriteBuf *wb, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    unsigned char *p = wb_reserve(wb, 8);
+    if (p) put_le(p, bits, 8);
+}
+
+static void wb_bytes(WriteBuf *wb, const char *s, size_t len) {
+    wb_uv(wb, (uint32_t)len + 1);
+    unsigned char *p = wb_reserve(wb, len);
+    if (p && len > 0) memcpy(p, s, len);
+}
+
+static void wb_str(WriteBuf *wb, const char *s) {
+    if (s == NULL) {
+        wb_uv(wb, 0);
+    } else {
+        wb_bytes(wb, s, strlen(s));
+    }
+}
+
+/* Start section 'index' of the table at the current end of the buffer */
+static void wb_section_begin(WriteBuf *wb, int index, uint32_t tag) {
+    if (wb->failed) {
+        return;
+    }
+    unsigned char *entry = wb->data + V2_HEADER_LEN + (size_t)index * V2_ENTRY_LEN;
+    put_le(entry, tag, 4);
+    put_le(entry + 4, V2_SECTION_VERSION, 4);
+    put_le(entry + 8, wb->len, 8);
+}
+
+static void wb_section_end(WriteBuf *wb, int index) {
+    if (wb->failed) {
+        return;
+    }
+    unsigned char *entry = wb->data + V2_HEADER_LEN + (size_t)index * V2_ENTRY_LEN;
+    uint64_t offset = 0;
+    for (int i = 7; i >= 0; i--) {
+        offset = offset << 8 | entry[8 + i];
+    }
+    put_le(entry + 16, wb->len - offset, 8);
+}
+
+static int canvas_save_v2(const Canvas *canvas, FILE *f) {
+    WriteBuf wb = {0};
+
+    unsigned char *header = wb_reserve(&wb, V2_HEADER_LEN + V2_SECTION_COUNT * V2_ENTRY_LEN);
+    if (header != NULL) {
+        memset(header, 0, V2_HEADER_LEN + V2_SECTION_COUNT * V2_ENTRY_LEN);
+        memcpy(header, V2_MAGIC, V2_MAGIC_LEN);
+        put_le(header + V2_MAGIC_LEN, V2_SECTION_COUNT, 4);
+    }
+
+    /* Boxes in draw order, as in V1; the selection is saved as a rank */
+    int selected_rank = -1;
+    int rank = 0;
+    wb_section_begin(&wb, 1, V2_SECTION_BOXES);
+    wb_uv(&wb, (uint32_t)canvas->box_count);
+    for (int i = canvas_draw_first(canvas); i >= 0; i = canvas_draw_next(canvas, i), rank++) {
+        const Box *box = &canvas->boxes[i];
+        if (i == canvas->selected_index) {
+            selected_rank = rank;
+        }
+        wb_iv(&wb, box->id);
+        wb_f64(&wb, box->x);
+        wb_f64(&wb, box->y);
+        wb_iv(&wb, box->width);
+        wb_iv(&wb, box->height);
+        wb_u8(&wb, (box->selected ? 1 : 0) | (box->command_stream ? 2 : 0));
+        wb_iv(&wb, box->color);
+        wb_iv(&wb, box->box_type);
+        wb_iv(&wb, box->content_type);
+        wb_iv(&wb, box->refresh_interval);
+        wb_str(&wb, box->title);
+        wb_str(&wb, box->file_path);
+        wb_str(&wb, box->command);
+
+        /* A mapped file is reopened from file_path instead */
+        int content_lines = box->file_map ? 0 : box_content_count(box);
+        wb_uv(&wb, (uint32_t)content_lines);
+        for (int j = 0; j < content_lines; j++) {
+            wb_bytes(&wb, box_content_line(box, j), box_content_line_length(box, j));
+        }
+    }
+    wb_section_end(&wb, 1);
+
+    wb_section_begin(&wb, 0, V2_SECTION_CANVAS);
+    wb_f64(&wb, canvas->world_width);
+    wb_f64(&wb, canvas->world_height);
+    wb_iv(&wb, canvas->next_id);
+    wb_iv(&wb, selected_rank);
+    wb_section_end(&wb, 0);
+
+    wb_section_begin(&wb, 2, V2_SECTION_CONNECTIONS);
+    wb_uv(&wb, (uint32_t)canvas->conn_count);
+    for (int i = 0; i < canvas->conn_count; i++) {
+        const Connection *conn = &canvas->connections[i];
+        wb_iv(&wb, conn->id);
+        wb_iv(&wb, conn->source_id);
+        wb_iv(&wb, conn->dest_id);
+        wb_iv(&wb, conn->color);
+    }
+    wb_iv(&wb, canvas->next_conn_id);
+    wb_section_end(&wb, 2);
+
+    wb_section_begin(&wb, 3, V2_SECTION_GRID);
+    wb_u8(&wb, canvas->grid.visible ? 1 : 0);
+    wb_u8(&wb, canvas->grid.snap_enabled ? 1 : 0);
+    wb_iv(&wb, canvas->grid.spacing);
+    wb_section_end(&wb, 3);
+
+    wb_section_begin(&wb, 4, V2_SECTION_DOCUMENT);
+    wb_str(&wb, canvas->document);
+    wb_iv(&wb, canvas->sidebar_state);
+    wb_iv(&wb, canvas->sidebar_width);
+    wb_section_end(&wb, 4);
+
+    if (wb.failed) {
+        free(wb.data);
         return -1;
     }
+    int result = fwrite(wb.data, 1, wb.len, f) == wb.len ? 0 : -1;
+    free(wb.data);
+    return result;
+}
 
-    char magic[MAX_LINE_LENGTH];
-    if (fgets(magic, sizeof(magic), f) == NULL) {
-        fclose(f);
+/* Bounds-checked cursor over one section; a read past the end sets
+ * 'failed' and yields zeros */
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool failed;
+} ReadCursor;
+
+static const unsigned char *rc_take(ReadCursor *rc, size_t n) {
+    if (rc->failed || (size_t)(rc->end - rc->p) < n) {
+        rc->failed = true;
+        return NULL;
+    }
+    const unsigned char *p = rc->p;
+    rc->p += n;
+    return p;
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+static unsigned rc_u8(ReadCursor *rc) {
+    const unsigned char *p = rc_take(rc, 1);
+    return p ? *p : 0;
+}
+
+static uint32_t rc_uv(ReadCursor *rc) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const unsigned char *p = rc_take(rc, 1);
+        if (p == NULL) {
+            return 0;
+        }
+        v |= (uint32_t)(*p & 0x7F) << shift;
+        if (!(*p & 0x80)) {
+            return v;
+        }
+    }
+    rc->failed = true;
+    return 0;
+}
+
+static int rc_iv(ReadCursor *rc) {
+    uint32_t u = rc_uv(rc);
+    return (int)((u >> 1) ^ (0u - (u & 1)));
+}
+
+static double rc_f64(ReadCursor *rc) {
+    const unsigned char *p = rc_take(rc, 8);
+    uint64_t bits = p ? get_le(p, 8) : 0;
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/* String bytes in place (not terminated); NULL for a missing string */
+static const char *rc_bytes(ReadCursor *rc, size_t *len) {
+    uint32_t n = rc_uv(rc);
+    *len = 0;
+    if (n == 0 || rc->failed) {
+        return NULL;
+    }
+    const unsigned char *p = rc_take(rc, n - 1);
+    *len = p ? n - 1 : 0;
+    return (const char *)p;
+}
+
+/* Terminated copy of a string, NULL for a missing one ('failed' on
+ * error) */
+static char *rc_strdup(ReadCursor *rc) {
+    size_t len;
+    const char *s = rc_bytes(rc, &len);
+    if (s == NULL) {
+        return NULL;
+    }
+    char *copy = malloc(len + 1);
+    if (copy == NULL) {
+        rc->failed = true;
+        return NULL;
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* True if the section table and every section in it lie within the
+ * file (a truncated file fails here) */
+static bool check_sections(const unsigned char *data, size_t size) {
+    uint32_t count = (uint32_t)get_le(data + V2_MAGIC_LEN, 4);
+    if (count > (size - V2_HEADER_LEN) / V2_ENTRY_LEN) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char *entry = data + V2_HEADER_LEN + (size_t)i * V2_ENTRY_LEN;
+        uint64_t offset = get_le(entry + 8, 8);
+        uint64_t length = get_le(entry + 16, 8);
+        if (offset > size || length > size - offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Section with this tag, or false if absent or of a newer version
+ * (the table has passed check_sections) */
+static bool find_section(const unsigned char *data, uint32_t tag, ReadCursor *rc) {
+    uint32_t count = (uint32_t)get_le(data + V2_MAGIC_LEN, 4);
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char *entry = data + V2_HEADER_LEN + (size_t)i * V2_ENTRY_LEN;
+        uint64_t offset = get_le(entry + 8, 8);
+        uint64_t length = get_le(entry + 16, 8);
+        if (get_le(entry, 4) != tag || get_le(entry + 4, 4) > V2_SECTION_VERSION) {
+            continue;
+        }
+        rc->p = data + offset;
+        rc->end = data + offset + length;
+        rc->failed = false;
+        return true;
+    }
+    return false;
+}
+
+static int load_v2_boxes(Canvas *canvas, ReadCursor *rc) {
+    uint32_t box_count = rc_uv(rc);
+    /* Bound a corrupt count before sizing anything from it */
+    if (rc->failed || box_count > (size_t)(rc->end - rc->p) / V2_MIN_BOX_LEN) {
         return -1;
     }
+    canvas_reserve(canvas, (int)box_count, 0);
 
-    /* Remove newline */
-    magic[strcspn(magic, "\n")] = 0;
+    for (uint32_t i = 0; i < box_count; i++) {
+        int id = rc_iv(rc);
+        double x = rc_f64(rc);
+        double y = rc_f64(rc);
+        int width = rc_iv(rc);
+        int height = rc_iv(rc);
+        unsigned flags = rc_u8(rc);
+        bool selected = flags & 1;
+        bool stream = flags & 2;
+        int color = rc_iv(rc);
+        int box_type = rc_iv(rc);
+        int content_type = rc_iv(rc);
+        int refresh_interval = rc_iv(rc);
+        char *title = rc_strdup(rc);
+        char *file_path = rc_strdup(rc);
+        char *command = rc_strdup(rc);
+        int box_id = rc->failed ? -1 :
+                     canvas_restore_box_with_id(canvas, id, x, y, width, height, title);
+        free(title);
+        if (box_id < 0) {
+            free(file_path);
+            free(command);
+            return -1;
+        }
 
-    /* Check magic number */
-    if (strcmp(magic, FILE_MAGIC) != 0) {
-        fclose(f);
+        Box *box = canvas_get_box(canvas, box_id);
+        box->selected = selected;
+        box->color = color;
+        box->box_type = box_type;
+        box->content_type = content_type;
+        box->file_path = file_path;
+        box->command = command;
+        box->refresh_interval = refresh_interval < 0 ? 0 : refresh_interval;
+        box->command_stream = stream;
+
+        /* Lines are copied straight from the file into one buffer */
+        uint32_t content_lines = rc_uv(rc);
+        if (rc->failed || content_lines > (size_t)(rc->end - rc->p)) {
+            return -1;
+        }
+        if (content_lines > 0) {
+            ContentBuffer *content = content_buffer_create((int)content_lines, 0);
+            if (content == NULL) {
+                return -1;
+            }
+            for (uint32_t j = 0; j < content_lines; j++) {
+                size_t len;
+                const char *line = rc_bytes(rc, &len);
+                if (rc->failed || content_buffer_append(content, line ? line : "", len) != 0) {
+                    content_buffer_release(content);
+                    return -1;
+                }
+            }
+            box_content_share(box, content);
+            content_buffer_release(content);
+        }
+
+        /* Large files are saved without their lines; map them again */
+        if (content_lines == 0 && box->content_type == BOX_CONTENT_FILE && box->file_path) {
+            struct stat st;
+            if (stat(box->file_path, &st) == 0 && st.st_size > FILE_VIEWER_MAP_THRESHOLD) {
+                file_viewer_load(box, box->file_path);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Load a V2 file held in memory */
+static int canvas_load_v2(Canvas *canvas, const unsigned char *data, size_t size) {
+    if (size < V2_HEADER_LEN) {
+        set_error("binary canvas is truncated");
         return -1;
     }
 
-    /* Read world size */
-    double world_width, world_height;
-    if (fscanf(f, "%lf %lf\n", &world_width, &world_height) != 2) {
-        fclose(f);
+    ReadCursor rc;
+    if (!check_sections(data, size) || !find_section(data, V2_SECTION_CANVAS, &rc)) {
+        set_error("binary canvas is truncated or has no canvas section");
+        return -1;
+    }
+    double world_width = rc_f64(&rc);
+    double world_height = rc_f64(&rc);
+    int next_id = rc_iv(&rc);
+    int selected_rank = rc_iv(&rc);
+    if (rc.failed) {
+        set_error("binary canvas section is truncated");
         return -1;
     }
 
-    /* Cleanup existing canvas data before reinitializing
-     * Only call cleanup if canvas appears to be initialized (boxes pointer is not NULL)
-     */
     if (canvas->boxes != NULL) {
         canvas_cleanup(canvas);
     }
-
-    /* Initialize canvas */
     if (canvas_init(canvas, world_width, world_height) != 0) {
-        fclose(f);
+        set_error("out of memory");
         return -1;
     }
 
-    /* Read box count */
-    int box_count;
-    if (fscanf(f, "%d\n", &box_count) != 1) {
+    if (find_section(data, V2_SECTION_BOXES, &rc) && load_v2_boxes(canvas, &rc) != 0) {
+        set_error("binary canvas box section is corrupt");
         canvas_cleanup(canvas);
-        fclose(f);
         return -1;
     }
+    if (next_id > canvas->next_id) {
+        canvas->next_id = next_id;
+    }
+    canvas->selected_index = canvas_get_box_at(canvas, selected_rank) ? selected_rank : -1;
 
-    /* Read each box */
-    for (int i = 0; i < box_count; i++) {
-        int id, width, height, selected_flag, color, box_type, content_type;
-        double x, y;
-
-        /* Try to read box properties with content_type (Issue #54)
-         * Fall back to old format if content_type is not present */
-        int scanned = fscanf(f, "%d %lf %lf %d %d %d %d %d %d\n",
-                   &id, &x, &y, &width, &height, &selected_flag, &color, &box_type, &content_type);
-
-        if (scanned == 7) {
-            /* Old format without box_type or content_type */
-            box_type = BOX_TYPE_NOTE;
-            content_type = BOX_CONTENT_TEXT;
-        } else if (scanned == 8) {
-            /* Format with box_type but without content_type */
-            content_type = BOX_CONTENT_TEXT;
-        } else if (scanned != 9) {
-            /* Invalid format */
-            canvas_cleanup(canvas);
-            fclose(f);
-            return -1;
+    if (find_section(data, V2_SECTION_CONNECTIONS, &rc)) {
+        uint32_t conn_count = rc_uv(&rc);
+        if (!rc.failed && conn_count <= (size_t)(rc.end - rc.p) / 4) {
+            canvas_reserve(canvas, canvas->box_count, (int)conn_count);
+            for (uint32_t i = 0; i < conn_count; i++) {
+                int id = rc_iv(&rc);
+                int source_id = rc_iv(&rc);
+                int dest_id = rc_iv(&rc);
+                int color = rc_iv(&rc);
+                /* Invalid, self or duplicate connections are skipped */
+                canvas_restore_connection_with_id(canvas, id, source_id, dest_id, color);
+            }
+            int next_conn_id = rc_iv(&rc);
+            if (!rc.failed && next_conn_id > canvas->next_conn_id) {
+                canvas->next_conn_id = next_conn_id;
+            }
         }
+    }
 
-        /* Read title */
-        char title_line[MAX_LINE_LENGTH];
-        if (fgets(title_line, sizeof(title_line), f) == NULL) {
-            canvas_cleanup(canvas);
-            fclose(f);
-            return -1;
+    if (find_section(data, V2_SECTION_GRID, &rc)) {
+        bool visible = rc_u8(&rc) != 0;
+        bool snap_enabled = rc_u8(&rc) != 0;
+        int spacing = rc_iv(&rc);
+        if (!rc.failed) {
+            canvas->grid.visible = visible;
+            canvas->grid.snap_enabled = snap_enabled;
+            canvas->grid.spacing = spacing;
         }
-        title_line[strcspn(title_line, "\n")] = 0;
+    }
 
-        char *title = NULL;
-        if (strcmp(title_line, "NULL") != 0) {
-            title = title_line;
+    if (find_section(data, V2_SECTION_DOCUMENT, &rc)) {
+        char *document = rc_strdup(&rc);
+        int state = rc_iv(&rc);
+        int width = rc_iv(&rc);
+        if (!rc.failed) {
+            canvas->document = document;
+            canvas->sidebar_state = (SidebarState)state;
+            canvas->sidebar_width = width < 20 ? 20 : width > 40 ? 40 : width;
+        } else {
+            free(document);
         }
+    }
 
-        /* Read file_path (Issue #54) - only present in new format */
-        char *file_path = NULL;
-        char *command = NULL;
-        if (scanned == 9) {
-            char file_path_line[MAX_LINE_LENGTH];
-            if (fgets(file_path_line, sizeof(file_path_line), f) == NULL) {
-                canvas_cleanup(canvas);
-                fclose(f);
-                return -1;
-            }
-            file_path_line[strcspn(file_path_line, "\n")] = 0;
-            if (strcmp(file_path_line, "NULL") != 0) {
-                file_path = strdup(file_path_line);
-            }
+    return 0;
+}
+
+int canvas_save(const Canvas *canvas, const char *filename) {
+    return canvas_save_format(canvas, filename, CANVAS_FORMAT_V1);
+}
+
+#ifndef _WIN32
+/* Make a rename in filename's directory durable */
+static void sync_parent_dir(const char *filename) {
+    const char *slash = strrchr(filename, '/');
+    char dir[PATH_MAX];
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else if ((size_t)(slash - filename) < sizeof(dir)) {
+        memcpy(dir, filename, (size_t)(slash - filename));
+        dir[slash == filename ? 1 : slash - filename] = '\0';
+    } else {
+        return;
+    }
+    int fd = open(dir, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+#endif
+
+/* The file is written beside filename under a name of its own, synced,
+ * and renamed over filename, so filename always holds either the old
+ * canvas or the whole new one, whatever happens mid-write */
+int canvas_write_format(const Canvas *canvas, const char *filename, CanvasFormat format) {
+    size_t len = strlen(filename);
+    char tmp[len + 32];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", filename, (long)getpid());
+
+    FILE *f = fopen(tmp, format == CANVAS_FORMAT_V2 ? "wb" : "w");
+    if (f == NULL) {
+        return -1;
+    }
+    int result = format == CANVAS_FORMAT_V2 ? canvas_save_v2(canvas, f) : canvas_save_v1(canvas, f);
+    if (fflush(f) != 0) {
+        result = -1;
+    }
+#ifndef _WIN32
+    if (result == 0 && fsync(fileno(f)) != 0) {
+        result = -1;
+    }
+#endif
+    if (fclose(f) != 0) {
+        result = -1;
+    }
+#ifdef _WIN32
+    if (result == 0) {
+        remove(filename);  /* rename() does not replace files here */
+    }
+#endif
+    if (result != 0 || rename(tmp, filename) != 0) {
+        int error = errno;
+        remove(tmp);
+        errno = error;
+        return -1;
+    }
+#ifndef _WIN32
+    sync_parent_dir(filename);
+#endif
+    saves_finished++;
+    return 0;
+}
+
+int canvas_save_format(const Canvas *canvas, const char *filename, CanvasFormat format) {
+    if (canvas_write_format(canvas, filename, format) != 0) {
+        return -1;
+    }
+    /* Replayed on load, the journal's edits would undo this save */
+    journal_remove(filename);
+    return 0;
+}
+
+int canvas_file_format(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    char magic[MAX_LINE_LENGTH];
+    int format = -1;
+    if (fgets(magic, sizeof(magic), f) != NULL) {
+        if (strcmp(magic, V2_MAGIC) == 0) {
+            format = CANVAS_FORMAT_V2;
+        } else if (strcmp(magic, FILE_MAGIC "\n") == 0 || strcmp(magic, FILE_MAGIC) == 0) {
+            format = CANVAS_FORMAT_V1;
+        }
+    }
+    fclose(f);
+    return format;
+}
 
-            /* Read command (Issue #54) */
-            char command_line[MAX_LINE_LENGTH];
-            if (fgets(command_line, sizeof(command_line), f) == NULL) {
-                if (file_path) free(file_path);
-                canvas_cleanup(canvas);
+int canvas_convert(const char *input, const char *output, CanvasFormat format) {
+    Canvas canvas;
+    canvas.boxes = NULL;
+    if (canvas_load(&canvas, input) != 0) {
+        return -1;
+    }
+    int result = canvas_save_format(&canvas, output, format);
+    canvas_cleanup(&canvas);
+    return result;
+}
+
+/* ============================================================
+ * Text format (V1) reader
+ *
+ * The whole file is mapped (or read in large blocks where mapping
+ * is not possible) and tokenized in place: numbers are parsed
+ * straight from the bytes and lines are handed out as pointer and
+ * length, so content goes from the file into the box's buffer with
+ * one copy and no line is ever cut short. Errors record the line
+ * and column they were found at.
+ * ============================================================ */
+
+/* A canvas file's bytes, mapped or read into memory */
+typedef struct {
+    const char *data;
+    size_t size;
+    bool mapped;
+} FileData;
+
+static int file_data_open(FileData *fd_data, const char *filename) {
+    memset(fd_data, 0, sizeof(*fd_data));
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            close(fd);
+            fd_data->data = data;
+            fd_data->size = (size_t)st.st_size;
+            fd_data->mapped = true;
+            return 0;
+        }
+    }
+    close(fd);
+#endif
+    /* Not mappable (empty, a pipe, or no mmap): read it in blocks */
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    char *data = NULL;
+    size_t size = 0, capacity = 0;
+    for (;;) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 1 << 20;
+            char *grown = realloc(data, capacity);
+            if (grown == NULL) {
+                free(data);
                 fclose(f);
                 return -1;
             }
-            command_line[strcspn(command_line, "\n")] = 0;
-            if (strcmp(command_line, "NULL") != 0) {
-                command = strdup(command_line);
-            }
+            data = grown;
         }
-
-        /* Add box to canvas */
-        int new_box_id = canvas_add_box(canvas, x, y, width, height, title);
-        if (new_box_id < 0) {
-            if (file_path) free(file_path);
-            if (command) free(command);
-            canvas_cleanup(canvas);
-            fclose(f);
-            return -1;
+        size_t n = fread(data + size, 1, capacity - size, f);
+        size += n;
+        if (n == 0) {
+            break;
         }
+    }
+    int error = ferror(f);
+    fclose(f);
+    if (error) {
+        free(data);
+        return -1;
+    }
+    fd_data->data = data;
+    fd_data->size = size;
+    return 0;
+}
+
+static void file_data_close(FileData *fd_data) {
+#ifndef _WIN32
+    if (fd_data->mapped) {
+        munmap((void *)fd_data->data, fd_data->size);
+        return;
+    }
+#endif
+    free((void *)fd_data->data);
+}
+
+/* Cursor over the text; the first error stops everything after it */
+typedef struct {
+    const char *p;
+    const char *end;
+    const char *line_start;
+    int line;
+    bool failed;
+} TextReader;
+
+static void tr_error(TextReader *tr, const char *what) {
+    if (!tr->failed) {
+        set_error("line %d, column %d: %s", tr->line, (int)(tr->p - tr->line_start) + 1, what);
+        tr->failed = true;
+    }
+}
+
+static bool tr_eof(const TextReader *tr) {
+    return tr->p >= tr->end;
+}
+
+static void tr_newline(TextReader *tr) {
+    tr->p++;
+    tr->line++;
+    tr->line_start = tr->p;
+}
+
+/* Skip spaces within the line */
+static void tr_skip_spaces(TextReader *tr) {
+    while (tr->p < tr->end && (*tr->p == ' ' || *tr->p == '\t' || *tr->p == '\r')) {
+        tr->p++;
+    }
+}
 
-        /* Update box ID to match saved ID */
-        Box *box = canvas_get_box(canvas, new_box_id);
-        if (box) {
-            box->id = id;
-            box->selected = selected_flag ? true : false;
-            box->color = color;
-            box->box_type = box_type;  /* Set box type (Issue #33) */
-            box->content_type = content_type;  /* Set content type (Issue #54) */
-            box->file_path = file_path;  /* Transfer ownership */
-            box->command = command;  /* Transfer ownership */
+/* Skip whitespace including blank lines, as fscanf did before a number */
+static void tr_skip_blank(TextReader *tr) {
+    for (;;) {
+        tr_skip_spaces(tr);
+        if (tr->p < tr->end && *tr->p == '\n') {
+            tr_newline(tr);
         } else {
-            if (file_path) free(file_path);
-            if (command) free(command);
+            return;
         }
+    }
+}
 
-        /* Read content lines */
-        int content_lines;
-        if (fscanf(f, "%d\n", &content_lines) != 1) {
-            canvas_cleanup(canvas);
-            fclose(f);
-            return -1;
+/* True if only spaces are left on the line */
+static bool tr_at_line_end(TextReader *tr) {
+    tr_skip_spaces(tr);
+    return tr->p >= tr->end || *tr->p == '\n';
+}
+
+/* Finish a line of numbers: nothing but spaces may follow */
+static bool tr_end_line(TextReader *tr) {
+    if (!tr_at_line_end(tr)) {
+        tr_error(tr, "unexpected text at end of line");
+        return false;
+    }
+    if (tr->p < tr->end) {
+        tr_newline(tr);
+    }
+    return true;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool tr_int(TextReader *tr, int *value) {
+    tr_skip_spaces(tr);
+    const char *p = tr->p;
+    bool negative = false;
+    if (p < tr->end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+    if (p >= tr->end || !is_digit(*p)) {
+        tr_error(tr, "expected an integer");
+        return false;
+    }
+    long long v = 0;
+    while (p < tr->end && is_digit(*p)) {
+        v = v * 10 + (*p++ - '0');
+        if (v > (long long)INT_MAX + 1) {
+            tr_error(tr, "integer out of range");
+            return false;
         }
+    }
+    v = negative ? -v : v;
+    if (v > INT_MAX) {
+        tr_error(tr, "integer out of range");
+        return false;
+    }
+    *value = (int)v;
+    tr->p = p;
+    return true;
+}
 
-        if (content_lines > 0) {
-            char **content = malloc(sizeof(char *) * content_lines);
-            if (content == NULL) {
-                canvas_cleanup(canvas);
-                fclose(f);
-                return -1;
-            }
+/* Powers of ten that are exact doubles */
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-            for (int j = 0; j < content_lines; j++) {
-                char line[MAX_LINE_LENGTH];
-                if (fgets(line, sizeof(line), f) == NULL) {
-                    for (int k = 0; k < j; k++) {
-                        free(content[k]);
-                    }
-                    free(content);
-                    canvas_cleanup(canvas);
-                    fclose(f);
-                    return -1;
-                }
-                line[strcspn(line, "\n")] = 0;
-                content[j] = strdup(line);
-            }
+static bool tr_double(TextReader *tr, double *value) {
+    tr_skip_spaces(tr);
+    const char *p = tr->p;
+    bool negative = false;
+    if (p < tr->end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0;
+    while (p < tr->end && is_digit(*p)) {
+        if (digits < 19) mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        digits++;
+        p++;
+    }
+    if (p < tr->end && *p == '.') {
+        p++;
+        while (p < tr->end && is_digit(*p)) {
+            if (digits < 19) mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits++;
+            fraction++;
+            p++;
+        }
+    }
+    if (digits == 0) {
+        tr_error(tr, "expected a number");
+        return false;
+    }
 
-            /* Set box content directly */
-            if (box) {
-                box->content = content;
-                box->content_lines = content_lines;
-            }
+    /* The saver's "%.2f" numbers: an exact integer over an exact power
+     * of ten, which one division rounds correctly. Anything else (an
+     * exponent, too many digits) goes through strtod. */
+    bool exponent = p < tr->end && (*p == 'e' || *p == 'E');
+    if (!exponent && digits < 19 && fraction <= 22 && mantissa < (1ULL << 53)) {
+        double v = (double)mantissa / exact_pow10[fraction];
+        *value = negative ? -v : v;
+        tr->p = p;
+        return true;
+    }
+    char number[64];
+    size_t len = 0;
+    for (const char *q = tr->p; q < tr->end && len < sizeof(number) - 1 &&
+         (is_digit(*q) || *q == '.' || *q == '-' || *q == '+' || *q == 'e' || *q == 'E'); q++) {
+        number[len++] = *q;
+    }
+    number[len] = '\0';
+    char *stop;
+    *value = strtod(number, &stop);
+    if (stop == number) {
+        tr_error(tr, "expected a number");
+        return false;
+    }
+    tr->p += stop - number;
+    return true;
+}
+
+/* Next whole line, without its newline (NULL at end of file) */
+static const char *tr_line(TextReader *tr, size_t *len) {
+    *len = 0;
+    if (tr->p >= tr->end) {
+        return NULL;
+    }
+    const char *start = tr->p;
+    const char *nl = memchr(start, '\n', (size_t)(tr->end - start));
+    const char *stop = nl ? nl : tr->end;
+    tr->p = stop;
+    if (nl) {
+        tr_newline(tr);
+    }
+    *len = (size_t)(stop - start);
+    return start;
+}
+
+/* Keyword lines may end in "\r" when a file went through Windows */
+static bool line_is(const char *line, size_t len, const char *word) {
+    if (line != NULL && len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    return line != NULL && len == strlen(word) && memcmp(line, word, len) == 0;
+}
+
+/* Copy of a title/path/command line; NULL for the literal "NULL" */
+static bool tr_string_line(TextReader *tr, char **out, const char *what) {
+    size_t len;
+    const char *line = tr_line(tr, &len);
+    *out = NULL;
+    if (line == NULL) {
+        tr_error(tr, what);
+        return false;
+    }
+    if (line_is(line, len, "NULL")) {
+        return true;
+    }
+    *out = malloc(len + 1);
+    if (*out == NULL) {
+        tr_error(tr, "out of memory");
+        return false;
+    }
+    memcpy(*out, line, len);
+    (*out)[len] = '\0';
+    return true;
+}
+
+/* One box: properties line, title, optional file path and command,
+ * then its content lines */
+static bool load_v1_box(Canvas *canvas, TextReader *tr) {
+    int id, width, height, selected, color;
+    int box_type = BOX_TYPE_NOTE, content_type = BOX_CONTENT_TEXT;
+    int refresh_interval = 0, stream = 0;
+    double x, y;
+
+    /* Blank lines before it were skipped by the old fscanf reader too */
+    tr_skip_blank(tr);
+    if (tr_eof(tr)) {
+        tr_error(tr, "file ends before the last box");
+        return false;
+    }
+    if (!tr_int(tr, &id) || !tr_double(tr, &x) || !tr_double(tr, &y) ||
+        !tr_int(tr, &width) || !tr_int(tr, &height) || !tr_int(tr, &selected) ||
+        !tr_int(tr, &color)) {
+        return false;
+    }
+    /* Later fields were added over time; lines stop where their writer did */
+    int fields = 7;
+    int *optional[] = {&box_type, &content_type, &refresh_interval, &stream};
+    for (int i = 0; i < 4 && !tr_at_line_end(tr); i++, fields++) {
+        if (!tr_int(tr, optional[i])) {
+            return false;
         }
     }
+    if (!tr_end_line(tr)) {
+        return false;
+    }
+    if (refresh_interval < 0) refresh_interval = 0;
 
-    /* Read next_id and selected_index */
-    if (fscanf(f, "%d %d\n", &canvas->next_id, &canvas->selected_index) != 2) {
-        /* Not fatal, just use defaults */
-        canvas->next_id = canvas->box_count + 1;
-        canvas->selected_index = -1;
+    char *title = NULL, *file_path = NULL, *command = NULL;
+    if (!tr_string_line(tr, &title, "missing box title") ||
+        (fields >= 9 && (!tr_string_line(tr, &file_path, "missing box file path") ||
+                         !tr_string_line(tr, &command, "missing box command")))) {
+        free(title);
+        free(file_path);
+        free(command);
+        return false;
     }
 
-    /* Try to read connections (Issue #20) - optional for backward compatibility */
-    char section_header[MAX_LINE_LENGTH];
-    if (fgets(section_header, sizeof(section_header), f) != NULL) {
-        section_header[strcspn(section_header, "\n")] = 0;
-
-        if (strcmp(section_header, "CONNECTIONS") == 0) {
-            int conn_count;
-            if (fscanf(f, "%d\n", &conn_count) == 1) {
-                for (int i = 0; i < conn_count; i++) {
-                    int id, source_id, dest_id, color;
-                    if (fscanf(f, "%d %d %d %d\n", &id, &source_id, &dest_id, &color) == 4) {
-                        /* Validate that source_id and dest_id reference valid boxes */
-                        if (!canvas_get_box(canvas, source_id) || !canvas_get_box(canvas, dest_id)) {
-                            continue;  /* Skip invalid connection */
-                        }
-
-                        /* Add connection after validation */
-                        if (canvas->conn_count >= canvas->conn_capacity) {
-                            int new_capacity = canvas->conn_capacity * 2;
-                            Connection *new_conns = realloc(canvas->connections,
-                                                           sizeof(Connection) * new_capacity);
-                            if (new_conns != NULL) {
-                                canvas->connections = new_conns;
-                                canvas->conn_capacity = new_capacity;
-                            }
-                        }
-
-                        if (canvas->conn_count < canvas->conn_capacity) {
-                            Connection *conn = &canvas->connections[canvas->conn_count];
-                            conn->id = id;
-                            conn->source_id = source_id;
-                            conn->dest_id = dest_id;
-                            conn->color = color;
-                            canvas->conn_count++;
-                        }
-                    }
-                }
+    /* Add box to canvas under its saved ID (keeps the ID index in sync) */
+    int box_id = canvas_restore_box_with_id(canvas, id, x, y, width, height, title);
+    free(title);
+    if (box_id < 0) {
+        free(file_path);
+        free(command);
+        tr_error(tr, "duplicate box ID or out of memory");
+        return false;
+    }
+    Box *box = canvas_get_box(canvas, box_id);
+    box->selected = selected ? true : false;
+    box->color = color;
+    box->box_type = box_type;  /* Set box type (Issue #33) */
+    box->content_type = content_type;  /* Set content type (Issue #54) */
+    box->file_path = file_path;  /* Transfer ownership */
+    box->command = command;  /* Transfer ownership */
+    box->refresh_interval = refresh_interval;
+    box->command_stream = stream ? true : false;
 
-                /* Read next_conn_id */
-                if (fscanf(f, "%d\n", &canvas->next_conn_id) != 1) {
-                    canvas->next_conn_id = canvas->conn_count + 1;
-                }
+    int content_lines;
+    tr_skip_blank(tr);
+    if (!tr_int(tr, &content_lines) || !tr_end_line(tr)) {
+        return false;
+    }
+    if (content_lines < 0) {
+        tr_error(tr, "negative line count");
+        return false;
+    }
+    if (content_lines > 0) {
+        ContentBuffer *content = content_buffer_create(content_lines, 0);
+        if (content == NULL) {
+            tr_error(tr, "out of memory");
+            return false;
+        }
+        box_content_share(box, content);
+        content_buffer_release(content);
+        for (int j = 0; j < content_lines; j++) {
+            size_t len;
+            const char *line = tr_line(tr, &len);
+            if (line == NULL) {
+                tr_error(tr, "file ends inside a box's content");
+                return false;
             }
-            
-            /* Read next section header after CONNECTIONS */
-            section_header[0] = '\0';  /* Clear buffer */
-            if (fgets(section_header, sizeof(section_header), f) != NULL) {
-                section_header[strcspn(section_header, "\n")] = 0;
+            if (content_buffer_append(content, line, len) != 0) {
+                tr_error(tr, "out of memory");
+                return false;
             }
         }
-        
-        /* Check if current section is GRID (either skipped CONNECTIONS or read after it) */
-        if (section_header[0] != '\0' && strcmp(section_header, "GRID") == 0) {
-            int visible, snap_enabled, spacing;
-            if (fscanf(f, "%d %d %d\n", &visible, &snap_enabled, &spacing) == 3) {
-                canvas->grid.visible = visible ? true : false;
-                canvas->grid.snap_enabled = snap_enabled ? true : false;
-                canvas->grid.spacing = spacing;
+    }
+
+    /* Large files are saved without their lines; map them again
+     * (best effort: the box stays empty if the file is gone) */
+    if (content_lines == 0 && box->content_type == BOX_CONTENT_FILE && box->file_path) {
+        struct stat st;
+        if (stat(box->file_path, &st) == 0 && st.st_size > FILE_VIEWER_MAP_THRESHOLD) {
+            file_viewer_load(box, box->file_path);
+        }
+    }
+    return true;
+}
+
+/* Sections after the boxes, each optional (older files end early).
+ * Best effort, as they always were: reading stops at the first line
+ * that does not parse and keeps what came before it. */
+static void load_v1_sections(Canvas *canvas, TextReader *tr) {
+    size_t len;
+    tr_skip_blank(tr);
+    const char *header = tr_line(tr, &len);
+
+    /* Connections (Issue #20) */
+    if (line_is(header, len, "CONNECTIONS")) {
+        int conn_count;
+        tr_skip_blank(tr);
+        if (!tr_int(tr, &conn_count) || !tr_end_line(tr)) {
+            return;
+        }
+        if (conn_count > 0) {
+            canvas_reserve(canvas, canvas->box_count, conn_count);
+        }
+        for (int i = 0; i < conn_count; i++) {
+            int id, source_id, dest_id, color;
+            tr_skip_blank(tr);
+            if (!tr_int(tr, &id) || !tr_int(tr, &source_id) || !tr_int(tr, &dest_id) ||
+                !tr_int(tr, &color) || !tr_end_line(tr)) {
+                return;
             }
-            
-            /* Read next section header after GRID */
-            section_header[0] = '\0';
-            if (fgets(section_header, sizeof(section_header), f) != NULL) {
-                section_header[strcspn(section_header, "\n")] = 0;
+            /* Invalid, self or duplicate connections are skipped */
+            canvas_restore_connection_with_id(canvas, id, source_id, dest_id, color);
+        }
+        int next_conn_id;
+        tr_skip_blank(tr);
+        if (!tr_eof(tr) && (is_digit(*tr->p) || *tr->p == '-')) {
+            if (!tr_int(tr, &next_conn_id)) {
+                return;
+            }
+            if (next_conn_id > canvas->next_conn_id) {
+                canvas->next_conn_id = next_conn_id;
+            }
+            if (!tr_end_line(tr)) {
+                return;
             }
         }
-        
-        /* Check if current section is DOCUMENT (Issue #35) */
-        if (section_header[0] != '\0' && strcmp(section_header, "DOCUMENT") == 0) {
-            /* Read document content until END_DOCUMENT marker */
-            char *doc_content = NULL;
-            size_t doc_size = 0;
-            size_t doc_capacity = 1024;
-            
-            doc_content = malloc(doc_capacity);
-            if (doc_content != NULL) {
-                doc_content[0] = '\0';
-                
-                char line[MAX_LINE_LENGTH];
-                while (fgets(line, sizeof(line), f) != NULL) {
-                    /* Check for end marker */
-                    char *trimmed = line;
-                    while (*trimmed == ' ' || *trimmed == '\t') trimmed++;
-                    if (strncmp(trimmed, "END_DOCUMENT", 12) == 0) {
-                        break;
-                    }
-                    
-                    /* Append line to document */
-                    size_t line_len = strlen(line);
-                    if (doc_size + line_len + 1 >= doc_capacity) {
-                        doc_capacity *= 2;
-                        char *new_content = realloc(doc_content, doc_capacity);
-                        if (new_content == NULL) {
-                            free(doc_content);
-                            doc_content = NULL;
-                            break;
-                        }
-                        doc_content = new_content;
-                    }
-                    
-                    memcpy(doc_content + doc_size, line, line_len);
-                    doc_size += line_len;
-                }
-                
-                canvas->document = doc_content;
+        tr_skip_blank(tr);
+        header = tr_line(tr, &len);
+    }
+
+    /* Grid configuration (Phase 4) */
+    if (line_is(header, len, "GRID")) {
+        int visible, snap_enabled, spacing;
+        tr_skip_blank(tr);
+        if (!tr_int(tr, &visible) || !tr_int(tr, &snap_enabled) || !tr_int(tr, &spacing) ||
+            !tr_end_line(tr)) {
+            return;
+        }
+        canvas->grid.visible = visible ? true : false;
+        canvas->grid.snap_enabled = snap_enabled ? true : false;
+        canvas->grid.spacing = spacing;
+        tr_skip_blank(tr);
+        header = tr_line(tr, &len);
+    }
+
+    /* Sidebar document (Issue #35): raw lines up to END_DOCUMENT */
+    if (line_is(header, len, "DOCUMENT")) {
+        const char *start = tr->p;
+        const char *stop = tr->end;
+        const char *line;
+        while ((line = tr->p, tr_line(tr, &len)) != NULL) {
+            const char *trimmed = line;
+            while (trimmed < line + len && (*trimmed == ' ' || *trimmed == '\t')) trimmed++;
+            if ((size_t)(line + len - trimmed) >= 12 && memcmp(trimmed, "END_DOCUMENT", 12) == 0) {
+                stop = line;
+                break;
             }
-            
-            /* Read sidebar state and width */
-            int state, width;
-            if (fscanf(f, "%d %d\n", &state, &width) == 2) {
-                canvas->sidebar_state = (SidebarState)state;
-                canvas->sidebar_width = width;
-                /* Clamp width to valid range */
-                if (canvas->sidebar_width < 20) canvas->sidebar_width = 20;
-                if (canvas->sidebar_width > 40) canvas->sidebar_width = 40;
+        }
+        size_t doc_size = (size_t)(stop - start);
+        canvas->document = malloc(doc_size + 1);
+        if (canvas->document != NULL) {
+            memcpy(canvas->document, start, doc_size);
+            canvas->document[doc_size] = '\0';
+        }
+
+        /* Sidebar state and width */
+        int state, width;
+        tr_skip_blank(tr);
+        if (!tr_eof(tr)) {
+            if (!tr_int(tr, &state) || !tr_int(tr, &width) || !tr_end_line(tr)) {
+                return;
             }
+            canvas->sidebar_state = (SidebarState)state;
+            canvas->sidebar_width = width;
+            /* Clamp width to valid range */
+            if (canvas->sidebar_width < 20) canvas->sidebar_width = 20;
+            if (canvas->sidebar_width > 40) canvas->sidebar_width = 40;
         }
     }
+}
 
-    fclose(f);
+static int canvas_load_v1(Canvas *canvas, const char *data, size_t size) {
+    TextReader tr = {data, data + size, data, 1, false};
+    size_t len;
+    const char *magic = tr_line(&tr, &len);
+    if (!line_is(magic, len, FILE_MAGIC)) {
+        set_error("not a boxes-live canvas file");
+        return -1;
+    }
+
+    double world_width, world_height;
+    tr_skip_blank(&tr);
+    if (!tr_double(&tr, &world_width) || !tr_double(&tr, &world_height) || !tr_end_line(&tr)) {
+        return -1;
+    }
+
+    /* Cleanup existing canvas data before reinitializing
+     * Only call cleanup if canvas appears to be initialized (boxes pointer is not NULL)
+     */
+    if (canvas->boxes != NULL) {
+        canvas_cleanup(canvas);
+    }
+    if (canvas_init(canvas, world_width, world_height) != 0) {
+        set_error("out of memory");
+        return -1;
+    }
+
+    int box_count;
+    tr_skip_blank(&tr);
+    if (!tr_int(&tr, &box_count) || !tr_end_line(&tr)) {
+        canvas_cleanup(canvas);
+        return -1;
+    }
+    if (box_count < 0) {
+        tr_error(&tr, "negative box count");
+        canvas_cleanup(canvas);
+        return -1;
+    }
+
+    /* Size everything once from the header so boxes are filled in
+     * place. Best effort: on failure the arrays simply grow as they go. */
+    canvas_reserve(canvas, box_count, 0);
+    for (int i = 0; i < box_count; i++) {
+        if (!load_v1_box(canvas, &tr)) {
+            canvas_cleanup(canvas);
+            return -1;
+        }
+    }
+
+    /* next_id and selected index; defaults when the file stops here */
+    tr_skip_blank(&tr);
+    if (!tr_eof(&tr) && (is_digit(*tr.p) || *tr.p == '-')) {
+        int next_id, selected;
+        if (!tr_int(&tr, &next_id) || !tr_int(&tr, &selected) || !tr_end_line(&tr)) {
+            canvas_cleanup(canvas);
+            return -1;
+        }
+        canvas->next_id = next_id;
+        canvas->selected_index = selected;
+    } else {
+        canvas->next_id = canvas->box_count + 1;
+        canvas->selected_index = -1;
+    }
+    if (canvas_get_box_at(canvas, canvas->selected_index) == NULL) {
+        canvas->selected_index = -1;
+    }
+
+    load_v1_sections(canvas, &tr);
+    last_error[0] = '\0';
     return 0;
 }
+
+/* Load canvas from file (V1 text or V2 binary) */
+int canvas_load(Canvas *canvas, const char *filename) {
+    FileData file;
+    last_error[0] = '\0';
+    if (file_data_open(&file, filename) != 0) {
+        set_error("cannot read file");
+        return -1;
+    }
+    int result;
+    if (file.size >= V2_MAGIC_LEN && memcmp(file.data, V2_MAGIC, V2_MAGIC_LEN) == 0) {
+        result = canvas_load_v2(canvas, (const unsigned char *)file.data, file.size);
+    } else {
+        result = canvas_load_v1(canvas, file.data, file.size);
+    }
+    file_data_close(&file);
+    if (result == 0) {
+        /* Edits saved since the file was last written whole */
+        journal_replay(canvas, filename);
+    }
+    return result;
+}
@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#include "reloader.h"
+#include "canvas.h"
+#include "command_runner.h"
+#include "file_watch.h"
+#include "journal.h"
+#include "persistence.h"
+
+void reloader_init(Reloader *reloader) {
+    reloader->pid = -1;
+    reloader->fd = -1;
+    reloader->records = NULL;
+    reloader->len = 0;
+    reloader->capacity = 0;
+    reloader->queued_path = NULL;
+    reloader->applied = 0;
+}
+
+/* Records bringing canvas up to date with path's contents (NULL if
+ * the file cannot be loaded) */
+static char *diff_with_file(Canvas *canvas, const char *path, size_t *len) {
+    Canvas loaded;
+    loaded.boxes = NULL;
+    if (canvas_load(&loaded, path) != 0) {
+        return NULL;
+    }
+    char *records = journal_diff(canvas, &loaded, len);
+    canvas_cleanup(&loaded);
+    return records;
+}
+
+/* Load, diff and apply in this process */
+static int reload_in_place(Reloader *reloader, Canvas *canvas, const char *path) {
+    size_t len = 0;
+    char *records = diff_with_file(canvas, path, &len);
+    if (records == NULL) {
+        return -1;
+    }
+    reloader->applied = journal_apply(canvas, records, len);
+    free(records);
+    return reloader->applied < 0 ? -1 : 0;
+}
+
+#ifndef _WIN32
+/* Child: send the records for path, then exit */
+static void run_child(Canvas *canvas, const char *path, int fd) {
+    /* The loaded canvas is thrown away: keep it off the parent's
+     * file watches and command schedule */
+    file_watch_set_global(NULL);
+    command_runner_set_global(NULL);
+
+    size_t len = 0;
+    char *records = diff_with_file(canvas, path, &len);
+    if (records == NULL) {
+        _exit(1);
+    }
+    const char *p = records;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            _exit(1);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    _exit(0);
+}
+#endif
+
+/* Start a reload now (none is running) */
+static int start_now(Reloader *reloader, Canvas *canvas, const char *path) {
+    reloader->len = 0;
+#ifndef _WIN32
+    int fds[2];
+    if (pipe(fds) == 0) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            run_child(canvas, path, fds[1]);
+        }
+        close(fds[1]);
+        if (pid > 0) {
+            fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            reloader->pid = pid;
+            reloader->fd = fds[0];
+            return 1;
+        }
+        close(fds[0]);
+    }
+#endif
+    return reload_in_place(reloader, canvas, path);
+}
+
+int reloader_start(Reloader *reloader, Canvas *canvas, const char *path) {
+    if (reloader->pid > 0) {
+        char *copy = strdup(path);
+        if (copy == NULL) {
+            return -1;
+        }
+        free(reloader->queued_path);
+        reloader->queued_path = copy;
+        return 1;
+    }
+    return start_now(reloader, canvas, path);
+}
+
+int reloader_fd(const Reloader *reloader) {
+    return reloader->fd;
+}
+
+bool reloader_busy(const Reloader *reloader) {
+    return reloader->pid > 0 || reloader->queued_path != NULL;
+}
+
+#ifndef _WIN32
+/* Read what is available; true once the child closed its end */
+static bool read_records(Reloader *reloader, bool *failed) {
+    for (;;) {
+        if (reloader->capacity - reloader->len < 4096) {
+            size_t capacity = reloader->capacity ? reloader->capacity * 2 : 65536;
+            char *grown = realloc(reloader->records, capacity);
+            if (grown == NULL) {
+                *failed = true;
+                return true;
+            }
+            reloader->records = grown;
+            reloader->capacity = capacity;
+        }
+        ssize_t n = read(reloader->fd, reloader->records + reloader->len,
+                         reloader->capacity - reloader->len);
+        if (n > 0) {
+            reloader->len += (size_t)n;
+        } else if (n == 0) {
+            return true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            *failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return *failed;
+        }
+    }
+}
+
+/* Close the pipe and collect the child (true if it succeeded) */
+static bool finish_child(Reloader *reloader, bool kill_it) {
+    close(reloader->fd);
+    reloader->fd = -1;
+    if (kill_it) {
+        kill(reloader->pid, SIGKILL);
+    }
+    int status;
+    pid_t pid;
+    do {
+        pid = waitpid(reloader->pid, &status, 0);
+    } while (pid < 0 && errno == EINTR);
+    reloader->pid = -1;
+    return pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+#endif
+
+int reloader_poll(Reloader *reloader, Canvas *canvas) {
+    if (reloader->pid <= 0) {
+        return 0;
+    }
+    int result = 0;
+#ifndef _WIN32
+    bool failed = false;
+    if (!read_records(reloader, &failed)) {
+        return 0;
+    }
+    /* The child is done (or something broke): apply its records */
+    if (finish_child(reloader, failed) && !failed) {
+        reloader->applied = journal_apply(canvas, reloader->records, reloader->len);
+        result = reloader->applied < 0 ? -1 : 1;
+    } else {
+        result = -1;
+    }
+    reloader->len = 0;
+#endif
+    if (reloader->queued_path != NULL) {
+        char *path = reloader->queued_path;
+        reloader->queued_path = NULL;
+        start_now(reloader, canvas, path);
+        free(path);
+    }
+    return result;
+}
+
+void reloader_cleanup(Reloader *reloader) {
+#ifndef _WIN32
+    if (reloader->pid > 0) {
+        finish_child(reloader, true);
+    }
+#endif
+    free(reloader->records);
+    free(reloader->queued_path);
+    reloader_init(reloader);
+}
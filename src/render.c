@@ -7,19 +7,36 @@
 #include "render.h"
 #include "viewport.h"
 #include "canvas.h"
+#include "box_content.h"
+#include "file_map.h"
+#include "damage.h"
+#include "terminal.h"
 #include "config.h"
 #include "editor.h"
 
 /* Maximum length for title with icon (Issue #33) */
 #define MAX_TITLE_WITH_ICON_LENGTH 256
 
+/* Screen cells redrawn this frame; world layers (grid, connections, boxes)
+ * only draw inside it. NULL while drawing overlays or a full frame. */
+static const Damage *render_clip = NULL;
+
+/* Screen-cell damage for the frame being drawn */
+static Damage frame_damage;
+
+/* Draw one cell of a world layer, honouring the frame clip */
+static void put_cell(int y, int x, chtype ch) {
+    if (render_clip && !damage_contains(render_clip, x, y)) return;
+    mvaddch(y, x, ch);
+}
+
 /* Helper function to draw a horizontal line */
 static void draw_hline(int y, int x1, int x2, chtype ch) {
     if (y < 0 || y >= LINES) return;
 
     for (int x = x1; x <= x2; x++) {
         if (x >= 0 && x < COLS) {
-            mvaddch(y, x, ch);
+            put_cell(y, x, ch);
         }
     }
 }
@@ -30,7 +47,7 @@ static void draw_vline(int x, int y1, int y2, chtype ch) {
 
     for (int y = y1; y <= y2; y++) {
         if (y >= 0 && y < LINES) {
-            mvaddch(y, x, ch);
+            put_cell(y, x, ch);
         }
     }
 }
@@ -42,12 +59,48 @@ static void safe_mvprintw(int y, int x, const char *text) {
     int max_len = COLS - x;
     if (max_len <= 0) return;
 
-    move(y, x);
     for (int i = 0; text[i] != '\0' && i < max_len; i++) {
-        addch(text[i]);
+        put_cell(y, x + i, text[i]);
     }
 }
 
+/* Title suffix showing a command box's run state (empty if never run async) */
+static const char *command_status(const Box *box, char *buf, size_t size) {
+    if (box->content_type != BOX_CONTENT_COMMAND) {
+        return "";
+    }
+    char exit_code[32];
+    const char *state = "";
+    switch (box->command_state) {
+        case COMMAND_QUEUED:    state = " [queued]"; break;
+        case COMMAND_RUNNING:   state = " [running]"; break;
+        case COMMAND_CANCELLED: state = " [cancelled]"; break;
+        case COMMAND_TIMED_OUT: state = " [timed out]"; break;
+        case COMMAND_FAILED:    state = " [failed]"; break;
+        case COMMAND_EXITED:
+            snprintf(exit_code, sizeof(exit_code), " [exit %d]", box->command_exit);
+            state = exit_code;
+            break;
+        default:
+            break;
+    }
+    char refresh[32] = "";
+    if (box->refresh_interval > 0) {
+        snprintf(refresh, sizeof(refresh), " [every %ds]", box->refresh_interval);
+    }
+    snprintf(buf, size, "%s%s%s", state, box->command_stream ? " [stream]" : "", refresh);
+    return buf;
+}
+
+/* First content line to draw: stream boxes show their newest lines */
+static int tail_start(const Box *box, int rows) {
+    int count = box_content_count(box);
+    if (!box->command_stream || rows <= 0 || count <= rows) {
+        return 0;
+    }
+    return count - rows;
+}
+
 void render_box(const Box *box, const Viewport *vp, DisplayMode mode, const char *icon) {
     /* Convert world coordinates to screen coordinates */
     int sx = world_to_screen_x(vp, box->x);
@@ -75,22 +128,22 @@ void render_box(const Box *box, const Viewport *vp, DisplayMode mode, const char
     /* Top border */
     if (sy >= 0 && sy < vp->term_height) {
         if (sx >= 0 && sx < vp->term_width) {
-            mvaddch(sy, sx, ACS_ULCORNER);
+            put_cell(sy, sx, ACS_ULCORNER);
         }
         draw_hline(sy, sx + 1, sx + scaled_width - 1, ACS_HLINE);
         if (sx + scaled_width >= 0 && sx + scaled_width < vp->term_width) {
-            mvaddch(sy, sx + scaled_width, ACS_URCORNER);
+            put_cell(sy, sx + scaled_width, ACS_URCORNER);
         }
     }
 
     /* Bottom border */
     if (sy + scaled_height >= 0 && sy + scaled_height < vp->term_height) {
         if (sx >= 0 && sx < vp->term_width) {
-            mvaddch(sy + scaled_height, sx, ACS_LLCORNER);
+            put_cell(sy + scaled_height, sx, ACS_LLCORNER);
         }
         draw_hline(sy + scaled_height, sx + 1, sx + scaled_width - 1, ACS_HLINE);
         if (sx + scaled_width >= 0 && sx + scaled_width < vp->term_width) {
-            mvaddch(sy + scaled_height, sx + scaled_width, ACS_LRCORNER);
+            put_cell(sy + scaled_height, sx + scaled_width, ACS_LRCORNER);
         }
     }
 
@@ -111,12 +164,14 @@ void render_box(const Box *box, const Viewport *vp, DisplayMode mode, const char
         if (content_y >= 0 && content_y < vp->term_height && content_x < vp->term_width) {
             /* Display icon + title (all modes) */
             char title_with_icon[MAX_TITLE_WITH_ICON_LENGTH];
+            char status_buf[128];
+            const char *status = command_status(box, status_buf, sizeof(status_buf));
             if (icon && icon[0] != '\0' && box->title) {
-                snprintf(title_with_icon, sizeof(title_with_icon), "%s %s", icon, box->title);
+                snprintf(title_with_icon, sizeof(title_with_icon), "%s %s%s", icon, box->title, status);
             } else if (box->title) {
-                snprintf(title_with_icon, sizeof(title_with_icon), "%s", box->title);
+                snprintf(title_with_icon, sizeof(title_with_icon), "%s%s", box->title, status);
             } else {
-                title_with_icon[0] = '\0';
+                snprintf(title_with_icon, sizeof(title_with_icon), "%s", status);
             }
             
             attron(A_BOLD);
@@ -131,28 +186,31 @@ void render_box(const Box *box, const Viewport *vp, DisplayMode mode, const char
             
             /* COMPACT mode: only show icon + title (already done above) */
             /* PREVIEW mode: show icon + title + 1-2 lines of content */
-            if (mode == DISPLAY_MODE_PREVIEW && box->content != NULL && scaled_height > 2) {
+            if (mode == DISPLAY_MODE_PREVIEW && box_content_count(box) > 0 && scaled_height > 2) {
                 int preview_lines = (scaled_height > 3) ? 2 : 1;
                 int content_start_y = content_y + 1;
+                int first = tail_start(box, preview_lines);
                 
-                for (int i = 0; i < preview_lines && i < box->content_lines; i++) {
+                for (int i = 0; i < preview_lines && first + i < box_content_count(box); i++) {
                     int line_y = content_start_y + i;
                     int line_x = sx + 2;
                     if (line_y >= 0 && line_y < vp->term_height && 
                         line_y < sy + scaled_height && line_x < vp->term_width) {
-                        safe_mvprintw(line_y, line_x, box->content[i]);
+                        safe_mvprintw(line_y, line_x, box_content_line(box, first + i));
                     }
                 }
             }
             /* FULL mode: show icon + title + all content */
-            else if (mode == DISPLAY_MODE_FULL && box->content != NULL && scaled_height > 2) {
+            else if (mode == DISPLAY_MODE_FULL && box_content_count(box) > 0 && scaled_height > 2) {
                 int content_start_y = content_y + 1;
                 
-                for (int i = 0; i < box->content_lines && content_start_y + i < sy + scaled_height; i++) {
+                int line_count = box_content_count(box);
+                int first = tail_start(box, sy + scaled_height - content_start_y);
+                for (int i = 0; first + i < line_count && content_start_y + i < sy + scaled_height; i++) {
                     int line_y = content_start_y + i;
                     int line_x = sx + 2;
                     if (line_y >= 0 && line_y < vp->term_height && line_x < vp->term_width) {
-                        safe_mvprintw(line_y, line_x, box->content[i]);
+                        safe_mvprintw(line_y, line_x, box_content_line(box, first + i));
                     }
                 }
             }
@@ -166,8 +224,26 @@ void render_box(const Box *box, const Viewport *vp, DisplayMode mode, const char
 }
 
 void render_canvas(const Canvas *canvas, const Viewport *vp, const AppConfig *config) {
-    for (int i = 0; i < canvas->box_count; i++) {
-        const Box *box = &canvas->boxes[i];
+    /* Visible boxes come from the spatial index; the buffer is reused across frames */
+    static int *visible = NULL;
+    static int visible_capacity = 0;
+
+    double x0 = vp->cam_x;
+    double y0 = vp->cam_y;
+    double x1 = vp->cam_x + vp->term_width / vp->zoom;
+    double y1 = vp->cam_y + vp->term_height / vp->zoom;
+
+    /* Partial frame: only boxes on the damaged rows. Text spills to the
+     * right of a box, so boxes left of the damage still count. */
+    DamageRect bounds;
+    if (render_clip && damage_bounds(render_clip, &bounds)) {
+        y0 = fmax(y0, screen_to_world_y(vp, (int)bounds.y0) - 1.0);
+        y1 = fmin(y1, screen_to_world_y(vp, (int)bounds.y1) + 1.0);
+    }
+
+    int count = canvas_query_boxes(canvas, x0, y0, x1, y1, &visible, &visible_capacity);
+    for (int i = 0; i < count; i++) {
+        const Box *box = &canvas->boxes[visible[i]];
         const char *icon = config ? config_get_box_icon(config, box->box_type) : "";
         render_box(box, vp, canvas->display_mode, icon);
     }
@@ -248,8 +324,11 @@ void render_status(const Canvas *canvas, const Viewport *vp) {
              "%s Pos: (%.1f, %.1f) | Zoom: %.2fx | Boxes: %d%s%s%s%s",
              file_info, vp->cam_x, vp->cam_y, vp->zoom, canvas->box_count, selected_info, grid_info, conn_info, display_mode_info);
 
-    /* Context-aware help hint (Issue #48) */
+    /* Context-aware help hint (Issue #48), or a message such as a save result */
     const char *help_hint = get_context_hint(canvas);
+    if (canvas->status_message[0] != '\0') {
+        help_hint = canvas->status_message;
+    }
 
     /* Draw status bar at bottom */
     attron(A_REVERSE);
@@ -856,7 +935,7 @@ void render_grid(const Canvas *canvas, const Viewport *vp) {
 
                 if (screen_x >= 0 && screen_x < vp->term_width &&
                     screen_y >= 0 && screen_y < vp->term_height - 1) {
-                    mvaddch(screen_y, screen_x, '.');
+                    put_cell(screen_y, screen_x, '.');
                 }
             }
         }
@@ -876,7 +955,7 @@ void render_grid(const Canvas *canvas, const Viewport *vp) {
 
                 /* Skip intersections - they'll be drawn in vertical pass */
                 if (wx_int % major_spacing != 0) {
-                    mvaddch(screen_y, screen_x, ACS_HLINE);
+                    put_cell(screen_y, screen_x, ACS_HLINE);
                 }
             }
         }
@@ -896,14 +975,14 @@ void render_grid(const Canvas *canvas, const Viewport *vp) {
                     if (wx == 0 && wy_int == 0) {
                         /* Origin marker - use cyan and bold (Issue #49) */
                         attron(COLOR_PAIR(6) | A_BOLD);  /* Cyan */
-                        mvaddch(screen_y, screen_x, '#');
+                        put_cell(screen_y, screen_x, '#');
                         attroff(COLOR_PAIR(6) | A_BOLD);
                         attron(COLOR_PAIR(GRID_COLOR_PAIR));
                     } else {
-                        mvaddch(screen_y, screen_x, '+');
+                        put_cell(screen_y, screen_x, '+');
                     }
                 } else {
-                    mvaddch(screen_y, screen_x, ACS_VLINE);
+                    put_cell(screen_y, screen_x, ACS_VLINE);
                 }
             }
         }
@@ -951,9 +1030,10 @@ void render_focused_box(const Canvas *canvas) {
     int content_height = LINES - 4;  /* Title(1) + Sep(1) + Status(2) */
 
     /* Calculate scroll max */
+    int line_count = box_content_count(box);
     int max_scroll = 0;
-    if (box->content_lines > content_height) {
-        max_scroll = box->content_lines - content_height;
+    if (line_count > content_height) {
+        max_scroll = line_count - content_height;
     }
 
     /* Update scroll max in canvas */
@@ -968,32 +1048,29 @@ void render_focused_box(const Canvas *canvas) {
     }
 
     /* Render content lines with scrolling */
-    if (box->content) {
+    if (line_count > 0) {
+        int digits = 4;
+        for (int n = line_count / 10000; n > 0; n /= 10) {
+            digits++;
+        }
         for (int i = 0; i < content_height; i++) {
             int line_idx = canvas->focus.scroll_offset + i;
 
-            if (line_idx >= 0 && line_idx < box->content_lines) {
-                /* Line numbers (dim) */
+            if (line_idx >= 0 && line_idx < line_count) {
+                /* Line numbers (dim), widened for files past 9999 lines */
                 attron(COLOR_PAIR(8));
-                mvprintw(content_start_y + i, 1, "%4d ", line_idx + 1);
+                mvprintw(content_start_y + i, 1, "%*d ", digits, line_idx + 1);
                 attroff(COLOR_PAIR(8));
 
                 /* Content (handle long lines by truncating) */
-                int content_start_x = 7;
+                int content_start_x = digits + 3;
                 int max_width = COLS - content_start_x - 1;
-                char display_line[1024];
-
-                if (box->content[line_idx]) {
-                    strncpy(display_line, box->content[line_idx], sizeof(display_line) - 1);
-                    display_line[sizeof(display_line) - 1] = '\0';
-
-                    /* Truncate if too long */
-                    if ((int)strlen(display_line) > max_width) {
-                        display_line[max_width] = '\0';
-                    }
-
-                    mvprintw(content_start_y + i, content_start_x, "%s", display_line);
+                int len = (int)box_content_line_length(box, line_idx);
+                if (len > max_width) {
+                    len = max_width;  /* Truncate if too long */
                 }
+                mvprintw(content_start_y + i, content_start_x, "%.*s", len,
+                         box_content_line(box, line_idx));
             }
         }
     }
@@ -1008,11 +1085,13 @@ void render_focused_box(const Canvas *canvas) {
     attron(A_REVERSE);
     char status[256];
     int current_line = canvas->focus.scroll_offset + 1;
-    int total_lines = box->content_lines;
+    int total_lines = line_count;
 
+    /* A mapped file still being indexed has more lines than counted so far */
+    bool counting = box->file_map != NULL && !file_map_complete(box->file_map);
     snprintf(status, sizeof(status),
-             " j/k: Scroll | g: Top | G: Bottom | ESC: Exit | Line %d/%d ",
-             current_line, total_lines > 0 ? total_lines : 1);
+             " j/k: Scroll | g: Top | G: Bottom | ESC: Exit | Line %d/%d%s ",
+             current_line, total_lines > 0 ? total_lines : 1, counting ? "+" : "");
 
     mvprintw(LINES - 1, 0, "%s", status);
     for (int x = strlen(status); x < COLS; x++) {
@@ -1046,7 +1125,7 @@ static void draw_bresenham_line(int x0, int y0, int x1, int y1, chtype ch,
     while (1) {
         /* Draw point if within screen bounds */
         if (x >= 0 && x < term_width && y >= 0 && y < term_height - 1) {
-            mvaddch(y, x, ch);
+            put_cell(y, x, ch);
         }
 
         /* Check if we've reached the end */
@@ -1098,6 +1177,12 @@ void render_connections(const Canvas *canvas, const Viewport *vp) {
             continue;
         }
 
+        /* Skip lines that miss every damaged region */
+        if (render_clip && !damage_intersects(render_clip, fmin(sx0, sx1), fmin(sy0, sy1),
+                                              fmax(sx0, sx1) + 1, fmax(sy0, sy1) + 1)) {
+            continue;
+        }
+
         /* Set connection color */
         if (conn->color > 0 && has_colors()) {
             attron(COLOR_PAIR(conn->color));
@@ -1491,13 +1576,7 @@ void render_edit_mode(const Canvas *canvas, const Viewport *vp) {
     }
 
     /* Get the box being edited */
-    Box *box = NULL;
-    for (int i = 0; i < canvas->box_count; i++) {
-        if (canvas->boxes[i].id == ed->box_id) {
-            box = &canvas->boxes[i];
-            break;
-        }
-    }
+    Box *box = canvas_get_box((Canvas *)canvas, ed->box_id);
     if (!box) return;
 
     /* Calculate screen position for title */
@@ -1560,3 +1639,132 @@ void render_edit_mode(const Canvas *canvas, const Viewport *vp) {
     }
 }
 
+
+/* ============================================================
+ * Frame Damage
+ * ============================================================ */
+
+/* Everything outside the canvas that changes the whole picture.
+ * A difference from the last frame forces a full redraw. */
+typedef struct {
+    Viewport viewport;
+    bool grid_visible;
+    int grid_spacing;
+    int grid_major_spacing;
+    DisplayMode display_mode;
+    SidebarState sidebar_state;
+    int sidebar_width;
+    bool focus_active;
+    int focus_box_id;
+    int focus_scroll;
+    bool help_visible;
+    bool command_active;
+    bool edit_active;
+    bool conn_mode_active;
+} FrameView;
+
+static FrameView last_view;
+static bool have_last_view = false;
+
+static void capture_frame_view(FrameView *view, const Canvas *canvas, const Viewport *vp) {
+    memset(view, 0, sizeof(*view));  /* memcmp-able, padding included */
+    view->viewport = *vp;
+    view->grid_visible = canvas->grid.visible;
+    view->grid_spacing = canvas->grid.spacing;
+    view->grid_major_spacing = canvas->grid.major_spacing;
+    view->display_mode = canvas->display_mode;
+    view->sidebar_state = canvas->sidebar_state;
+    view->sidebar_width = canvas->sidebar_width;
+    view->focus_active = canvas->focus.active;
+    view->focus_box_id = canvas->focus.focused_box_id;
+    view->focus_scroll = canvas->focus.scroll_offset;
+    view->help_visible = canvas->help.visible;
+    view->command_active = canvas->command_line.active;
+    view->edit_active = canvas->editor.active;
+    view->conn_mode_active = canvas->conn_mode.active;
+}
+
+/* Full-screen overlays that cover the canvas get redrawn whole */
+static bool overlay_active(const Canvas *canvas) {
+    return canvas->focus.active || canvas->help.visible ||
+           canvas->command_line.active || canvas->editor.active;
+}
+
+/* Convert world damage to screen cells, padded for rounding and borders */
+static void damage_world_to_screen(Damage *screen, const Damage *world, const Viewport *vp) {
+    for (int i = 0; i < world->count; i++) {
+        const DamageRect *r = &world->rects[i];
+        double x0 = floor((r->x0 - vp->cam_x) * vp->zoom) - 2.0;
+        double y0 = floor((r->y0 - vp->cam_y) * vp->zoom) - 2.0;
+        double x1 = ceil((r->x1 - vp->cam_x) * vp->zoom) + 2.0;
+        double y1 = ceil((r->y1 - vp->cam_y) * vp->zoom) + 2.0;
+
+        x0 = fmax(x0, 0.0);
+        y0 = fmax(y0, 0.0);
+        x1 = fmin(x1, vp->term_width);
+        y1 = fmin(y1, vp->term_height);
+        damage_mark(screen, x0, y0, x1, y1);
+    }
+}
+
+bool render_frame_pending(const Canvas *canvas, const Viewport *vp) {
+    if (!damage_is_empty(&canvas->damage) || !have_last_view) {
+        return true;
+    }
+    FrameView view;
+    capture_frame_view(&view, canvas, vp);
+    return memcmp(&view, &last_view, sizeof(view)) != 0;
+}
+
+bool render_frame_begin(Canvas *canvas, const Viewport *vp) {
+    FrameView view;
+    capture_frame_view(&view, canvas, vp);
+    if (!have_last_view || memcmp(&view, &last_view, sizeof(view)) != 0) {
+        damage_mark_all(&canvas->damage);
+    }
+    last_view = view;
+    have_last_view = true;
+
+    if (damage_is_empty(&canvas->damage)) {
+        return false;  /* Nothing changed: draw nothing, send nothing */
+    }
+    if (overlay_active(canvas)) {
+        damage_mark_all(&canvas->damage);
+    }
+
+    damage_clear(&frame_damage);
+    if (canvas->damage.full) {
+        erase();
+        render_clip = NULL;
+    } else {
+        damage_world_to_screen(&frame_damage, &canvas->damage, vp);
+        /* Status bar text depends on canvas state; always redraw it */
+        damage_mark(&frame_damage, 0, vp->term_height - 1, vp->term_width, vp->term_height);
+
+        attrset(A_NORMAL);
+        for (int i = 0; i < frame_damage.count; i++) {
+            const DamageRect *r = &frame_damage.rects[i];
+            for (int y = (int)r->y0; y < (int)r->y1; y++) {
+                mvhline(y, (int)r->x0, ' ', (int)r->x1 - (int)r->x0);
+            }
+        }
+        render_clip = &frame_damage;
+    }
+
+    damage_clear(&canvas->damage);
+    return true;
+}
+
+void render_frame_overlays(void) {
+    render_clip = NULL;
+}
+
+void render_frame_end(void) {
+    render_clip = NULL;
+    terminal_refresh();
+}
+
+void render_frame_reset(void) {
+    have_last_view = false;
+    render_clip = NULL;
+}
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#include "saver.h"
+#include "persistence.h"
+
+/* Saver F2 goes through (NULL: F2 saves in place) */
+static Saver *global_saver = NULL;
+
+void saver_init(Saver *saver) {
+    saver->pid = -1;
+    saver->path = NULL;
+    saver->last_path = NULL;
+    saver->format = CANVAS_FORMAT_V1;
+    saver->queued_path = NULL;
+    saver->queued_format = CANVAS_FORMAT_V1;
+    saver->error = 0;
+    saver->keep_journal = false;
+}
+
+/* The running save is over: remember what it wrote */
+static void finish(Saver *saver, int error) {
+    saver->pid = -1;
+    saver->error = error;
+    free(saver->last_path);
+    saver->last_path = saver->path;
+    saver->path = NULL;
+}
+
+/* Write the file as a whole save, or for the journal (see keep_journal) */
+static int write_file(const Saver *saver, const Canvas *canvas, const char *path, int format) {
+    if (saver->keep_journal) {
+        return canvas_write_format(canvas, path, (CanvasFormat)format);
+    }
+    return canvas_save_format(canvas, path, (CanvasFormat)format);
+}
+
+/* Start writing canvas to path (nothing is running); returns as saver_start() */
+static int start_now(Saver *saver, const Canvas *canvas, char *path, int format) {
+    saver->path = path;
+    saver->format = format;
+#ifndef _WIN32
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* Only write the file: no terminal, no handlers, no atexit */
+        if (write_file(saver, canvas, path, format) != 0) {
+            int error = errno;
+            _exit(error > 0 && error < 256 ? error : EIO);
+        }
+        _exit(0);
+    }
+    if (pid > 0) {
+        saver->pid = pid;
+        return 1;
+    }
+#endif
+    /* No child: save in place */
+    if (write_file(saver, canvas, path, format) != 0) {
+        finish(saver, errno ? errno : EIO);
+        return -1;
+    }
+    finish(saver, 0);
+    return 0;
+}
+
+int saver_start(Saver *saver, const Canvas *canvas, const char *path, int format) {
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        saver->error = ENOMEM;
+        return -1;
+    }
+    if (saver->pid > 0) {
+        /* The newest request wins: it saves the latest canvas anyway */
+        free(saver->queued_path);
+        saver->queued_path = copy;
+        saver->queued_format = format;
+        return 1;
+    }
+    return start_now(saver, canvas, copy, format);
+}
+
+bool saver_busy(const Saver *saver) {
+    return saver->pid > 0 || saver->queued_path != NULL;
+}
+
+/* Collect the child; 1 done, -1 failed, 0 still running */
+static int reap(Saver *saver, bool block) {
+#ifndef _WIN32
+    int status;
+    pid_t pid;
+    do {
+        pid = waitpid(saver->pid, &status, block ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+        return 0;
+    }
+    if (pid < 0) {
+        finish(saver, ECHILD);
+        return -1;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        persistence_count_save();  /* The child's count is lost with it */
+        finish(saver, 0);
+        return 1;
+    }
+    finish(saver, WIFEXITED(status) ? WEXITSTATUS(status) : EINTR);
+    return -1;
+#else
+    (void)block;
+    finish(saver, 0);
+    return 1;
+#endif
+}
+
+/* Start the save requested while the last one ran, if any. One that
+ * cannot fork runs in place, and its result replaces the last one's. */
+static int start_queued(Saver *saver, const Canvas *canvas, int result) {
+    if (saver->queued_path == NULL) {
+        return result;
+    }
+    char *path = saver->queued_path;
+    saver->queued_path = NULL;
+    int started = start_now(saver, canvas, path, saver->queued_format);
+    if (started == 0) {
+        return 1;
+    }
+    return started < 0 ? -1 : result;
+}
+
+int saver_poll(Saver *saver, const Canvas *canvas) {
+    if (saver->pid <= 0) {
+        return 0;
+    }
+    int result = reap(saver, false);
+    return result != 0 ? start_queued(saver, canvas, result) : 0;
+}
+
+int saver_wait(Saver *saver, const Canvas *canvas) {
+    int result = 0;
+    while (saver->pid > 0) {
+        result = start_queued(saver, canvas, reap(saver, true));
+    }
+    return result;
+}
+
+void saver_cleanup(Saver *saver, const Canvas *canvas) {
+    saver_wait(saver, canvas);
+    free(saver->path);
+    free(saver->last_path);
+    free(saver->queued_path);
+    saver_init(saver);
+}
+
+const char *saver_last_path(const Saver *saver) {
+    return saver->last_path;
+}
+
+void saver_describe(const Saver *saver, int result, char *out, size_t size) {
+    const char *done = saver->last_path ? saver->last_path : "canvas";
+    if (result < 0) {
+        snprintf(out, size, "Save failed: %s (%s)", done, strerror(saver->error));
+    } else if (saver->pid > 0) {
+        snprintf(out, size, "Saving %s...", saver->path);
+    } else {
+        snprintf(out, size, "Saved %s", done);
+    }
+}
+
+void saver_set_global(Saver *saver) {
+    global_saver = saver;
+}
+
+Saver *saver_get_global(void) {
+    return global_saver;
+}
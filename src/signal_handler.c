@@ -5,6 +5,11 @@
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "signal_handler.h"
 #include "terminal.h"
 
@@ -19,28 +24,57 @@ static volatile sig_atomic_t sync_flag = 0;
  * UNIX IMPLEMENTATION - Full POSIX signal handling
  * ======================================================================== */
 
+/* Self-pipe: handlers write a byte so a loop blocked in poll() wakes up */
+static int wakeup_pipe[2] = {-1, -1};
+
+/* Wake the main loop (async-signal-safe) */
+static void wake_main_loop(void) {
+    if (wakeup_pipe[1] >= 0) {
+        int saved_errno = errno;
+        ssize_t written = write(wakeup_pipe[1], "", 1);
+        (void)written;  /* Pipe full is fine: a wake-up is already pending */
+        errno = saved_errno;
+    }
+}
+
+/* Create the non-blocking, close-on-exec self-pipe */
+static int open_wakeup_pipe(void) {
+    if (pipe(wakeup_pipe) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(wakeup_pipe[i], F_SETFL, fcntl(wakeup_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(wakeup_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    return 0;
+}
+
 /* Signal handler for termination signals (SIGINT, SIGTERM, SIGHUP) */
 static void handle_termination(int sig) {
     (void)sig; /* Unused parameter */
     quit_flag = 1;
+    wake_main_loop();
 }
 
 /* Signal handler for window resize (SIGWINCH) */
 static void handle_resize(int sig) {
     (void)sig; /* Unused parameter */
     resize_flag = 1;
+    wake_main_loop();
 }
 
 /* Signal handler for reload (SIGUSR1) */
 static void handle_reload(int sig) {
     (void)sig; /* Unused parameter */
     reload_flag = 1;
+    wake_main_loop();
 }
 
 /* Signal handler for sync (SIGUSR2) */
 static void handle_sync(int sig) {
     (void)sig; /* Unused parameter */
     sync_flag = 1;
+    wake_main_loop();
 }
 
 /* Initialize signal handlers */
@@ -50,6 +84,11 @@ int signal_handler_init(void) {
     struct sigaction sa_reload;
     struct sigaction sa_sync;
 
+    /* Self-pipe first so no signal can arrive before it exists */
+    if (wakeup_pipe[0] < 0 && open_wakeup_pipe() != 0) {
+        return -1;
+    }
+
     /* Setup termination signal handler */
     sa_term.sa_handler = handle_termination;
     sigemptyset(&sa_term.sa_mask);
@@ -133,6 +172,22 @@ bool signal_should_sync(void) {
     return false;
 }
 
+/* Read end of the self-pipe, readable after any handled signal */
+int signal_wakeup_fd(void) {
+    return wakeup_pipe[0];
+}
+
+/* Empty the self-pipe after waking up */
+void signal_clear_wakeup(void) {
+    char buf[64];
+    if (wakeup_pipe[0] < 0) {
+        return;
+    }
+    while (read(wakeup_pipe[0], buf, sizeof(buf)) > 0) {
+        /* Drain */
+    }
+}
+
 /* Cleanup signal handlers - restore defaults */
 void signal_handler_cleanup(void) {
     signal(SIGINT, SIG_DFL);
@@ -142,6 +197,13 @@ void signal_handler_cleanup(void) {
     signal(SIGUSR1, SIG_DFL);
     signal(SIGUSR2, SIG_DFL);
     signal(SIGPIPE, SIG_DFL);
+
+    for (int i = 0; i < 2; i++) {
+        if (wakeup_pipe[i] >= 0) {
+            close(wakeup_pipe[i]);
+            wakeup_pipe[i] = -1;
+        }
+    }
 }
 
 #else
@@ -198,6 +260,15 @@ bool signal_should_sync(void) {
     return false;
 }
 
+/* No self-pipe on Windows */
+int signal_wakeup_fd(void) {
+    return -1;
+}
+
+/* No self-pipe on Windows */
+void signal_clear_wakeup(void) {
+}
+
 /* Cleanup signal handlers */
 void signal_handler_cleanup(void) {
     /* Remove our console control handler */
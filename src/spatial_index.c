@@ -0,0 +1,397 @@
+#include <stdlib.h>
+#include <math.h>
+#include "spatial_index.h"
+#include "id_index.h"
+
+/* Initial number of hash buckets (grows with entry count) */
+#define SPATIAL_INITIAL_BUCKETS 64
+
+/* Grid cell containing a world coordinate, clamped (NaN goes low) */
+static int cell_of(const SpatialIndex *index, double v) {
+    double cell = floor(v / index->cell_size);
+    if (!(cell > -SPATIAL_CELL_LIMIT)) {
+        return -SPATIAL_CELL_LIMIT;
+    }
+    if (cell > SPATIAL_CELL_LIMIT) {
+        return SPATIAL_CELL_LIMIT;
+    }
+    return (int)cell;
+}
+
+/* Number of cells in a clamped cell range (0 if empty) */
+static long long cell_span(int c0, int c1, int d0, int d1) {
+    if (c1 < c0 || d1 < d0) {
+        return 0;
+    }
+    return ((long long)c1 - c0 + 1) * ((long long)d1 - d0 + 1);
+}
+
+/* Hash a cell coordinate pair into the bucket table */
+static unsigned int bucket_of(int cx, int cy, int bucket_count) {
+    unsigned int h = ((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u);
+    return h & (unsigned int)(bucket_count - 1);
+}
+
+/* Append an entry to a bucket, growing it if needed */
+static int bucket_push(SpatialBucket *bucket, int cx, int cy, int id) {
+    if (bucket->count >= bucket->capacity) {
+        int new_capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        SpatialEntry *new_entries = realloc(bucket->entries, sizeof(SpatialEntry) * new_capacity);
+        if (new_entries == NULL) {
+            return -1;
+        }
+        bucket->entries = new_entries;
+        bucket->capacity = new_capacity;
+    }
+    SpatialEntry *entry = &bucket->entries[bucket->count++];
+    entry->cx = cx;
+    entry->cy = cy;
+    entry->id = id;
+    return 0;
+}
+
+/* Double the bucket table and redistribute all entries */
+static int grow_buckets(SpatialIndex *index) {
+    int new_count = index->bucket_count * 2;
+    SpatialBucket *new_buckets = calloc(new_count, sizeof(SpatialBucket));
+    if (new_buckets == NULL) {
+        return -1;
+    }
+
+    for (int b = 0; b < index->bucket_count; b++) {
+        SpatialBucket *old = &index->buckets[b];
+        for (int i = 0; i < old->count; i++) {
+            SpatialEntry *e = &old->entries[i];
+            SpatialBucket *dst = &new_buckets[bucket_of(e->cx, e->cy, new_count)];
+            if (bucket_push(dst, e->cx, e->cy, e->id) != 0) {
+                for (int k = 0; k < new_count; k++) {
+                    free(new_buckets[k].entries);
+                }
+                free(new_buckets);
+                return -1;
+            }
+        }
+    }
+
+    for (int b = 0; b < index->bucket_count; b++) {
+        free(index->buckets[b].entries);
+    }
+    free(index->buckets);
+    index->buckets = new_buckets;
+    index->bucket_count = new_count;
+    return 0;
+}
+
+/* Register a record's bounds in every cell it touches, or on the
+ * large list if that is too many cells */
+static int add_cells(SpatialIndex *index, SpatialRecord *rec) {
+    int cx0 = cell_of(index, rec->x);
+    int cy0 = cell_of(index, rec->y);
+    int cx1 = cell_of(index, rec->x + rec->width);
+    int cy1 = cell_of(index, rec->y + rec->height);
+
+    rec->large = cell_span(cx0, cx1, cy0, cy1) > SPATIAL_MAX_CELLS;
+    if (rec->large) {
+        if (index->large_count == index->large_capacity) {
+            int new_capacity = index->large_capacity ? index->large_capacity * 2 : 8;
+            int *new_large = realloc(index->large, sizeof(int) * new_capacity);
+            if (new_large == NULL) {
+                rec->large = false;
+                return -1;
+            }
+            index->large = new_large;
+            index->large_capacity = new_capacity;
+        }
+        index->large[index->large_count++] = rec->id;
+        return 0;
+    }
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            SpatialBucket *bucket = &index->buckets[bucket_of(cx, cy, index->bucket_count)];
+            if (bucket_push(bucket, cx, cy, rec->id) != 0) {
+                return -1;
+            }
+            index->entry_count++;
+        }
+    }
+
+    if (index->entry_count > index->bucket_count * 2) {
+        grow_buckets(index);  /* Best effort - a full table is only slower */
+    }
+    return 0;
+}
+
+/* Remove a record's registrations from every cell it touched */
+static void remove_cells(SpatialIndex *index, const SpatialRecord *rec) {
+    if (rec->large) {
+        for (int i = 0; i < index->large_count; i++) {
+            if (index->large[i] == rec->id) {
+                index->large[i] = index->large[--index->large_count];
+                break;
+            }
+        }
+        return;
+    }
+    int cx0 = cell_of(index, rec->x);
+    int cy0 = cell_of(index, rec->y);
+    int cx1 = cell_of(index, rec->x + rec->width);
+    int cy1 = cell_of(index, rec->y + rec->height);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            SpatialBucket *bucket = &index->buckets[bucket_of(cx, cy, index->bucket_count)];
+            for (int i = 0; i < bucket->count; i++) {
+                SpatialEntry *e = &bucket->entries[i];
+                if (e->id == rec->id && e->cx == cx && e->cy == cy) {
+                    /* Swap-remove: order within a bucket is irrelevant */
+                    *e = bucket->entries[bucket->count - 1];
+                    bucket->count--;
+                    index->entry_count--;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void spatial_index_init(SpatialIndex *index, double cell_size) {
+    index->cell_size = cell_size > 0.0 ? cell_size : SPATIAL_CELL_SIZE;
+    index->buckets = NULL;
+    index->bucket_count = 0;
+    index->entry_count = 0;
+    index->records = NULL;
+    index->record_count = 0;
+    index->record_capacity = 0;
+    id_index_init(&index->record_of);
+    index->large = NULL;
+    index->large_count = 0;
+    index->large_capacity = 0;
+}
+
+void spatial_index_free(SpatialIndex *index) {
+    for (int b = 0; b < index->bucket_count; b++) {
+        free(index->buckets[b].entries);
+    }
+    free(index->buckets);
+    free(index->records);
+    free(index->large);
+    id_index_free(&index->record_of);
+    spatial_index_init(index, index->cell_size);
+}
+
+int spatial_index_reserve(SpatialIndex *index, int count) {
+    if (count > index->record_capacity) {
+        SpatialRecord *new_records = realloc(index->records, sizeof(SpatialRecord) * count);
+        if (new_records == NULL) {
+            return -1;
+        }
+        index->records = new_records;
+        index->record_capacity = count;
+    }
+
+    if (id_index_reserve(&index->record_of, count) != 0) {
+        return -1;
+    }
+
+    /* Most boxes straddle a few cells; size for ~2 entries per bucket */
+    if (index->buckets == NULL) {
+        int buckets = SPATIAL_INITIAL_BUCKETS;
+        while (buckets < count) {
+            buckets *= 2;
+        }
+        index->buckets = calloc(buckets, sizeof(SpatialBucket));
+        if (index->buckets == NULL) {
+            return -1;
+        }
+        index->bucket_count = buckets;
+    } else {
+        while (index->bucket_count < count) {
+            if (grow_buckets(index) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int spatial_index_insert(SpatialIndex *index, int box_id,
+                         double x, double y, double width, double height) {
+    if (id_index_get(&index->record_of, box_id) >= 0) {
+        return spatial_index_update(index, box_id, x, y, width, height);
+    }
+
+    if (index->buckets == NULL) {
+        index->buckets = calloc(SPATIAL_INITIAL_BUCKETS, sizeof(SpatialBucket));
+        if (index->buckets == NULL) {
+            return -1;
+        }
+        index->bucket_count = SPATIAL_INITIAL_BUCKETS;
+    }
+
+    if (index->record_count >= index->record_capacity) {
+        int new_capacity = index->record_capacity ? index->record_capacity * 2 : 16;
+        SpatialRecord *new_records = realloc(index->records, sizeof(SpatialRecord) * new_capacity);
+        if (new_records == NULL) {
+            return -1;
+        }
+        index->records = new_records;
+        index->record_capacity = new_capacity;
+    }
+
+    SpatialRecord *rec = &index->records[index->record_count];
+    rec->id = box_id;
+    rec->x = x;
+    rec->y = y;
+    rec->width = width;
+    rec->height = height;
+    rec->large = false;
+
+    if (id_index_put(&index->record_of, box_id, index->record_count) != 0) {
+        return -1;
+    }
+    index->record_count++;
+
+    if (add_cells(index, rec) != 0) {
+        spatial_index_remove(index, box_id);
+        return -1;
+    }
+    return 0;
+}
+
+int spatial_index_update(SpatialIndex *index, int box_id,
+                         double x, double y, double width, double height) {
+    int r = id_index_get(&index->record_of, box_id);
+    if (r < 0) {
+        return spatial_index_insert(index, box_id, x, y, width, height);
+    }
+
+    SpatialRecord *rec = &index->records[r];
+    SpatialRecord moved = *rec;
+    moved.x = x;
+    moved.y = y;
+    moved.width = width;
+    moved.height = height;
+
+    /* Only touch the grid if the covered cell range changed */
+    if (rec->large ||
+        cell_of(index, rec->x) != cell_of(index, x) ||
+        cell_of(index, rec->y) != cell_of(index, y) ||
+        cell_of(index, rec->x + rec->width) != cell_of(index, x + width) ||
+        cell_of(index, rec->y + rec->height) != cell_of(index, y + height)) {
+        remove_cells(index, rec);
+        moved.large = false;
+        *rec = moved;
+        if (add_cells(index, rec) != 0) {
+            return -1;
+        }
+    } else {
+        *rec = moved;
+    }
+    return 0;
+}
+
+int spatial_index_remove(SpatialIndex *index, int box_id) {
+    int r = id_index_get(&index->record_of, box_id);
+    if (r < 0) {
+        return -1;
+    }
+
+    remove_cells(index, &index->records[r]);
+    id_index_remove(&index->record_of, box_id);
+
+    /* Swap the last record into the hole */
+    int last = index->record_count - 1;
+    if (r != last) {
+        index->records[r] = index->records[last];
+        id_index_put(&index->record_of, index->records[r].id, r);
+    }
+    index->record_count--;
+    return 0;
+}
+
+void spatial_index_visit_point(const SpatialIndex *index, double x, double y,
+                               SpatialVisitFn fn, void *ctx) {
+    if (index->bucket_count == 0) {
+        return;
+    }
+
+    int cx = cell_of(index, x);
+    int cy = cell_of(index, y);
+    const SpatialBucket *bucket = &index->buckets[bucket_of(cx, cy, index->bucket_count)];
+
+    for (int i = 0; i < bucket->count; i++) {
+        const SpatialEntry *e = &bucket->entries[i];
+        if (e->cx != cx || e->cy != cy) {
+            continue;  /* Different cell hashed into the same bucket */
+        }
+        const SpatialRecord *rec = &index->records[id_index_get(&index->record_of, e->id)];
+        if (x >= rec->x && x <= rec->x + rec->width &&
+            y >= rec->y && y <= rec->y + rec->height) {
+            fn(e->id, ctx);
+        }
+    }
+    for (int i = 0; i < index->large_count; i++) {
+        const SpatialRecord *rec = &index->records[id_index_get(&index->record_of, index->large[i])];
+        if (x >= rec->x && x <= rec->x + rec->width &&
+            y >= rec->y && y <= rec->y + rec->height) {
+            fn(rec->id, ctx);
+        }
+    }
+}
+
+void spatial_index_visit_rect(const SpatialIndex *index,
+                              double x0, double y0, double x1, double y1,
+                              SpatialVisitFn fn, void *ctx) {
+    if (index->record_count == 0) {
+        return;
+    }
+
+    int qx0 = cell_of(index, x0);
+    int qy0 = cell_of(index, y0);
+    int qx1 = cell_of(index, x1);
+    int qy1 = cell_of(index, y1);
+
+    /* A query covering more cells than there are boxes is cheaper as a scan */
+    if (cell_span(qx0, qx1, qy0, qy1) > index->record_count) {
+        for (int r = 0; r < index->record_count; r++) {
+            const SpatialRecord *rec = &index->records[r];
+            if (rec->x <= x1 && rec->x + rec->width >= x0 &&
+                rec->y <= y1 && rec->y + rec->height >= y0) {
+                fn(rec->id, ctx);
+            }
+        }
+        return;
+    }
+
+    for (int cy = qy0; cy <= qy1; cy++) {
+        for (int cx = qx0; cx <= qx1; cx++) {
+            const SpatialBucket *bucket = &index->buckets[bucket_of(cx, cy, index->bucket_count)];
+            for (int i = 0; i < bucket->count; i++) {
+                const SpatialEntry *e = &bucket->entries[i];
+                if (e->cx != cx || e->cy != cy) {
+                    continue;
+                }
+                const SpatialRecord *rec = &index->records[id_index_get(&index->record_of, e->id)];
+                if (rec->x > x1 || rec->x + rec->width < x0 ||
+                    rec->y > y1 || rec->y + rec->height < y0) {
+                    continue;
+                }
+                /* A box spanning several cells is reported only from the
+                 * first cell where it overlaps the query */
+                int bx0 = cell_of(index, rec->x);
+                int by0 = cell_of(index, rec->y);
+                if (cx == (bx0 > qx0 ? bx0 : qx0) && cy == (by0 > qy0 ? by0 : qy0)) {
+                    fn(e->id, ctx);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < index->large_count; i++) {
+        const SpatialRecord *rec = &index->records[id_index_get(&index->record_of, index->large[i])];
+        if (rec->x <= x1 && rec->x + rec->width >= x0 &&
+            rec->y <= y1 && rec->y + rec->height >= y0) {
+            fn(rec->id, ctx);
+        }
+    }
+}
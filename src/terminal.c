@@ -1,7 +1,10 @@
+#define _GNU_SOURCE
 #include <ncurses.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "terminal.h"
 #include "types.h"
 #include "signal_handler.h"
@@ -101,10 +104,50 @@ void terminal_update_size(Viewport *vp) {
     getmaxyx(stdscr, vp->term_height, vp->term_width);
 }
 
+int terminal_read_key(void) {
+    int ch = getch();
+    return ch == ERR ? -1 : ch;
+}
+
 void terminal_clear(void) {
     clear();
 }
 
+/* Bytes written by this thread so far, from /proc (Linux only; -1 if unavailable).
+ * ncurses writes straight to the terminal fd, so this is the only place
+ * the frame's output size can be observed without touching ncurses. */
+static long thread_bytes_written(void) {
+    static int io_fd = -2;
+    if (io_fd == -2) {
+        io_fd = open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+    }
+    if (io_fd < 0) {
+        return -1;
+    }
+
+    char buf[512];
+    ssize_t n = pread(io_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+
+    const char *field = strstr(buf, "wchar:");
+    if (field == NULL) {
+        return -1;
+    }
+    return strtol(field + 6, NULL, 10);
+}
+
+static long last_frame_bytes = -1;
+
 void terminal_refresh(void) {
+    long before = thread_bytes_written();
     refresh();
+    long after = thread_bytes_written();
+    last_frame_bytes = (before >= 0 && after >= 0) ? after - before : -1;
+}
+
+long terminal_frame_bytes(void) {
+    return last_frame_bytes;
 }
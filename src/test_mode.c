@@ -7,6 +7,7 @@
 #include <curses.h>
 #include "test_mode.h"
 #include "types.h"  /* For GRID_COLOR_PAIR */
+#include "terminal.h"
 
 /* Global test mode pointer for key handling */
 static TestMode *g_test_mode = NULL;
@@ -224,6 +225,15 @@ void test_mode_update_fps(TestMode *tm) {
     }
 }
 
+void test_mode_record_latency(TestMode *tm, double seconds) {
+    if (!tm) return;
+
+    tm->input_latency = seconds;
+    if (seconds > tm->input_latency_max) {
+        tm->input_latency_max = seconds;
+    }
+}
+
 const char *test_mode_grid_style_name(GridStyle style) {
     switch (style) {
         case GRID_STYLE_NONE:       return "None";
@@ -251,7 +261,7 @@ void test_mode_render_overlay(TestMode *tm, float cam_x, float cam_y,
 
     /* Draw overlay box in top-right corner */
     int overlay_width = 40;
-    int overlay_height = 12;
+    int overlay_height = 13;
     int overlay_x = max_x - overlay_width - 2;
     int overlay_y = 1;
 
@@ -313,6 +323,18 @@ void test_mode_render_overlay(TestMode *tm, float cam_x, float cam_y,
     time_t runtime = time(NULL) - tm->start_time;
     mvprintw(y++, x, "Runtime: %ldm %lds", runtime / 60, runtime % 60);
 
+    /* Terminal output of the previous frame */
+    long frame_bytes = terminal_frame_bytes();
+    if (frame_bytes >= 0) {
+        mvprintw(y++, x, "Frame: %ld bytes", frame_bytes);
+    } else {
+        mvprintw(y++, x, "Frame: n/a");
+    }
+
+    /* Input-to-display latency */
+    mvprintw(y++, x, "Latency: %.1fms (max %.1fms)",
+             tm->input_latency * 1000.0, tm->input_latency_max * 1000.0);
+
     attroff(A_REVERSE);
 
     /* Event log (bottom portion) */
@@ -3,6 +3,8 @@
 #include <string.h>
 #include "undo.h"
 #include "canvas.h"
+#include "box_content.h"
+#include "file_viewer.h"
 
 /* ============================================================
  * Helper Functions
@@ -14,36 +16,6 @@ static char *safe_strdup(const char *s) {
     return strdup(s);
 }
 
-/* Deep copy content array */
-static char **copy_content(char **content, int count) {
-    if (content == NULL || count <= 0) return NULL;
-
-    char **copy = malloc(sizeof(char *) * count);
-    if (copy == NULL) return NULL;
-
-    for (int i = 0; i < count; i++) {
-        copy[i] = safe_strdup(content[i]);
-        if (content[i] != NULL && copy[i] == NULL) {
-            /* Cleanup on failure */
-            for (int j = 0; j < i; j++) {
-                free(copy[j]);
-            }
-            free(copy);
-            return NULL;
-        }
-    }
-    return copy;
-}
-
-/* Free content array */
-static void free_content(char **content, int count) {
-    if (content == NULL) return;
-    for (int i = 0; i < count; i++) {
-        free(content[i]);
-    }
-    free(content);
-}
-
 /* Create a snapshot of a box */
 static void snapshot_box(BoxSnapshot *snap, const Box *box) {
     snap->id = box->id;
@@ -52,8 +24,9 @@ static void snapshot_box(BoxSnapshot *snap, const Box *box) {
     snap->width = box->width;
     snap->height = box->height;
     snap->title = safe_strdup(box->title);
-    snap->content = copy_content(box->content, box->content_lines);
-    snap->content_lines = box->content_lines;
+    /* Copy-on-write: the box copies the buffer if it writes while shared.
+     * Output still arriving is copied now, as it is appended in place. */
+    snap->content = content_buffer_freeze(box->content);
     snap->color = box->color;
     snap->box_type = box->box_type;
     snap->content_type = box->content_type;
@@ -64,7 +37,7 @@ static void snapshot_box(BoxSnapshot *snap, const Box *box) {
 /* Free a box snapshot */
 static void free_box_snapshot(BoxSnapshot *snap) {
     free(snap->title);
-    free_content(snap->content, snap->content_lines);
+    content_buffer_release(snap->content);
     free(snap->file_path);
     free(snap->command);
     /* Zero out to prevent double-free */
@@ -101,8 +74,8 @@ static void free_operation(Operation *op) {
             free(op->after.box_after.title);
             break;
         case OP_BOX_CONTENT:
-            free_content(op->before.box_before.content, op->before.box_before.content_lines);
-            free_content(op->after.box_after.content, op->after.box_after.content_lines);
+            content_buffer_release(op->before.box_before.content);
+            content_buffer_release(op->after.box_after.content);
             break;
         case OP_CONNECTION_CREATE:
         case OP_CONNECTION_DELETE:
@@ -320,11 +293,8 @@ static int restore_box_from_snapshot(Canvas *canvas, const BoxSnapshot *snap) {
     box->box_type = snap->box_type;
     box->content_type = snap->content_type;
 
-    /* Restore content */
-    if (snap->content != NULL && snap->content_lines > 0) {
-        canvas_add_box_content(canvas, restored_id,
-                               (const char **)snap->content, snap->content_lines);
-    }
+    /* Restore content by sharing the snapshot's buffer */
+    box_content_share(box, snap->content);
 
     /* Restore file_path and command with NULL checks */
     if (snap->file_path) {
@@ -345,6 +315,11 @@ static int restore_box_from_snapshot(Canvas *canvas, const BoxSnapshot *snap) {
         box->command = new_command;
     }
 
+    /* A mapped file is not held in the snapshot; map it again */
+    if (snap->content == NULL && box->content_type == BOX_CONTENT_FILE && box->file_path) {
+        file_viewer_load(box, box->file_path);
+    }
+
     return restored_id;
 }
 
@@ -371,21 +346,15 @@ bool canvas_undo(Canvas *canvas) {
 
         case OP_BOX_MOVE: {
             /* Undo move = restore old position */
-            Box *box = canvas_get_box(canvas, op->box_id);
-            if (box) {
-                box->x = op->before.box_before.x;
-                box->y = op->before.box_before.y;
-            }
+            canvas_move_box(canvas, op->box_id,
+                            op->before.box_before.x, op->before.box_before.y);
             break;
         }
 
         case OP_BOX_RESIZE: {
             /* Undo resize = restore old dimensions */
-            Box *box = canvas_get_box(canvas, op->box_id);
-            if (box) {
-                box->width = op->before.box_before.width;
-                box->height = op->before.box_before.height;
-            }
+            canvas_resize_box(canvas, op->box_id,
+                              op->before.box_before.width, op->before.box_before.height);
             break;
         }
 
@@ -395,6 +364,7 @@ bool canvas_undo(Canvas *canvas) {
             if (box) {
                 free(box->title);
                 box->title = safe_strdup(op->before.box_before.title);
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
@@ -403,10 +373,8 @@ bool canvas_undo(Canvas *canvas) {
             /* Undo content change = restore old content */
             Box *box = canvas_get_box(canvas, op->box_id);
             if (box) {
-                free_content(box->content, box->content_lines);
-                box->content = copy_content(op->before.box_before.content,
-                                            op->before.box_before.content_lines);
-                box->content_lines = op->before.box_before.content_lines;
+                box_content_share(box, op->before.box_before.content);
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
@@ -416,6 +384,7 @@ bool canvas_undo(Canvas *canvas) {
             Box *box = canvas_get_box(canvas, op->box_id);
             if (box) {
                 box->color = op->before.box_before.color;
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
@@ -476,21 +445,15 @@ bool canvas_redo(Canvas *canvas) {
 
         case OP_BOX_MOVE: {
             /* Redo move = apply new position */
-            Box *box = canvas_get_box(canvas, op->box_id);
-            if (box) {
-                box->x = op->after.box_after.x;
-                box->y = op->after.box_after.y;
-            }
+            canvas_move_box(canvas, op->box_id,
+                            op->after.box_after.x, op->after.box_after.y);
             break;
         }
 
         case OP_BOX_RESIZE: {
             /* Redo resize = apply new dimensions */
-            Box *box = canvas_get_box(canvas, op->box_id);
-            if (box) {
-                box->width = op->after.box_after.width;
-                box->height = op->after.box_after.height;
-            }
+            canvas_resize_box(canvas, op->box_id,
+                              op->after.box_after.width, op->after.box_after.height);
             break;
         }
 
@@ -500,6 +463,7 @@ bool canvas_redo(Canvas *canvas) {
             if (box) {
                 free(box->title);
                 box->title = safe_strdup(op->after.box_after.title);
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
@@ -508,10 +472,8 @@ bool canvas_redo(Canvas *canvas) {
             /* Redo content change = apply new content */
             Box *box = canvas_get_box(canvas, op->box_id);
             if (box) {
-                free_content(box->content, box->content_lines);
-                box->content = copy_content(op->after.box_after.content,
-                                            op->after.box_after.content_lines);
-                box->content_lines = op->after.box_after.content_lines;
+                box_content_share(box, op->after.box_after.content);
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
@@ -521,6 +483,7 @@ bool canvas_redo(Canvas *canvas) {
             Box *box = canvas_get_box(canvas, op->box_id);
             if (box) {
                 box->color = op->after.box_after.color;
+                canvas_mark_box_dirty(canvas, op->box_id);
             }
             break;
         }
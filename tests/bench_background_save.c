@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/saver.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: how long F2 keeps the main loop from editing.
+ * Same canvas as bench_canvas_format. "blocking" is canvas_save() on
+ * the main thread (now with its fsync and rename); "background" is
+ * saver_start(), i.e. the fork, with the child's total time alongside.
+ * Best of three. */
+
+#define SAVE_FILE "bench_background_save_temp.txt"
+#define RUNS 3
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    const int sizes[] = {10000, 100000, 1000000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const char *lines[] = {"first line", "second line"};
+
+    printf("=== F2 save: main loop stall ===\n");
+    printf("%8s %14s %16s %14s\n", "boxes", "blocking ms", "background ms", "child ms");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < sizes[s]; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.25, (i / 1000) * 10.5, 20, 5, "Box");
+            canvas_add_box_content(&canvas, id, lines, 2);
+            if (i > 0) {
+                canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+            }
+        }
+
+        double blocking = -1.0, background = -1.0, child = -1.0;
+        for (int run = 0; run < RUNS; run++) {
+            double start = now_sec();
+            canvas_save(&canvas, SAVE_FILE);
+            double elapsed = now_sec() - start;
+            if (blocking < 0.0 || elapsed < blocking) {
+                blocking = elapsed;
+            }
+
+            Saver saver;
+            saver_init(&saver);
+            start = now_sec();
+            saver_start(&saver, &canvas, SAVE_FILE, CANVAS_FORMAT_V1);
+            elapsed = now_sec() - start;
+            if (background < 0.0 || elapsed < background) {
+                background = elapsed;
+            }
+            saver_wait(&saver, &canvas);
+            elapsed = now_sec() - start;
+            if (child < 0.0 || elapsed < child) {
+                child = elapsed;
+            }
+            saver_cleanup(&saver, &canvas);
+        }
+        printf("%8d %14.2f %16.2f %14.2f\n", sizes[s], blocking * 1000.0,
+               background * 1000.0, child * 1000.0);
+
+        canvas_cleanup(&canvas);
+        unlink(SAVE_FILE);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/canvas.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: canvas_get_box() cost as the canvas grows.
+ * With the ID index the per-lookup time should stay flat from
+ * 100 to 1M boxes instead of growing linearly. */
+
+#define LOOKUPS 2000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    const int sizes[] = {100, 1000, 10000, 100000, 1000000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("=== Box lookup by ID ===\n");
+    printf("%10s %14s %12s\n", "boxes", "lookups", "ns/lookup");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 10000.0, 10000.0);
+
+        for (int i = 0; i < sizes[s]; i++) {
+            canvas_add_box(&canvas, (i % 1000) * 30.0, (i / 1000) * 10.0, 20, 5, NULL);
+        }
+
+        /* Pseudo-random IDs so the access pattern is not sequential */
+        unsigned int seed = 12345;
+        long found = 0;
+        double start = now_sec();
+        for (int i = 0; i < LOOKUPS; i++) {
+            seed = seed * 1103515245u + 12345u;
+            int id = 1 + (int)(seed % (unsigned int)sizes[s]);
+            if (canvas_get_box(&canvas, id) != NULL) {
+                found++;
+            }
+        }
+        double elapsed = now_sec() - start;
+
+        printf("%10d %14d %12.1f%s\n", sizes[s], LOOKUPS,
+               elapsed * 1e9 / LOOKUPS, found == LOOKUPS ? "" : "  (missing IDs!)");
+
+        canvas_cleanup(&canvas);
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: V1 text vs V2 binary canvas files.
+ * Same canvas as bench_canvas_load (title, two content lines and a
+ * connection per box, at fractional positions), saved and loaded in
+ * each format. Reports best-of-three save and load time and file size. */
+
+#define V1_FILE "bench_canvas_format_temp.txt"
+#define V2_FILE "bench_canvas_format_temp.canvas"
+#define RUNS 3
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long file_kb(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)(st.st_size / 1024) : -1;
+}
+
+static double time_save(const Canvas *canvas, const char *path, CanvasFormat format) {
+    double best = -1.0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now_sec();
+        if (canvas_save_format(canvas, path, format) != 0) {
+            return -1.0;
+        }
+        double elapsed = now_sec() - start;
+        if (best < 0.0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static double time_load(const char *path) {
+    double best = -1.0;
+    for (int run = 0; run < RUNS; run++) {
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        double start = now_sec();
+        int result = canvas_load(&loaded, path);
+        double elapsed = now_sec() - start;
+        canvas_cleanup(&loaded);
+        if (result != 0) {
+            return -1.0;
+        }
+        if (best < 0.0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(void) {
+    const int sizes[] = {1000, 10000, 100000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const char *lines[] = {"first line", "second line"};
+
+    printf("=== canvas save/load: V1 text vs V2 binary ===\n");
+    printf("%8s %6s %10s %10s %10s\n", "boxes", "format", "save ms", "load ms", "size KB");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < sizes[s]; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.25, (i / 1000) * 10.5, 20, 5, "Box");
+            canvas_add_box_content(&canvas, id, lines, 2);
+            if (i > 0) {
+                canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+            }
+        }
+
+        double save_v1 = time_save(&canvas, V1_FILE, CANVAS_FORMAT_V1);
+        double save_v2 = time_save(&canvas, V2_FILE, CANVAS_FORMAT_V2);
+        canvas_cleanup(&canvas);
+        double load_v1 = time_load(V1_FILE);
+        double load_v2 = time_load(V2_FILE);
+        if (save_v1 < 0.0 || save_v2 < 0.0 || load_v1 < 0.0 || load_v2 < 0.0) {
+            fprintf(stderr, "save or load failed at %d boxes\n", sizes[s]);
+            unlink(V1_FILE);
+            unlink(V2_FILE);
+            return 1;
+        }
+
+        printf("%8d %6s %10.2f %10.2f %10ld\n", sizes[s], "V1",
+               save_v1 * 1e3, load_v1 * 1e3, file_kb(V1_FILE));
+        printf("%8d %6s %10.2f %10.2f %10ld\n", sizes[s], "V2",
+               save_v2 * 1e3, load_v2 * 1e3, file_kb(V2_FILE));
+    }
+
+    unlink(V1_FILE);
+    unlink(V2_FILE);
+    return 0;
+}
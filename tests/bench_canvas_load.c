@@ -0,0 +1,60 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: canvas_load() cost per box.
+ * Each box carries a title and two content lines, and consecutive
+ * boxes are connected. Per-box time should stay flat up to 100k. */
+
+#define BENCH_FILE "bench_canvas_load_temp.txt"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    const int sizes[] = {1000, 10000, 100000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const char *lines[] = {"first line", "second line"};
+
+    printf("=== canvas_load() ===\n");
+    printf("%10s %12s %12s\n", "boxes", "load ms", "ns/box");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < sizes[s]; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.0, (i / 1000) * 10.0, 20, 5, "Box");
+            canvas_add_box_content(&canvas, id, lines, 2);
+            if (i > 0) {
+                canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+            }
+        }
+        canvas_save(&canvas, BENCH_FILE);
+        canvas_cleanup(&canvas);
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        double start = now_sec();
+        if (canvas_load(&loaded, BENCH_FILE) != 0) {
+            fprintf(stderr, "load failed at %d boxes\n", sizes[s]);
+            canvas_cleanup(&loaded);
+            unlink(BENCH_FILE);
+            return 1;
+        }
+        double elapsed = now_sec() - start;
+        canvas_cleanup(&loaded);
+
+        printf("%10d %12.2f %12.1f\n", sizes[s], elapsed * 1e3, elapsed / sizes[s] * 1e9);
+    }
+
+    unlink(BENCH_FILE);
+    return 0;
+}
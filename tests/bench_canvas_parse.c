@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: reading a text (V1) canvas file.
+ * Files are shaped like test-canvases/stress-test.txt (seven-field
+ * boxes, a quoted title and two content lines each), scaled up.
+ * Reports best-of-three times for:
+ *   stdio scan - the fgets/fscanf/sscanf calls the old loader made,
+ *                with the values thrown away (its parsing cost alone)
+ *   load       - canvas_load(), parsing and building the canvas
+ *   insert     - adding the same boxes and lines straight to a canvas,
+ *                the floor any loader pays */
+
+#define PARSE_FILE "bench_canvas_parse_temp.txt"
+#define RUNS 3
+#define LINE_MAX_LEN 1024
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int box_x(int i) { return 50 + (i % 1000) * 220; }
+static int box_y(int i) { return 50 + (i / 1000) * 150; }
+
+static int write_stress_file(int count) {
+    FILE *f = fopen(PARSE_FILE, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "BOXES_CANVAS_V1\n300000.00 250000.00\n%d\n", count);
+    for (int i = 0; i < count; i++) {
+        int color = 2 + i % 6;
+        fprintf(f, "%d %d.00 %d.00 20 8 0 %d\n\"Box %d\"\n2\nPosition: (%d, %d)\nColor: %d\n",
+                i + 1, box_x(i), box_y(i), color, i + 1, box_x(i), box_y(i), color);
+    }
+    return fclose(f);
+}
+
+/* The old loader's stdio calls, per box */
+static double stdio_scan(void) {
+    FILE *f = fopen(PARSE_FILE, "r");
+    if (f == NULL) {
+        return -1.0;
+    }
+    double start = now_sec();
+    char line[LINE_MAX_LEN];
+    double w, h, x, y;
+    int count, id, width, height, selected, color, lines;
+    if (fgets(line, sizeof(line), f) == NULL ||
+        fscanf(f, "%lf %lf\n", &w, &h) != 2 || fscanf(f, "%d\n", &count) != 1) {
+        fclose(f);
+        return -1.0;
+    }
+    for (int i = 0; i < count; i++) {
+        if (fgets(line, sizeof(line), f) == NULL ||
+            sscanf(line, "%d %lf %lf %d %d %d %d", &id, &x, &y, &width, &height,
+                   &selected, &color) != 7 ||
+            fgets(line, sizeof(line), f) == NULL ||
+            fscanf(f, "%d\n", &lines) != 1) {
+            fclose(f);
+            return -1.0;
+        }
+        for (int j = 0; j < lines; j++) {
+            if (fgets(line, sizeof(line), f) == NULL) {
+                fclose(f);
+                return -1.0;
+            }
+            line[strcspn(line, "\n")] = 0;
+        }
+    }
+    double elapsed = now_sec() - start;
+    fclose(f);
+    return elapsed;
+}
+
+static double load(void) {
+    Canvas canvas;
+    canvas_init(&canvas, 0.0, 0.0);
+    double start = now_sec();
+    int result = canvas_load(&canvas, PARSE_FILE);
+    double elapsed = now_sec() - start;
+    canvas_cleanup(&canvas);
+    return result == 0 ? elapsed : -1.0;
+}
+
+static double insert(int count) {
+    Canvas canvas;
+    canvas_init(&canvas, 300000.0, 250000.0);
+    double start = now_sec();
+    canvas_reserve(&canvas, count, 0);
+    for (int i = 0; i < count; i++) {
+        char title[32], position[64], color[32];
+        snprintf(title, sizeof(title), "\"Box %d\"", i + 1);
+        snprintf(position, sizeof(position), "Position: (%d, %d)", box_x(i), box_y(i));
+        snprintf(color, sizeof(color), "Color: %d", 2 + i % 6);
+        const char *lines[] = {position, color};
+        canvas_restore_box_with_id(&canvas, i + 1, box_x(i), box_y(i), 20, 8, title);
+        canvas_add_box_content(&canvas, i + 1, lines, 2);
+    }
+    double elapsed = now_sec() - start;
+    canvas_cleanup(&canvas);
+    return elapsed;
+}
+
+static double best_of(double (*fn)(void)) {
+    double best = -1.0;
+    for (int run = 0; run < RUNS; run++) {
+        double t = fn();
+        if (t < 0.0) {
+            return -1.0;
+        }
+        if (best < 0.0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+int main(void) {
+    const int sizes[] = {10000, 100000, 1000000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("=== V1 text canvas parsing ===\n");
+    printf("%8s %14s %10s %10s\n", "boxes", "stdio scan ms", "load ms", "insert ms");
+
+    for (int s = 0; s < num_sizes; s++) {
+        if (write_stress_file(sizes[s]) != 0) {
+            fprintf(stderr, "cannot write %s\n", PARSE_FILE);
+            return 1;
+        }
+        double scan = best_of(stdio_scan);
+        double loaded = best_of(load);
+        double inserted = -1.0;
+        for (int run = 0; run < RUNS; run++) {
+            double t = insert(sizes[s]);
+            if (inserted < 0.0 || t < inserted) {
+                inserted = t;
+            }
+        }
+        if (scan < 0.0 || loaded < 0.0) {
+            fprintf(stderr, "scan or load failed at %d boxes\n", sizes[s]);
+            unlink(PARSE_FILE);
+            return 1;
+        }
+        printf("%8d %14.2f %10.2f %10.2f\n", sizes[s], scan * 1e3, loaded * 1e3, inserted * 1e3);
+    }
+
+    unlink(PARSE_FILE);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/box_content.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: building, freeing and snapshotting a box's content.
+ * Compares the old layout (one malloc'd array plus a strdup per line)
+ * against the contiguous content buffer, and reports the buffer's
+ * overhead beyond the line text. Malloc's own per-block headers
+ * (typically 8-16 bytes per strdup) are not visible here and favour
+ * the buffer further. Finally streams output through a 1000-line
+ * rolling tail: rebuilding a growable buffer per line vs. a ring. */
+
+#define LINES 1000
+#define ROUNDS 2000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char **copy_strdup(char **lines, int count) {
+    char **content = malloc(sizeof(char *) * count);
+    for (int i = 0; i < count; i++) {
+        content[i] = strdup(lines[i]);
+    }
+    return content;
+}
+
+static void free_strdup(char **content, int count) {
+    for (int i = 0; i < count; i++) {
+        free(content[i]);
+    }
+    free(content);
+}
+
+static void build_strdup(char lines[][48], int count) {
+    char *views[LINES];
+    for (int i = 0; i < count; i++) {
+        views[i] = lines[i];
+    }
+    free_strdup(copy_strdup(views, count), count);
+}
+
+static void build_buffer(char lines[][48], int count) {
+    Box box;
+    memset(&box, 0, sizeof(box));
+    for (int i = 0; i < count; i++) {
+        box_content_append(&box, lines[i]);
+    }
+    box_content_clear(&box);
+}
+
+int main(void) {
+    static char lines[LINES][48];
+    size_t text = 0;
+    for (int i = 0; i < LINES; i++) {
+        snprintf(lines[i], sizeof(lines[i]), "drwxr-xr-x  2 user group 4096 file_%04d", i);
+        text += strlen(lines[i]);
+    }
+
+    printf("=== Build + free %d content lines ===\n", LINES);
+    printf("%20s %12s %14s\n", "layout", "us/build", "allocations");
+
+    double start = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        build_strdup(lines, LINES);
+    }
+    double before = (now_sec() - start) / ROUNDS;
+    printf("%20s %12.1f %14d\n", "strdup per line", before * 1e6, LINES + 1);
+
+    start = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        build_buffer(lines, LINES);
+    }
+    double after = (now_sec() - start) / ROUNDS;
+    printf("%20s %12.1f %14s\n", "content buffer", after * 1e6, "~25");
+
+    printf("\nLine text: %zu bytes in %d lines\n", text, LINES);
+    printf("%20s %14s %12s\n", "buffer", "overhead B", "B/line");
+
+    /* Grown line by line, as command output is */
+    Box box;
+    memset(&box, 0, sizeof(box));
+    for (int i = 0; i < LINES; i++) {
+        box_content_append(&box, lines[i]);
+    }
+    size_t overhead = content_buffer_overhead(box.content);
+    printf("%20s %14zu %12.1f\n", "grown", overhead, (double)overhead / LINES);
+    box_content_clear(&box);
+
+    /* Sized up front, as file and canvas loads are */
+    const char *views[LINES];
+    for (int i = 0; i < LINES; i++) {
+        views[i] = lines[i];
+    }
+    box_content_set(&box, views, LINES);
+    overhead = content_buffer_overhead(box.content);
+    printf("%20s %14zu %12.1f\n", "sized", overhead, (double)overhead / LINES);
+
+    /* Undo snapshot: deep copy of every line vs. a shared reference */
+    printf("\n=== Undo snapshot of %d lines ===\n", LINES);
+    printf("%20s %12s\n", "snapshot", "us/snapshot");
+
+    char **deep_src = copy_strdup((char **)views, LINES);
+    start = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        free_strdup(copy_strdup(deep_src, LINES), LINES);
+    }
+    before = (now_sec() - start) / ROUNDS;
+    printf("%20s %12.2f\n", "deep copy", before * 1e6);
+    free_strdup(deep_src, LINES);
+
+    start = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        content_buffer_release(content_buffer_retain(box.content));
+    }
+    after = (now_sec() - start) / ROUNDS;
+    printf("%20s %12.2f\n", "shared buffer", after * 1e6);
+
+    /* Worst case: the box writes while the snapshot still holds it */
+    start = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        ContentBuffer *snapshot = content_buffer_retain(box.content);
+        box_content_append(&box, "x");
+        content_buffer_release(snapshot);
+    }
+    after = (now_sec() - start) / ROUNDS;
+    printf("%20s %12.2f\n", "shared + first write", after * 1e6);
+    box_content_clear(&box);
+
+    /* Rolling tail of a stream (tail -f): keep the newest LINES lines */
+    printf("\n=== Rolling %d-line tail of a stream ===\n", LINES);
+    printf("%20s %10s %12s %14s\n", "tail", "lines", "ns/line", "bytes held");
+
+    const int rebuild_lines = 20000;
+    start = now_sec();
+    for (int i = 0; i < rebuild_lines; i++) {
+        if (box_content_count(&box) == LINES) {
+            /* Drop the oldest line by copying the rest into a new buffer */
+            const char *rest[LINES];
+            for (int j = 1; j < LINES; j++) {
+                rest[j - 1] = box_content_line(&box, j);
+            }
+            Box next;
+            memset(&next, 0, sizeof(next));
+            box_content_set(&next, rest, LINES - 1);
+            box_content_clear(&box);
+            box.content = next.content;
+        }
+        box_content_append(&box, lines[i % LINES]);
+    }
+    before = (now_sec() - start) / rebuild_lines;
+    printf("%20s %10d %12.1f %14zu\n", "rebuild per line", rebuild_lines, before * 1e9,
+           box.content->size + sizeof(size_t) * (size_t)box.content->capacity);
+    box_content_clear(&box);
+
+    const int ring_lines = 1000000;
+    ContentBuffer *ring = content_buffer_create_ring(LINES, 64 * 1024);
+    start = now_sec();
+    for (int i = 0; i < ring_lines; i++) {
+        content_buffer_append(ring, lines[i % LINES], strlen(lines[i % LINES]));
+    }
+    after = (now_sec() - start) / ring_lines;
+    printf("%20s %10d %12.1f %14zu\n", "ring buffer", ring_lines, after * 1e9,
+           ring->size + sizeof(size_t) * (size_t)ring->capacity);
+    printf("%20s %10lu dropped, %d kept\n", "", content_buffer_dropped(ring),
+           content_buffer_count(ring));
+    content_buffer_release(ring);
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "../include/canvas.h"
+#include "../include/control.h"
+#include "../include/persistence.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: what one small update to a running session costs.
+ * Same canvas as bench_canvas_format. "file" is a connector's round
+ * trip: the canvas file rewritten, then loaded again by the UI (best
+ * of three). "control" is "update ID append TEXT" sent over the
+ * control socket by another process, UPDATES of them, with the main
+ * loop's side timed from the first command to the last reply sent. */
+
+#define CONTROL_SOCKET "bench_control_temp.sock"
+#define CONTROL_FILE "bench_control_temp.txt"
+#define RUNS 3
+#define UPDATES 100000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Client: send the updates and read the replies */
+static void run_client(int boxes) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, CONTROL_SOCKET);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        _exit(1);
+    }
+    if (fork() == 0) {
+        char line[64];
+        for (int i = 0; i < UPDATES; i++) {
+            int len = snprintf(line, sizeof(line), "update %d append tick %d\n",
+                               1 + (i * 7919) % boxes, i);
+            if (write(fd, line, (size_t)len) != len) {
+                _exit(1);
+            }
+        }
+        shutdown(fd, SHUT_WR);
+        _exit(0);
+    }
+    char buf[65536];
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+    wait(NULL);
+    _exit(0);
+}
+
+int main(void) {
+    const int sizes[] = {10000, 100000, 1000000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const char *lines[] = {"first line", "second line"};
+
+    printf("=== One small update to a running session ===\n");
+    printf("%8s %14s %18s %16s\n", "boxes", "file ms", "control us", "updates/s");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < sizes[s]; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.25, (i / 1000) * 10.5, 20, 5, "Box");
+            canvas_add_box_content(&canvas, id, lines, 2);
+            if (i > 0) {
+                canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+            }
+        }
+
+        double file = -1.0;
+        for (int run = 0; run < RUNS; run++) {
+            double start = now_sec();
+            canvas_save(&canvas, CONTROL_FILE);
+            Canvas loaded;
+            loaded.boxes = NULL;
+            canvas_load(&loaded, CONTROL_FILE);
+            double elapsed = now_sec() - start;
+            canvas_cleanup(&loaded);
+            if (file < 0.0 || elapsed < file) {
+                file = elapsed;
+            }
+        }
+        unlink(CONTROL_FILE);
+
+        ControlServer server;
+        control_server_init(&server);
+        unlink(CONTROL_SOCKET);
+        if (control_server_listen(&server, CONTROL_SOCKET) != 0) {
+            perror("listen");
+            return 1;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_client(sizes[s]);
+        }
+        int applied = 0;
+        double start = -1.0;
+        while (applied < UPDATES || control_server_pending(&server)) {
+            int n = control_server_poll(&server, &canvas);
+            if (n > 0 && start < 0.0) {
+                start = now_sec();
+            }
+            applied += n;
+            if (n == 0) {
+                struct timespec pause = {0, 20000};
+                nanosleep(&pause, NULL);
+            }
+        }
+        double elapsed = now_sec() - start;
+        waitpid(pid, NULL, 0);
+        control_server_shutdown(&server);
+
+        printf("%8d %14.2f %18.2f %16.0f\n", sizes[s], file * 1000.0,
+               elapsed / UPDATES * 1e6, UPDATES / elapsed);
+        canvas_cleanup(&canvas);
+    }
+    return 0;
+}
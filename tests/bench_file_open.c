@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/box_content.h"
+#include "../include/canvas.h"
+#include "../include/file_map.h"
+#include "../include/file_viewer.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: opening a large log file in a box.
+ * Writes a 512 MB log (~100-byte lines) to a temporary file, then:
+ *   read in - every line read into a content buffer (the eager
+ *             loader, which small files still use)
+ *   mapped  - file_viewer_load() mapping the file; time to open, to
+ *             show the first screen and a screen from the middle, and
+ *             to finish indexing in main-loop slices
+ * Reports time and resident memory (VmRSS) for each step. */
+
+#define FILE_MB 512
+#define SCREEN 48
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Resident set size in KB */
+static long rss_kb(void) {
+    FILE *f = fopen("/proc/self/status", "r");
+    char line[256];
+    long kb = -1;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1) {
+            break;
+        }
+    }
+    if (f) fclose(f);
+    return kb;
+}
+
+static void report(const char *step, double start, int lines) {
+    printf("%22s %12.1f %12d %12.1f\n", step, (now_sec() - start) * 1000.0, lines,
+           rss_kb() / 1024.0);
+}
+
+static void show_screen(Box *box, int first) {
+    size_t bytes = 0;
+    for (int i = first; i < first + SCREEN; i++) {
+        bytes += box_content_line_length(box, i);
+    }
+    (void)bytes;
+}
+
+int main(void) {
+    char path[] = "/tmp/bench_file_open_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (f == NULL) {
+        perror("mkstemp");
+        return 1;
+    }
+    long target = (long)FILE_MB * 1024 * 1024;
+    long written = 0;
+    for (long i = 0; written < target; i++) {
+        written += fprintf(f, "2026-01-01T00:00:%02ld.%06ld host app[%ld]: request %ld "
+                           "served in %ld us status=200 bytes=%ld\n",
+                           i / 1000000 % 60, i % 1000000, i % 4096, i, i % 9973, i % 65536);
+    }
+    fclose(f);
+
+    Canvas canvas;
+    canvas_init(&canvas, 1000.0, 1000.0);
+    int id = canvas_add_box(&canvas, 0.0, 0.0, 80, SCREEN + 2, "log");
+    Box *box = canvas_get_box(&canvas, id);
+
+    printf("=== %d MB log file, %d-line screen ===\n", FILE_MB, SCREEN);
+    printf("%22s %12s %12s %12s\n", "step", "ms", "lines", "RSS MB");
+    report("baseline", now_sec(), 0);
+
+    double start = now_sec();
+    file_viewer_load(box, path);
+    report("mapped: open", start, box_content_count(box));
+
+    start = now_sec();
+    show_screen(box, 0);
+    report("mapped: first screen", start, box_content_count(box));
+
+    start = now_sec();
+    show_screen(box, 2500000);
+    report("mapped: jump to 2.5M", start, box_content_count(box));
+
+    start = now_sec();
+    while (file_viewer_indexing()) {
+        file_viewer_index_step(&canvas);
+    }
+    report("mapped: full index", start, box_content_count(box));
+    printf("%22s %12s %12s %12.1f\n", "mapped: heap", "", "",
+           file_map_heap_bytes(box->file_map) / (1024.0 * 1024.0));
+    box_content_clear(box);
+
+    /* The old loader without its size limit: every line into memory */
+    start = now_sec();
+    FILE *in = fopen(path, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while (in && (len = getline(&line, &cap, in)) != -1) {
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+        box_content_append(box, line);
+    }
+    free(line);
+    if (in) fclose(in);
+    report("read in", start, box_content_count(box));
+
+    canvas_cleanup(&canvas);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ncurses.h>
+#include "../include/canvas.h"
+#include "../include/render.h"
+#include "../include/viewport.h"
+#include "../include/config.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: terminal output and draw time per frame.
+ * Renders into an off-screen 160x48 xterm and measures how many bytes
+ * each kind of frame sends: an idle frame, a frame after one box moved,
+ * and a frame after the camera panned (which redraws everything).
+ * The last row is the old loop: clear() and a full repaint every frame. */
+
+#define FRAMES 200
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void draw(Canvas *canvas, Viewport *vp, const AppConfig *config) {
+    if (render_frame_begin(canvas, vp)) {
+        render_grid(canvas, vp);
+        render_connections(canvas, vp);
+        render_canvas(canvas, vp, config);
+        render_frame_overlays();
+        render_status(canvas, vp);
+        render_frame_end();
+    }
+}
+
+int main(void) {
+    FILE *out = tmpfile();
+    FILE *in = fopen("/dev/null", "r");
+    setenv("LINES", "48", 1);
+    setenv("COLUMNS", "160", 1);
+    SCREEN *screen = (out && in) ? newterm("xterm", out, in) : NULL;
+    if (screen == NULL) {
+        fprintf(stderr, "xterm terminfo not available\n");
+        return 1;
+    }
+    set_term(screen);
+
+    AppConfig config;
+    config_init_defaults(&config);
+    Viewport vp;
+    viewport_init(&vp);
+    getmaxyx(stdscr, vp.term_height, vp.term_width);
+
+    Canvas canvas;
+    canvas_init(&canvas, 1000.0, 1000.0);
+    canvas.grid.visible = true;
+    int first = -1;
+    for (int i = 0; i < 40; i++) {
+        int id = canvas_add_box(&canvas, (i % 8) * 20.0, (i / 8) * 9.0, 16, 6, "Box");
+        const char *lines[] = {"status: ok", "load 0.42"};
+        canvas_add_box_content(&canvas, id, lines, 2);
+        if (first < 0) first = id;
+        else if (i % 3 == 0) canvas_add_connection(&canvas, first, id);
+    }
+    draw(&canvas, &vp, &config);
+
+    const char *names[] = {"idle", "one box moved", "camera panned", "clear (before)"};
+    printf("=== Frame output at %dx%d, 40 boxes ===\n", vp.term_width, vp.term_height);
+    printf("%16s %14s %14s\n", "frame", "bytes/frame", "us/frame");
+
+    for (int kind = 0; kind < 4; kind++) {
+        fflush(out);
+        long start_bytes = ftell(out);
+        double start = now_sec();
+        for (int f = 0; f < FRAMES; f++) {
+            if (kind == 1) {
+                canvas_move_box(&canvas, first, (f % 2) ? 1.0 : 0.0, 0.0);
+            } else if (kind == 2) {
+                vp.cam_x = (f % 2) ? 1.0 : 0.0;
+            } else if (kind == 3) {
+                clear();
+                canvas_mark_all_dirty(&canvas);
+            }
+            draw(&canvas, &vp, &config);
+        }
+        double elapsed = (now_sec() - start) / FRAMES;
+        fflush(out);
+        long bytes = (ftell(out) - start_bytes) / FRAMES;
+        printf("%16s %14ld %14.1f\n", names[kind], bytes, elapsed * 1e6);
+    }
+
+    canvas_cleanup(&canvas);
+    endwin();
+    delscreen(screen);
+    fclose(out);
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <sys/resource.h>
+#include "../include/event_loop.h"
+
+/* Micro-benchmark: what an idle wait costs. A loop with nothing to
+ * do but one timer waits for it, as the main loop does between the
+ * joystick reconnect ticks. Reports how late the timer fired, the
+ * wake-ups it took and the CPU time used, for a few timer lengths. */
+
+#define RUNS 5
+
+static double cpu_seconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void count_fire(void *ctx) {
+    (*(int *)ctx)++;
+}
+
+int main(void) {
+    const double delays[] = {0.05, 0.2, 1.0};
+    const int num_delays = sizeof(delays) / sizeof(delays[0]);
+
+    printf("=== Idle wait for one timer (worst of %d) ===\n", RUNS);
+    printf("%8s %12s %10s %10s\n", "timer s", "late ms", "wake-ups", "CPU ms");
+
+    for (int d = 0; d < num_delays; d++) {
+        double late = 0.0, cpu = 0.0;
+        unsigned long wakeups = 0;
+        for (int run = 0; run < RUNS; run++) {
+            EventLoop loop;
+            event_loop_init(&loop, 60);
+            int fired = 0;
+            event_loop_add_timer(&loop, delays[d], 0.0, count_fire, &fired);
+
+            double cpu_start = cpu_seconds();
+            double start = event_loop_now();
+            while (!fired) {
+                event_loop_wait(&loop, -1.0);
+                event_loop_run_timers(&loop);
+            }
+            double run_late = event_loop_now() - start - delays[d];
+            double run_cpu = cpu_seconds() - cpu_start;
+            if (run_late > late) late = run_late;
+            if (run_cpu > cpu) cpu = run_cpu;
+            if (loop.wakeups > wakeups) wakeups = loop.wakeups;
+        }
+        printf("%8.2f %12.3f %10lu %10.3f\n", delays[d], late * 1000.0, wakeups, cpu * 1000.0);
+    }
+    return 0;
+}
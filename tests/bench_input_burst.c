@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ncurses.h>
+#include "../include/canvas.h"
+#include "../include/event_loop.h"
+#include "../include/input.h"
+#include "../include/render.h"
+#include "../include/viewport.h"
+#include "../include/config.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: input-to-display latency for a burst of input.
+ * Writes 200 keys (pans with a few zoom steps, as when text is pasted
+ * or a key auto-repeats) into the terminal in one go, then runs three
+ * main loops until the last key's effect is on screen:
+ *   fixed sleep  - one key, a full repaint, then sleep 16ms (the old loop)
+ *   key per pass - one key per pass, frames paced to 60 FPS
+ *   batched      - drain and coalesce everything queued, then one frame
+ * Reports the time from the burst to its final frame, frames drawn and
+ * bytes sent to the terminal. */
+
+#define BURST 200
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void draw(Canvas *canvas, Viewport *vp, const AppConfig *config) {
+    if (render_frame_begin(canvas, vp)) {
+        render_grid(canvas, vp);
+        render_connections(canvas, vp);
+        render_canvas(canvas, vp, config);
+        render_frame_overlays();
+        render_status(canvas, vp);
+        render_frame_end();
+    }
+}
+
+int main(void) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    FILE *out = tmpfile();
+    FILE *in = fdopen(fds[0], "r");
+    setenv("LINES", "48", 1);
+    setenv("COLUMNS", "160", 1);
+    SCREEN *screen = (out && in) ? newterm("xterm", out, in) : NULL;
+    if (screen == NULL) {
+        fprintf(stderr, "xterm terminfo not available\n");
+        return 1;
+    }
+    set_term(screen);
+    nodelay(stdscr, TRUE);
+    keypad(stdscr, TRUE);
+
+    AppConfig config;
+    config_init_defaults(&config);
+    JoystickState js;
+    memset(&js, 0, sizeof(js));
+    js.fd = -1;
+    js.mode = MODE_NAV;
+    js.selected_box_id = -1;
+
+    char keys[BURST + 1];
+    const char *pattern = "llllssssllllsssszlllllllllssssssx";
+    for (int i = 0; i < BURST; i++) {
+        keys[i] = pattern[i % strlen(pattern)];
+    }
+    keys[BURST] = '\0';
+
+    const char *names[] = {"fixed sleep", "key per pass", "batched"};
+    printf("=== %d-key burst at 160x48, 40 boxes ===\n", BURST);
+    printf("%14s %14s %10s %14s\n", "loop", "latency (ms)", "frames", "bytes");
+
+    for (int kind = 0; kind < 3; kind++) {
+        Viewport vp;
+        viewport_init(&vp);
+        getmaxyx(stdscr, vp.term_height, vp.term_width);
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        canvas.grid.visible = true;
+        for (int i = 0; i < 40; i++) {
+            canvas_add_box(&canvas, (i % 8) * 20.0, (i / 8) * 9.0, 16, 6, "Box");
+        }
+        render_frame_reset();
+        draw(&canvas, &vp, &config);
+
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        event_loop_add_fd(&loop, fds[0]);
+
+        fflush(out);
+        long start_bytes = ftell(out);
+        ssize_t written = write(fds[1], keys, BURST);
+        (void)written;
+        double start = now_sec();
+
+        int consumed = 0;
+        int frames = 0;
+        while (consumed < BURST || render_frame_pending(&canvas, &vp)) {
+            if (kind == 0) {
+                int ch = getch();
+                if (ch != ERR) {
+                    consumed++;
+                    handle_key(&canvas, &vp, &js, &config, ch);
+                }
+                clear();
+                canvas_mark_all_dirty(&canvas);
+                draw(&canvas, &vp, &config);
+                frames++;
+                struct timespec ts = {0, 16000000};
+                nanosleep(&ts, NULL);
+                continue;
+            }
+
+            int events = 0;
+            if (kind == 1) {
+                int ch = getch();
+                if (ch != ERR) {
+                    events = 1;
+                    handle_key(&canvas, &vp, &js, &config, ch);
+                }
+            } else {
+                handle_input_batch(&canvas, &vp, &js, &config, &events);
+            }
+            consumed += events;
+
+            bool pending = render_frame_pending(&canvas, &vp);
+            if (pending && event_loop_now() >= event_loop_next_frame(&loop)) {
+                draw(&canvas, &vp, &config);
+                event_loop_frame_drawn(&loop);
+                frames++;
+                pending = false;
+            }
+            if (events == 0 && (pending || consumed < BURST)) {
+                event_loop_wait(&loop, pending ? event_loop_next_frame(&loop) : -1.0);
+            }
+        }
+        double latency = now_sec() - start;
+        fflush(out);
+        printf("%14s %14.1f %10d %14ld\n", names[kind], latency * 1000.0, frames,
+               ftell(out) - start_bytes);
+
+        canvas_cleanup(&canvas);
+    }
+
+    endwin();
+    delscreen(screen);
+    fclose(out);
+    fclose(in);
+    close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/journal.h"
+#include "../include/persistence.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: saving after one edit, full rewrite vs journal.
+ * Same canvas as bench_canvas_format. Each save follows one box move;
+ * reports the mean time per save and the bytes it wrote. Journal saves
+ * include their fsync; full saves do not (canvas_save never syncs). */
+
+#define SAVE_FILE "bench_journal_save_temp.txt"
+#define SAVES 50
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+int main(void) {
+    const int sizes[] = {1000, 10000, 100000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const char *lines[] = {"first line", "second line"};
+
+    printf("=== save after one edit: full rewrite vs journal ===\n");
+    printf("%8s %8s %12s %14s\n", "boxes", "mode", "ms/save", "bytes/save");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < sizes[s]; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.25, (i / 1000) * 10.5, 20, 5, "Box");
+            canvas_add_box_content(&canvas, id, lines, 2);
+            if (i > 0) {
+                canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+            }
+        }
+
+        double start = now_sec();
+        for (int i = 0; i < SAVES; i++) {
+            canvas_move_box(&canvas, 1 + i, i * 3.5, 7.25);
+            canvas_save(&canvas, SAVE_FILE);
+        }
+        double full_ms = (now_sec() - start) * 1000.0 / SAVES;
+        printf("%8d %8s %12.3f %14ld\n", sizes[s], "full", full_ms, file_size(SAVE_FILE));
+
+        Journal journal;
+        journal_init(&journal);
+        journal_open(&journal, &canvas, SAVE_FILE, false);
+        long before = file_size(SAVE_FILE JOURNAL_SUFFIX);
+        start = now_sec();
+        for (int i = 0; i < SAVES; i++) {
+            canvas_move_box(&canvas, 1 + i, i * 3.5, 9.25);
+            journal_save(&journal, &canvas);
+        }
+        double journal_ms = (now_sec() - start) * 1000.0 / SAVES;
+        long written = file_size(SAVE_FILE JOURNAL_SUFFIX) - before;
+        printf("%8d %8s %12.3f %14ld\n", sizes[s], "journal", journal_ms, written / SAVES);
+        journal_close(&journal, &canvas);
+
+        canvas_cleanup(&canvas);
+        unlink(SAVE_FILE);
+        unlink(SAVE_FILE JOURNAL_SUFFIX);
+    }
+    return 0;
+}
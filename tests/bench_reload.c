@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/reloader.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: how long a SIGUSR1 reload keeps the main loop busy
+ * when a connector moved 10 boxes. Same canvas as bench_canvas_format.
+ * "swap" is the old way, canvas_load() on the main loop; "main loop"
+ * is the time spent in reloader_start() and reloader_poll(), i.e. the
+ * fork and applying the differences; "total" is until they are
+ * applied. Best of three. */
+
+#define RELOAD_FILE "bench_reload_temp.txt"
+#define RUNS 3
+#define MOVED 10
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void build(Canvas *canvas, int boxes) {
+    const char *lines[] = {"first line", "second line"};
+    canvas_init(canvas, 100000.0, 100000.0);
+    for (int i = 0; i < boxes; i++) {
+        int id = canvas_add_box(canvas, (i % 1000) * 40.25, (i / 1000) * 10.5, 20, 5, "Box");
+        canvas_add_box_content(canvas, id, lines, 2);
+        if (i > 0) {
+            canvas_restore_connection_with_id(canvas, i, id - 1, id, 0);
+        }
+    }
+}
+
+int main(void) {
+    const int sizes[] = {10000, 100000, 1000000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("=== SIGUSR1 reload, %d boxes changed ===\n", MOVED);
+    printf("%8s %12s %14s %12s %9s\n", "boxes", "swap ms", "main loop ms", "total ms", "records");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        build(&canvas, sizes[s]);
+        double swap = -1.0, main_loop = -1.0, total = -1.0;
+        int applied = 0;
+
+        for (int run = 0; run < RUNS; run++) {
+            /* The connector's version: a few boxes moved */
+            Canvas file;
+            build(&file, sizes[s]);
+            for (int i = 0; i < MOVED; i++) {
+                int id = 1 + (sizes[s] / MOVED) * i;
+                canvas_move_box(&file, id, -100.0 - run, -100.0 * i);
+            }
+            canvas_save(&file, RELOAD_FILE);
+            canvas_cleanup(&file);
+
+            Canvas loaded;
+            loaded.boxes = NULL;
+            double start = now_sec();
+            canvas_load(&loaded, RELOAD_FILE);
+            double elapsed = now_sec() - start;
+            if (swap < 0.0 || elapsed < swap) {
+                swap = elapsed;
+            }
+            canvas_cleanup(&loaded);
+
+            Reloader reloader;
+            reloader_init(&reloader);
+            start = now_sec();
+            int result = reloader_start(&reloader, &canvas, RELOAD_FILE);
+            double busy = now_sec() - start;
+            while (result > 0 && reloader_busy(&reloader)) {
+                struct timespec pause = {0, 100000};
+                nanosleep(&pause, NULL);
+                double poll_start = now_sec();
+                result = reloader_poll(&reloader, &canvas) != 0 ? 0 : 1;
+                busy += now_sec() - poll_start;
+            }
+            elapsed = now_sec() - start;
+            if (main_loop < 0.0 || busy < main_loop) {
+                main_loop = busy;
+            }
+            if (total < 0.0 || elapsed < total) {
+                total = elapsed;
+            }
+            applied = reloader.applied;
+            reloader_cleanup(&reloader);
+        }
+        printf("%8d %12.2f %14.2f %12.2f %9d\n", sizes[s], swap * 1000.0,
+               main_loop * 1000.0, total * 1000.0, applied);
+
+        canvas_cleanup(&canvas);
+        unlink(RELOAD_FILE);
+    }
+    return 0;
+}
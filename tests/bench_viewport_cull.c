@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/canvas.h"
+#include "../include/types.h"
+
+/* Micro-benchmark: per-frame viewport culling and hit-testing cost.
+ * Boxes are spread over a large world; an 80x24 viewport at zoom 1.0
+ * sees a handful of them. With the spatial index the per-frame cost
+ * should track the visible count, not the total.
+ *
+ * The second table compares a full linear cull pass (what zoomed-out
+ * views fall back to) over the Box records, as the renderer used to do,
+ * against canvas_scan_boxes() over the hot geometry table. */
+
+#define FRAMES 2000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The pre-split cull pass: walk every Box record and test its bounds */
+static int cull_box_records(const Canvas *canvas, double x0, double y0, double x1, double y1,
+                            int *out) {
+    int count = 0;
+    for (int i = 0; i < canvas->slot_count; i++) {
+        const Box *box = &canvas->boxes[i];
+        if (!canvas->box_slots[i].live) continue;
+        if (box->x + box->width >= x0 && box->x <= x1 &&
+            box->y + box->height >= y0 && box->y <= y1) {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+int main(void) {
+    const int sizes[] = {1000, 10000, 100000};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    printf("=== Viewport cull + hit-test per frame ===\n");
+    printf("%10s %10s %14s %14s\n", "boxes", "visible", "cull us/frame", "hit ns/query");
+
+    for (int s = 0; s < num_sizes; s++) {
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+
+        /* 40 world units apart horizontally, 10 vertically */
+        int per_row = 1000;
+        for (int i = 0; i < sizes[s]; i++) {
+            canvas_add_box(&canvas, (i % per_row) * 40.0, (i / per_row) * 10.0, 25, 6, NULL);
+        }
+
+        int *visible = NULL;
+        int capacity = 0;
+        int count = 0;
+        double start = now_sec();
+        for (int f = 0; f < FRAMES; f++) {
+            /* Pan across the world a little each frame */
+            double cam_x = (f % 500) * 40.0;
+            double cam_y = (f % 50) * 10.0;
+            count = canvas_query_boxes(&canvas, cam_x, cam_y, cam_x + 80.0, cam_y + 24.0,
+                                       &visible, &capacity);
+        }
+        double cull = (now_sec() - start) / FRAMES;
+
+        unsigned int seed = 42;
+        long hits = 0;
+        start = now_sec();
+        for (int q = 0; q < FRAMES * 100; q++) {
+            seed = seed * 1103515245u + 12345u;
+            double x = (seed % 40000u);
+            double y = ((seed >> 8) % 1000u);
+            if (canvas_find_box_at(&canvas, x, y) >= 0) hits++;
+        }
+        double hit = (now_sec() - start) / (FRAMES * 100);
+
+        printf("%10d %10d %14.2f %14.1f\n", sizes[s], count, cull * 1e6, hit * 1e9);
+
+        free(visible);
+        canvas_cleanup(&canvas);
+    }
+
+    printf("\n=== Linear cull pass at 100k boxes ===\n");
+    printf("%24s %12s %10s\n", "pass", "us/pass", "matched");
+    {
+        const int count = 100000;
+        const int passes = 200;
+        Canvas canvas;
+        canvas_init(&canvas, 100000.0, 100000.0);
+        for (int i = 0; i < count; i++) {
+            int id = canvas_add_box(&canvas, (i % 1000) * 40.0, (i / 1000) * 10.0, 25, 6, "Box");
+            const char *line = "content";
+            canvas_add_box_content(&canvas, id, &line, 1);
+        }
+
+        int *out = malloc(sizeof(int) * count);
+        int matched = 0;
+        double start = now_sec();
+        for (int p = 0; p < passes; p++) {
+            double cam_x = (p % 500) * 40.0;
+            matched = cull_box_records(&canvas, cam_x, 0.0, cam_x + 80.0, 24.0, out);
+        }
+        double before = (now_sec() - start) / passes;
+        printf("%24s %12.1f %10d\n", "Box records (before)", before * 1e6, matched);
+
+        int *visible = NULL;
+        int capacity = 0;
+        start = now_sec();
+        for (int p = 0; p < passes; p++) {
+            double cam_x = (p % 500) * 40.0;
+            matched = canvas_scan_boxes(&canvas, cam_x, 0.0, cam_x + 80.0, 24.0, &visible, &capacity);
+        }
+        double after = (now_sec() - start) / passes;
+        printf("%24s %12.1f %10d\n", "geometry table (after)", after * 1e6, matched);
+
+        free(visible);
+        free(out);
+        canvas_cleanup(&canvas);
+    }
+
+    return 0;
+}
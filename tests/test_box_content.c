@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "../include/box_content.h"
+#include "../include/canvas.h"
+#include "../include/undo.h"
+#include "../include/types.h"
+
+int main(void) {
+    TEST_START();
+
+    TEST("Buffer appends lines as terminated copies") {
+        ContentBuffer *buffer = content_buffer_create(0, 0);
+        ASSERT_NOT_NULL(buffer, "Buffer created");
+
+        char buf[] = "hello world";
+        int r1 = content_buffer_append(buffer, buf, 5);
+        int r2 = content_buffer_append(buffer, "", 0);
+        ASSERT(r1 == 0 && r2 == 0, "Appends succeed");
+        buf[0] = 'X';
+
+        ASSERT_EQ(content_buffer_count(buffer), 2, "Two lines stored");
+        ASSERT_STR_EQ(content_buffer_line(buffer, 0), "hello", "Line is a copy of the prefix");
+        ASSERT_STR_EQ(content_buffer_line(buffer, 1), "", "Empty line kept");
+        ASSERT_EQ((int)content_buffer_line_length(buffer, 0), 5, "Length of first line");
+        ASSERT_EQ((int)content_buffer_line_length(buffer, 1), 0, "Length of empty last line");
+        ASSERT_NULL(content_buffer_line(buffer, 2), "Out of range line is NULL");
+        ASSERT_NULL(content_buffer_line(buffer, -1), "Negative line is NULL");
+
+        content_buffer_release(buffer);
+    }
+
+    TEST("Growth keeps earlier lines intact") {
+        ContentBuffer *buffer = content_buffer_create(0, 0);
+
+        char line[32];
+        for (int i = 0; i < 5000; i++) {
+            snprintf(line, sizeof(line), "line %d", i);
+            content_buffer_append(buffer, line, strlen(line));
+        }
+
+        int bad = 0;
+        for (int i = 0; i < 5000; i++) {
+            snprintf(line, sizeof(line), "line %d", i);
+            if (strcmp(content_buffer_line(buffer, i), line) != 0) bad++;
+            if (content_buffer_line_length(buffer, i) != strlen(line)) bad++;
+        }
+        ASSERT_EQ(bad, 0, "Every line readable after many reallocations");
+
+        content_buffer_release(buffer);
+    }
+
+    TEST("Reset reuses blocks without reallocating") {
+        ContentBuffer *buffer = content_buffer_create(4, 64);
+        for (int i = 0; i < 4; i++) {
+            content_buffer_append(buffer, "0123456789", 10);
+        }
+        char *data = buffer->data;
+        size_t size = buffer->size;
+
+        content_buffer_reset(buffer);
+        ASSERT_EQ(content_buffer_count(buffer), 0, "Reset empties the buffer");
+        for (int i = 0; i < 4; i++) {
+            content_buffer_append(buffer, "abcdefghij", 10);
+        }
+        ASSERT(buffer->data == data, "Data block reused");
+        ASSERT_EQ((int)buffer->size, (int)size, "No growth on refill");
+        ASSERT_STR_EQ(content_buffer_line(buffer, 3), "abcdefghij", "Refilled content visible");
+
+        content_buffer_release(buffer);
+    }
+
+    TEST("Overhead is bounded for a sized buffer") {
+        ContentBuffer *buffer = content_buffer_create(1000, 1000 * 41);
+        char line[41];
+        memset(line, 'x', 40);
+        line[40] = '\0';
+        for (int i = 0; i < 1000; i++) {
+            content_buffer_append(buffer, line, 40);
+        }
+        size_t overhead = content_buffer_overhead(buffer);
+        ASSERT(overhead < 1000 * 16, "Overhead under 16 bytes per line");
+        ASSERT(content_buffer_overhead(NULL) == 0, "NULL buffer has no overhead");
+        content_buffer_release(buffer);
+    }
+
+    TEST("Find scans lines and reports the matching line") {
+        ContentBuffer *buffer = content_buffer_create(0, 0);
+        const char *lines[] = {"alpha", "beta gamma", "", "delta", "gamma ray"};
+        for (int i = 0; i < 5; i++) {
+            content_buffer_append(buffer, lines[i], strlen(lines[i]));
+        }
+
+        ASSERT_EQ(content_buffer_find(buffer, "gamma", 0), 1, "First match");
+        ASSERT_EQ(content_buffer_find(buffer, "gamma", 2), 4, "Search resumes from a line");
+        ASSERT_EQ(content_buffer_find(buffer, "alpha", 0), 0, "Match on first line");
+        ASSERT_EQ(content_buffer_find(buffer, "adelta", 0), -1, "No match across lines");
+        ASSERT_EQ(content_buffer_find(buffer, "zeta", 0), -1, "Missing needle");
+        ASSERT_EQ(content_buffer_find(buffer, "ray", 5), -1, "Start past the end");
+        ASSERT_EQ(content_buffer_find(NULL, "a", 0), -1, "NULL buffer");
+
+        content_buffer_release(buffer);
+    }
+
+    TEST("Ring buffer keeps the newest lines in fixed blocks") {
+        ContentBuffer *ring = content_buffer_create_ring(100, 1024);
+        char *data = ring->data;
+        size_t *offsets = ring->offsets;
+        char line[64];
+        bool appended = true;
+        for (int i = 0; i < 5000; i++) {
+            /* Varying lengths so lines wrap at every point of the block */
+            int len = snprintf(line, sizeof(line), "%d %.*s", i, i % 23, "abcdefghijklmnopqrstuvw");
+            appended = appended && content_buffer_append(ring, line, (size_t)len) == 0;
+        }
+        ASSERT(appended, "Append never fails");
+        ASSERT(ring->data == data && ring->offsets == offsets, "Blocks never reallocated");
+        ASSERT(ring->size == 1024 && ring->capacity == 100, "Size fixed");
+
+        int count = content_buffer_count(ring);
+        ASSERT(count > 0 && count <= 100, "At most the line limit kept");
+        ASSERT_EQ((int)content_buffer_dropped(ring) + count, 5000, "Every other line dropped");
+        bool in_order = true;
+        for (int i = 0; i < count; i++) {
+            int n = -1;
+            sscanf(content_buffer_line(ring, i), "%d", &n);
+            in_order = in_order && n == 5000 - count + i;
+            in_order = in_order && content_buffer_line_length(ring, i) ==
+                       strlen(content_buffer_line(ring, i));
+        }
+        ASSERT(in_order, "Newest lines, oldest first, with correct lengths");
+        ASSERT_EQ(content_buffer_find(ring, "4999", 0), count - 1, "Find works across the wrap");
+        ASSERT_EQ(content_buffer_find(ring, "4000 ", 0), -1, "Dropped lines are not found");
+
+        /* Line limit reached before the byte limit */
+        ContentBuffer *short_lines = content_buffer_create_ring(10, 4096);
+        for (int i = 0; i < 25; i++) {
+            snprintf(line, sizeof(line), "%d", i);
+            content_buffer_append(short_lines, line, strlen(line));
+        }
+        ASSERT_EQ(content_buffer_count(short_lines), 10, "Exactly the line limit kept");
+        ASSERT_STR_EQ(content_buffer_line(short_lines, 0), "15", "Oldest kept line");
+        ASSERT_STR_EQ(content_buffer_line(short_lines, 9), "24", "Newest line last");
+        content_buffer_release(short_lines);
+
+        /* A line longer than the whole ring is cut to fit */
+        char big[2048];
+        memset(big, 'x', sizeof(big));
+        content_buffer_append(ring, big, sizeof(big));
+        ASSERT_EQ(content_buffer_count(ring), 1, "Long line displaced everything");
+        ASSERT_EQ((int)content_buffer_line_length(ring, 0), 1023, "Cut to the block size");
+
+        content_buffer_reset(ring);
+        ASSERT_EQ(content_buffer_count(ring), 0, "Reset empties the ring");
+        content_buffer_release(ring);
+    }
+
+    TEST("Shared ring buffers stay rings when copied") {
+        Box box;
+        memset(&box, 0, sizeof(box));
+        ContentBuffer *ring = content_buffer_create_ring(3, 256);
+        box_content_share(&box, ring);
+        content_buffer_release(ring);
+        box_content_append(&box, "a");
+        box_content_append(&box, "b");
+
+        ContentBuffer *snapshot = content_buffer_retain(box.content);
+        box_content_append(&box, "c");
+        box_content_append(&box, "d");
+        ASSERT(box.content != snapshot, "Copied on write");
+        ASSERT_EQ(box_content_count(&box), 3, "Copy keeps the line limit");
+        ASSERT_STR_EQ(box_content_line(&box, 0), "b", "Oldest dropped from the copy");
+        ASSERT_EQ(content_buffer_count(snapshot), 2, "Snapshot untouched");
+
+        content_buffer_release(snapshot);
+        box_content_clear(&box);
+    }
+
+    TEST("Box content set, append, reset and clear") {
+        Canvas canvas;
+        canvas_init(&canvas, 100.0, 100.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "Box");
+        Box *box = canvas_get_box(&canvas, id);
+
+        const char *lines[] = {"one", "two"};
+        int result = box_content_set(box, lines, 2);
+        ASSERT_EQ(result, 0, "Set succeeds");
+        ASSERT_EQ(box_content_count(box), 2, "Two lines");
+        ASSERT_STR_EQ(box_content_line(box, 1), "two", "Second line visible");
+
+        result = box_content_append(box, "three");
+        ASSERT_EQ(result, 0, "Append succeeds");
+        ASSERT_EQ(box_content_count(box), 3, "Three lines");
+        ASSERT_STR_EQ(box_content_line(box, 2), "three", "Appended line visible");
+        ASSERT_EQ(box_content_find(box, "hre", 0), 2, "Find through the box");
+
+        box_content_reset(box);
+        ASSERT_EQ(box_content_count(box), 0, "Count zero after reset");
+        ASSERT_NOT_NULL(box->content, "Buffer kept after reset");
+
+        /* Replacing content twice must not leak the first copy */
+        canvas_add_box_content(&canvas, id, lines, 2);
+        result = canvas_add_box_content(&canvas, id, lines, 1);
+        ASSERT_EQ(result, 0, "Replace content");
+        ASSERT_EQ(box_content_count(box), 1, "Replaced content has one line");
+
+        box_content_clear(box);
+        ASSERT_NULL(box->content, "Clear frees the buffer");
+        ASSERT_EQ(box_content_count(box), 0, "Empty box has no lines");
+        ASSERT_NULL(box_content_line(box, 0), "Empty box has no first line");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Shared buffers are copied on write") {
+        Canvas canvas;
+        canvas_init(&canvas, 100.0, 100.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "Box");
+        Box *box = canvas_get_box(&canvas, id);
+
+        const char *lines[] = {"shared"};
+        box_content_set(box, lines, 1);
+        ContentBuffer *snapshot = content_buffer_retain(box->content);
+        ASSERT_EQ(snapshot->refs, 2, "Box and snapshot share one buffer");
+
+        box_content_append(box, "private");
+        ASSERT(box->content != snapshot, "Append gave the box its own copy");
+        ASSERT_EQ(content_buffer_count(snapshot), 1, "Snapshot unchanged by append");
+        ASSERT_EQ(box_content_count(box), 2, "Box sees both lines");
+        ASSERT_EQ(snapshot->refs, 1, "Snapshot now sole owner");
+
+        box_content_share(box, snapshot);
+        box_content_reset(box);
+        ASSERT_EQ(content_buffer_count(snapshot), 1, "Reset leaves a shared buffer alone");
+        ASSERT_EQ(box_content_count(box), 0, "Box is empty after reset");
+
+        content_buffer_release(snapshot);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Undoing a delete restores the shared content") {
+        Canvas canvas;
+        canvas_init(&canvas, 100.0, 100.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "Box");
+
+        const char *lines[] = {"kept", "across", "undo"};
+        canvas_add_box_content(&canvas, id, lines, 3);
+        ContentBuffer *original = canvas_get_box(&canvas, id)->content;
+
+        undo_record_box_delete(&canvas, id);
+        canvas_remove_box(&canvas, id);
+        canvas_undo(&canvas);
+
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_NOT_NULL(box, "Box restored");
+        ASSERT(box->content == original, "Snapshot shared the buffer instead of copying");
+        ASSERT_EQ(box_content_count(box), 3, "Line count restored");
+        ASSERT_STR_EQ(box_content_line(box, 2), "undo", "Text restored");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Snapshots of a live buffer keep the lines as they were") {
+        Canvas canvas;
+        canvas_init(&canvas, 100.0, 100.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "Box");
+
+        /* A buffer a command run fills in place while the box shows it */
+        ContentBuffer *output = content_buffer_create(0, 0);
+        content_buffer_set_live(output, true);
+        content_buffer_append(output, "before", 6);
+        box_content_share(canvas_get_box(&canvas, id), output);
+
+        undo_record_box_delete(&canvas, id);
+        content_buffer_append(output, "after", 5);
+        ASSERT_EQ(box_content_count(canvas_get_box(&canvas, id)), 2, "Box sees the new line");
+        canvas_remove_box(&canvas, id);
+        canvas_undo(&canvas);
+
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT(box->content != output, "Snapshot took a copy");
+        ASSERT_EQ(box_content_count(box), 1, "Snapshot unchanged by later output");
+
+        content_buffer_set_live(output, false);
+        ContentBuffer *frozen = content_buffer_freeze(output);
+        ASSERT(frozen == output, "A finished buffer is shared");
+
+        content_buffer_release(frozen);
+        content_buffer_release(output);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST_END();
+}
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "test.h"
 #include "../include/canvas.h"
+#include "../include/box_content.h"
 #include "../include/types.h"
 
 int main(void) {
@@ -57,10 +58,10 @@ int main(void) {
         ASSERT_EQ(result, 0, "Adding content succeeds");
 
         Box *box = canvas_get_box(&canvas, id);
-        ASSERT_EQ(box->content_lines, 3, "Content has 3 lines");
-        ASSERT_STR_EQ(box->content[0], "Line 1", "First line is correct");
-        ASSERT_STR_EQ(box->content[1], "Line 2", "Second line is correct");
-        ASSERT_STR_EQ(box->content[2], "Line 3", "Third line is correct");
+        ASSERT_EQ(box_content_count(box), 3, "Content has 3 lines");
+        ASSERT_STR_EQ(box_content_line(box, 0), "Line 1", "First line is correct");
+        ASSERT_STR_EQ(box_content_line(box, 1), "Line 2", "Second line is correct");
+        ASSERT_STR_EQ(box_content_line(box, 2), "Line 3", "Third line is correct");
 
         canvas_cleanup(&canvas);
     }
@@ -189,6 +190,146 @@ int main(void) {
         canvas_cleanup(&canvas);
     }
 
+    TEST("Box pointers and handles survive unrelated removals") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int id1 = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "One");
+        int id2 = canvas_add_box(&canvas, 20.0, 0.0, 10, 4, "Two");
+        int id3 = canvas_add_box(&canvas, 40.0, 0.0, 10, 4, "Three");
+
+        Box *three = canvas_get_box(&canvas, id3);
+        BoxHandle h1 = canvas_box_handle(&canvas, id1);
+        BoxHandle h3 = canvas_box_handle(&canvas, id3);
+
+        canvas_remove_box(&canvas, id1);
+        ASSERT(canvas_get_box(&canvas, id3) == three, "Box pointer unchanged after removing another box");
+        ASSERT_STR_EQ(three->title, "Three", "Pointer still refers to the same box");
+        ASSERT_NULL(canvas_handle_box(&canvas, h1), "Handle to removed box is stale");
+        ASSERT(canvas_handle_box(&canvas, h3) == three, "Handle to surviving box resolves");
+
+        /* The freed slot is reused, but the old handle stays stale */
+        int id4 = canvas_add_box(&canvas, 60.0, 0.0, 10, 4, "Four");
+        BoxHandle h4 = canvas_box_handle(&canvas, id4);
+        ASSERT_EQ(h4.slot, h1.slot, "Freed slot is reused");
+        ASSERT_NULL(canvas_handle_box(&canvas, h1), "Reused slot does not revive old handle");
+        ASSERT(canvas_handle_box(&canvas, h4) == canvas_get_box(&canvas, id4), "New handle resolves");
+        ASSERT_EQ(canvas.box_count, 3, "Three live boxes");
+        ASSERT_EQ(canvas.slot_count, 3, "No new slot needed");
+
+        (void)id2;
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Draw order is creation order and matches hit-testing") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        /* Three boxes stacked on the same spot */
+        int a = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "A");
+        int b = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "B");
+        int c = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "C");
+
+        canvas_remove_box(&canvas, a);
+        /* Reuses A's slot but is placed on top */
+        int d = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "D");
+
+        int order[4];
+        int n = 0;
+        for (int i = canvas_draw_first(&canvas); i >= 0 && n < 4; i = canvas_draw_next(&canvas, i)) {
+            order[n++] = canvas.boxes[i].id;
+        }
+        ASSERT_EQ(n, 3, "Three boxes in draw order");
+        ASSERT(order[0] == b && order[1] == c && order[2] == d, "Order is B, C, D");
+        ASSERT_EQ(canvas_find_box_at(&canvas, 5.0, 2.0), d, "Topmost hit is last drawn");
+
+        int *slots = NULL;
+        int capacity = 0;
+        int count = canvas_query_boxes(&canvas, 0.0, 0.0, 10.0, 4.0, &slots, &capacity);
+        ASSERT_EQ(count, 3, "Query finds all three");
+        if (count == 3) {
+            ASSERT_EQ(canvas.boxes[slots[0]].id, b, "Query starts at bottom");
+            ASSERT_EQ(canvas.boxes[slots[2]].id, d, "Query ends at top");
+        }
+        free(slots);
+
+        canvas_remove_box(&canvas, d);
+        ASSERT_EQ(canvas_find_box_at(&canvas, 5.0, 2.0), c, "Next box down becomes topmost");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Pruning many boxes keeps storage compact") {
+        Canvas canvas;
+        canvas_init(&canvas, 10000.0, 10000.0);
+
+        for (int i = 0; i < 20000; i++) {
+            canvas_add_box(&canvas, (i % 200) * 20.0, (i / 200) * 10.0, 10, 4, NULL);
+        }
+        /* Drop the oldest half, as a log canvas would */
+        for (int id = 1; id <= 10000; id++) {
+            canvas_remove_box(&canvas, id);
+        }
+        ASSERT_EQ(canvas.box_count, 10000, "Half the boxes remain");
+
+        for (int i = 0; i < 10000; i++) {
+            canvas_add_box(&canvas, 0.0, 0.0, 10, 4, NULL);
+        }
+        ASSERT_EQ(canvas.slot_count, 20000, "New boxes refill freed slots");
+
+        int walked = 0;
+        for (int i = canvas_draw_first(&canvas); i >= 0; i = canvas_draw_next(&canvas, i)) {
+            walked++;
+        }
+        ASSERT_EQ(walked, 20000, "Draw order visits every live box");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Box ID index stays in sync with box array") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int ids[200];
+        for (int i = 0; i < 200; i++) {
+            ids[i] = canvas_add_box(&canvas, i * 5.0, 0.0, 10, 4, "Box");
+        }
+
+        /* Remove every third box; survivors keep their slots */
+        for (int i = 0; i < 200; i += 3) {
+            canvas_remove_box(&canvas, ids[i]);
+        }
+
+        int mismatches = 0;
+        for (int i = 0; i < 200; i++) {
+            Box *box = canvas_get_box(&canvas, ids[i]);
+            if (i % 3 == 0) {
+                if (box != NULL) mismatches++;
+            } else if (box == NULL || box->id != ids[i]) {
+                mismatches++;
+            }
+        }
+        ASSERT_EQ(mismatches, 0, "Every ID resolves to its own box after removals");
+
+        /* Restore a removed ID and look it up again */
+        int restored = canvas_restore_box_with_id(&canvas, ids[0], 1.0, 2.0, 10, 4, "Back");
+        ASSERT_EQ(restored, ids[0], "Restore reuses the original ID");
+        Box *box = canvas_get_box(&canvas, ids[0]);
+        ASSERT_NOT_NULL(box, "Restored box is found by ID");
+        if (box) {
+            ASSERT_STR_EQ(box->title, "Back", "Restored box is the new one");
+        }
+
+        /* Selection resolves through the index too */
+        canvas_select_box(&canvas, ids[199]);
+        Box *selected = canvas_get_selected(&canvas);
+        ASSERT(selected != NULL && selected->id == ids[199], "Select by ID finds the right box");
+
+        ASSERT_EQ(canvas_remove_box(&canvas, 9999), -1, "Removing unknown ID fails");
+
+        canvas_cleanup(&canvas);
+    }
+
     /* Proportional sizing tests (Issue #18) */
 
     TEST("Proportional sizing - No boxes returns defaults") {
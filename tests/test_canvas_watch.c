@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/canvas_watch.h"
+#include "../include/persistence.h"
+
+#define WATCH_FILE "test_canvas_watch_temp.txt"
+#define WATCH_TMP "test_canvas_watch_temp.txt.new"
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+int main(void) {
+    TEST_START();
+
+    write_file(WATCH_FILE, "old\n");
+
+    TEST("A complete write reloads once it has been quiet") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        ASSERT_EQ(canvas_watch_start(&watch, WATCH_FILE), 0, "Watching");
+        ASSERT(canvas_watch_fd(&watch) >= 0, "Has a descriptor");
+        ASSERT_EQ(canvas_watch_next_deadline(&watch), -1.0, "Nothing pending");
+
+        write_file(WATCH_FILE, "new\n");
+        ASSERT(canvas_watch_read_events(&watch, 10.0) > 0, "Write seen");
+        ASSERT(!canvas_watch_due(&watch, 10.05), "Not yet quiet");
+        ASSERT_NEAR(canvas_watch_next_deadline(&watch), 10.0 + CANVAS_WATCH_QUIET, 0.0001, "Deadline");
+        ASSERT(canvas_watch_due(&watch, 10.0 + CANVAS_WATCH_QUIET), "Due once quiet");
+        ASSERT(!canvas_watch_due(&watch, 20.0), "Only once");
+
+        canvas_watch_stop(&watch);
+        ASSERT_EQ(canvas_watch_fd(&watch), -1, "Stopped");
+    }
+
+    TEST("Other files in the directory are ignored") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        canvas_watch_start(&watch, WATCH_FILE);
+        write_file(WATCH_TMP, "other\n");
+        ASSERT_EQ(canvas_watch_read_events(&watch, 1.0), 0, "Not ours");
+        ASSERT(!canvas_watch_due(&watch, 5.0), "No reload");
+        canvas_watch_stop(&watch);
+        unlink(WATCH_TMP);
+    }
+
+    TEST("A file renamed into place reloads") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        canvas_watch_start(&watch, WATCH_FILE);
+        write_file(WATCH_TMP, "renamed\n");
+        canvas_watch_read_events(&watch, 1.0);
+        rename(WATCH_TMP, WATCH_FILE);
+        ASSERT(canvas_watch_read_events(&watch, 1.0) > 0, "Rename seen");
+        ASSERT(canvas_watch_due(&watch, 2.0), "Due");
+        canvas_watch_stop(&watch);
+    }
+
+    TEST("A write still under way holds the reload back") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        canvas_watch_start(&watch, WATCH_FILE);
+        int fd = open(WATCH_FILE, O_WRONLY | O_TRUNC);
+        ASSERT(write(fd, "part", 4) == 4, "Wrote part");
+        canvas_watch_read_events(&watch, 1.0);
+        ASSERT(!canvas_watch_due(&watch, 5.0), "Not while open");
+        ASSERT_EQ(canvas_watch_next_deadline(&watch), -1.0, "No deadline");
+        close(fd);
+        canvas_watch_read_events(&watch, 6.0);
+        ASSERT(canvas_watch_due(&watch, 6.0 + CANVAS_WATCH_QUIET), "Due once closed");
+        canvas_watch_stop(&watch);
+    }
+
+    TEST("A stream of writes reloads at a bounded rate") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        canvas_watch_start(&watch, WATCH_FILE);
+        int reloads = 0;
+        /* A write every 10 ms for 2 seconds */
+        for (int i = 0; i < 200; i++) {
+            double now = i * 0.01;
+            write_file(WATCH_FILE, "tick\n");
+            canvas_watch_read_events(&watch, now);
+            if (canvas_watch_due(&watch, now)) {
+                reloads++;
+            }
+        }
+        ASSERT(reloads >= 2 && reloads <= (int)(2.0 / CANVAS_WATCH_MAX_DELAY) + 1, "Bounded");
+        canvas_watch_stop(&watch);
+    }
+
+    TEST("The file as this process saved it is not reloaded") {
+        CanvasWatch watch;
+        canvas_watch_init(&watch);
+        canvas_watch_start(&watch, WATCH_FILE);
+        Canvas canvas;
+        canvas_init(&canvas, 100.0, 100.0);
+        canvas_add_box(&canvas, 0.0, 0.0, 10, 5, "Box");
+        unsigned int saves = persistence_save_count();
+        canvas_save(&canvas, WATCH_FILE);
+        ASSERT(persistence_save_count() != saves, "Save counted");
+        canvas_watch_ignore_current(&watch);
+        ASSERT(canvas_watch_read_events(&watch, 1.0) > 0, "Save seen");
+        ASSERT(!canvas_watch_due(&watch, 5.0), "Own save skipped");
+
+        /* Someone else's write after it still counts */
+        write_file(WATCH_FILE, "theirs\n");
+        canvas_watch_read_events(&watch, 6.0);
+        ASSERT(canvas_watch_due(&watch, 7.0), "Their write reloads");
+
+        canvas_cleanup(&canvas);
+        canvas_watch_stop(&watch);
+    }
+
+    unlink(WATCH_FILE);
+    TEST_END();
+}
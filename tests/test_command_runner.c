@@ -2,10 +2,45 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "test.h"
 #include "../include/canvas.h"
+#include "../include/box_content.h"
 #include "../include/command_runner.h"
 
+#define SHARED_LOG "test_command_shared.tmp"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void nap(void) {
+    struct timespec ts = {0, 5000000};
+    nanosleep(&ts, NULL);
+}
+
+/* Poll the runner like the main loop until the box's run ends (or timeout) */
+static bool wait_done(CommandRunner *runner, Canvas *canvas, int box_id, double timeout) {
+    double end = now_sec() + timeout;
+    while (now_sec() < end) {
+        command_runner_poll(runner, canvas);
+        if (!command_runner_busy(runner, box_id)) {
+            return true;
+        }
+        nap();
+    }
+    return false;
+}
+
+/* Add a command box */
+static int command_box(Canvas *canvas, const char *command) {
+    int id = canvas_add_box(canvas, 10.0, 20.0, 30, 10, "Cmd");
+    command_runner_set_command(canvas_get_box(canvas, id), command);
+    return id;
+}
+
 int main(void) {
     TEST_START();
 
@@ -53,11 +88,11 @@ int main(void) {
 
         ASSERT_EQ(exit_code, 0, "Echo should exit with 0");
         ASSERT_EQ(box->content_type, BOX_CONTENT_COMMAND, "Content type is COMMAND");
-        ASSERT(box->content_lines > 0, "Should have output lines");
+        ASSERT(box_content_count(box) > 0, "Should have output lines");
 
         /* First line should contain "hello" (may have trailing space on Windows) */
-        if (box->content && box->content_lines > 0) {
-            ASSERT(strstr(box->content[0], "hello") != NULL, "First line contains hello");
+        if (box->content && box_content_count(box) > 0) {
+            ASSERT(strstr(box_content_line(box, 0), "hello") != NULL, "First line contains hello");
         }
 
         canvas_cleanup(&canvas);
@@ -110,11 +145,11 @@ int main(void) {
         command_runner_set_command(box, "echo hello");
         command_runner_execute(box);
 
-        ASSERT(box->content_lines > 0, "Has output before clear");
+        ASSERT(box_content_count(box) > 0, "Has output before clear");
 
         command_runner_clear(box);
 
-        ASSERT_EQ(box->content_lines, 0, "No content after clear");
+        ASSERT_EQ(box_content_count(box), 0, "No content after clear");
         ASSERT_NULL(box->content, "Content is NULL after clear");
         /* Command should still be set */
         ASSERT_NOT_NULL(box->command, "Command preserved after clear");
@@ -173,16 +208,16 @@ int main(void) {
         /* First run */
         command_runner_set_command(box, "echo first");
         command_runner_execute(box);
-        int first_lines = box->content_lines;
+        int first_lines = box_content_count(box);
         ASSERT(first_lines > 0, "First run has output");
 
         /* Second run - should replace content */
         command_runner_execute(box);
-        ASSERT(box->content_lines > 0, "Second run has output");
+        ASSERT(box_content_count(box) > 0, "Second run has output");
 
         /* Check first line contains "first" (command unchanged, may have trailing space) */
-        if (box->content && box->content_lines > 0) {
-            ASSERT(strstr(box->content[0], "first") != NULL, "Re-run output contains first");
+        if (box->content && box_content_count(box) > 0) {
+            ASSERT(strstr(box_content_line(box, 0), "first") != NULL, "Re-run output contains first");
         }
 
         canvas_cleanup(&canvas);
@@ -204,10 +239,366 @@ int main(void) {
         command_runner_execute(box);
 
         /* Should have at least 3 output lines plus exit code line */
-        ASSERT(box->content_lines >= 3, "Should have multiple output lines");
+        ASSERT(box_content_count(box) >= 3, "Should have multiple output lines");
+
+        canvas_cleanup(&canvas);
+    }
+
+#ifndef _WIN32
+    TEST("Async - output, exit code and state") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int id = command_box(&canvas, "printf 'alpha\\nbeta\\npartial'; echo oops >&2; exit 3");
+        ASSERT_EQ(command_runner_start(&runner, &canvas, id), 0, "Started");
+        ASSERT_EQ(canvas_get_box(&canvas, id)->command_state, COMMAND_RUNNING, "Running");
+        ASSERT(wait_done(&runner, &canvas, id, 5.0), "Finished");
+
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_EQ(box->command_state, COMMAND_EXITED, "Exited");
+        ASSERT_EQ(box->command_exit, 3, "Exit status kept");
+        ASSERT_EQ(command_runner_get_exit_code(box), 3, "Exit line written");
+        ASSERT_STR_EQ(box_content_line(box, 0), "alpha", "First line");
+        ASSERT_STR_EQ(box_content_line(box, 1), "beta", "Second line");
+        ASSERT(box_content_find(box, "partial", 0) >= 0, "Unterminated line kept");
+        ASSERT(box_content_find(box, "oops", 0) >= 0, "stderr captured");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Async - output streams in while the command runs") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int id = command_box(&canvas, "echo first; sleep 0.5; echo second");
+        double start = now_sec();
+        command_runner_start(&runner, &canvas, id);
+        ASSERT(now_sec() - start < 0.1, "Start does not wait for the command");
+
+        bool streamed = false;
+        while (now_sec() - start < 2.0 && command_runner_busy(&runner, id)) {
+            command_runner_poll(&runner, &canvas);
+            Box *box = canvas_get_box(&canvas, id);
+            if (box_content_count(box) == 1 && box->command_state == COMMAND_RUNNING) {
+                streamed = strcmp(box_content_line(box, 0), "first") == 0;
+                break;
+            }
+            nap();
+        }
+        ASSERT(streamed, "First line shown before the command exits");
+        ASSERT(wait_done(&runner, &canvas, id, 5.0), "Finished");
+        ASSERT(box_content_find(canvas_get_box(&canvas, id), "second", 0) >= 0, "Rest arrives");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Async - cancel and timeout stop the command") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 0.3);
+
+        int cancelled = command_box(&canvas, "sleep 10");
+        int slow = command_box(&canvas, "sleep 10 | cat");
+        command_runner_start(&runner, &canvas, cancelled);
+        command_runner_start(&runner, &canvas, slow);
+        ASSERT_EQ(command_runner_cancel(&runner, &canvas, cancelled), 0, "Cancel accepted");
+
+        double start = now_sec();
+        ASSERT(wait_done(&runner, &canvas, cancelled, 3.0), "Cancelled run ends");
+        ASSERT(wait_done(&runner, &canvas, slow, 3.0), "Timed out run ends");
+        ASSERT(now_sec() - start < 2.0, "Both stopped well before the command would finish");
+
+        Box *box = canvas_get_box(&canvas, cancelled);
+        ASSERT_EQ(box->command_state, COMMAND_CANCELLED, "Marked cancelled");
+        ASSERT(box_content_find(box, "[Cancelled]", 0) >= 0, "Cancel noted in output");
+        ASSERT_EQ(command_runner_get_exit_code(box), -1, "No exit status");
+
+        box = canvas_get_box(&canvas, slow);
+        ASSERT_EQ(box->command_state, COMMAND_TIMED_OUT, "Marked timed out");
+        ASSERT_EQ(command_runner_running(&runner), 0, "Whole pipeline reaped");
+        ASSERT_EQ(command_runner_cancel(&runner, &canvas, slow), -1, "Nothing left to cancel");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Async - concurrency cap queues extra runs") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 2, 10.0);
+
+        int ids[4];
+        for (int i = 0; i < 4; i++) {
+            char command[64];
+            snprintf(command, sizeof(command), "sleep 0.1; echo done %d", i);
+            ids[i] = command_box(&canvas, command);
+            command_runner_start(&runner, &canvas, ids[i]);
+        }
+        ASSERT_EQ(command_runner_running(&runner), 2, "Only two children at once");
+        ASSERT_EQ(canvas_get_box(&canvas, ids[3])->command_state, COMMAND_QUEUED, "Extra run queued");
+
+        bool over_cap = false;
+        double end = now_sec() + 5.0;
+        while (now_sec() < end && (command_runner_busy(&runner, ids[2]) ||
+                                   command_runner_busy(&runner, ids[3]))) {
+            command_runner_poll(&runner, &canvas);
+            over_cap = over_cap || command_runner_running(&runner) > 2;
+            nap();
+        }
+        ASSERT(!over_cap, "Cap held while the queue drained");
+        int exited = 0;
+        for (int i = 0; i < 4; i++) {
+            wait_done(&runner, &canvas, ids[i], 2.0);
+            exited += canvas_get_box(&canvas, ids[i])->command_state == COMMAND_EXITED;
+        }
+        ASSERT_EQ(exited, 4, "Every queued run completed");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Async - re-run replaces a run in flight, deleted boxes are safe") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int id = command_box(&canvas, "sleep 5; echo old");
+        command_runner_start(&runner, &canvas, id);
+        command_runner_set_command(canvas_get_box(&canvas, id), "echo new");
+        command_runner_start(&runner, &canvas, id);
+        ASSERT(wait_done(&runner, &canvas, id, 3.0), "New run finished");
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_STR_EQ(box_content_line(box, 0), "new", "Only the new run's output");
+
+        int doomed = command_box(&canvas, "sleep 5");
+        command_runner_start(&runner, &canvas, doomed);
+        canvas_remove_box(&canvas, doomed);
+
+        double end = now_sec() + 3.0;
+        while (now_sec() < end && command_runner_running(&runner) > 0) {
+            command_runner_poll(&runner, &canvas);
+            nap();
+        }
+        ASSERT_EQ(command_runner_running(&runner), 0, "Old and orphaned runs stopped");
 
+        command_runner_shutdown(&runner);
         canvas_cleanup(&canvas);
     }
 
+    TEST("Shared - boxes running the same command share one run") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+        remove(SHARED_LOG);
+
+        const char *command = "echo run >> " SHARED_LOG "; sleep 0.2; echo shared";
+        int ids[3];
+        for (int i = 0; i < 3; i++) {
+            ids[i] = command_box(&canvas, command);
+            command_runner_start(&runner, &canvas, ids[i]);
+        }
+        int other = command_box(&canvas, "sleep 0.2; echo other");
+        command_runner_start(&runner, &canvas, other);
+        ASSERT_EQ(command_runner_running(&runner), 2, "One child per distinct command");
+        ASSERT_EQ(canvas_get_box(&canvas, ids[2])->command_state, COMMAND_RUNNING,
+                  "Joined box shows the run");
+
+        ASSERT_EQ(command_runner_cancel(&runner, &canvas, ids[2]), 0, "One box cancelled");
+        ASSERT_EQ(canvas_get_box(&canvas, ids[2])->command_state, COMMAND_CANCELLED,
+                  "Cancelled at once");
+        ASSERT(canvas_get_box(&canvas, ids[2])->content != canvas_get_box(&canvas, ids[0])->content,
+               "Cancelled box no longer shares the run's output");
+        ASSERT_EQ(command_runner_running(&runner), 2, "Run carries on for the others");
+
+        ASSERT(wait_done(&runner, &canvas, ids[0], 3.0), "Finished");
+        Box *first = canvas_get_box(&canvas, ids[0]);
+        Box *second = canvas_get_box(&canvas, ids[1]);
+        ASSERT(first->content != NULL && first->content == second->content, "One copy of the output");
+        ASSERT_STR_EQ(box_content_line(second, 0), "shared", "Output shown in every box");
+        ASSERT_EQ(second->command_state, COMMAND_EXITED, "Every box finished");
+        ASSERT(box_content_find(canvas_get_box(&canvas, ids[2]), "shared", 0) < 0,
+               "Cancelled box keeps its own copy");
+
+        FILE *f = fopen(SHARED_LOG, "r");
+        int runs = 0;
+        char line[16];
+        while (f && fgets(line, sizeof(line), f)) {
+            runs++;
+        }
+        if (f) fclose(f);
+        ASSERT_EQ(runs, 1, "Command forked once");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+        remove(SHARED_LOG);
+    }
+
+    TEST("Shared - refreshes reuse a fresh result instead of forking") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int ids[3];
+        for (int i = 0; i < 3; i++) {
+            ids[i] = command_box(&canvas, "echo status");
+            canvas_get_box(&canvas, ids[i])->refresh_interval = 10;
+        }
+        command_runner_schedule_canvas(&runner, &canvas);
+        for (int i = 0; i < runner.refresh_count; i++) {
+            runner.refresh[i].due = runner.refresh[i].box_id == ids[0] ? 0.0 : now_sec() + 60.0;
+        }
+        command_runner_poll(&runner, &canvas);
+        ASSERT(wait_done(&runner, &canvas, ids[0], 3.0), "First refresh ran");
+
+        for (int i = 0; i < runner.refresh_count; i++) {
+            runner.refresh[i].due = runner.refresh[i].box_id == ids[1] ? 0.0 : now_sec() + 60.0;
+        }
+        command_runner_poll(&runner, &canvas);
+        ASSERT(!command_runner_busy(&runner, ids[1]), "No run needed");
+        ASSERT(canvas_get_box(&canvas, ids[1])->content == canvas_get_box(&canvas, ids[0])->content,
+               "Result shared");
+        ASSERT_EQ(canvas_get_box(&canvas, ids[1])->command_state, COMMAND_EXITED, "Shown as finished");
+
+        runner.cache_ttl = 0.0;
+        for (int i = 0; i < runner.refresh_count; i++) {
+            runner.refresh[i].due = runner.refresh[i].box_id == ids[2] ? 0.0 : now_sec() + 60.0;
+        }
+        command_runner_poll(&runner, &canvas);
+        ASSERT(command_runner_busy(&runner, ids[2]), "Expired result runs again");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Stream - rolling tail without output limits or timeout") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 0.3);
+
+        int id = command_box(&canvas, "seq 1 5000; sleep 0.5; echo end");
+        canvas_get_box(&canvas, id)->command_stream = true;
+        ASSERT_EQ(command_runner_start(&runner, &canvas, id), 0, "Stream started");
+        ASSERT(wait_done(&runner, &canvas, id, 5.0), "Stream ended on its own");
+
+        Box *box = canvas_get_box(&canvas, id);
+        int count = box_content_count(box);
+        ASSERT_EQ(box->command_state, COMMAND_EXITED, "Not stopped by the timeout");
+        ASSERT_EQ(count, COMMAND_RUNNER_STREAM_LINES, "Tail holds the line limit");
+        ASSERT_STR_EQ(box_content_line(box, count - 2), "end", "Newest output kept");
+        ASSERT_STR_EQ(box_content_line(box, count - 1), "[Exit: 0]", "Exit line last");
+        ASSERT_STR_EQ(box_content_line(box, 0), "4003", "Oldest output dropped");
+        ASSERT_EQ((int)content_buffer_dropped(box->content), 5002 - COMMAND_RUNNER_STREAM_LINES,
+                  "Dropped lines counted");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Refresh - due runs replace output in one step, in-flight runs are skipped") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int id = command_box(&canvas, "echo fresh; sleep 0.2");
+        const char *old[] = {"stale"};
+        box_content_set(canvas_get_box(&canvas, id), old, 1);
+        ASSERT_EQ(command_runner_set_refresh(&runner, &canvas, id, 2), 0, "Scheduled");
+        ASSERT_EQ(runner.refresh_count, 1, "One scheduled box");
+        ASSERT(runner.refresh[0].due <= now_sec() + COMMAND_RUNNER_REFRESH_SPREAD,
+               "First run within the spread window");
+
+        runner.refresh[0].due = 0.0;
+        command_runner_poll(&runner, &canvas);
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_EQ(command_runner_running(&runner), 1, "Due refresh started");
+        ASSERT_STR_EQ(box_content_line(box, 0), "stale", "Old output kept while it runs");
+        ASSERT_EQ(box->command_state, COMMAND_IDLE, "Title does not flip to running");
+
+        runner.refresh[0].due = 0.0;
+        double before = now_sec();
+        command_runner_poll(&runner, &canvas);
+        ASSERT_EQ(command_runner_running(&runner), 1, "Second run skipped while in flight");
+        ASSERT(runner.refresh[0].due >= before + 2.0 * (1.0 - COMMAND_RUNNER_REFRESH_JITTER) &&
+               runner.refresh[0].due <= now_sec() + 2.0 * (1.0 + COMMAND_RUNNER_REFRESH_JITTER),
+               "Skipped run rescheduled one jittered interval out");
+
+        ASSERT(wait_done(&runner, &canvas, id, 3.0), "Refresh finished");
+        box = canvas_get_box(&canvas, id);
+        ASSERT_EQ(box_content_count(box), 2, "Output plus exit line");
+        ASSERT_STR_EQ(box_content_line(box, 0), "fresh", "New output swapped in");
+        ASSERT_EQ(box->command_state, COMMAND_EXITED, "State updated at the end");
+
+        ASSERT_EQ(command_runner_set_refresh(&runner, &canvas, id, 0), 0, "Unscheduled");
+        ASSERT_EQ(runner.refresh_count, 0, "Nothing scheduled");
+        ASSERT(command_runner_next_deadline(&runner) < 0.0, "No deadline left");
+
+        int text = canvas_add_box(&canvas, 0.0, 0.0, 10, 5, "Note");
+        ASSERT_EQ(command_runner_set_refresh(&runner, &canvas, text, 5), -1, "Text boxes refused");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Refresh - fifty boxes due at once stay within the pool") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        CommandRunner runner;
+        command_runner_init(&runner, 4, 10.0);
+
+        int ids[50];
+        for (int i = 0; i < 50; i++) {
+            ids[i] = command_box(&canvas, "sleep 0.02; echo ok");
+            canvas_get_box(&canvas, ids[i])->refresh_interval = 2;
+        }
+        command_runner_schedule_canvas(&runner, &canvas);
+        ASSERT_EQ(runner.refresh_count, 50, "Every box scheduled");
+
+        /* Worst case: everything due in the same instant */
+        for (int i = 0; i < runner.refresh_count; i++) {
+            runner.refresh[i].due = 0.0;
+        }
+        int most = 0;
+        double slowest = 0.0;
+        int done = 0;
+        double end = now_sec() + 10.0;
+        while (done < 50 && now_sec() < end) {
+            double start = now_sec();
+            command_runner_poll(&runner, &canvas);
+            double took = now_sec() - start;
+            slowest = took > slowest ? took : slowest;
+            int running = command_runner_running(&runner);
+            most = running > most ? running : most;
+            done = 0;
+            for (int i = 0; i < 50; i++) {
+                done += canvas_get_box(&canvas, ids[i])->command_state == COMMAND_EXITED;
+            }
+            nap();
+        }
+        ASSERT_EQ(done, 50, "Every box refreshed");
+        ASSERT(most <= 4, "Never more than max_running children");
+        ASSERT(slowest < 0.05, "Polling never blocks");
+
+        canvas_remove_box(&canvas, ids[0]);
+        command_runner_poll(&runner, &canvas);
+        ASSERT_EQ(runner.refresh_count, 49, "Deleted box dropped from the schedule");
+
+        command_runner_shutdown(&runner);
+        canvas_cleanup(&canvas);
+    }
+#endif
+
     TEST_END();
 }
@@ -334,5 +334,50 @@ int main(void) {
         unlink(test_file);
     }
 
+    TEST("General - max_fps default, parse and clamping") {
+        AppConfig config;
+        config_init_defaults(&config);
+        ASSERT_EQ(config.max_fps, 60, "Default frame cap is 60");
+
+        const char *test_file = "/tmp/test_config_max_fps.ini";
+        FILE *f = fopen(test_file, "w");
+        ASSERT_NOT_NULL(f, "Created test config file");
+        fprintf(f, "[general]\n");
+        fprintf(f, "max_fps = 30\n");
+        fclose(f);
+        config_load(&config, test_file);
+        ASSERT_EQ(config.max_fps, 30, "max_fps parsed");
+
+        f = fopen(test_file, "w");
+        fprintf(f, "[general]\n");
+        fprintf(f, "max_fps = 1000\n");  /* Above max (240) */
+        fclose(f);
+        config_init_defaults(&config);
+        config_load(&config, test_file);
+        ASSERT_EQ(config.max_fps, 240, "max_fps clamped to max 240");
+
+        unlink(test_file);
+    }
+
+    TEST("Commands - defaults, parse and clamping") {
+        AppConfig config;
+        config_init_defaults(&config);
+        ASSERT_EQ(config.command_max_running, 4, "Default cap is 4");
+        ASSERT_EQ(config.command_timeout, 30, "Default timeout is 30s");
+
+        const char *test_file = "/tmp/test_config_commands.ini";
+        FILE *f = fopen(test_file, "w");
+        ASSERT_NOT_NULL(f, "Created test config file");
+        fprintf(f, "[commands]\n");
+        fprintf(f, "max_running = 99\n");
+        fprintf(f, "timeout = 0\n");
+        fclose(f);
+        config_load(&config, test_file);
+        ASSERT_EQ(config.command_max_running, 16, "max_running clamped to 16");
+        ASSERT_EQ(config.command_timeout, 0, "timeout 0 means no limit");
+
+        unlink(test_file);
+    }
+
     TEST_END();
 }
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "test.h"
 #include "../include/canvas.h"
+#include "../include/undo.h"
 #include "../include/types.h"
 
 int main(void) {
@@ -331,6 +332,88 @@ int main(void) {
         canvas_cleanup(&canvas);
     }
 
+    TEST("Removing a hub box drops all of its edges") {
+        Canvas canvas;
+        canvas_init(&canvas, 2000.0, 2000.0);
+
+        int hub = canvas_add_box(&canvas, 0.0, 0.0, 10, 5, "Hub");
+        int spokes[200];
+        for (int i = 0; i < 200; i++) {
+            spokes[i] = canvas_add_box(&canvas, (i + 1) * 20.0, 100.0, 10, 5, "Spoke");
+            canvas_add_connection(&canvas, hub, spokes[i]);
+        }
+        canvas_add_connection(&canvas, spokes[0], spokes[1]);
+
+        int conn_ids[256];
+        ASSERT_EQ(canvas_get_box_connections(&canvas, hub, conn_ids, 256), 200, "Hub has 200 edges");
+        ASSERT_EQ(canvas_get_box_connections(&canvas, spokes[0], conn_ids, 256), 2, "Spoke 0 has 2 edges");
+
+        canvas_remove_box(&canvas, hub);
+
+        ASSERT_EQ(canvas.conn_count, 1, "Only the spoke-to-spoke edge remains");
+        ASSERT_EQ(canvas_get_box_connections(&canvas, hub, conn_ids, 256), 0, "Hub has no edges");
+        ASSERT_EQ(canvas_get_box_connections(&canvas, spokes[0], conn_ids, 256), 1, "Spoke 0 keeps 1 edge");
+        ASSERT(canvas_find_connection(&canvas, spokes[0], spokes[1]) >= 0, "Remaining edge still found");
+        ASSERT_EQ(canvas_find_connection(&canvas, hub, spokes[5]), -1, "Hub edge no longer found");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Lookups stay valid after removals reorder the array") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int id1 = canvas_add_box(&canvas, 10.0, 10.0, 30, 5, "Box 1");
+        int id2 = canvas_add_box(&canvas, 50.0, 50.0, 30, 5, "Box 2");
+        int id3 = canvas_add_box(&canvas, 90.0, 30.0, 30, 5, "Box 3");
+
+        int conn1 = canvas_add_connection(&canvas, id1, id2);
+        int conn2 = canvas_add_connection(&canvas, id2, id3);
+        int conn3 = canvas_add_connection(&canvas, id1, id3);
+
+        canvas_remove_connection(&canvas, conn1);
+
+        Connection *c2 = canvas_get_connection(&canvas, conn2);
+        Connection *c3 = canvas_get_connection(&canvas, conn3);
+        ASSERT(c2 && c2->source_id == id2 && c2->dest_id == id3, "Connection 2 intact");
+        ASSERT(c3 && c3->source_id == id1 && c3->dest_id == id3, "Connection 3 intact");
+        ASSERT_EQ(canvas_find_connection(&canvas, id1, id3), conn3, "Pair lookup after move");
+        ASSERT_EQ(canvas_find_connection(&canvas, id1, id2), -1, "Removed pair gone");
+
+        /* The removed pair can be connected again */
+        int again = canvas_add_connection(&canvas, id2, id1);
+        ASSERT(again >= 0, "Re-adding a removed pair succeeds");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Connection index consistent through undo and redo") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int id1 = canvas_add_box(&canvas, 10.0, 10.0, 30, 5, "Box 1");
+        int id2 = canvas_add_box(&canvas, 50.0, 50.0, 30, 5, "Box 2");
+
+        int conn = canvas_add_connection(&canvas, id1, id2);
+        undo_record_connection_create(&canvas, conn);
+
+        canvas_undo(&canvas);
+        int conn_ids[4];
+        ASSERT_EQ(canvas_find_connection(&canvas, id1, id2), -1, "Undo removes pair");
+        ASSERT_EQ(canvas_get_box_connections(&canvas, id1, conn_ids, 4), 0, "Undo empties adjacency");
+        ASSERT_EQ(canvas_add_connection(&canvas, id2, id1) >= 0 ? 1 : 0, 1,
+                  "Reverse edge allowed after undo");
+        canvas_remove_connection(&canvas, canvas_find_connection(&canvas, id2, id1));
+
+        canvas_redo(&canvas);
+        ASSERT_EQ(canvas_find_connection(&canvas, id1, id2), conn, "Redo restores pair with same ID");
+        ASSERT_EQ(canvas_get_box_connections(&canvas, id2, conn_ids, 4), 1, "Redo restores adjacency");
+        ASSERT_EQ(conn_ids[0], conn, "Adjacency holds restored ID");
+        ASSERT_EQ(canvas_add_connection(&canvas, id2, id1), -1, "Duplicate rejected after redo");
+
+        canvas_cleanup(&canvas);
+    }
+
     TEST("NULL canvas safety") {
         /* These should not crash */
         int result = canvas_add_connection(NULL, 1, 2);
@@ -0,0 +1,276 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/box_content.h"
+#include "../include/control.h"
+
+#define CONTROL_SOCKET "test_control_temp.sock"
+
+static int connect_client(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, CONTROL_SOCKET);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void send_text(int fd, const char *text) {
+    size_t len = strlen(text);
+    while (len > 0) {
+        ssize_t n = write(fd, text, len);
+        if (n <= 0) {
+            return;
+        }
+        text += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Poll the server, as the main loop does, until 'lines' replies are in */
+static char *exchange(ControlServer *server, Canvas *canvas, int fd, const char *text, int lines) {
+    static char replies[65536];
+    size_t len = 0;
+    int seen = 0;
+    send_text(fd, text);
+    for (int tries = 0; tries < 2000 && seen < lines; tries++) {
+        control_server_poll(server, canvas);
+        struct timespec pause = {0, 1000000};
+        nanosleep(&pause, NULL);
+        ssize_t n = recv(fd, replies + len, sizeof(replies) - 1 - len, MSG_DONTWAIT);
+        if (n > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                seen += replies[len + (size_t)i] == '\n';
+            }
+            len += (size_t)n;
+        }
+    }
+    replies[len] = '\0';
+    return replies;
+}
+
+int main(void) {
+    TEST_START();
+
+    unlink(CONTROL_SOCKET);
+
+    TEST("Commands change the canvas and are answered in order") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ControlServer server;
+        control_server_init(&server);
+        ASSERT_EQ(control_server_listen(&server, CONTROL_SOCKET), 0, "Listening");
+        int fd = connect_client();
+        ASSERT(fd >= 0, "Connected");
+
+        const char *replies = exchange(&server, &canvas, fd,
+            "ping\n"
+            "add 10 20 30 8 First box\n"
+            "add 50 20 30 8 Second\n"
+            "connect 1 2 3\n"
+            "update 1 pos 15.5 25\n"
+            "update 1 size 40 10\n"
+            "update 2 title Renamed\n"
+            "update 2 color 4\n"
+            "update 2 content 2\n"
+            "line one\n"
+            "line two\n"
+            "update 2 append line three\n"
+            "query 1\n"
+            "query\n", 12);
+        ASSERT_STR_EQ(replies,
+            "ok\n"
+            "ok 1\n"
+            "ok 2\n"
+            "ok 1\n"
+            "ok\n"
+            "ok\n"
+            "ok\n"
+            "ok\n"
+            "ok\n"
+            "ok\n"
+            "ok 1 15.50 25.00 40 10 0 0 0 First box\n"
+            "ok 2 1\n", "Replies");
+
+        Box *box = canvas_get_box(&canvas, 2);
+        ASSERT_STR_EQ(box->title, "Renamed", "Title");
+        ASSERT_EQ(box->color, 4, "Color");
+        ASSERT_EQ(box_content_count(box), 3, "Content lines");
+        ASSERT_STR_EQ(box_content_line(box, 2), "line three", "Appended");
+        ASSERT_EQ(canvas_get_connection(&canvas, 1)->color, 3, "Connection color");
+
+        close(fd);
+        control_server_shutdown(&server);
+        ASSERT(access(CONTROL_SOCKET, F_OK) != 0, "Socket removed");
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Errors are reported and do not stop the client") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ControlServer server;
+        control_server_init(&server);
+        control_server_listen(&server, CONTROL_SOCKET);
+        int fd = connect_client();
+
+        const char *replies = exchange(&server, &canvas, fd,
+            "delete 9\n"
+            "update 9 content 1\n"
+            "skipped line\n"
+            "add 1 2\n"
+            "frobnicate\n"
+            "ping\n", 5);
+        ASSERT_STR_EQ(replies,
+            "err no such box\n"
+            "err no such box\n"
+            "err usage: add X Y W H [TITLE]\n"
+            "err unknown command\n"
+            "ok\n", "Replies");
+        ASSERT_EQ(canvas.box_count, 0, "Nothing added");
+
+        close(fd);
+        control_server_shutdown(&server);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Out-of-range positions and sizes are refused") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ControlServer server;
+        control_server_init(&server);
+        control_server_listen(&server, CONTROL_SOCKET);
+        int fd = connect_client();
+
+        const char *replies = exchange(&server, &canvas, fd,
+            "add nan 0 3 3\n"
+            "add 0 inf 3 3\n"
+            "add 2e9 0 3 3\n"
+            "add 0 0 2000000000 3\n"
+            "add 0 0 3 2\n", 5);
+        ASSERT_STR_EQ(replies,
+            "err X and Y must be finite, at most 1e9 from 0\n"
+            "err X and Y must be finite, at most 1e9 from 0\n"
+            "err X and Y must be finite, at most 1e9 from 0\n"
+            "err W and H must be 3-10000\n"
+            "err W and H must be 3-10000\n", "Replies");
+        ASSERT_EQ(canvas.box_count, 0, "Nothing added");
+
+        int id = canvas_add_box(&canvas, 10.0, 20.0, 5, 4, "Box");
+        replies = exchange(&server, &canvas, fd,
+            "update 1 pos -nan 0\n"
+            "update 1 pos 0 -1e10\n"
+            "update 1 size 3 10001\n"
+            "update 1 size 10000 10000\n", 4);
+        ASSERT_STR_EQ(replies,
+            "err X and Y must be finite, at most 1e9 from 0\n"
+            "err X and Y must be finite, at most 1e9 from 0\n"
+            "err W and H must be 3-10000\n"
+            "ok\n", "Update replies");
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_NEAR(box->x, 10.0, 0.0001, "X kept");
+        ASSERT_NEAR(box->y, 20.0, 0.0001, "Y kept");
+        ASSERT_EQ(box->width, 10000, "Largest width taken");
+
+        close(fd);
+        control_server_shutdown(&server);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("A batch is applied whole, in one pass") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ControlServer server;
+        control_server_init(&server);
+        control_server_listen(&server, CONTROL_SOCKET);
+        int fd = connect_client();
+
+        /* Half a batch is held back until the rest arrives */
+        send_text(fd, "batch 3\nadd 0 0 10 5 A\n");
+        control_server_poll(&server, &canvas);
+        ASSERT_EQ(canvas.box_count, 0, "Not yet");
+
+        const char *replies = exchange(&server, &canvas, fd,
+            "add 20 0 10 5 B\nconnect 1 2\n", 1);
+        ASSERT_STR_EQ(replies, "ok 1 2 1\n", "IDs made");
+        ASSERT_EQ(canvas.box_count, 2, "Boxes added");
+        ASSERT_EQ(canvas.conn_count, 1, "Connected");
+
+        replies = exchange(&server, &canvas, fd, "batch 3\ndelete 1\ndelete 1\nquery\n", 1);
+        ASSERT_STR_EQ(replies, "err 2 no such box\n", "First failure reported");
+        ASSERT_EQ(canvas.box_count, 1, "The rest applied");
+
+        close(fd);
+        control_server_shutdown(&server);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Thousands of updates from one client") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ControlServer server;
+        control_server_init(&server);
+        control_server_listen(&server, CONTROL_SOCKET);
+        int fd = connect_client();
+
+        exchange(&server, &canvas, fd, "add 0 0 20 5 Counter\n", 1);
+        char *text = malloc(10000 * 32);
+        size_t len = 0;
+        for (int i = 0; i < 10000; i++) {
+            len += (size_t)sprintf(text + len, "update 1 pos %d 0\n", i);
+        }
+        /* Send from a child so neither side blocks on a full socket */
+        pid_t pid = fork();
+        if (pid == 0) {
+            send_text(fd, text);
+            _exit(0);
+        }
+        int applied = 0;
+        size_t received = 0;
+        char buf[4096];
+        for (int tries = 0; tries < 5000 && received < 10000 * 3; tries++) {
+            applied += control_server_poll(&server, &canvas);
+            ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0) {
+                received += (size_t)n;
+            } else {
+                struct timespec pause = {0, 100000};
+                nanosleep(&pause, NULL);
+            }
+        }
+        waitpid(pid, NULL, 0);
+        ASSERT_EQ(applied, 10000, "All applied");
+        ASSERT_NEAR(canvas_get_box(&canvas, 1)->x, 9999.0, 0.001, "Last one wins");
+        ASSERT_EQ((int)received, 10000 * 3, "All answered");
+
+        free(text);
+        close(fd);
+        control_server_shutdown(&server);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("A socket in use by another session is left alone") {
+        ControlServer first, second;
+        control_server_init(&first);
+        control_server_init(&second);
+        ASSERT_EQ(control_server_listen(&first, CONTROL_SOCKET), 0, "First listens");
+        ASSERT_EQ(control_server_listen(&second, CONTROL_SOCKET), -1, "Second refused");
+        control_server_shutdown(&first);
+        ASSERT_EQ(control_server_listen(&second, CONTROL_SOCKET), 0, "Free again");
+        control_server_shutdown(&second);
+    }
+
+    TEST_END();
+}
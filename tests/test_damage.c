@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <ncurses.h>
+#include "test.h"
+#include "../include/damage.h"
+#include "../include/canvas.h"
+#include "../include/render.h"
+#include "../include/terminal.h"
+#include "../include/viewport.h"
+#include "../include/config.h"
+#include "../include/types.h"
+
+/* Draw one frame the way the main loop does; returns false if skipped */
+static bool draw_frame(Canvas *canvas, Viewport *vp, const AppConfig *config) {
+    if (!render_frame_begin(canvas, vp)) {
+        return false;
+    }
+    render_grid(canvas, vp);
+    render_connections(canvas, vp);
+    render_canvas(canvas, vp, config);
+    render_frame_overlays();
+    render_status(canvas, vp);
+    render_frame_end();
+    return true;
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("Touching rectangles merge, distant ones stay apart") {
+        Damage d;
+        damage_init(&d);
+        ASSERT(damage_is_empty(&d), "Starts empty");
+
+        damage_mark(&d, 0, 0, 10, 10);
+        damage_mark(&d, 5, 5, 15, 15);
+        ASSERT_EQ(d.count, 1, "Overlapping rects merged");
+        ASSERT(damage_contains(&d, 14, 14), "Merged rect covers both");
+
+        damage_mark(&d, 100, 100, 110, 110);
+        ASSERT_EQ(d.count, 2, "Distant rect kept separate");
+        ASSERT(!damage_contains(&d, 50, 50), "Gap between rects is clean");
+        ASSERT(damage_intersects(&d, 105, 0, 200, 101), "Intersection found");
+        ASSERT(!damage_intersects(&d, 20, 20, 90, 90), "No intersection in the gap");
+
+        /* A rect bridging both pulls them into one */
+        damage_mark(&d, 12, 12, 102, 102);
+        ASSERT_EQ(d.count, 1, "Bridge merges everything");
+
+        damage_mark(&d, 5, 5, 5, 20);
+        ASSERT_EQ(d.count, 1, "Empty rect ignored");
+
+        damage_clear(&d);
+        ASSERT(damage_is_empty(&d), "Clear empties");
+    }
+
+    TEST("Full list folds new damage instead of growing") {
+        Damage d;
+        damage_init(&d);
+        for (int i = 0; i < DAMAGE_MAX_RECTS + 10; i++) {
+            damage_mark(&d, i * 10.0, 0, i * 10.0 + 2.0, 2.0);
+        }
+        ASSERT_EQ(d.count, DAMAGE_MAX_RECTS, "Count capped");
+
+        int missing = 0;
+        for (int i = 0; i < DAMAGE_MAX_RECTS + 10; i++) {
+            if (!damage_contains(&d, i * 10.0 + 1.0, 1.0)) missing++;
+        }
+        ASSERT_EQ(missing, 0, "Every marked rect is still covered");
+
+        DamageRect bounds;
+        ASSERT(damage_bounds(&d, &bounds), "Bounds available");
+        ASSERT(bounds.x0 == 0.0 && bounds.x1 == (DAMAGE_MAX_RECTS + 9) * 10.0 + 2.0,
+               "Bounds span all damage");
+
+        damage_mark_all(&d);
+        ASSERT(damage_contains(&d, -1e9, 1e9), "Full damage contains everything");
+        ASSERT(!damage_bounds(&d, &bounds), "Full damage has no finite bounds");
+    }
+
+    TEST("Canvas mutations record damage") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        ASSERT(canvas.damage.full, "New canvas needs a full draw");
+        damage_clear(&canvas.damage);
+
+        int a = canvas_add_box(&canvas, 10.0, 10.0, 20, 5, "A");
+        ASSERT(damage_contains(&canvas.damage, 12.0, 12.0), "Added box damaged");
+        damage_clear(&canvas.damage);
+
+        canvas_move_box(&canvas, a, 300.0, 200.0);
+        ASSERT(damage_contains(&canvas.damage, 12.0, 12.0), "Old position damaged");
+        ASSERT(damage_contains(&canvas.damage, 305.0, 202.0), "New position damaged");
+        ASSERT(!damage_contains(&canvas.damage, 100.0, 100.0), "Untouched area clean");
+        damage_clear(&canvas.damage);
+
+        int b = canvas_add_box(&canvas, 300.0, 500.0, 20, 5, "B");
+        damage_clear(&canvas.damage);
+        canvas_add_connection(&canvas, a, b);
+        ASSERT(damage_contains(&canvas.damage, 310.0, 350.0), "Connection path damaged");
+        damage_clear(&canvas.damage);
+
+        canvas_select_box(&canvas, b);
+        ASSERT(damage_contains(&canvas.damage, 302.0, 502.0), "Selected box damaged");
+        damage_clear(&canvas.damage);
+
+        canvas_mark_box_dirty(&canvas, a);
+        ASSERT(damage_contains(&canvas.damage, 302.0, 202.0), "Explicit mark damages box");
+        damage_clear(&canvas.damage);
+
+        canvas_remove_box(&canvas, a);
+        ASSERT(damage_contains(&canvas.damage, 302.0, 202.0), "Removed box damaged");
+        ASSERT(damage_contains(&canvas.damage, 310.0, 350.0), "Its connection damaged");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Unchanged frames send nothing to the terminal") {
+        FILE *out = tmpfile();
+        FILE *in = fopen("/dev/null", "r");
+        SCREEN *screen = (out && in) ? newterm("xterm", out, in) : NULL;
+        if (screen == NULL) {
+            printf("  (skipped: no xterm terminfo)\n");
+            if (out) fclose(out);
+            if (in) fclose(in);
+        } else {
+            set_term(screen);
+            render_frame_reset();
+
+            AppConfig config;
+            config_init_defaults(&config);
+            Viewport vp;
+            viewport_init(&vp);
+            terminal_update_size(&vp);
+
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int id = canvas_add_box(&canvas, 5.0, 3.0, 20, 5, "Box");
+            for (int i = 0; i < 8; i++) {
+                canvas_add_box(&canvas, 5.0 + (i % 3) * 25.0, 10.0 + (i / 3) * 4.0, 20, 3, "Other");
+            }
+
+            bool drawn = draw_frame(&canvas, &vp, &config);
+            fflush(out);
+            long full_bytes = ftell(out);
+            ASSERT(drawn, "First frame drawn");
+            ASSERT(full_bytes > 0, "First frame writes output");
+
+            drawn = draw_frame(&canvas, &vp, &config);
+            fflush(out);
+            ASSERT(!drawn, "Second frame skipped");
+            ASSERT_EQ((int)(ftell(out) - full_bytes), 0, "Idle frame writes zero bytes");
+
+            canvas_move_box(&canvas, id, 6.0, 3.0);
+            long before = ftell(out);
+            drawn = draw_frame(&canvas, &vp, &config);
+            fflush(out);
+            long move_bytes = ftell(out) - before;
+            ASSERT(drawn, "Frame after a move drawn");
+            ASSERT(move_bytes > 0 && move_bytes < full_bytes, "Move costs less than a full frame");
+            if (terminal_frame_bytes() >= 0) {
+                ASSERT_EQ((int)terminal_frame_bytes(), (int)move_bytes, "Byte counter matches output");
+            }
+
+            vp.cam_x += 1.0;
+            before = ftell(out);
+            drawn = draw_frame(&canvas, &vp, &config);
+            fflush(out);
+            ASSERT(drawn && ftell(out) > before, "Panning redraws");
+
+            canvas_cleanup(&canvas);
+            endwin();
+            delscreen(screen);
+            fclose(out);
+            fclose(in);
+        }
+    }
+
+    TEST_END();
+}
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include <signal.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/event_loop.h"
+#include "../include/signal_handler.h"
+
+static void count_fire(void *ctx) {
+    (*(int *)ctx)++;
+}
+
+/* Records the order timers fire in */
+typedef struct {
+    int order[8];
+    int count;
+} FireLog;
+
+typedef struct {
+    FireLog *log;
+    int id;
+} Tagged;
+
+static void log_fire(void *ctx) {
+    Tagged *t = ctx;
+    if (t->log->count < 8) {
+        t->log->order[t->log->count] = t->id;
+    }
+    t->log->count++;
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("Frame rate cap sets the frame interval") {
+        EventLoop loop;
+        event_loop_init(&loop, 50);
+        ASSERT(loop.frame_interval > 0.0199 && loop.frame_interval < 0.0201, "50 FPS is 20ms");
+
+        event_loop_set_max_fps(&loop, 0);
+        ASSERT(loop.frame_interval == 1.0 / EVENT_LOOP_MIN_FPS, "Clamped to the minimum");
+        event_loop_set_max_fps(&loop, 100000);
+        ASSERT(loop.frame_interval == 1.0 / EVENT_LOOP_MAX_FPS, "Clamped to the maximum");
+
+        event_loop_frame_drawn(&loop);
+        ASSERT(event_loop_next_frame(&loop) > event_loop_now(), "Next frame is in the future");
+    }
+
+    TEST("Timers fire when due, in deadline order") {
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        FireLog log = {{0}, 0};
+        Tagged a = {&log, 1}, b = {&log, 2};
+
+        event_loop_add_timer(&loop, 0.02, 0.0, log_fire, &a);
+        event_loop_add_timer(&loop, 0.01, 0.0, log_fire, &b);
+        int fired = event_loop_run_timers(&loop);
+        ASSERT_EQ(fired, 0, "Nothing due yet");
+
+        while (log.count < 2) {
+            event_loop_wait(&loop, -1.0);
+            event_loop_run_timers(&loop);
+        }
+        ASSERT_EQ(log.order[0], 2, "Earlier deadline first");
+        ASSERT_EQ(log.order[1], 1, "Later deadline second");
+        ASSERT(event_loop_next_deadline(&loop) < 0.0, "One-shot timers are gone");
+    }
+
+    TEST("Repeating timers reschedule, cancelled timers stop") {
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        int ticks = 0;
+        int id = event_loop_add_timer(&loop, 0.0, 0.005, count_fire, &ticks);
+        ASSERT(id >= 0, "Timer added");
+
+        double end = event_loop_now() + 0.05;
+        while (event_loop_now() < end) {
+            event_loop_wait(&loop, end);
+            event_loop_run_timers(&loop);
+        }
+        ASSERT(ticks >= 3 && ticks <= 12, "Fires about once per interval");
+
+        event_loop_cancel_timer(&loop, id);
+        int before = ticks;
+        event_loop_wait(&loop, event_loop_now() + 0.02);
+        event_loop_run_timers(&loop);
+        ASSERT_EQ(ticks, before, "Cancelled timer does not fire");
+    }
+
+    TEST("Wait wakes on a readable descriptor and reports hangups") {
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        int fds[2];
+        ASSERT_EQ(pipe(fds), 0, "Pipe created");
+        event_loop_add_fd(&loop, fds[0]);
+
+        int ready = event_loop_wait(&loop, event_loop_now() + 0.01);
+        ASSERT_EQ(ready, 0, "Timeout with nothing to read");
+        ASSERT(!event_loop_fd_ready(&loop, fds[0]), "Not ready");
+
+        ssize_t written = write(fds[1], "x", 1);
+        ASSERT_EQ((int)written, 1, "Wrote a byte");
+        double start = event_loop_now();
+        ready = event_loop_wait(&loop, -1.0);
+        ASSERT_EQ(ready, 1, "One descriptor ready");
+        ASSERT(event_loop_fd_ready(&loop, fds[0]), "Pipe is readable");
+        ASSERT(event_loop_now() - start < 0.5, "Returned without waiting");
+
+        char c;
+        ssize_t got = read(fds[0], &c, 1);
+        ASSERT_EQ((int)got, 1, "Read the byte");
+        close(fds[1]);
+        event_loop_wait(&loop, -1.0);
+        ASSERT(event_loop_fd_hangup(&loop, fds[0]), "Closed writer is a hangup");
+
+        event_loop_remove_fd(&loop, fds[0]);
+        ASSERT_EQ(loop.fd_count, 0, "Descriptor removed");
+        close(fds[0]);
+    }
+
+    TEST("Idle wait sleeps instead of spinning") {
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        int fired = 0;
+        event_loop_add_timer(&loop, 0.2, 0.0, count_fire, &fired);
+
+        double start = event_loop_now();
+        while (!fired) {
+            event_loop_wait(&loop, -1.0);
+            event_loop_run_timers(&loop);
+        }
+
+        /* Lateness and CPU use are timing-dependent: see bench_idle_wait */
+        ASSERT(event_loop_now() - start >= 0.2, "Woke for the timer, not before");
+        ASSERT(loop.wakeups <= 3, "A handful of wake-ups, not one per frame");
+    }
+
+    TEST("Signals wake the loop through the self-pipe") {
+        ASSERT_EQ(signal_handler_init(), 0, "Handlers installed");
+        int wake_fd = signal_wakeup_fd();
+        ASSERT(wake_fd >= 0, "Self-pipe available");
+
+        EventLoop loop;
+        event_loop_init(&loop, 60);
+        event_loop_add_fd(&loop, wake_fd);
+
+        raise(SIGUSR1);
+        int ready = event_loop_wait(&loop, event_loop_now() + 1.0);
+        ASSERT_EQ(ready, 1, "Woken by the signal");
+        ASSERT(signal_should_reload(), "Reload flag set");
+
+        signal_clear_wakeup();
+        ready = event_loop_wait(&loop, event_loop_now() + 0.01);
+        ASSERT_EQ(ready, 0, "Drained pipe no longer wakes");
+
+        signal_handler_cleanup();
+        ASSERT_EQ(signal_wakeup_fd(), -1, "Self-pipe closed on cleanup");
+    }
+
+    TEST_END();
+}
@@ -5,9 +5,13 @@
 #include <unistd.h>
 #include "test.h"
 #include "../include/canvas.h"
+#include "../include/box_content.h"
 #include "../include/file_viewer.h"
+#include "../include/file_map.h"
 
 #define TEST_FILE "test_file_viewer_temp.txt"
+#define LARGE_FILE "test_file_viewer_large.txt"
+#define LARGE_LINES 200000
 
 /* Helper function to create a test file with content */
 static int create_test_file(const char *filename, const char *content) {
@@ -84,13 +88,13 @@ int main(void) {
         ASSERT_NOT_NULL(box->file_path, "file_path should be set");
         ASSERT_STR_EQ(box->file_path, TEST_FILE, "file_path matches");
 
-        ASSERT_EQ(box->content_lines, 3, "Should have 3 lines");
+        ASSERT_EQ(box_content_count(box), 3, "Should have 3 lines");
         ASSERT_NOT_NULL(box->content, "Content array should be allocated");
 
-        if (box->content && box->content_lines >= 3) {
-            ASSERT_STR_EQ(box->content[0], "Line 1", "First line content");
-            ASSERT_STR_EQ(box->content[1], "Line 2", "Second line content");
-            ASSERT_STR_EQ(box->content[2], "Line 3", "Third line content");
+        if (box->content && box_content_count(box) >= 3) {
+            ASSERT_STR_EQ(box_content_line(box, 0), "Line 1", "First line content");
+            ASSERT_STR_EQ(box_content_line(box, 1), "Line 2", "Second line content");
+            ASSERT_STR_EQ(box_content_line(box, 2), "Line 3", "Third line content");
         }
 
         canvas_cleanup(&canvas);
@@ -109,10 +113,10 @@ int main(void) {
         int result = file_viewer_load(box, TEST_FILE);
         ASSERT_EQ(result, 0, "Load should succeed with CRLF");
 
-        ASSERT_EQ(box->content_lines, 2, "Should have 2 lines");
-        if (box->content && box->content_lines >= 2) {
-            ASSERT_STR_EQ(box->content[0], "Line 1", "First line without CR");
-            ASSERT_STR_EQ(box->content[1], "Line 2", "Second line without CR");
+        ASSERT_EQ(box_content_count(box), 2, "Should have 2 lines");
+        if (box->content && box_content_count(box) >= 2) {
+            ASSERT_STR_EQ(box_content_line(box, 0), "Line 1", "First line without CR");
+            ASSERT_STR_EQ(box_content_line(box, 1), "Line 2", "Second line without CR");
         }
 
         canvas_cleanup(&canvas);
@@ -132,7 +136,7 @@ int main(void) {
         ASSERT_EQ(result, 0, "Load should succeed for empty file");
 
         ASSERT_EQ(box->content_type, BOX_CONTENT_FILE, "Content type should be FILE");
-        ASSERT_EQ(box->content_lines, 0, "Should have 0 lines");
+        ASSERT_EQ(box_content_count(box), 0, "Should have 0 lines");
 
         canvas_cleanup(&canvas);
         unlink(TEST_FILE);
@@ -180,7 +184,7 @@ int main(void) {
         create_test_file(TEST_FILE, "Original\n");
         file_viewer_load(box, TEST_FILE);
 
-        ASSERT_EQ(box->content_lines, 1, "Initially 1 line");
+        ASSERT_EQ(box_content_count(box), 1, "Initially 1 line");
 
         /* Modify file */
         create_test_file(TEST_FILE, "Updated\nNew line\n");
@@ -188,10 +192,10 @@ int main(void) {
         int result = file_viewer_reload(box);
         ASSERT_EQ(result, 0, "Reload should succeed");
 
-        ASSERT_EQ(box->content_lines, 2, "After reload 2 lines");
-        if (box->content && box->content_lines >= 2) {
-            ASSERT_STR_EQ(box->content[0], "Updated", "Updated first line");
-            ASSERT_STR_EQ(box->content[1], "New line", "New second line");
+        ASSERT_EQ(box_content_count(box), 2, "After reload 2 lines");
+        if (box->content && box_content_count(box) >= 2) {
+            ASSERT_STR_EQ(box_content_line(box, 0), "Updated", "Updated first line");
+            ASSERT_STR_EQ(box_content_line(box, 1), "New line", "New second line");
         }
 
         canvas_cleanup(&canvas);
@@ -222,12 +226,12 @@ int main(void) {
         create_test_file(TEST_FILE, "Line 1\nLine 2\n");
         file_viewer_load(box, TEST_FILE);
 
-        ASSERT_EQ(box->content_lines, 2, "Has 2 lines before clear");
+        ASSERT_EQ(box_content_count(box), 2, "Has 2 lines before clear");
         ASSERT_NOT_NULL(box->content, "Content allocated before clear");
 
         file_viewer_clear(box);
 
-        ASSERT_EQ(box->content_lines, 0, "Has 0 lines after clear");
+        ASSERT_EQ(box_content_count(box), 0, "Has 0 lines after clear");
         ASSERT_NULL(box->content, "Content is NULL after clear");
         /* Note: file_path is NOT cleared by file_viewer_clear */
 
@@ -252,22 +256,136 @@ int main(void) {
         const char *initial[] = {"Old line 1", "Old line 2", "Old line 3"};
         canvas_add_box_content(&canvas, box_id, initial, 3);
 
-        ASSERT_EQ(box->content_lines, 3, "Initially 3 lines");
+        ASSERT_EQ(box_content_count(box), 3, "Initially 3 lines");
 
         /* Load file - should replace content */
         create_test_file(TEST_FILE, "New line\n");
         int result = file_viewer_load(box, TEST_FILE);
 
         ASSERT_EQ(result, 0, "Load should succeed");
-        ASSERT_EQ(box->content_lines, 1, "Now has 1 line");
-        if (box->content && box->content_lines >= 1) {
-            ASSERT_STR_EQ(box->content[0], "New line", "Content replaced");
+        ASSERT_EQ(box_content_count(box), 1, "Now has 1 line");
+        if (box->content && box_content_count(box) >= 1) {
+            ASSERT_STR_EQ(box_content_line(box, 0), "New line", "Content replaced");
         }
 
         canvas_cleanup(&canvas);
         unlink(TEST_FILE);
     }
 
+    TEST("file_viewer_load - Long lines are kept whole") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int box_id = canvas_add_box(&canvas, 10.0, 20.0, 30, 10, "Test Box");
+        Box *box = canvas_get_box(&canvas, box_id);
+
+        char long_line[3001];
+        memset(long_line, 'a', 3000);
+        long_line[3000] = '\0';
+        FILE *f = fopen(TEST_FILE, "w");
+        fprintf(f, "short\n%s\nend\n", long_line);
+        fclose(f);
+
+        ASSERT_EQ(file_viewer_load(box, TEST_FILE), 0, "Load should succeed");
+        ASSERT_EQ(box_content_count(box), 3, "Long line not split");
+        ASSERT_EQ((int)box_content_line_length(box, 1), 3000, "Long line not truncated");
+        ASSERT_STR_EQ(box_content_line(box, 2), "end", "Line after it intact");
+
+        canvas_cleanup(&canvas);
+        unlink(TEST_FILE);
+    }
+
+    TEST("file_viewer_load - Large file is mapped and indexed lazily") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int box_id = canvas_add_box(&canvas, 10.0, 20.0, 30, 10, "Big");
+        Box *box = canvas_get_box(&canvas, box_id);
+
+        /* 200000 numbered lines (~2.4 MB), one of them 10000 bytes long,
+         * one with a CRLF ending, and a last line without a newline */
+        FILE *f = fopen(LARGE_FILE, "w");
+        for (int i = 0; i < LARGE_LINES; i++) {
+            if (i == 5) {
+                for (int j = 0; j < 10000; j++) fputc('x', f);
+                fputc('\n', f);
+            } else if (i == 7) {
+                fprintf(f, "line %06d\r\n", i);
+            } else {
+                fprintf(f, "line %06d\n", i);
+            }
+        }
+        fprintf(f, "tail");
+        fclose(f);
+
+        ASSERT_EQ(file_viewer_load(box, LARGE_FILE), 0, "Load should succeed");
+        ASSERT(box->file_map != NULL, "File is mapped");
+        ASSERT(box->content == NULL, "No lines read into a buffer");
+        ASSERT(file_viewer_indexing(), "Rest of the file left for the main loop");
+        ASSERT(box_content_count(box) < LARGE_LINES, "Only the start indexed on open");
+        ASSERT_EQ(box->content_type, BOX_CONTENT_FILE, "Content type set");
+
+        ASSERT_STR_EQ(box_content_line(box, 0), "line 000000", "First line");
+        ASSERT_EQ((int)box_content_line_length(box, 5), FILE_MAP_LINE_MAX,
+                  "Very long line cut when materialized");
+        ASSERT_STR_EQ(box_content_line(box, 7), "line 000007", "CR stripped");
+        ASSERT_STR_EQ(box_content_line(box, 150000), "line 150000",
+                      "Line past the index found on demand");
+        ASSERT(file_map_heap_bytes(box->file_map) < 256 * 1024,
+               "Heap use independent of file size");
+
+        ASSERT_EQ(box_content_find(box, "line 123456", 0), 123456, "Find past the index");
+        ASSERT_EQ(box_content_find(box, "line 000010", 11), -1, "Find starts at start_line");
+
+        while (file_viewer_indexing()) {
+            file_viewer_index_step(&canvas);
+        }
+        ASSERT_EQ(box_content_count(box), LARGE_LINES + 1, "Every line counted");
+        ASSERT_STR_EQ(box_content_line(box, LARGE_LINES), "tail", "Unterminated last line");
+        ASSERT(box_content_line(box, LARGE_LINES + 1) == NULL, "Nothing past the end");
+
+        /* Editing turns the mapping into an ordinary buffer */
+        box_content_append(box, "edited");
+        ASSERT(box->file_map == NULL, "Mapping dropped on write");
+        ASSERT_EQ(box_content_count(box), 1, "Buffer holds the new line");
+
+        ASSERT_EQ(file_viewer_load(box, LARGE_FILE), 0, "Map again");
+        canvas_cleanup(&canvas);
+        ASSERT(!file_viewer_indexing(), "Closing a box stops its indexing");
+        unlink(LARGE_FILE);
+    }
+
+    TEST("file_map - File truncated while mapped") {
+        FILE *f = fopen(LARGE_FILE, "w");
+        for (int i = 0; i < LARGE_LINES; i++) {
+            fprintf(f, "line %06d\n", i);
+        }
+        fclose(f);
+
+        FileMap *map = file_map_open(LARGE_FILE);
+        ASSERT_NOT_NULL(map, "Mapped");
+        ASSERT_EQ(truncate(LARGE_FILE, 0), 0, "Truncated");
+        ASSERT(file_map_line(map, 150000, NULL) == NULL, "Nothing read past the new end");
+        ASSERT_EQ(file_map_find(map, "line", 0), -1, "Nothing found");
+        ASSERT_EQ(file_map_count(map), 0, "Index cut");
+        ASSERT(file_map_complete(map), "Nothing left to index");
+        file_map_close(map);
+
+        /* Rewritten in place, shorter */
+        f = fopen(LARGE_FILE, "w");
+        for (int i = 0; i < LARGE_LINES; i++) {
+            fprintf(f, "line %06d\n", i);
+        }
+        fclose(f);
+        map = file_map_open(LARGE_FILE);
+        create_test_file(LARGE_FILE, "short\n");
+        ASSERT(file_map_line(map, 150000, NULL) == NULL, "Old lines gone");
+        ASSERT_STR_EQ(file_map_line(map, 0, NULL), "short", "New first line");
+        while (file_map_index_pending(FILE_MAP_INDEX_SLICE, NULL, NULL) > 0) {
+        }
+        ASSERT_EQ(file_map_count(map), 1, "Indexed again to the new end");
+        file_map_close(map);
+        unlink(LARGE_FILE);
+    }
+
     /* Cleanup test file */
     unlink(TEST_FILE);
 
@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/box_content.h"
+#include "../include/damage.h"
+#include "../include/file_map.h"
+#include "../include/file_viewer.h"
+#include "../include/file_watch.h"
+
+#define WATCH_FILE "test_file_watch_temp.txt"
+#define WATCH_LARGE "test_file_watch_large.txt"
+#define WATCH_NEW "test_file_watch_new.txt"
+
+static void write_file(const char *path, const char *mode, const char *text) {
+    FILE *f = fopen(path, mode);
+    if (f) {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+static const char *line_at(const Box *box, int i) {
+    const char *line = box_content_line(box, i);
+    return line ? line : "(none)";
+}
+
+/* Pick up events and apply them, as the main loop does each frame */
+static int settle(FileWatch *watch, Canvas *canvas) {
+    file_watch_read_events(watch);
+    return file_watch_apply(watch, canvas);
+}
+
+int main(void) {
+    TEST_START();
+
+    FileWatch watch;
+    bool live = file_watch_init(&watch) == 0;
+    file_watch_set_global(&watch);
+    if (!live) {
+        printf("  (inotify unavailable: change tests skipped)\n");
+    }
+
+    TEST("Boxes showing the same file share one copy") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int a = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "A");
+        int b = canvas_add_box(&canvas, 40.0, 0.0, 30, 10, "B");
+        write_file(WATCH_FILE, "w", "one\ntwo\n");
+
+        ASSERT_EQ(file_viewer_load(canvas_get_box(&canvas, a), WATCH_FILE), 0, "Load into A");
+        ASSERT_EQ(file_viewer_load(canvas_get_box(&canvas, b), "./" WATCH_FILE), 0,
+                  "Load into B by another spelling of the path");
+        ASSERT(canvas_get_box(&canvas, a)->content == canvas_get_box(&canvas, b)->content,
+               "One parsed copy");
+        ASSERT_EQ(watch.count, 1, "One watched file");
+        ASSERT_STR_EQ(canvas_get_box(&canvas, b)->file_path, "./" WATCH_FILE,
+                      "Box keeps the path it was given");
+
+        canvas_cleanup(&canvas);
+        unlink(WATCH_FILE);
+    }
+
+    /* Changes on disk need inotify */
+    if (live) {
+        TEST("Appends are parsed incrementally and shown in every box") {
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int a = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "A");
+            int b = canvas_add_box(&canvas, 40.0, 0.0, 30, 10, "B");
+            write_file(WATCH_FILE, "w", "one\ntwo\nthr");
+            file_viewer_load(canvas_get_box(&canvas, a), WATCH_FILE);
+            file_viewer_load(canvas_get_box(&canvas, b), WATCH_FILE);
+            Box *box = canvas_get_box(&canvas, a);
+            const ContentBuffer *before = box->content;
+            ASSERT_EQ(box_content_count(box), 3, "Unterminated last line shown");
+            settle(&watch, &canvas);
+            damage_clear(&canvas.damage);
+
+            /* Many small writes between frames */
+            write_file(WATCH_FILE, "a", "ee\n");
+            for (int i = 0; i < 50; i++) {
+                write_file(WATCH_FILE, "a", "more\n");
+            }
+            ASSERT_EQ(file_watch_read_events(&watch), 1, "Events coalesced into one change");
+            ASSERT(file_watch_pending(&watch), "Change waits for the frame");
+            ASSERT_EQ(file_watch_apply(&watch, &canvas), 1, "One update for the frame");
+
+            box = canvas_get_box(&canvas, a);
+            ASSERT(box->content == before, "Updated in place");
+            ASSERT_EQ(box_content_count(box), 53, "Appended lines added");
+            ASSERT_STR_EQ(line_at(box, 2), "three", "Partial line completed");
+            ASSERT_STR_EQ(line_at(box, 52), "more", "Last appended line");
+            ASSERT_EQ(box_content_count(canvas_get_box(&canvas, b)), 53, "Other box sees it too");
+            ASSERT(!damage_is_empty(&canvas.damage), "Boxes redrawn");
+            ASSERT(!file_watch_pending(&watch), "Nothing left to apply");
+
+            canvas_cleanup(&canvas);
+            unlink(WATCH_FILE);
+        }
+
+        TEST("Truncation and replacement read the file again") {
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "A");
+            write_file(WATCH_FILE, "w", "alpha\nbeta\ngamma\n");
+            file_viewer_load(canvas_get_box(&canvas, id), WATCH_FILE);
+
+            write_file(WATCH_FILE, "w", "short\n");
+            settle(&watch, &canvas);
+            Box *box = canvas_get_box(&canvas, id);
+            ASSERT_EQ(box_content_count(box), 1, "Truncated file re-read");
+            ASSERT_STR_EQ(line_at(box, 0), "short", "New content shown");
+
+            /* Same size, new bytes: not an append */
+            write_file(WATCH_FILE, "w", "SHORT\n");
+            settle(&watch, &canvas);
+            ASSERT_STR_EQ(line_at(canvas_get_box(&canvas, id), 0), "SHORT", "Rewrite in place re-read");
+
+            /* An editor saving by rename */
+            write_file(WATCH_NEW, "w", "saved\nby\nrename\n");
+            rename(WATCH_NEW, WATCH_FILE);
+            settle(&watch, &canvas);
+            box = canvas_get_box(&canvas, id);
+            ASSERT_EQ(box_content_count(box), 3, "Renamed-over file read");
+
+            write_file(WATCH_FILE, "a", "after\n");
+            settle(&watch, &canvas);
+            ASSERT_EQ(box_content_count(canvas_get_box(&canvas, id)), 4,
+                      "New file at the path is watched");
+
+            canvas_cleanup(&canvas);
+            unlink(WATCH_FILE);
+        }
+
+        TEST("A mapped file that grows keeps its index") {
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "Big");
+            FILE *f = fopen(WATCH_LARGE, "w");
+            for (int i = 0; i < 100000; i++) {
+                fprintf(f, "line %06d\n", i);
+            }
+            fprintf(f, "unterminated");
+            fclose(f);
+
+            file_viewer_load(canvas_get_box(&canvas, id), WATCH_LARGE);
+            Box *box = canvas_get_box(&canvas, id);
+            FileMap *map = box->file_map;
+            ASSERT(map != NULL, "Large file mapped");
+            while (file_viewer_indexing()) {
+                file_viewer_index_step(&canvas);
+            }
+            ASSERT_EQ(box_content_count(box), 100001, "All lines indexed");
+
+            write_file(WATCH_LARGE, "a", " now ended\nnext\n");
+            settle(&watch, &canvas);
+            box = canvas_get_box(&canvas, id);
+            ASSERT(box->file_map == map, "Same mapping");
+            ASSERT(map->mark_count > 1000, "Index kept");
+            while (file_viewer_indexing()) {
+                file_viewer_index_step(&canvas);
+            }
+            ASSERT_EQ(box_content_count(box), 100002, "Appended line indexed");
+            ASSERT_STR_EQ(line_at(box, 100000), "unterminated now ended", "Last line continued");
+            ASSERT_STR_EQ(line_at(box, 100001), "next", "New line");
+
+            canvas_cleanup(&canvas);
+            unlink(WATCH_LARGE);
+        }
+
+        TEST("A mapped file cut short is read safely before its event") {
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "Big");
+            FILE *f = fopen(WATCH_LARGE, "w");
+            for (int i = 0; i < 100000; i++) {
+                fprintf(f, "line %06d\n", i);
+            }
+            fclose(f);
+            file_viewer_load(canvas_get_box(&canvas, id), WATCH_LARGE);
+            settle(&watch, &canvas);
+
+            /* Rewritten shorter in place; the main loop indexes and draws
+             * before it reads the events */
+            write_file(WATCH_LARGE, "w", "short\nfile\n");
+            while (file_viewer_indexing()) {
+                file_viewer_index_step(&canvas);
+            }
+            Box *box = canvas_get_box(&canvas, id);
+            ASSERT_STR_EQ(line_at(box, 90000), "(none)", "Nothing read past the end");
+            ASSERT_STR_EQ(line_at(box, 1), "file", "What is left is shown");
+            ASSERT(file_watch_pending(&watch), "Re-read without waiting for the event");
+            ASSERT_EQ(file_watch_apply(&watch, &canvas), 1, "Read again");
+            ASSERT(!box->file_map->cut, "Mapped afresh");
+            ASSERT_EQ(box_content_count(box), 2, "New length");
+            settle(&watch, &canvas);
+            ASSERT(!file_watch_pending(&watch), "Nothing left to apply");
+
+            canvas_cleanup(&canvas);
+            unlink(WATCH_LARGE);
+        }
+
+        TEST("A read-in file that grows past the limit is mapped") {
+            Canvas canvas;
+            canvas_init(&canvas, 1000.0, 1000.0);
+            int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "Log");
+            write_file(WATCH_FILE, "w", "start\n");
+            file_viewer_load(canvas_get_box(&canvas, id), WATCH_FILE);
+
+            FILE *f = fopen(WATCH_FILE, "a");
+            for (int i = 0; i < 100000; i++) {
+                fprintf(f, "line %06d\n", i);
+            }
+            fclose(f);
+            settle(&watch, &canvas);
+
+            Box *box = canvas_get_box(&canvas, id);
+            ASSERT(box->file_map != NULL && box->content == NULL, "Box moved to a mapping");
+            ASSERT_STR_EQ(line_at(box, 100000), "line 099999", "Lines intact");
+
+            canvas_cleanup(&canvas);
+            unlink(WATCH_FILE);
+        }
+    }
+
+    TEST("Files no box shows are forgotten") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "A");
+        write_file(WATCH_FILE, "w", "x\n");
+        write_file(WATCH_NEW, "w", "y\n");
+        file_viewer_load(canvas_get_box(&canvas, id), WATCH_FILE);
+        file_viewer_load(canvas_get_box(&canvas, id), WATCH_NEW);
+        ASSERT_EQ(watch.count, 1, "Previous file dropped");
+        ASSERT_STR_EQ(line_at(canvas_get_box(&canvas, id), 0), "y", "New file shown");
+
+        canvas_cleanup(&canvas);
+        unlink(WATCH_FILE);
+        unlink(WATCH_NEW);
+    }
+
+    file_watch_shutdown(&watch);
+    ASSERT(file_watch_get_global() == NULL, "Shutdown clears the global watch");
+    TEST_END();
+}
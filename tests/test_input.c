@@ -0,0 +1,269 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <ncurses.h>
+#include "test.h"
+#include "../include/input.h"
+#include "../include/canvas.h"
+#include "../include/viewport.h"
+#include "../include/joystick.h"
+#include "../include/config.h"
+#include "../include/types.h"
+#include "../include/undo.h"
+
+/* Terminal whose keyboard is the read end of a pipe */
+typedef struct {
+    SCREEN *screen;
+    FILE *out;
+    FILE *in;
+    int feed;   /* Write end: bytes written here arrive as keys */
+} FakeTerm;
+
+static bool fake_term_open(FakeTerm *term) {
+    int fds[2];
+    memset(term, 0, sizeof(*term));
+    term->feed = -1;
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    term->feed = fds[1];
+    term->in = fdopen(fds[0], "r");
+    term->out = tmpfile();
+    term->screen = (term->in && term->out) ? newterm("xterm", term->out, term->in) : NULL;
+    if (term->screen == NULL) {
+        return false;
+    }
+    set_term(term->screen);
+    nodelay(stdscr, TRUE);
+    keypad(stdscr, TRUE);
+    mousemask(ALL_MOUSE_EVENTS | REPORT_MOUSE_POSITION, NULL);
+    mouseinterval(0);
+    return true;
+}
+
+static void fake_term_close(FakeTerm *term) {
+    if (term->screen) {
+        endwin();
+        delscreen(term->screen);
+    }
+    if (term->out) fclose(term->out);
+    if (term->in) fclose(term->in);
+    if (term->feed >= 0) close(term->feed);
+}
+
+static void feed(const FakeTerm *term, const char *keys) {
+    size_t len = strlen(keys);
+    ssize_t written = write(term->feed, keys, len);
+    (void)written;
+}
+
+/* Append an xterm SGR mouse report: code 0 press, 32 motion with the
+ * button held, release = true for the button coming up */
+static int mouse_report(char *buf, int code, int x, int y, bool release) {
+    return sprintf(buf, "\033[<%d;%d;%d%c", code, x + 1, y + 1, release ? 'm' : 'M');
+}
+
+/* Apply keys one at a time, as the loop did before batching */
+static int apply_one_by_one(Canvas *canvas, Viewport *vp, JoystickState *js,
+                            const AppConfig *config, const char *keys) {
+    int quit = 0;
+    for (const char *k = keys; *k && !quit; k++) {
+        quit = handle_key(canvas, vp, js, config, (unsigned char)*k);
+    }
+    return quit;
+}
+
+static void setup(Canvas *canvas, Viewport *vp, JoystickState *js) {
+    canvas_init(canvas, 1000.0, 1000.0);
+    viewport_init(vp);
+    vp->term_width = 80;
+    vp->term_height = 24;
+    /* No device: just the keyboard-facing state */
+    memset(js, 0, sizeof(*js));
+    js->fd = -1;
+    js->mode = MODE_NAV;
+    js->selected_box_id = -1;
+}
+
+int main(void) {
+    TEST_START();
+
+    FakeTerm term;
+    if (!fake_term_open(&term)) {
+        printf("  (skipped: no xterm terminfo)\n");
+        fake_term_close(&term);
+        TEST_END();
+    }
+
+    AppConfig config;
+    config_init_defaults(&config);
+
+    TEST("A burst of pans is one batch with the same result") {
+        Canvas canvas, ref;
+        Viewport vp, ref_vp;
+        JoystickState js, ref_js;
+        setup(&canvas, &vp, &js);
+        setup(&ref, &ref_vp, &ref_js);
+
+        char keys[201];
+        for (int i = 0; i < 200; i++) {
+            keys[i] = (i % 4 == 3) ? 's' : 'l';
+        }
+        keys[200] = '\0';
+        feed(&term, keys);
+
+        int events = 0;
+        int quit = handle_input_batch(&canvas, &vp, &js, &config, &events);
+        ASSERT_EQ(quit, 0, "Keeps running");
+        ASSERT_EQ(events, 200, "All 200 keys read in one batch");
+
+        apply_one_by_one(&ref, &ref_vp, &ref_js, &config, keys);
+        ASSERT(vp.cam_x == ref_vp.cam_x && vp.cam_y == ref_vp.cam_y,
+               "Summed pan matches key-by-key pans");
+
+        int again = -1;
+        handle_input_batch(&canvas, &vp, &js, &config, &again);
+        ASSERT_EQ(again, 0, "Queue drained");
+
+        canvas_cleanup(&canvas);
+        canvas_cleanup(&ref);
+    }
+
+    TEST("Mixed input keeps its order") {
+        Canvas canvas, ref;
+        Viewport vp, ref_vp;
+        JoystickState js, ref_js;
+        setup(&canvas, &vp, &js);
+        setup(&ref, &ref_vp, &ref_js);
+
+        /* Zoom past the clamp and back, pan, then create boxes at the
+         * viewport centre the pans moved to */
+        const char *keys = "zzzzzzzzzzzzzzzxxxlllnwwwwzhhhnxxxxxxxxxxxxxxxxxxxxxzz";
+        feed(&term, keys);
+
+        int events = 0;
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        apply_one_by_one(&ref, &ref_vp, &ref_js, &config, keys);
+
+        ASSERT_EQ(events, (int)strlen(keys), "Every key read");
+        ASSERT_NEAR(vp.zoom, ref_vp.zoom, 1e-9, "Zoom matches key-by-key");
+        ASSERT_NEAR(vp.cam_x, ref_vp.cam_x, 1e-9, "Camera X matches key-by-key");
+        ASSERT_NEAR(vp.cam_y, ref_vp.cam_y, 1e-9, "Camera Y matches key-by-key");
+        ASSERT_EQ(canvas.box_count, 2, "Both boxes created");
+        ASSERT_EQ(canvas.box_count, ref.box_count, "Same box count as key-by-key");
+
+        int id = canvas_draw_first(&canvas);
+        int ref_id = canvas_draw_first(&ref);
+        while (id >= 0 && ref_id >= 0) {
+            Box *box = canvas_get_box_at(&canvas, id);
+            Box *ref_box = canvas_get_box_at(&ref, ref_id);
+            ASSERT(fabs(box->x - ref_box->x) < 1e-9 && fabs(box->y - ref_box->y) < 1e-9,
+                   "Box placed where the key-by-key run put it");
+            id = canvas_draw_next(&canvas, id);
+            ref_id = canvas_draw_next(&ref, ref_id);
+        }
+
+        canvas_cleanup(&canvas);
+        canvas_cleanup(&ref);
+    }
+
+    TEST("Quit stops the batch") {
+        Canvas canvas;
+        Viewport vp;
+        JoystickState js;
+        setup(&canvas, &vp, &js);
+
+        feed(&term, "llqll");
+        int events = 0;
+        int quit = handle_input_batch(&canvas, &vp, &js, &config, &events);
+        ASSERT_EQ(quit, 1, "Quit reported");
+        ASSERT_EQ(events, 3, "Keys after quit left queued");
+        ASSERT(vp.cam_x > 0.0, "Pans before quit applied");
+
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("A flood is split into bounded batches") {
+        Canvas canvas;
+        Viewport vp;
+        JoystickState js;
+        setup(&canvas, &vp, &js);
+
+        static char keys[INPUT_BATCH_MAX + 101];
+        memset(keys, 'l', INPUT_BATCH_MAX + 100);
+        keys[INPUT_BATCH_MAX + 100] = '\0';
+        feed(&term, keys);
+
+        int events = 0;
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        ASSERT_EQ(events, INPUT_BATCH_MAX, "First batch capped");
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        ASSERT_EQ(events, 100, "Rest in the next batch");
+        ASSERT(vp.cam_x == (INPUT_BATCH_MAX + 100) * 2.0, "Every pan applied");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("A drag moves the box once per frame and records one undo step") {
+        Canvas canvas;
+        Viewport vp;
+        JoystickState js;
+        setup(&canvas, &vp, &js);
+        int id = canvas_add_box(&canvas, 5.0, 3.0, 20, 5, "Drag me");
+        int undo_before = canvas.undo_stack.size;
+
+        /* Press inside the box (ncurses drops a press that is queued right
+         * behind other mouse reports, so it goes in its own read), then a
+         * burst of 20 motion reports */
+        char buf[512];
+        mouse_report(buf, 0, 10, 5, false);
+        feed(&term, buf);
+        int events = 0;
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        ASSERT(canvas_get_selected(&canvas) && canvas_get_selected(&canvas)->id == id,
+               "Press selects the box");
+
+        int len = 0;
+        for (int i = 1; i <= 20; i++) {
+            len += mouse_report(buf + len, 32, 10 + i, 5 + i / 4, false);
+        }
+        feed(&term, buf);
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+        Box *box = canvas_get_box(&canvas, id);
+        ASSERT_EQ(events, 20, "Motion burst read in one batch");
+        ASSERT(input_drag_pending(), "Drag position waiting for the frame");
+        ASSERT(box->x == 5.0 && box->y == 3.0, "Box not moved per motion event");
+
+        input_apply_drag(&canvas);
+        box = canvas_get_box(&canvas, id);
+        ASSERT(box->x == 25.0 && box->y == 8.0, "Frame applies the latest position");
+        ASSERT(!input_drag_pending(), "Nothing left to apply");
+        ASSERT_EQ(canvas.undo_stack.size, undo_before, "No undo entries mid-drag");
+
+        len = 0;
+        for (int i = 21; i <= 30; i++) {
+            len += mouse_report(buf + len, 32, 10 + i, 10, false);
+        }
+        len += mouse_report(buf + len, 0, 40, 10, true);
+        feed(&term, buf);
+        handle_input_batch(&canvas, &vp, &js, &config, &events);
+
+        box = canvas_get_box(&canvas, id);
+        ASSERT(box->x == 35.0 && box->y == 8.0, "Release applies the final position");
+        ASSERT_EQ(canvas.undo_stack.size, undo_before + 1, "One undo entry for the gesture");
+        ASSERT(canvas.undo_stack.current && canvas.undo_stack.current->type == OP_BOX_MOVE,
+               "Recorded as a box move");
+
+        canvas_undo(&canvas);
+        box = canvas_get_box(&canvas, id);
+        ASSERT(box->x == 5.0 && box->y == 3.0, "Undo restores the position before the drag");
+
+        canvas_cleanup(&canvas);
+    }
+
+    fake_term_close(&term);
+    TEST_END();
+}
@@ -0,0 +1,338 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/box_content.h"
+#include "../include/change_set.h"
+#include "../include/journal.h"
+#include "../include/persistence.h"
+#include "../include/saver.h"
+
+#define JOURNAL_FILE "test_journal_temp.txt"
+#define JOURNAL_LOG JOURNAL_FILE JOURNAL_SUFFIX
+#define JOURNAL_EXPECTED "test_journal_expected.txt"
+#define JOURNAL_ACTUAL "test_journal_actual.txt"
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static char *read_all(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    long size = file_size(path);
+    char *data = calloc(1, (size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        data[0] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+/* True if loading JOURNAL_FILE (and its journal) gives back canvas */
+static bool loads_as(const Canvas *canvas) {
+    Canvas loaded;
+    loaded.boxes = NULL;
+    if (canvas_load(&loaded, JOURNAL_FILE) != 0) {
+        return false;
+    }
+    canvas_save(canvas, JOURNAL_EXPECTED);
+    canvas_save(&loaded, JOURNAL_ACTUAL);
+    canvas_cleanup(&loaded);
+    char *expected = read_all(JOURNAL_EXPECTED);
+    char *actual = read_all(JOURNAL_ACTUAL);
+    bool same = expected && actual && strcmp(expected, actual) == 0;
+    free(expected);
+    free(actual);
+    unlink(JOURNAL_EXPECTED);
+    unlink(JOURNAL_ACTUAL);
+    return same;
+}
+
+static void remove_files(void) {
+    unlink(JOURNAL_FILE);
+    unlink(JOURNAL_LOG);
+}
+
+static void setup_canvas(Canvas *canvas, int boxes) {
+    canvas_init(canvas, 1000.0, 1000.0);
+    for (int i = 0; i < boxes; i++) {
+        int id = canvas_add_box(canvas, (i % 100) * 30.0, (i / 100) * 20.0, 25, 8, "Box");
+        const char *lines[] = {"first line", "second line"};
+        canvas_add_box_content(canvas, id, lines, 2);
+    }
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("Saved edits replay over the file to the same canvas") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 5);
+        canvas_add_connection(&canvas, 1, 2);
+        int conn = canvas_add_connection(&canvas, 2, 3);
+        ASSERT_EQ(journal_open(&journal, &canvas, JOURNAL_FILE, false), 0, "Open writes the file");
+        long base = file_size(JOURNAL_FILE);
+
+        int id = canvas_add_box(&canvas, 500.0, 500.0, 30, 10, "New");
+        const char *lines[] = {"", "  indented", "last"};
+        canvas_add_box_content(&canvas, id, lines, 3);
+        canvas_move_box(&canvas, 1, 123.5, 45.25);
+        canvas_resize_box(&canvas, 2, 40, 12);
+        Box *box = canvas_get_box(&canvas, 3);
+        free(box->title);
+        box->title = strdup("Renamed");
+        box->color = 4;
+        canvas_mark_box_dirty(&canvas, 3);
+        canvas_remove_connection(&canvas, conn);
+        canvas_add_connection(&canvas, id, 1);
+        canvas_remove_box(&canvas, 4);
+        canvas_select_box(&canvas, id);
+        canvas.document = strdup("Notes\nline two");
+        ASSERT(journal_pending(&journal, &canvas), "Edits are pending");
+
+        ASSERT_EQ(journal_save(&journal, &canvas), 0, "Save");
+        ASSERT(!journal_pending(&journal, &canvas), "Nothing pending after the save");
+        ASSERT_EQ(file_size(JOURNAL_FILE), base, "The canvas file is left alone");
+        ASSERT(loads_as(&canvas), "File plus journal loads as the canvas");
+
+        /* Replaying records the file already has changes nothing */
+        ASSERT_EQ(journal_compact(&journal, &canvas), 0, "Compact");
+        ASSERT_EQ(file_size(JOURNAL_LOG), (long)strlen(JOURNAL_MAGIC) + 1, "Journal emptied");
+        ASSERT(loads_as(&canvas), "Compacted file loads as the canvas");
+
+        journal_close(&journal, &canvas);
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("Positions replay exactly") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 2);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+
+        /* Values no short decimal represents */
+        int id = canvas_add_box(&canvas, 0.1 + 0.2, 1.0 / 3.0, 20, 5, "Added");
+        canvas_move_box(&canvas, 1, -2.0 / 3.0, 1234.5678901234567);
+        journal_save(&journal, &canvas);
+
+        Canvas loaded;
+        loaded.boxes = NULL;
+        ASSERT_EQ(canvas_load(&loaded, JOURNAL_FILE), 0, "Load replays the journal");
+        Box *added = canvas_get_box(&loaded, id);
+        Box *moved = canvas_get_box(&loaded, 1);
+        ASSERT(added && added->x == 0.1 + 0.2 && added->y == 1.0 / 3.0, "Added box exact");
+        ASSERT(moved && moved->x == -2.0 / 3.0 && moved->y == 1234.5678901234567,
+               "Moved box exact");
+        canvas_cleanup(&loaded);
+
+        journal_close(&journal, &canvas);
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("A save writes only what changed") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 2000);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+        long before = file_size(JOURNAL_LOG);
+
+        canvas_move_box(&canvas, 1000, 10.0, 20.0);
+        journal_save(&journal, &canvas);
+        long written = file_size(JOURNAL_LOG) - before;
+        ASSERT(written > 0 && written < 64, "One short record for one move");
+
+        /* Deleting a box then undoing it saves the box once, whole */
+        Box copy = *canvas_get_box(&canvas, 7);
+        canvas_remove_box(&canvas, 7);
+        canvas_restore_box_with_id(&canvas, 7, copy.x, copy.y, copy.width, copy.height, "Box");
+        const char *lines[] = {"first line", "second line"};
+        canvas_add_box_content(&canvas, 7, lines, 2);
+        /* A box added and deleted between saves is never written */
+        int gone = canvas_add_box(&canvas, 0.0, 0.0, 10, 5, "Gone");
+        canvas_remove_box(&canvas, gone);
+        journal_save(&journal, &canvas);
+        char *log = read_all(JOURNAL_LOG);
+        ASSERT(log && strstr(log, "\nD 7\nA 7 ") != NULL, "Delete then restore");
+        char record[32];
+        snprintf(record, sizeof(record), "A %d ", gone);
+        ASSERT(log && strstr(log, record) == NULL, "Short-lived box skipped");
+        free(log);
+        ASSERT(loads_as(&canvas), "Loads as the canvas");
+
+        journal_close(&journal, &canvas);
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("Command output is redrawn, not journaled") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 10);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+
+        /* Turning a box into a command box writes what it shows */
+        Box *box = canvas_get_box(&canvas, 3);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command = strdup("seq 1000");
+        canvas_mark_box_source(&canvas, 3);
+        journal_save(&journal, &canvas);
+        char *log = read_all(JOURNAL_LOG);
+        ASSERT(log && strstr(log, "\nC 3 2\n") != NULL, "Content written with the command");
+        free(log);
+
+        /* Output arriving only redraws the box */
+        long before = file_size(JOURNAL_LOG);
+        for (int i = 0; i < 100; i++) {
+            char line[16];
+            snprintf(line, sizeof(line), "%d", i);
+            box_content_append(box, line);
+            canvas_redraw_box(&canvas, 3);
+        }
+        ASSERT(!journal_pending(&journal, &canvas), "Nothing to save");
+        journal_save(&journal, &canvas);
+        ASSERT(file_size(JOURNAL_LOG) == before, "Output not journaled");
+
+        /* A field edit of a command box leaves its output out */
+        free(box->title);
+        box->title = strdup("Counter");
+        canvas_mark_box_dirty(&canvas, 3);
+        journal_save(&journal, &canvas);
+        long written = file_size(JOURNAL_LOG) - before;
+        ASSERT(written > 0 && written < 64, "Title without the output");
+
+        journal_close(&journal, &canvas);
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("A record torn by a crash is ignored and cut off") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 3);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+        canvas_move_box(&canvas, 2, 77.0, 88.0);
+        journal_save(&journal, &canvas);
+        journal_close(&journal, &canvas);
+        long intact = file_size(JOURNAL_LOG);
+
+        FILE *f = fopen(JOURNAL_LOG, "a");
+        fputs("M 3 999.00", f);
+        fclose(f);
+        ASSERT(loads_as(&canvas), "Torn record not applied");
+
+        Canvas loaded;
+        loaded.boxes = NULL;
+        canvas_load(&loaded, JOURNAL_FILE);
+        ASSERT_EQ(journal_open(&journal, &loaded, JOURNAL_FILE, true), 0, "Reopen");
+        ASSERT_EQ(file_size(JOURNAL_LOG), intact, "Torn record cut off");
+        canvas_move_box(&loaded, 3, 5.0, 6.0);
+        journal_save(&journal, &loaded);
+        ASSERT(loads_as(&loaded), "Later saves replay");
+
+        journal_close(&journal, &loaded);
+        canvas_cleanup(&loaded);
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("A save outside journal mode supersedes the journal") {
+        Journal journal;
+        journal_init(&journal);
+        Canvas canvas;
+        setup_canvas(&canvas, 3);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+        canvas_move_box(&canvas, 1, 50.0, 0.0);
+        journal_save(&journal, &canvas);
+        journal_close(&journal, &canvas);
+        canvas_cleanup(&canvas);
+
+        /* A later session without journal mode */
+        Canvas loaded;
+        loaded.boxes = NULL;
+        canvas_load(&loaded, JOURNAL_FILE);
+        ASSERT(canvas_get_box(&loaded, 1)->x == 50.0, "Journal replayed");
+        canvas_move_box(&loaded, 1, 99.0, 0.0);
+        ASSERT_EQ(canvas_save(&loaded, JOURNAL_FILE), 0, "Whole save");
+        ASSERT_EQ(file_size(JOURNAL_LOG), -1, "Journal removed");
+        canvas_cleanup(&loaded);
+
+        loaded.boxes = NULL;
+        canvas_load(&loaded, JOURNAL_FILE);
+        ASSERT(canvas_get_box(&loaded, 1)->x == 99.0, "The save is what loads");
+        canvas_cleanup(&loaded);
+
+        /* The same through a background save */
+        setup_canvas(&canvas, 3);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+        canvas_move_box(&canvas, 1, 50.0, 0.0);
+        journal_save(&journal, &canvas);
+        journal_close(&journal, &canvas);
+        canvas_move_box(&canvas, 1, 99.0, 0.0);
+        Saver saver;
+        saver_init(&saver);
+        saver_start(&saver, &canvas, JOURNAL_FILE, CANVAS_FORMAT_V1);
+        ASSERT_EQ(saver_wait(&saver, &canvas), 1, "Background save");
+        saver_cleanup(&saver, &canvas);
+        ASSERT_EQ(file_size(JOURNAL_LOG), -1, "Journal removed");
+        ASSERT(loads_as(&canvas), "The save is what loads");
+
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("The journal is compacted in the background past its threshold") {
+        Journal journal;
+        journal_init(&journal);
+        journal.compact_bytes = 1024;
+        Canvas canvas;
+        setup_canvas(&canvas, 50);
+        journal_open(&journal, &canvas, JOURNAL_FILE, false);
+        char *base = read_all(JOURNAL_FILE);
+
+        for (int i = 0; i < 200; i++) {
+            canvas_move_box(&canvas, 1 + i % 50, i * 1.5, i * 2.5);
+            journal_save(&journal, &canvas);
+        }
+        /* Edits keep going to the journal while the file is rewritten */
+        int id = canvas_add_box(&canvas, 1.0, 2.0, 10, 5, "Late");
+        journal_save(&journal, &canvas);
+        journal_close(&journal, &canvas);
+
+        char *compacted = read_all(JOURNAL_FILE);
+        ASSERT(base && compacted && strcmp(base, compacted) != 0, "Canvas file rewritten");
+        free(base);
+        free(compacted);
+        ASSERT(file_size(JOURNAL_LOG) < 1024, "Journal cut back");
+        ASSERT(canvas_get_box(&canvas, id) != NULL, "Late box kept");
+        ASSERT(loads_as(&canvas), "Loads as the canvas");
+
+        canvas_cleanup(&canvas);
+        remove_files();
+    }
+
+    TEST("Edits are only tracked while a journal is open") {
+        Canvas canvas;
+        setup_canvas(&canvas, 3);
+        canvas_move_box(&canvas, 1, 9.0, 9.0);
+        ASSERT(change_set_empty(&canvas.changes), "Untracked without a journal");
+        canvas_cleanup(&canvas);
+    }
+
+    TEST_END();
+}
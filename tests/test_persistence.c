@@ -3,14 +3,58 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "test.h"
 #include "../include/canvas.h"
+#include "../include/box_content.h"
 #include "../include/persistence.h"
 
 #define TEST_FILE "test_canvas_temp.txt"
 #define SNAPSHOT_FILE "tests/snapshots/expected_canvas.txt"
 
+/* Write a canvas file with 'count' boxes (two content lines each) and
+ * count - 1 connections chaining them together */
+static int write_large_canvas(const char *filename, int count) {
+    Canvas canvas;
+    if (canvas_init(&canvas, 100000.0, 100000.0) != 0) {
+        return -1;
+    }
+    const char *lines[] = {"first line", "second line"};
+    for (int i = 0; i < count; i++) {
+        int id = canvas_add_box(&canvas, (i % 1000) * 40.0, (i / 1000) * 10.0, 20, 5, "Box");
+        canvas_add_box_content(&canvas, id, lines, 2);
+        if (i > 0) {
+            canvas_restore_connection_with_id(&canvas, i, id - 1, id, 0);
+        }
+    }
+    int result = canvas_save(&canvas, filename);
+    canvas_cleanup(&canvas);
+    return result;
+}
+
+/* Best-of-three wall time to load a canvas file, in seconds */
+static double time_load(const char *filename) {
+    double best = -1.0;
+    for (int run = 0; run < 3; run++) {
+        Canvas canvas;
+        canvas_init(&canvas, 0.0, 0.0);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int result = canvas_load(&canvas, filename);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        canvas_cleanup(&canvas);
+        if (result != 0) {
+            return -1.0;
+        }
+        double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        if (best < 0.0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
 /* Helper function to compare two files */
 static int files_equal(const char *file1, const char *file2) __attribute__((unused));
 static int files_equal(const char *file1, const char *file2) {
@@ -311,6 +355,279 @@ int main(void) {
         canvas_cleanup(&loaded);
     }
 
+    TEST("Save and load command refresh interval") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int plain = canvas_add_box(&canvas, 10.0, 20.0, 30, 10, "Once");
+        int live = canvas_add_box(&canvas, 50.0, 20.0, 30, 10, "42 live");
+        Box *box = canvas_get_box(&canvas, plain);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command = strdup("uptime");
+        box = canvas_get_box(&canvas, live);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command = strdup("date");
+        box->refresh_interval = 2;
+
+        ASSERT_EQ(canvas_save(&canvas, TEST_FILE), 0, "Save should succeed");
+
+        /* Only the scheduled box gets the extra field */
+        FILE *f = fopen(TEST_FILE, "r");
+        char line[256];
+        int nine = 0, ten = 0;
+        while (f && fgets(line, sizeof(line), f)) {
+            int id, w, h, sel, color, type, ctype, refresh;
+            double x, y;
+            int n = sscanf(line, "%d %lf %lf %d %d %d %d %d %d %d",
+                           &id, &x, &y, &w, &h, &sel, &color, &type, &ctype, &refresh);
+            nine += (n == 9);
+            ten += (n == 10);
+        }
+        if (f) fclose(f);
+        ASSERT_EQ(nine, 1, "Unscheduled box keeps the 9-field line");
+        ASSERT_EQ(ten, 1, "Scheduled box line carries the interval");
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), 0, "Load should succeed");
+        Box *loaded_plain = canvas_get_box(&loaded, plain);
+        Box *loaded_live = canvas_get_box(&loaded, live);
+        ASSERT(loaded_plain && loaded_plain->refresh_interval == 0, "No interval by default");
+        ASSERT(loaded_live && loaded_live->refresh_interval == 2, "Interval restored");
+        ASSERT(loaded_live && strcmp(loaded_live->title, "42 live") == 0,
+               "Title starting with a number is not read as a field");
+
+        canvas_cleanup(&canvas);
+        canvas_cleanup(&loaded);
+    }
+
+    TEST("Save after removals keeps draw order and selection") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int a = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "A");
+        int b = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "B");
+        canvas_remove_box(&canvas, a);
+        int c = canvas_add_box(&canvas, 0.0, 0.0, 10, 4, "C");  /* Reuses A's slot, on top */
+        canvas_select_box(&canvas, b);
+
+        ASSERT_EQ(canvas_save(&canvas, TEST_FILE), 0, "Save should succeed");
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), 0, "Load should succeed");
+        ASSERT_EQ(canvas_find_box_at(&loaded, 5.0, 2.0), c, "Top box is still on top");
+        Box *selected = canvas_get_selected(&loaded);
+        ASSERT(selected != NULL && selected->id == b, "Selection restored to the same box");
+
+        canvas_cleanup(&canvas);
+        canvas_cleanup(&loaded);
+    }
+
+    TEST("Load pre-sizes storage from header counts") {
+        ASSERT_EQ(write_large_canvas(TEST_FILE, 1000), 0, "Large canvas saved");
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), 0, "Load should succeed");
+        ASSERT_EQ(loaded.box_count, 1000, "All boxes loaded");
+        ASSERT_EQ(loaded.box_capacity, 1000, "Box array sized exactly from header");
+        ASSERT_EQ(loaded.conn_count, 999, "All connections loaded");
+        ASSERT_EQ(loaded.conn_capacity, 999, "Connection array sized exactly from header");
+
+        Box *last = canvas_get_box(&loaded, 1000);
+        ASSERT_NOT_NULL(last, "Last box found by ID");
+        if (last) {
+            ASSERT_EQ(box_content_count(last), 2, "Content loaded into last box");
+            ASSERT_EQ(canvas_find_box_at(&loaded, last->x + 1.0, last->y + 1.0), 1000,
+                      "Loaded boxes are hit-testable");
+        }
+
+        canvas_cleanup(&loaded);
+    }
+
+    TEST("Load time scales linearly with box count") {
+        const char *small_file = "test_canvas_small_temp.txt";
+        const char *large_file = "test_canvas_large_temp.txt";
+        ASSERT_EQ(write_large_canvas(small_file, 4000), 0, "Small canvas saved");
+        ASSERT_EQ(write_large_canvas(large_file, 16000), 0, "Large canvas saved");
+
+        double t_small = time_load(small_file);
+        double t_large = time_load(large_file);
+        ASSERT(t_small > 0.0 && t_large > 0.0, "Both loads succeed");
+
+        /* 4x the boxes: linear is ~4x, quadratic would be ~16x */
+        double ratio = t_large / t_small;
+        printf("    load 4000: %.2f ms, 16000: %.2f ms (ratio %.1f)\n",
+               t_small * 1e3, t_large * 1e3, ratio);
+        ASSERT(ratio < 8.0, "Load time grows linearly, not quadratically");
+
+        unlink(small_file);
+        unlink(large_file);
+    }
+
+    TEST("Binary format round-trips exactly and is detected on load") {
+        Canvas canvas;
+        canvas_init(&canvas, 1234.5678, 987.654321);
+        int a = canvas_add_box(&canvas, 0.1 + 0.2, -1.0 / 3.0, 30, 10, "Exact");
+        int b = canvas_add_box(&canvas, 50.0, 60.0, 25, 8, NULL);
+        char long_line[3000];
+        memset(long_line, 'x', sizeof(long_line) - 1);
+        long_line[sizeof(long_line) - 1] = '\0';
+        const char *lines[] = {"NULL", "", long_line, "END_DOCUMENT"};
+        canvas_add_box_content(&canvas, a, lines, 4);
+        Box *box = canvas_get_box(&canvas, b);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command = strdup("tail -f /var/log/syslog");
+        box->refresh_interval = 5;
+        box->command_stream = true;
+        box->color = 3;
+        canvas_add_connection(&canvas, a, b);
+        canvas_select_box(&canvas, b);
+        canvas.grid.visible = true;
+        canvas.grid.spacing = 7;
+        canvas.document = strdup("notes\nwithout a final newline");
+        canvas.sidebar_width = 33;
+
+        ASSERT_EQ(canvas_save_format(&canvas, TEST_FILE, CANVAS_FORMAT_V2), 0, "Saved as V2");
+        ASSERT_EQ(canvas_file_format(TEST_FILE), CANVAS_FORMAT_V2, "Detected as V2");
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), 0, "canvas_load reads V2");
+        Box *la = canvas_get_box(&loaded, a);
+        Box *lb = canvas_get_box(&loaded, b);
+        ASSERT(la != NULL && lb != NULL, "Boxes restored by ID");
+        if (la && lb) {
+            ASSERT(la->x == 0.1 + 0.2 && la->y == -1.0 / 3.0, "Positions are bit-exact");
+            ASSERT(loaded.world_width == 1234.5678, "World size is bit-exact");
+            ASSERT_EQ(box_content_count(la), 4, "All lines restored");
+            ASSERT_STR_EQ(box_content_line(la, 0), "NULL", "Line reading NULL kept as text");
+            ASSERT_EQ((int)box_content_line_length(la, 2), 2999, "Long line kept whole");
+            ASSERT_STR_EQ(box_content_line(la, 3), "END_DOCUMENT", "Marker-like line kept");
+            ASSERT_NULL(lb->title, "Missing title stays NULL");
+            ASSERT_STR_EQ(lb->command, "tail -f /var/log/syslog", "Command restored");
+            ASSERT(lb->refresh_interval == 5 && lb->command_stream, "Schedule and stream flag");
+            ASSERT_EQ(lb->color, 3, "Color restored");
+        }
+        ASSERT_EQ(loaded.conn_count, 1, "Connection restored");
+        Box *selected = canvas_get_selected(&loaded);
+        ASSERT(selected != NULL && selected->id == b, "Selection restored");
+        ASSERT(loaded.grid.visible && loaded.grid.spacing == 7, "Grid restored");
+        ASSERT(loaded.document && strcmp(loaded.document, "notes\nwithout a final newline") == 0,
+               "Document restored as written");
+        ASSERT_EQ(loaded.sidebar_width, 33, "Sidebar width restored");
+
+        canvas_cleanup(&canvas);
+        canvas_cleanup(&loaded);
+    }
+
+    TEST("Converter turns V1 into V2 and back") {
+        const char *v2_file = "test_canvas_v2_temp.canvas";
+        const char *v1_file = "test_canvas_v1_back_temp.txt";
+        ASSERT_EQ(write_large_canvas(TEST_FILE, 200), 0, "V1 canvas saved");
+        ASSERT_EQ(canvas_file_format(TEST_FILE), CANVAS_FORMAT_V1, "Detected as V1");
+        ASSERT_EQ(canvas_convert(TEST_FILE, v2_file, CANVAS_FORMAT_V2), 0, "Converted to V2");
+        ASSERT_EQ(canvas_convert(v2_file, v1_file, CANVAS_FORMAT_V1), 0, "Converted back");
+        ASSERT(files_equal(TEST_FILE, v1_file), "Round trip gives the same V1 file");
+        ASSERT_EQ(canvas_convert("no_such_canvas.txt", v2_file, CANVAS_FORMAT_V2), -1,
+                  "Missing input fails");
+        unlink(v2_file);
+        unlink(v1_file);
+    }
+
+    TEST("Truncated or corrupt V2 files fail cleanly") {
+        ASSERT_EQ(write_large_canvas(TEST_FILE, 50), 0, "V1 canvas saved");
+        Canvas canvas;
+        canvas.boxes = NULL;
+        canvas_load(&canvas, TEST_FILE);
+        ASSERT_EQ(canvas_save_format(&canvas, TEST_FILE, CANVAS_FORMAT_V2), 0, "Saved as V2");
+        canvas_cleanup(&canvas);
+
+        FILE *f = fopen(TEST_FILE, "rb");
+        char data[8192];
+        size_t size = f ? fread(data, 1, sizeof(data), f) : 0;
+        if (f) fclose(f);
+        ASSERT(size > 200 && size < sizeof(data), "Whole file read");
+
+        int failures = 0;
+        const size_t cuts[] = {10, 30, 100, size / 2, size - 1};
+        for (size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); i++) {
+            f = fopen(TEST_FILE, "wb");
+            fwrite(data, 1, cuts[i], f);
+            fclose(f);
+            Canvas loaded;
+            canvas_init(&loaded, 0.0, 0.0);
+            failures += canvas_load(&loaded, TEST_FILE) != 0;
+            canvas_cleanup(&loaded);
+        }
+        ASSERT_EQ(failures, 5, "Every truncation rejected");
+
+        /* A huge box count in an otherwise intact file: the boxes
+         * section's offset is the second table entry's u64 at 8 */
+        size_t boxes_at = 0;
+        for (int i = 7; i >= 0; i--) {
+            boxes_at = boxes_at << 8 | (unsigned char)data[16 + 8 + 24 + 8 + i];
+        }
+        memset(data + boxes_at, 0xFF, 4);
+        f = fopen(TEST_FILE, "wb");
+        fwrite(data, 1, size, f);
+        fclose(f);
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        int result = canvas_load(&loaded, TEST_FILE);
+        canvas_cleanup(&loaded);
+        ASSERT_EQ(result, -1, "Impossible box count rejected");
+    }
+
+    TEST("Text format keeps long, blank and indented lines whole") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int id = canvas_add_box(&canvas, 12.5, -3.25, 30, 10, "Lines");
+        char long_line[5000];
+        memset(long_line, 'y', sizeof(long_line) - 1);
+        long_line[sizeof(long_line) - 1] = '\0';
+        const char *lines[] = {long_line, "", "   indented", "7", "tail\r"};
+        canvas_add_box_content(&canvas, id, lines, 5);
+        ASSERT_EQ(canvas_save(&canvas, TEST_FILE), 0, "Saved as V1");
+        canvas_cleanup(&canvas);
+
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), 0, "Loaded");
+        Box *box = canvas_get_box(&loaded, id);
+        ASSERT(box != NULL, "Box restored");
+        if (box) {
+            ASSERT(box->x == 12.5 && box->y == -3.25, "Position restored");
+            ASSERT_EQ(box_content_count(box), 5, "Every line restored");
+            ASSERT_EQ((int)box_content_line_length(box, 0), 4999, "Long line not split");
+            ASSERT_STR_EQ(box_content_line(box, 1), "", "Blank line kept");
+            ASSERT_STR_EQ(box_content_line(box, 2), "   indented", "Leading spaces kept");
+            ASSERT_STR_EQ(box_content_line(box, 3), "7", "Number-like line kept as text");
+            ASSERT_STR_EQ(box_content_line(box, 4), "tail\r", "Carriage return kept");
+        }
+        ASSERT_STR_EQ(persistence_last_error(), "", "No error after a good load");
+        canvas_cleanup(&loaded);
+    }
+
+    TEST("Malformed text files report the line and column") {
+        FILE *f = fopen(TEST_FILE, "w");
+        fputs("BOXES_CANVAS_V1\n100.00 100.00\n1\n1 10.00 oops 20 5 0 0\nTitle\n0\n", f);
+        fclose(f);
+        Canvas loaded;
+        canvas_init(&loaded, 0.0, 0.0);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), -1, "Bad number rejected");
+        ASSERT_STR_EQ(persistence_last_error(), "line 4, column 9: expected a number",
+                      "Error points at the bad field");
+
+        f = fopen(TEST_FILE, "w");
+        fputs("BOXES_CANVAS_V1\n100.00 100.00\n2\n1 10.00 5.00 20 5 0 0\nTitle\n3\na\nb\n", f);
+        fclose(f);
+        ASSERT_EQ(canvas_load(&loaded, TEST_FILE), -1, "Short content rejected");
+        ASSERT_STR_EQ(persistence_last_error(), "line 9, column 1: file ends inside a box's content",
+                      "Error points at the end of the file");
+        canvas_cleanup(&loaded);
+    }
+
     /* Cleanup test file */
     unlink(TEST_FILE);
 
@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/box_content.h"
+#include "../include/journal.h"
+#include "../include/persistence.h"
+#include "../include/reloader.h"
+#include "../include/undo.h"
+
+#define RELOAD_FILE "test_reloader_temp.txt"
+
+/* Run a reload to the end, as the main loop does between frames */
+static int reload(Reloader *reloader, Canvas *canvas, const char *path) {
+    int result = reloader_start(reloader, canvas, path);
+    while (result > 0 && reloader_busy(reloader)) {
+        struct timespec pause = {0, 1000000};
+        nanosleep(&pause, NULL);
+        int polled = reloader_poll(reloader, canvas);
+        if (polled != 0) {
+            result = polled;
+        }
+    }
+    return result < 0 ? -1 : 0;
+}
+
+static const char *line_at(const Box *box, int i) {
+    const char *line = box_content_line(box, i);
+    return line ? line : "(none)";
+}
+
+static void setup_canvas(Canvas *canvas, int boxes) {
+    canvas_init(canvas, 1000.0, 1000.0);
+    for (int i = 0; i < boxes; i++) {
+        int id = canvas_add_box(canvas, (i % 100) * 30.0, (i / 100) * 20.0, 25, 8, "Box");
+        const char *lines[] = {"first line", "second line"};
+        canvas_add_box_content(canvas, id, lines, 2);
+        if (i > 0) {
+            canvas_add_connection(canvas, id - 1, id);
+        }
+    }
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("Reload applies only what changed in the file") {
+        Canvas canvas;
+        setup_canvas(&canvas, 500);
+        canvas_save(&canvas, RELOAD_FILE);
+
+        /* A connector rewrites the file with a few changes */
+        Canvas file;
+        file.boxes = NULL;
+        canvas_load(&file, RELOAD_FILE);
+        canvas_move_box(&file, 5, 400.0, 300.0);
+        Box *box = canvas_get_box(&file, 6);
+        free(box->title);
+        box->title = strdup("Renamed");
+        const char *lines[] = {"new", "lines", "here"};
+        box_content_set(canvas_get_box(&file, 8), lines, 3);
+        canvas_remove_box(&file, 7);
+        int added = canvas_add_box(&file, 900.0, 900.0, 20, 5, "Added");
+        canvas_add_connection(&file, added, 1);
+        canvas_save(&file, RELOAD_FILE);
+        canvas_cleanup(&file);
+
+        /* Meanwhile the user selected a box and has something to undo */
+        canvas_select_box(&canvas, 3);
+        undo_record_box_move(&canvas, 2, 30.0, 0.0, 35.0, 0.0);
+        canvas_move_box(&canvas, 2, 35.0, 0.0);
+        int undo_size = canvas.undo_stack.size;
+
+        Reloader reloader;
+        reloader_init(&reloader);
+        int result = reload(&reloader, &canvas, RELOAD_FILE);
+        ASSERT_EQ(result, 0, "Reloaded");
+        ASSERT(reloader.applied > 0 && reloader.applied < 20, "Only the changes applied");
+
+        ASSERT_NEAR(canvas_get_box(&canvas, 5)->x, 400.0, 0.001, "Moved");
+        ASSERT_STR_EQ(canvas_get_box(&canvas, 6)->title, "Renamed", "Retitled");
+        ASSERT_STR_EQ(line_at(canvas_get_box(&canvas, 8), 2), "here", "New content");
+        ASSERT(canvas_get_box(&canvas, 7) == NULL, "Deleted");
+        ASSERT(canvas_get_box(&canvas, added) != NULL, "Added");
+        ASSERT(canvas_find_connection(&canvas, added, 1) >= 0, "Connected");
+        ASSERT_EQ(canvas.box_count, 500, "Box count");
+
+        ASSERT(canvas_get_selected(&canvas) == canvas_get_box(&canvas, 3), "Selection kept");
+        ASSERT_EQ(canvas.undo_stack.size, undo_size, "Undo history kept");
+        ASSERT_NEAR(canvas_get_box(&canvas, 2)->x, 30.0, 0.001, "The file wins for boxes it has");
+
+        reloader_cleanup(&reloader);
+        canvas_cleanup(&canvas);
+        unlink(RELOAD_FILE);
+    }
+
+    TEST("An unchanged file changes nothing") {
+        Canvas canvas;
+        setup_canvas(&canvas, 50);
+        canvas.document = strdup("notes");
+        canvas_save(&canvas, RELOAD_FILE);
+
+        Canvas file;
+        file.boxes = NULL;
+        canvas_load(&file, RELOAD_FILE);
+        size_t len = 99;
+        char *records = journal_diff(&canvas, &file, &len);
+        ASSERT(records != NULL && len == 0, "Empty diff");
+        free(records);
+        canvas_cleanup(&file);
+
+        Reloader reloader;
+        reloader_init(&reloader);
+        int result = reload(&reloader, &canvas, RELOAD_FILE);
+        ASSERT_EQ(result, 0, "Reloaded");
+        ASSERT_EQ(reloader.applied, 0, "Nothing applied");
+
+        reloader_cleanup(&reloader);
+        canvas_cleanup(&canvas);
+        unlink(RELOAD_FILE);
+    }
+
+    TEST("Command boxes keep their live output") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "Cmd");
+        Box *box = canvas_get_box(&canvas, id);
+        box->content_type = BOX_CONTENT_COMMAND;
+        box->command = strdup("date");
+        const char *saved[] = {"old output"};
+        box_content_set(box, saved, 1);
+        canvas_save(&canvas, RELOAD_FILE);
+
+        const char *live[] = {"new output"};
+        box_content_set(canvas_get_box(&canvas, id), live, 1);
+        Reloader reloader;
+        reloader_init(&reloader);
+        int result = reload(&reloader, &canvas, RELOAD_FILE);
+        ASSERT_EQ(result, 0, "Reloaded");
+        ASSERT_STR_EQ(line_at(canvas_get_box(&canvas, id), 0), "new output", "Output kept");
+
+        reloader_cleanup(&reloader);
+        canvas_cleanup(&canvas);
+        unlink(RELOAD_FILE);
+    }
+
+    TEST("A file that cannot be loaded leaves the canvas alone") {
+        Canvas canvas;
+        setup_canvas(&canvas, 5);
+        Reloader reloader;
+        reloader_init(&reloader);
+        int result = reload(&reloader, &canvas, "test_reloader_missing.txt");
+        ASSERT_EQ(result, -1, "Failed");
+        ASSERT_EQ(canvas.box_count, 5, "Canvas kept");
+        ASSERT(!reloader_busy(&reloader), "Idle again");
+
+        reloader_cleanup(&reloader);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST_END();
+}
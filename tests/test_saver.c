@@ -0,0 +1,104 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test.h"
+#include "../include/canvas.h"
+#include "../include/persistence.h"
+#include "../include/saver.h"
+
+#define SAVER_FILE "test_saver_temp.txt"
+#define SAVER_MISSING_DIR "test_saver_missing_dir/canvas.txt"
+
+static int boxes_in(const char *path) {
+    Canvas loaded;
+    loaded.boxes = NULL;
+    if (canvas_load(&loaded, path) != 0) {
+        return -1;
+    }
+    int count = loaded.box_count;
+    canvas_cleanup(&loaded);
+    return count;
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("A background save writes the canvas as it was when started") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "One");
+        Saver saver;
+        saver_init(&saver);
+
+        int started = saver_start(&saver, &canvas, SAVER_FILE, CANVAS_FORMAT_V1);
+        ASSERT(started >= 0, "Started");
+        /* Edits after the start are not in this save */
+        canvas_add_box(&canvas, 30.0, 0.0, 20, 5, "Two");
+        int result = saver_wait(&saver, &canvas);
+        ASSERT(started == 0 || result == 1, "Finished");
+        ASSERT(!saver_busy(&saver), "Idle again");
+        ASSERT_EQ(boxes_in(SAVER_FILE), 1, "Snapshot saved");
+
+        char message[128];
+        saver_describe(&saver, 1, message, sizeof(message));
+        ASSERT_STR_EQ(message, "Saved " SAVER_FILE, "Reported");
+
+        saver_cleanup(&saver, &canvas);
+        canvas_cleanup(&canvas);
+        unlink(SAVER_FILE);
+    }
+
+    TEST("A save requested during another runs after it") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "One");
+        Saver saver;
+        saver_init(&saver);
+
+        saver_start(&saver, &canvas, SAVER_FILE, CANVAS_FORMAT_V1);
+        canvas_add_box(&canvas, 30.0, 0.0, 20, 5, "Two");
+        saver_start(&saver, &canvas, SAVER_FILE, CANVAS_FORMAT_V1);
+        canvas_add_box(&canvas, 60.0, 0.0, 20, 5, "Three");
+        saver_wait(&saver, &canvas);
+        int count = boxes_in(SAVER_FILE);
+        ASSERT(count >= 2, "Second save written");
+
+        saver_cleanup(&saver, &canvas);
+        canvas_cleanup(&canvas);
+        unlink(SAVER_FILE);
+    }
+
+    TEST("A failed save is reported with its reason") {
+        Canvas canvas;
+        canvas_init(&canvas, 1000.0, 1000.0);
+        canvas_add_box(&canvas, 0.0, 0.0, 20, 5, "One");
+        Saver saver;
+        saver_init(&saver);
+
+        int result = saver_start(&saver, &canvas, SAVER_MISSING_DIR, CANVAS_FORMAT_V1);
+        if (result > 0) {
+            result = saver_wait(&saver, &canvas);
+        }
+        ASSERT_EQ(result, -1, "Failed");
+        ASSERT_EQ(saver.error, ENOENT, "With the reason");
+        char message[128];
+        saver_describe(&saver, result, message, sizeof(message));
+        ASSERT(strstr(message, "Save failed: " SAVER_MISSING_DIR) == message, "Reported");
+
+        /* canvas_save() itself never leaves a half-written file */
+        ASSERT_EQ(canvas_save(&canvas, SAVER_FILE), 0, "Save");
+        ASSERT_EQ(boxes_in(SAVER_FILE), 1, "Saved");
+        char tmp[64];
+        snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", SAVER_FILE, (long)getpid());
+        ASSERT(access(tmp, F_OK) != 0, "Written under a temporary name, then renamed");
+
+        saver_cleanup(&saver, &canvas);
+        canvas_cleanup(&canvas);
+        unlink(SAVER_FILE);
+    }
+
+    TEST_END();
+}
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include "test.h"
+#include "../include/spatial_index.h"
+#include "../include/canvas.h"
+#include "../include/undo.h"
+#include "../include/types.h"
+
+/* Collects visited box IDs for assertions */
+typedef struct {
+    int ids[64];
+    int count;
+} Visited;
+
+static void collect(int box_id, void *ctx) {
+    Visited *v = ctx;
+    if (v->count < 64) {
+        v->ids[v->count] = box_id;
+    }
+    v->count++;
+}
+
+static int contains(const Visited *v, int id) {
+    for (int i = 0; i < v->count && i < 64; i++) {
+        if (v->ids[i] == id) return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    TEST_START();
+
+    TEST("Point query finds containing boxes only") {
+        SpatialIndex index;
+        spatial_index_init(&index, 10.0);
+
+        spatial_index_insert(&index, 1, 0.0, 0.0, 20.0, 5.0);
+        spatial_index_insert(&index, 2, 15.0, 0.0, 20.0, 5.0);
+        spatial_index_insert(&index, 3, 100.0, 100.0, 5.0, 5.0);
+
+        Visited v = {{0}, 0};
+        spatial_index_visit_point(&index, 17.0, 2.0, collect, &v);
+        ASSERT_EQ(v.count, 2, "Two overlapping boxes contain the point");
+        ASSERT(contains(&v, 1) && contains(&v, 2), "Both overlapping boxes reported");
+
+        v.count = 0;
+        spatial_index_visit_point(&index, 50.0, 50.0, collect, &v);
+        ASSERT_EQ(v.count, 0, "Empty area has no boxes");
+
+        v.count = 0;
+        spatial_index_visit_point(&index, 105.0, 105.0, collect, &v);
+        ASSERT_EQ(v.count, 1, "Far corner edge is inclusive");
+
+        spatial_index_free(&index);
+    }
+
+    TEST("Rect query reports multi-cell boxes exactly once") {
+        SpatialIndex index;
+        spatial_index_init(&index, 10.0);
+
+        /* Spans 6x6 cells */
+        spatial_index_insert(&index, 7, 5.0, 5.0, 50.0, 50.0);
+        spatial_index_insert(&index, 8, 200.0, 0.0, 5.0, 5.0);
+
+        Visited v = {{0}, 0};
+        spatial_index_visit_rect(&index, 0.0, 0.0, 60.0, 60.0, collect, &v);
+        ASSERT_EQ(v.count, 1, "Large box reported once");
+        ASSERT(contains(&v, 7), "Large box found");
+
+        v.count = 0;
+        spatial_index_visit_rect(&index, 30.0, 30.0, 35.0, 35.0, collect, &v);
+        ASSERT_EQ(v.count, 1, "Query inside a large box finds it");
+
+        spatial_index_free(&index);
+    }
+
+    TEST("Update and remove keep the grid consistent") {
+        SpatialIndex index;
+        spatial_index_init(&index, 10.0);
+
+        spatial_index_insert(&index, 1, 0.0, 0.0, 5.0, 5.0);
+        spatial_index_update(&index, 1, 500.0, 500.0, 5.0, 5.0);
+
+        Visited v = {{0}, 0};
+        spatial_index_visit_point(&index, 2.0, 2.0, collect, &v);
+        ASSERT_EQ(v.count, 0, "Old position no longer matches");
+
+        spatial_index_visit_point(&index, 502.0, 502.0, collect, &v);
+        ASSERT_EQ(v.count, 1, "New position matches");
+
+        ASSERT_EQ(spatial_index_remove(&index, 1), 0, "Remove succeeds");
+        ASSERT_EQ(spatial_index_remove(&index, 1), -1, "Second remove fails");
+        ASSERT_EQ(index.entry_count, 0, "No entries left after remove");
+
+        spatial_index_free(&index);
+    }
+
+    TEST("Far-away, huge and NaN bounds stay cheap") {
+        SpatialIndex index;
+        spatial_index_init(&index, SPATIAL_CELL_SIZE);
+
+        /* Cell INT_MAX unclamped: the cell loop used to wrap around */
+        ASSERT_EQ(spatial_index_insert(&index, 1, 68719476704.0, 0.0, 20.0, 5.0), 0, "Far box");
+        Visited v = {{0}, 0};
+        spatial_index_visit_point(&index, 68719476710.0, 1.0, collect, &v);
+        ASSERT(v.count == 1 && contains(&v, 1), "Far box found");
+
+        /* Tens of millions of cells: one entry on the large list */
+        int entries = index.entry_count;
+        ASSERT_EQ(spatial_index_insert(&index, 2, 0.0, 0.0, 2e9, 10.0), 0, "Huge box");
+        ASSERT_EQ(index.large_count, 1, "On the large list");
+        ASSERT_EQ(index.entry_count, entries, "No cells registered");
+        v.count = 0;
+        spatial_index_visit_point(&index, 1e9, 5.0, collect, &v);
+        ASSERT(v.count == 1 && contains(&v, 2), "Point query finds it");
+        v.count = 0;
+        spatial_index_visit_rect(&index, 100.0, 0.0, 110.0, 10.0, collect, &v);
+        ASSERT(v.count == 1 && contains(&v, 2), "Rect query finds it once");
+
+        spatial_index_update(&index, 2, 0.0, 0.0, 20.0, 5.0);
+        ASSERT_EQ(index.large_count, 0, "Shrunk back into the grid");
+        v.count = 0;
+        spatial_index_visit_point(&index, 10.0, 2.0, collect, &v);
+        ASSERT(v.count == 1 && contains(&v, 2), "Found in its cells");
+
+        ASSERT_EQ(spatial_index_insert(&index, 3, NAN, NAN, 20.0, 5.0), 0, "NaN box");
+        v.count = 0;
+        spatial_index_visit_rect(&index, -1e12, -1e12, 1e12, 1e12, collect, &v);
+        ASSERT(!contains(&v, 3), "NaN box matches nothing");
+        ASSERT_EQ(spatial_index_remove(&index, 3), 0, "NaN box removed");
+        ASSERT_EQ(spatial_index_remove(&index, 2), 0, "Removed");
+        ASSERT_EQ(spatial_index_remove(&index, 1), 0, "Removed");
+        ASSERT_EQ(index.entry_count, 0, "Nothing left");
+
+        spatial_index_free(&index);
+    }
+
+    TEST("Many boxes survive bucket growth") {
+        SpatialIndex index;
+        spatial_index_init(&index, 10.0);
+
+        for (int i = 0; i < 2000; i++) {
+            spatial_index_insert(&index, i + 1, (i % 50) * 20.0, (i / 50) * 20.0, 8.0, 8.0);
+        }
+
+        int misses = 0;
+        for (int i = 0; i < 2000; i++) {
+            Visited v = {{0}, 0};
+            spatial_index_visit_point(&index, (i % 50) * 20.0 + 4.0, (i / 50) * 20.0 + 4.0,
+                                      collect, &v);
+            if (v.count != 1 || v.ids[0] != i + 1) misses++;
+        }
+        ASSERT_EQ(misses, 0, "Every box is found at its own position");
+
+        spatial_index_free(&index);
+    }
+
+    TEST("Canvas hit-testing returns the topmost box") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int bottom = canvas_add_box(&canvas, 0.0, 0.0, 30, 10, "Bottom");
+        int top = canvas_add_box(&canvas, 10.0, 2.0, 30, 10, "Top");
+
+        ASSERT_EQ(canvas_find_box_at(&canvas, 15.0, 5.0), top, "Overlap resolves to later box");
+        ASSERT_EQ(canvas_find_box_at(&canvas, 2.0, 2.0), bottom, "Non-overlapping part hits bottom");
+
+        canvas_remove_box(&canvas, top);
+        ASSERT_EQ(canvas_find_box_at(&canvas, 15.0, 5.0), bottom, "Removed box no longer hit");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Canvas move, resize and undo update the index") {
+        Canvas canvas;
+        canvas_init(&canvas, 200.0, 100.0);
+
+        int id = canvas_add_box(&canvas, 0.0, 0.0, 10, 5, "Box");
+
+        canvas_move_box(&canvas, id, 300.0, 300.0);
+        ASSERT_EQ(canvas_find_box_at(&canvas, 2.0, 2.0), -1, "Old position empty after move");
+        ASSERT_EQ(canvas_find_box_at(&canvas, 305.0, 302.0), id, "Box found at new position");
+
+        canvas_resize_box(&canvas, id, 100, 50);
+        ASSERT_EQ(canvas_find_box_at(&canvas, 390.0, 340.0), id, "Resized area is hit");
+
+        undo_record_box_move(&canvas, id, 300.0, 300.0, 600.0, 600.0);
+        canvas_move_box(&canvas, id, 600.0, 600.0);
+        canvas_undo(&canvas);
+        ASSERT_EQ(canvas_find_box_at(&canvas, 305.0, 302.0), id, "Undo move re-indexes box");
+        ASSERT_EQ(canvas_find_box_at(&canvas, 605.0, 602.0), -1, "Redo position empty after undo");
+
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Canvas viewport query returns visible boxes in draw order") {
+        Canvas canvas;
+        canvas_init(&canvas, 10000.0, 10000.0);
+
+        for (int i = 0; i < 1000; i++) {
+            canvas_add_box(&canvas, (i % 100) * 100.0, (i / 100) * 100.0, 20, 5, "Box");
+        }
+
+        int *indices = NULL;
+        int capacity = 0;
+        int count = canvas_query_boxes(&canvas, 0.0, 0.0, 250.0, 150.0, &indices, &capacity);
+        ASSERT_EQ(count, 6, "Only the 3x2 boxes in view are returned");
+
+        int sorted = 1;
+        for (int i = 1; i < count; i++) {
+            if (indices[i - 1] >= indices[i]) sorted = 0;
+        }
+        ASSERT(sorted, "Indices are in draw order");
+
+        free(indices);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST("Linear geometry scan matches the grid query") {
+        Canvas canvas;
+        canvas_init(&canvas, 10000.0, 10000.0);
+
+        unsigned int seed = 7;
+        for (int i = 0; i < 500; i++) {
+            seed = seed * 1103515245u + 12345u;
+            canvas_add_box(&canvas, (seed % 2000u) * 1.0, ((seed >> 11) % 2000u) * 1.0,
+                           5 + (int)(seed % 40u), 3 + (int)((seed >> 5) % 10u), NULL);
+        }
+        /* Free some slots and move some boxes so the table has holes */
+        for (int id = 1; id <= 500; id += 7) {
+            canvas_remove_box(&canvas, id);
+        }
+        for (int id = 2; id <= 500; id += 11) {
+            canvas_move_box(&canvas, id, 100.0 + id, 100.0);
+        }
+
+        int *grid = NULL, *scan = NULL;
+        int grid_cap = 0, scan_cap = 0;
+        int mismatches = 0;
+        for (int q = 0; q < 50; q++) {
+            double x0 = (q * 37) % 1800;
+            double y0 = (q * 53) % 1800;
+            int ng = canvas_query_boxes(&canvas, x0, y0, x0 + 80.0, y0 + 24.0, &grid, &grid_cap);
+            int ns = canvas_scan_boxes(&canvas, x0, y0, x0 + 80.0, y0 + 24.0, &scan, &scan_cap);
+            if (ng != ns) {
+                mismatches++;
+                continue;
+            }
+            for (int i = 0; i < ng; i++) {
+                if (grid[i] != scan[i]) mismatches++;
+            }
+        }
+        ASSERT_EQ(mismatches, 0, "Scan and grid return the same slots in draw order");
+
+        free(grid);
+        free(scan);
+        canvas_cleanup(&canvas);
+    }
+
+    TEST_END();
+}